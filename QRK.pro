@@ -1,6 +1,6 @@
 TEMPLATE=subdirs
 
-SUBDIRS=qrkcore plugins src UnitTests
+SUBDIRS=qrkcore plugins src consolidate UnitTests
 
 RESOURCES += \
     src/qrk.qrc
@@ -26,7 +26,8 @@ TARGET = QRK-UnitTests
 TEMPLATE = app qt
 
 QT += core testlib
-QT -= gui
+QT += gui
+QT += sql
 
 # The following define makes your compiler emit warnings if you use
 # any feature of Qt which as been marked as deprecated (the exact warnings
@@ -43,12 +44,19 @@ DEFINES += QT_DEPRECATED_WARNINGS
 #QMAKE_LFLAGS += -Wl,--rpath=../qrkcore
 CONFIG += console warn_off no_testcase_installs
 
-SOURCES += test-main.cpp
+SOURCES += test-main.cpp \
+    ../consolidate/consolidator.cpp \
+    ../plugins/chart/salesanalytics.cpp \
+    ../src/import/csvreader.cpp \
+    ../src/receiptdetailcache.cpp
 
-HEADERS +=
+HEADERS += ../consolidate/consolidator.h \
+    ../plugins/chart/salesanalytics.h \
+    ../src/import/csvreader.h \
+    ../src/receiptdetailcache.h
 
-INCLUDEPATH += $$SRC_DIR/qrkcore
-DEPENDPATH += $$SRC_DIR/qrkcore
+INCLUDEPATH += $$SRC_DIR/qrkcore $$SRC_DIR/consolidate $$SRC_DIR/plugins/chart $$SRC_DIR/src
+DEPENDPATH += $$SRC_DIR/qrkcore $$SRC_DIR/consolidate $$SRC_DIR/plugins/chart $$SRC_DIR/src
 
 DEFINES += QT_DEPRECATED_WARNINGS
 
@@ -30,13 +30,583 @@
 
 #include "RK/rk_signaturemodule.h"
 #include "RK/rk_signaturemodulefactory.h"
+#include "RK/rk_signaturesession.h"
+#include "RK/rk_smartcardinfo.h"
+#include "RK/rk_turnovercrypto.h"
 
 #include "3rdparty/qbcmath/bcmath.h"
+#include "3rdparty/ckvsoft/ckvtemplate.h"
+#include "utils/metrics.h"
+#include "utils/qrcode.h"
+#include "utils/jsonimportfile.h"
+#include "utils/utils.h"
+#include "queryprofiler.h"
+#include "database.h"
+#include "databasemanager.h"
+#include "journalpartitions.h"
+#include "registerstatistics.h"
+#include "consolidator.h"
+#include "salesanalytics.h"
+#include "receiptdetailcache.h"
+#include "import/csvreader.h"
+#include "preferences/qrksettings.h"
 
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QMessageAuthenticationCode>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSet>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QSqlRecord>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTextCodec>
+#include <QThread>
+#include <QThreadPool>
 #include <QtTest/QTest>
+#include <QtEndian>
+
+/* the Crypto++ pipelines RKSignatureModule used before RKTurnoverCrypto,
+ * kept here as reference for byte identical output */
+namespace Reference {
+
+QByteArray hashValue(QString value)
+{
+    CryptoPP::SHA256 hash;
+    std::string digest;
+    CryptoPP::StringSource s(value.toStdString(), true, new CryptoPP::HashFilter(hash, new CryptoPP::HexEncoder(new CryptoPP::StringSink(digest))));
+    return QByteArray::fromStdString(digest);
+}
+
+QString encryptCTR(std::string hashValue, qlonglong turnoverCounter, std::string symmetricKey)
+{
+    qlonglong source = qToBigEndian(turnoverCounter);
+    unsigned char key[CryptoPP::AES::MAX_KEYLENGTH], iv[CryptoPP::AES::BLOCKSIZE], out[8];
+    CryptoPP::StringSource ssk(symmetricKey, true, new CryptoPP::HexDecoder(new CryptoPP::ArraySink(key, CryptoPP::AES::MAX_KEYLENGTH)));
+    CryptoPP::StringSource ssv(hashValue, true, new CryptoPP::HexDecoder(new CryptoPP::ArraySink(iv, CryptoPP::AES::BLOCKSIZE)));
+    CryptoPP::CTR_Mode<CryptoPP::AES>::Encryption encryption(key, sizeof(key), iv, sizeof(iv));
+    encryption.ProcessData(out, reinterpret_cast<const unsigned char *>(&source), sizeof(out));
+    return QByteArray(reinterpret_cast<const char *>(out), sizeof(out)).toBase64();
+}
+
+QString decryptCTR(std::string hashValue, QString encryptedTurnoverCounter, std::string symmetricKey)
+{
+    std::string hex = QByteArray::fromBase64(encryptedTurnoverCounter.toUtf8()).toHex().toStdString();
+    unsigned char key[CryptoPP::AES::MAX_KEYLENGTH], iv[CryptoPP::AES::BLOCKSIZE];
+    unsigned char data[CryptoPP::AES::BLOCKSIZE], recovered[CryptoPP::AES::BLOCKSIZE];
+    memset(data, 0x00, sizeof(data));
+    CryptoPP::StringSource ssk(symmetricKey, true, new CryptoPP::HexDecoder(new CryptoPP::ArraySink(key, CryptoPP::AES::MAX_KEYLENGTH)));
+    CryptoPP::StringSource ssv(hashValue, true, new CryptoPP::HexDecoder(new CryptoPP::ArraySink(iv, CryptoPP::AES::BLOCKSIZE)));
+    CryptoPP::StringSource ssd(hex, true, new CryptoPP::HexDecoder(new CryptoPP::ArraySink(data, CryptoPP::AES::BLOCKSIZE)));
+    CryptoPP::CTR_Mode<CryptoPP::AES>::Decryption decryption(key, sizeof(key), iv, sizeof(iv));
+    decryption.ProcessData(recovered, data, CryptoPP::AES::BLOCKSIZE);
+    return QString::number(qFromBigEndian<qint64>(recovered));
+}
+
+/* the server mode import loader before JsonImportFile */
+QJsonObject loadJSonFile(const QString &filename, const QString &codecName)
+{
+    QFile file(filename);
+    file.open(QIODevice::ReadOnly | QIODevice::Text);
+    QByteArray receiptInfo = file.readAll();
+    file.close();
+    if (!receiptInfo.startsWith('{')) {
+        int begin = receiptInfo.indexOf('{');
+        int end = receiptInfo.lastIndexOf('}') - begin + 1;
+        receiptInfo = receiptInfo.mid(begin,end);
+    }
+
+    QTextCodec *codec = QTextCodec::codecForName(codecName.toUtf8());
+    QString json = codec->toUnicode(receiptInfo);
+    return QJsonDocument::fromJson(json.toUtf8()).object();
+}
+
+}
+
+static void writeImportFiles(const QString &path, int files, int items, const char *codec)
+{
+    for (int f = 0; f < files; f++) {
+        QJsonArray itemArray;
+        for (int i = 0; i < items; i++) {
+            QJsonObject item;
+            item["count"] = QString::number(i % 3 + 1);
+            item["name"] = QString("Käsekrainer %1").arg(i);
+            item["gross"] = QString("1.%1,50").arg(i % 10, 3, 10, QChar('0'));
+            item["net"] = QString("%1,25").arg(i);
+            item["tax"] = "20,00";
+            itemArray.append(item);
+        }
+        QJsonObject receipt;
+        receipt["payedBy"] = "0";
+        receipt["customerText"] = "Tisch 4";
+        receipt["items"] = itemArray;
+        QJsonObject root;
+        root["receipt"] = QJsonArray() << receipt;
+
+        QFile file(QString("%1/%2.json").arg(path).arg(f));
+        file.open(QIODevice::WriteOnly);
+        file.write("HTTP/1.1 200 OK\r\n\r\n");
+        file.write(QTextCodec::codecForName(codec)->fromUnicode(QString::fromUtf8(QJsonDocument(root).toJson())));
+        file.write("\r\n--end--");
+    }
+}
+
+/* the second row holds a field with a line break and escaped quotes */
+static const char *csvText = "Nr;Name;Preis\r\n"
+                             "1;\"Äpfel; rot\";1,50\r\n"
+                             "2;\"Birne\r\n"
+                             "mit \"\"Stiel\"\"\";2,00\r\n"
+                             "3;Kiwi;0,80\r\n";
+
+static QList<QStringList> readCsv(const CsvImportSource &source, QStringList &header)
+{
+    QList<QStringList> rows;
+    CsvReader reader(source);
+    if (!reader.open())
+        return rows;
+
+    header = reader.header();
+    QStringList row;
+    while (reader.nextRow(row))
+        rows << row;
+
+    return rows;
+}
+
+/* runs month reports on the "RS" connection of the pool like the report
+ * dialogs do until it is stopped */
+class ReportReader : public QThread
+{
+    public:
+        ReportReader() : m_insertRefused(false) {}
+
+        void stop() { m_stop.storeRelease(1); }
+        int reports() const { return m_reports.loadAcquire(); }
+        bool insertRefused() const { return m_insertRefused; }
+        QString connectionName() const { return m_connectionName; }
+
+    protected:
+        void run()
+        {
+            QDateTime from(QDate(2019, 1, 1), QTime(0, 0));
+            QDateTime to(QDate(2019, 1, 31), QTime(23, 59, 59));
+
+            {
+                QSqlDatabase dbc = Database::readOnlyDatabase(true);
+                m_connectionName = dbc.connectionName();
+                if (dbc.isOpen()) {
+                    while (!m_stop.loadAcquire()) {
+                        RegisterStatistics statistics;
+                        if (!statistics.compute(dbc, from, to))
+                            break;
+                        m_reports.ref();
+                    }
+
+                    QSqlQuery query(dbc);
+                    m_insertRefused = !query.exec("INSERT INTO receipts (receiptNum, timestamp, infodate, payedBy, gross) VALUES (0, '2019-01-01T00:00:00', '2019-01-01T00:00:00', 0, 0)");
+                }
+            }
+            DatabaseManager::removeCurrentThread("RS");
+        }
+
+    private:
+        QAtomicInt m_stop;
+        QAtomicInt m_reports;
+        bool m_insertRefused;
+        QString m_connectionName;
+};
+
+/* books receipts with five orders each, one transaction per sale like
+ * ReceiptItemModel does, returns the mean commit latency in ns or -1 */
+static qint64 writeSales(QSqlDatabase &dbc, int first, int sales)
+{
+    QSqlQuery query(dbc);
+    QElapsedTimer timer;
+    qint64 elapsed = 0;
+
+    for (int receiptNum = first; receiptNum < first + sales; receiptNum++) {
+        timer.start();
+        dbc.transaction();
+        QString timestamp = QDateTime(QDate(2019, 1, 1 + receiptNum % 31), QTime(12, 0)).toString(Qt::ISODate);
+        query.prepare("INSERT INTO receipts (receiptNum, timestamp, infodate, payedBy, gross, net) VALUES (:receiptNum, :timestamp, :infodate, 0, 25, 0)");
+        query.bindValue(":receiptNum", receiptNum);
+        query.bindValue(":timestamp", timestamp);
+        query.bindValue(":infodate", timestamp);
+        if (!query.exec())
+            return -1;
+        for (int i = 0; i < 5; i++) {
+            query.prepare("INSERT INTO orders (receiptId, product, count, net, gross, tax) VALUES (:receiptId, 1, 1, 0, 5, :tax)");
+            query.bindValue(":receiptId", receiptNum);
+            query.bindValue(":tax", i % 2 ? 20 : 10);
+            if (!query.exec())
+                return -1;
+        }
+        if (!dbc.commit())
+            return -1;
+        elapsed += timer.nsecsElapsed();
+    }
+
+    return elapsed / sales;
+}
+
+/* points Database::getConnectionDefinition() at an SQLite file, the
+ * settings are written to the QStandardPaths test location */
+static void useSqliteDatabase(const QString &filename)
+{
+    QStandardPaths::setTestModeEnabled(true);
+    QCoreApplication::instance()->setProperty("configuration", "UnitTests");
+    QrkSettings settings;
+    settings.save2Settings("DB_type", "QSQLITE", false);
+    globalStringValues.insert("databasename", filename);
+}
+
+/* creates the tables of a new data file like Database::open does */
+static bool createSchema(QSqlDatabase &dbc)
+{
+    QFile f(":src/sql/QRK-sqlite.sql");
+    if (!f.open(QIODevice::ReadOnly))
+        return false;
+
+    QSqlQuery query(dbc);
+    QStringList commands = QString(f.readAll()).split(';', QString::SkipEmptyParts);
+    foreach (const QString &command, commands) {
+        if (command.trimmed().isEmpty())
+            continue;
+        if (!query.exec(command)) {
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " " << query.lastError().text();
+            return false;
+        }
+    }
+
+    return query.exec("INSERT INTO globals (name, value) VALUES('lastReceiptNum', 0)");
+}
+
+/* one order line of a receipt booked by bookReceipt */
+struct TestLine
+{
+    TestLine(int product, double count, double gross, double discount, double tax)
+        : product(product), count(count), gross(gross), discount(discount), tax(tax) {}
+    int product;
+    double count;
+    double gross;
+    double discount;
+    double tax;
+};
+
+/* writes a finished receipt and its order lines on the connection of the
+ * current thread and adds it to the running aggregates like
+ * ReceiptItemModel::completeReceipt does */
+static bool bookReceipt(int receiptNum, const QDateTime &timestamp, int payedBy, const QList<TestLine> &lines)
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+    if (!dbc.transaction())
+        return false;
+
+    query.prepare("INSERT INTO receipts (id, receiptNum, timestamp, infodate, payedBy, gross, net) VALUES (:id, :receiptNum, :timestamp, :infodate, :payedBy, 0, 0)");
+    query.bindValue(":id", receiptNum);
+    query.bindValue(":receiptNum", receiptNum);
+    query.bindValue(":timestamp", timestamp.toString(Qt::ISODate));
+    query.bindValue(":infodate", timestamp.toString(Qt::ISODate));
+    query.bindValue(":payedBy", payedBy);
+    bool ok = query.exec();
+
+    foreach (const TestLine &line, lines) {
+        if (!ok)
+            break;
+        query.prepare("INSERT INTO orders (receiptId, product, count, discount, net, gross, tax) VALUES (:receiptId, :product, :count, :discount, 0, :gross, :tax)");
+        query.bindValue(":receiptId", receiptNum);
+        query.bindValue(":product", line.product);
+        query.bindValue(":count", line.count);
+        query.bindValue(":discount", line.discount);
+        query.bindValue(":gross", line.gross);
+        query.bindValue(":tax", line.tax);
+        ok = query.exec();
+    }
+
+    ok = ok && Database::addSalesBreakdown(receiptNum) && Database::addProductSales(receiptNum);
+
+    if (!ok) {
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit();
+}
+
+/* sums the order lines one by one with QBCMath rounding like the reports did
+ * before salesBreakdown existed */
+static QMap<QString, QMap<double, double> > salesPerPaymentPerLine(QSqlDatabase &dbc, const QDateTime &from, const QDateTime &to)
+{
+    QMap<QString, QMap<double, double> > sales;
+    QSqlQuery query(dbc);
+    query.prepare("SELECT actionTypes.actionText, orders.tax, (orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount) as total from orders "
+                  " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
+                  " LEFT JOIN actionTypes on receipts.payedBy=actionTypes.actionId"
+                  " WHERE receipts.timestamp between :fromDate AND :toDate AND receipts.payedBy < 3"
+                  " ORDER BY receipts.payedBy, orders.tax");
+    query.bindValue(":fromDate", from.toString(Qt::ISODate));
+    query.bindValue(":toDate", to.toString(Qt::ISODate));
+    if (!query.exec())
+        return sales;
+
+    while (query.next()) {
+        QBCMath tax(query.value("tax").toString());
+        tax.round(2);
+        QBCMath total(query.value("total").toString());
+        total.round(2);
+        sales[query.value("actionText").toString()][tax.toDouble()] += total.toDouble();
+    }
+
+    return sales;
+}
+
+/* compares two sales maps in cents */
+static bool sameSales(const QMap<QString, QMap<double, double> > &a, const QMap<QString, QMap<double, double> > &b)
+{
+    if (a.keys() != b.keys())
+        return false;
+
+    QMap<QString, QMap<double, double> >::const_iterator i;
+    for (i = a.constBegin(); i != a.constEnd(); ++i) {
+        QMap<double, double> other = b.value(i.key());
+        if (i.value().keys() != other.keys())
+            return false;
+        QMap<double, double>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            if (qRound64(j.value() * 100) != qRound64(other.value(j.key()) * 100))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+/* returns the rows of a query, the columns separated by blanks */
+static QStringList selectRows(QSqlDatabase &dbc, const QString &sql)
+{
+    QStringList rows;
+    QSqlQuery query(dbc);
+    query.exec(sql);
+    while (query.next()) {
+        QStringList columns;
+        for (int i = 0; i < query.record().count(); i++)
+            columns << query.value(i).toString();
+        rows << columns.join(' ');
+    }
+
+    return rows;
+}
+
+/* figures of one register as its report has to show them, in cents */
+struct RegisterFigures
+{
+    RegisterFigures() : products(0), payments(0), gross(0) {}
+    double products;
+    int payments;
+    qint64 gross;
+    QMap<double, qint64> perTax;
+};
+
+/* books receipts in January 2019 into a new register database and fills
+ * salesBreakdown like schema update 23 does */
+static bool writeRegister(QSqlDatabase &dbc, const QString &cashRegisterId, int receipts, int seed, RegisterFigures &figures)
+{
+    if (!createSchema(dbc))
+        return false;
+
+    QSqlQuery query(dbc);
+    bool ok = query.exec("INSERT INTO globals (name, value) VALUES('schemaVersion', 26)");
+    ok = ok && query.exec(QString("INSERT INTO globals (name, strValue) VALUES('shopCashRegisterId', '%1')").arg(cashRegisterId));
+    ok = ok && query.exec("INSERT INTO products (itemnum, barcode, name, net, gross) VALUES ('1', '', 'Wurst', 0, 0), ('2', '', 'Bier', 0, 0), ('3', '', 'Kaffee', 0, 0)");
+    if (!ok || !dbc.transaction())
+        return false;
+
+    for (int receiptNum = 1; ok && receiptNum <= receipts; receiptNum++) {
+        qint64 gross = 0;
+        for (int line = 0; ok && line < 2; line++) {
+            int product = (receiptNum + seed + line) % 3 + 1;
+            int count = 1 + (receiptNum + line) % 2;
+            qint64 price = 150 * product + 10 * seed;
+            double tax = (product == 2) ? 20.0 : 10.0;
+
+            query.prepare("INSERT INTO orders (receiptId, product, count, net, gross, tax) VALUES (:receiptId, :product, :count, 0, :gross, :tax)");
+            query.bindValue(":receiptId", receiptNum);
+            query.bindValue(":product", product);
+            query.bindValue(":count", count);
+            query.bindValue(":gross", price / 100.0);
+            query.bindValue(":tax", tax);
+            ok = query.exec();
+
+            gross += count * price;
+            figures.perTax[tax] += count * price;
+            figures.products += count;
+        }
+
+        QString timestamp = QDateTime(QDate(2019, 1, 1 + receiptNum % 31), QTime(8 + receiptNum % 12, 30)).toString(Qt::ISODate);
+        query.prepare("INSERT INTO receipts (timestamp, infodate, receiptNum, payedBy, gross, net) VALUES (:timestamp, :infodate, :receiptNum, :payedBy, :gross, 0)");
+        query.bindValue(":timestamp", timestamp);
+        query.bindValue(":infodate", timestamp);
+        query.bindValue(":receiptNum", receiptNum);
+        query.bindValue(":payedBy", receiptNum % 3);
+        query.bindValue(":gross", gross / 100.0);
+        ok = ok && query.exec();
+
+        figures.payments++;
+        figures.gross += gross;
+    }
+
+    if (!ok) {
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit() && Database::rebuildSalesBreakdown(dbc);
+}
+
+/* journal rows 1 - 4 are the header, rows 5 .. 4 + rows are spread over
+ * year. Existing rows are kept, so a second call completes a shorter copy. */
+static bool createJournal(QSqlDatabase &dbc, int year, int rows)
+{
+    QSqlQuery query(dbc);
+    if (!query.exec("CREATE TABLE IF NOT EXISTS journal (id INTEGER PRIMARY KEY AUTOINCREMENT, version text, cashregisterid text, datetime datetime, data text, checksum text)"))
+        return false;
+    if (!query.exec("CREATE TABLE IF NOT EXISTS globals (id INTEGER PRIMARY KEY AUTOINCREMENT, name text NOT NULL, value INTEGER, strValue text)"))
+        return false;
+
+    query.prepare("INSERT OR IGNORE INTO journal (id, version, cashregisterid, datetime, data, checksum) VALUES (:id, '1.0', 'QRK-TEST', :datetime, :data, '')");
+    for (int id = 1; id <= 4 + rows; id++) {
+        QDateTime datetime(QDate(year, 1, 1), QTime(8, 0));
+        if (id > 4)
+            datetime = datetime.addDays(id * 20);
+        query.bindValue(":id", id);
+        query.bindValue(":datetime", datetime.toString(Qt::ISODate));
+        query.bindValue(":data", QString("Beleg\t%1").arg(id));
+        if (!query.exec())
+            return false;
+    }
+
+    return true;
+}
+
+/* reads the journal like ExportJournal does */
+static QStringList exportJournal(QSqlDatabase &dbc, const QString &from, const QString &to)
+{
+    QStringList rows;
+    JournalPartitions partitions(dbc);
+    foreach (int year, partitions.years(from, to)) {
+        QSqlQuery query(dbc);
+        if (!partitions.select(query, year, "version, cashregisterid, data", from, to))
+            return QStringList() << "error";
+        while (query.next())
+            rows.append(QString("%1\t%2\t%3").arg(query.value(0).toString()).arg(query.value(1).toString()).arg(query.value(2).toString()));
+    }
+
+    return rows;
+}
+
+/* receipt data as RKSignatureSession::sign reads it from compileData */
+static QJsonObject signatureData(int receiptNum, double normal, double reduced, bool storno = false)
+{
+    QJsonObject data;
+    data["kasse"] = "QRK-TEST";
+    data["receiptNum"] = receiptNum;
+    data["receiptTime"] = QString("2019-01-02T10:%1:00").arg(receiptNum, 2, 10, QChar('0'));
+    data["Satz-Normal"] = normal;
+    data["Satz-Ermaessigt-1"] = reduced;
+    data["isStorno"] = storno;
+    return data;
+}
+
+/* raises the normal tax turnover of a signed DEP-7 entry by 100 without
+ * signing it again, the stored turnover counter no longer matches */
+static QString tamperDepTurnover(const QString &data)
+{
+    QStringList jws = data.split('.');
+    QStringList list = QString(RKSignatureModule::base64Url_decode(jws.at(1))).split('_');
+    list[5].prepend('1');
+    jws[1] = QString(RKSignatureModule::base64Url_encode(list.join('_')));
+    return jws.join('.');
+}
+
+/* leases a "CN" connection from DatabaseManager and keeps it until it is
+ * released, the pool takes the connection back when the thread finishes */
+class PoolLease : public QThread
+{
+    public:
+        PoolLease(bool reconnect = false, bool reports = false)
+            : m_reconnect(reconnect), m_reports(reports), m_valid(false), m_reopened(false), m_reportsValid(false) {}
+
+        bool waitLeased(int msecs = 10000) { return m_leased.tryAcquire(1, msecs); }
+        bool isLeased() { return m_leased.available() > 0; }
+        void release() { m_release.release(); }
+        bool isValid() const { return m_valid; }
+        bool reopened() const { return m_reopened; }
+        bool reportsValid() const { return m_reportsValid; }
+
+    protected:
+        void run()
+        {
+            {
+                QSqlDatabase dbc = DatabaseManager::database("CN");
+                m_valid = dbc.isValid() && dbc.isOpen();
+                if (m_valid && m_reconnect) {
+                    dbc.close();
+                    dbc = DatabaseManager::database("CN");
+                    QSqlQuery query(dbc);
+                    m_reopened = dbc.isOpen() && query.exec("SELECT 1");
+                }
+                if (m_valid && m_reports) {
+                    QSqlDatabase reports = DatabaseManager::database("RS");
+                    m_reportsValid = reports.isValid() && reports.isOpen();
+                }
+            }
+            m_leased.release();
+            m_release.acquire();
+        }
+
+    private:
+        bool m_reconnect;
+        bool m_reports;
+        bool m_valid;
+        bool m_reopened;
+        bool m_reportsValid;
+        QSemaphore m_leased;
+        QSemaphore m_release;
+};
+
+/* leases a connection on a QThreadPool thread and returns it at the end of
+ * the runnable, the pool thread itself stays alive */
+class PooledJob : public QRunnable
+{
+    public:
+        PooledJob() : m_valid(false) { setAutoDelete(false); }
+
+        bool waitDone(int msecs = 10000) { return m_done.tryAcquire(1, msecs); }
+        bool isValid() const { return m_valid; }
+
+    protected:
+        void run()
+        {
+            {
+                QSqlDatabase dbc = DatabaseManager::database("CN");
+                m_valid = dbc.isValid() && dbc.isOpen();
+            }
+            DatabaseManager::releaseCurrentThread();
+            m_done.release();
+        }
+
+    private:
+        bool m_valid;
+        QSemaphore m_done;
+};
 
 class QRK : public QObject
 {
@@ -93,6 +663,73 @@ class QRK : public QObject
             delete module;
         }
 
+        void turnovercrypto_reference(void)
+        {
+            QString key = "7265d688acd4a89f3f6ead0e58e4ca915ea2d06d00232cf6e29644213403d217";
+            RKTurnoverCrypto crypto(key);
+            QVERIFY(crypto.isValid());
+
+            QList<qlonglong> counters = QList<qlonglong>() << 0 << 1 << -12345 << 34567 << 1234567890123LL;
+            for (int i = 0; i < 200; i++) {
+                QString concatenated = QString("DEMO-CASH-BOX-%1%2").arg(i % 7).arg(i);
+                QByteArray hash = Reference::hashValue(concatenated);
+                QVERIFY(crypto.hashHex(concatenated) == hash);
+
+                foreach (qlonglong counter, counters) {
+                    counter += i;
+                    QString encrypted = Reference::encryptCTR(hash.toStdString(), counter, key.toStdString());
+                    QVERIFY(crypto.encrypt(concatenated, counter) == encrypted);
+                    QVERIFY(QString::number(crypto.decrypt(concatenated, encrypted)) == Reference::decryptCTR(hash.toStdString(), encrypted, key.toStdString()));
+                    QVERIFY(crypto.decrypt(concatenated, encrypted) == counter);
+                }
+            }
+
+            /* storno marker and short (5 byte) counters decode like before */
+            QVERIFY(QString::number(crypto.decrypt("DEMO-CASH-BOX-1", "U1RP")) == Reference::decryptCTR(Reference::hashValue("DEMO-CASH-BOX-1").toStdString(), "U1RP", key.toStdString()));
+            QVERIFY(QString::number(crypto.decrypt("DEMO-CASH-BOX-1", "AAAAAAA=")) == Reference::decryptCTR(Reference::hashValue("DEMO-CASH-BOX-1").toStdString(), "AAAAAAA=", key.toStdString()));
+        }
+
+        void turnovercrypto_benchmark_encrypt(void)
+        {
+            RKTurnoverCrypto crypto("7265d688acd4a89f3f6ead0e58e4ca915ea2d06d00232cf6e29644213403d217");
+            QByteArray concatenated("DEMO-CASH-BOX-1234567");
+            unsigned char out[RK_TURNOVER_SIZE];
+            qlonglong counter = 0;
+            QBENCHMARK {
+                crypto.encrypt(concatenated.constData(), concatenated.size(), ++counter, out);
+            }
+        }
+
+        void turnovercrypto_benchmark_decrypt(void)
+        {
+            RKTurnoverCrypto crypto("7265d688acd4a89f3f6ead0e58e4ca915ea2d06d00232cf6e29644213403d217");
+            QByteArray concatenated("DEMO-CASH-BOX-1234567");
+            unsigned char encrypted[RK_TURNOVER_SIZE];
+            crypto.encrypt(concatenated.constData(), concatenated.size(), 123456, encrypted);
+            QBENCHMARK {
+                crypto.decrypt(concatenated.constData(), concatenated.size(), encrypted, RK_TURNOVER_SIZE);
+            }
+        }
+
+        void turnovercrypto_benchmark_hash(void)
+        {
+            RKTurnoverCrypto crypto("7265d688acd4a89f3f6ead0e58e4ca915ea2d06d00232cf6e29644213403d217");
+            QByteArray data(1024, 'x');
+            unsigned char digest[RK_HASH_SIZE];
+            QBENCHMARK {
+                crypto.hash(data.constData(), data.size(), digest);
+            }
+        }
+
+        void turnovercrypto_benchmark_reference(void)
+        {
+            std::string key = "7265d688acd4a89f3f6ead0e58e4ca915ea2d06d00232cf6e29644213403d217";
+            qlonglong counter = 0;
+            QBENCHMARK {
+                Reference::encryptCTR(Reference::hashValue("DEMO-CASH-BOX-1234567").toStdString(), ++counter, key);
+            }
+        }
+
         void bcmath(void)
         {
             QString test = "63.99";
@@ -133,6 +770,871 @@ class QRK : public QObject
             QVERIFY(ba1.toBase64() == ba2.toBase64());
         }
 
+        void metrics(void)
+        {
+            Metrics::setEnabled(false);
+            Metrics::reset();
+            Metrics::addCount("test.count");
+            QVERIFY(Metrics::counter("test.count") == 0);
+
+            Metrics::setEnabled(true);
+            Metrics::addCount("test.count", 3);
+            QVERIFY(Metrics::counter("test.count") == 3);
+
+            MetricsHistogram h;
+            for (int i = 1; i <= 100; i++)
+                h.add(i);
+            QVERIFY(h.count == 100 && h.min == 1 && h.max == 100);
+            QVERIFY(h.percentile(0.5) == 64);
+            QVERIFY(h.percentile(0.95) == 100);
+
+            Metrics::setEnabled(false);
+            Metrics::reset();
+        }
+
+        void receipttemplate(void)
+        {
+            QStringList variables = QStringList() << "DATUM" << "DISPLAYNAME" << "UHRZEIT" << "BONNUMMER" << "VERSION" << "SUMME";
+            QStringList values = QStringList() << QDate(2019, 5, 17).toString() << "" << "10:15:00" << "42" << "1.10.190517" << "12.35";
+
+            QStringList templates;
+            templates << "Bon {{BONNUMMER}} vom {{DATUM}} {{UHRZEIT}}\nSumme: {{SUMME}}"
+                      << "Doppelt {{SUMME * 2}}, Plus {{SUMME + 1,5}}, Drittel {{SUMME / 3}}"
+                      << "{{SUMME - 10 * 2}} {{BONNUMMER % 7}} {{2 + SUMME * 3}} {{10 * 3}}"
+                      << "Gutschein gültig bis {{DATUM 30}} bzw. {{DATUM 1M}} ab {{UHRZEIT x}}"
+                      << "Kassier: {{DISPLAYNAME}} Version {{VERSION}} {{SUMME * BONNUMMER}}"
+                      << "{{SUMME / 0}} {{}} ohne Variablen";
+
+            foreach (const QString &tpl, templates) {
+                ckvTemplate legacy;
+                for (int i = 0; i < variables.size(); i++)
+                    legacy.set(variables.at(i), values.at(i));
+
+                QString expected = legacy.process(tpl);
+                QString compiled = ckvCompiledTemplate::compile(tpl, variables)->render(values);
+                QVERIFY2(compiled == expected, qPrintable(QString("%1 != %2").arg(compiled).arg(expected)));
+            }
+
+            /* the sum of a test print is "0,0" */
+            values.replace(5, "0,0");
+            ckvTemplate legacy;
+            for (int i = 0; i < variables.size(); i++)
+                legacy.set(variables.at(i), values.at(i));
+            QVERIFY(ckvCompiledTemplate::compile(templates.at(1), variables)->render(values) == legacy.process(templates.at(1)));
+
+            /* a half cent is rounded half up, the double 1.005 of the legacy engine is below */
+            values.replace(5, "2.01");
+            ckvTemplate halfCent;
+            halfCent.set("SUMME", "2.01");
+            QCOMPARE(halfCent.process("{{SUMME / 2}}"), QString("1.00"));
+            QCOMPARE(ckvCompiledTemplate::compile("{{SUMME / 2}}", variables)->render(values), QString("1.01"));
+        }
+
+        void receipttemplate_benchmark(void)
+        {
+            QStringList variables = QStringList() << "DATUM" << "DISPLAYNAME" << "UHRZEIT" << "BONNUMMER" << "VERSION" << "SUMME";
+            QString header = "Bon {{BONNUMMER}} vom {{DATUM}} {{UHRZEIT}}\nKassier: {{DISPLAYNAME}}";
+            QString footer = "Summe {{SUMME}}, davon 10% {{SUMME * 10 / 100}}\nDanke für Ihren Einkauf";
+
+            QBENCHMARK {
+                for (int i = 0; i < 10000; i++) {
+                    QStringList values = QStringList() << QDate(2019, 5, 17).toString() << "Kassier" << "10:15:00"
+                                                       << QString::number(i) << "1.10" << QString::number(i / 100.0, 'f', 2);
+                    ckvCompiledTemplate::compile(header, variables)->render(values);
+                    ckvCompiledTemplate::compile(footer, variables)->render(values);
+                }
+            }
+        }
+
+        void receipttemplate_benchmark_legacy(void)
+        {
+            QStringList variables = QStringList() << "DATUM" << "DISPLAYNAME" << "UHRZEIT" << "BONNUMMER" << "VERSION" << "SUMME";
+            QString header = "Bon {{BONNUMMER}} vom {{DATUM}} {{UHRZEIT}}\nKassier: {{DISPLAYNAME}}";
+            QString footer = "Summe {{SUMME}}, davon 10% {{SUMME * 10 / 100}}\nDanke für Ihren Einkauf";
+
+            QBENCHMARK {
+                for (int i = 0; i < 10000; i++) {
+                    QStringList values = QStringList() << QDate(2019, 5, 17).toString() << "Kassier" << "10:15:00"
+                                                       << QString::number(i) << "1.10" << QString::number(i / 100.0, 'f', 2);
+                    ckvTemplate Template;
+                    for (int j = 0; j < variables.size(); j++)
+                        Template.set(variables.at(j), values.at(j));
+                    Template.process(header);
+                    Template.process(footer);
+                }
+            }
+        }
+
+        void qrcode_cache(void)
+        {
+            Metrics::setEnabled(true);
+            Metrics::reset();
+            QRCode::clearCache();
+
+            QRCode qr;
+            QString text = "_R1-AT1_DEMO-CASH-BOX524_366585_2019-05-17T10:15:00_12,35_0,00_0,00_0,00_0,00_AAAAAAAAAAA=_5a2d1e59_AAAAAAAAAAA=";
+            QImage first = qr.encodeTextToImage(text, 1.0, 1000);
+            QImage second = qr.encodeTextToImage(text, 1.0, 1000);
+            QVERIFY(Metrics::counter("qrcode.cache.miss") == 1);
+            QVERIFY(Metrics::counter("qrcode.cache.hit") == 1);
+            QVERIFY(first.format() == QImage::Format_Mono);
+            QVERIFY(first == second);
+
+            // margin is white, the top left finder pattern starts black
+            QVERIFY(first.pixelIndex(0, 0) == 0);
+            QVERIFY(first.pixelIndex(4, 4) == 1);
+
+            QImage scaled = qr.encodeTextToImage(text, 3.0, 1000);
+            QVERIFY(scaled.width() == first.width() * 3);
+            QVERIFY(qr.encodeTextToImage(text, 3.0, 100).width() == 100);
+
+            Metrics::setEnabled(false);
+            Metrics::reset();
+        }
+
+        void jsonimport(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+
+            QList<QByteArray> codecs = QList<QByteArray>() << "UTF-8" << "ISO-8859-15";
+            foreach (const QByteArray &codec, codecs) {
+                writeImportFiles(dir.path(), 1, 5, codec);
+                QString filename = dir.path() + "/0.json";
+
+                JsonImportFile file(filename, codec);
+                QVERIFY(file.open());
+                QJsonObject data = file.object();
+                file.close();
+
+                QVERIFY(data.contains("receipt"));
+                QVERIFY(data == Reference::loadJSonFile(filename, codec));
+            }
+
+            QStringList numbers = QStringList() << "12" << "12,50" << "1.234,56" << "1,234.56" << "-3,5" << " 7.25 " << "0,005" << "20,00";
+            foreach (const QString &number, numbers) {
+                QString decimal;
+                QVERIFY(Utils::parseDecimal(number, decimal));
+                QVERIFY2(decimal == Utils::normalizeNumber(number).trimmed(), qPrintable(number));
+            }
+
+            QString decimal;
+            QVERIFY(!Utils::parseDecimal("", decimal));
+            QVERIFY(!Utils::parseDecimal("12a", decimal));
+            QVERIFY(!Utils::parseDecimal("1e3", decimal));
+        }
+
+        void csvreader(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+
+            QList<QStringList> expected;
+            expected << (QStringList() << "1" << "Äpfel; rot" << "1,50")
+                     << (QStringList() << "2" << "Birne\nmit \"Stiel\"" << "2,00")
+                     << (QStringList() << "3" << "Kiwi" << "0,80");
+
+            CsvImportSource source;
+            source.delimiter = ";";
+            source.textDelimiter = "\"";
+
+            /* UTF-16 with and without byte order mark */
+            QList<QByteArray> codecs = QList<QByteArray>() << "UTF-8" << "UTF-16" << "UTF-16BE";
+            foreach (const QByteArray &codec, codecs) {
+                QTextCodec::ConverterState state(codec == "UTF-16BE" ? QTextCodec::IgnoreHeader : QTextCodec::DefaultConversion);
+                QString text = QString::fromUtf8(csvText);
+                QFile file(dir.path() + "/" + codec + ".csv");
+                QVERIFY(file.open(QIODevice::WriteOnly));
+                file.write(QTextCodec::codecForName(codec)->fromUnicode(text.constData(), text.size(), &state));
+                file.close();
+
+                source.filename = file.fileName();
+                source.codec = codec;
+                source.firstRowIsHeader = true;
+                source.fromLine = 1;
+                source.toLine = 1;
+
+                QStringList header;
+                QList<QStringList> rows = readCsv(source, header);
+                QVERIFY2(header == (QStringList() << "Nr" << "Name" << "Preis"), codec.constData());
+                QVERIFY2(rows == expected, codec.constData());
+
+                /* the preview counts lines, the quoted line break included */
+                CsvReader reader(source);
+                QVERIFY(reader.open());
+                QStringList row;
+                QVERIFY(reader.nextRow(row) && reader.nextRow(row));
+                QVERIFY(reader.linesRead() == 3);
+                QVERIFY(reader.countRemainingLines() == 1);
+                reader.close();
+
+                /* the window counts lines, a row started inside is read to its end */
+                source.firstRowIsHeader = false;
+                source.fromLine = 2;
+                source.toLine = 3;
+                rows = readCsv(source, header);
+                QVERIFY(header.isEmpty());
+                QVERIFY2(rows == expected.mid(0, 2), codec.constData());
+
+                source.fromLine = 5;
+                source.toLine = 5;
+                rows = readCsv(source, header);
+                QVERIFY2(rows == expected.mid(2), codec.constData());
+            }
+        }
+
+        void jsonimport_benchmark(void)
+        {
+            const int files = 500;
+            const int items = 20;
+
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            writeImportFiles(dir.path(), files, items, "UTF-8");
+
+            QStringList fields = QStringList() << "gross" << "net" << "tax" << "count";
+
+            QElapsedTimer timer;
+            timer.start();
+            int legacyItems = 0;
+            for (int f = 0; f < files; f++) {
+                QJsonObject data = Reference::loadJSonFile(QString("%1/%2.json").arg(dir.path()).arg(f), "UTF-8");
+                foreach (const QJsonValue &value, data.value("receipt").toArray().first().toObject().value("items").toArray()) {
+                    QJsonObject item = value.toObject();
+                    foreach (const QString &field, fields)
+                        if (Utils::isNumber(Utils::normalizeNumber(item.value(field).toString())))
+                            legacyItems++;
+                }
+            }
+            qint64 legacy = qMax(timer.nsecsElapsed(), qint64(1));
+
+            timer.restart();
+            int mappedItems = 0;
+            QString decimal;
+            for (int f = 0; f < files; f++) {
+                JsonImportFile file(QString("%1/%2.json").arg(dir.path()).arg(f));
+                file.open();
+                QJsonObject data = file.object();
+                file.close();
+                foreach (const QJsonValue &value, data.value("receipt").toArray().first().toObject().value("items").toArray()) {
+                    QJsonObject item = value.toObject();
+                    foreach (const QString &field, fields)
+                        if (Utils::parseDecimal(item.value(field).toString(), decimal))
+                            mappedItems++;
+                }
+            }
+            qint64 mapped = qMax(timer.nsecsElapsed(), qint64(1));
+
+            QVERIFY(legacyItems == files * items * fields.size());
+            QVERIFY(mappedItems == legacyItems);
+
+            qInfo() << "json import legacy:" << qRound64(files * 1e9 / legacy) << "files/s,"
+                    << "mapped:" << qRound64(files * 1e9 / mapped) << "files/s";
+        }
+
+        void queryprofiler_normalize(void)
+        {
+            QString sql = "SELECT  id FROM products\n WHERE name='Wurst ''scharf''' AND tax=20.5 AND id IN (1, 2,3) AND groupid=:groupid";
+            QVERIFY(QueryProfiler::normalize(sql) == "SELECT id FROM products WHERE name=? AND tax=? AND id IN (?, ...) AND groupid=:groupid");
+            QVERIFY(QueryProfiler::normalize("UPDATE globals SET value=42 WHERE name='lastReceiptNum'")
+                    == QueryProfiler::normalize("UPDATE globals SET value=43 WHERE name='lastReceiptNum'"));
+            QVERIFY(QueryProfiler::normalize("SELECT t2.id FROM table2 t2") == "SELECT t2.id FROM table2 t2");
+        }
+
+        void readonly_report_concurrent_sales(void)
+        {
+            const int sales = 500;
+
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            QString filename = dir.path() + "/2019-QRK.db";
+            useSqliteDatabase(filename);
+
+            {
+                QSqlDatabase dbc = QSqlDatabase::addDatabase("QSQLITE", "sales_writer");
+                dbc.setDatabaseName(filename);
+                QVERIFY(dbc.open());
+                QSqlQuery query(dbc);
+                QVERIFY(query.exec("PRAGMA journal_mode = WAL"));
+                QVERIFY(createSchema(dbc));
+                QVERIFY(query.exec("INSERT INTO products (itemnum, barcode, name, net, gross) VALUES ('1', '', 'Wurst', 0, 5)"));
+
+                qint64 alone = writeSales(dbc, 1, sales);
+                QVERIFY(alone > 0);
+
+                ReportReader reader;
+                reader.start();
+                while (reader.isRunning() && reader.reports() == 0)
+                    QThread::msleep(1);
+
+                qint64 concurrent = writeSales(dbc, 1 + sales, sales);
+                reader.stop();
+                QVERIFY(reader.wait(10000));
+
+                // every sale committed while the reports ran on the read-only RS connection
+                QVERIFY(concurrent > 0);
+                QVERIFY(reader.connectionName().startsWith("RS_"));
+                QVERIFY(reader.reports() > 0);
+                QVERIFY(reader.insertRefused());
+
+                QVERIFY(query.exec("SELECT COUNT(*) FROM receipts") && query.next());
+                QVERIFY(query.value(0).toInt() == 2 * sales);
+
+                // timing depends on the machine, it is reported only
+                qInfo() << "commit latency alone:" << alone / 1000 << "us,"
+                        << "with month reports:" << concurrent / 1000 << "us,"
+                        << "reports:" << reader.reports();
+            }
+            QSqlDatabase::removeDatabase("sales_writer");
+        }
+
+        void databasemanager_pool(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            useSqliteDatabase(dir.path() + "/pool.db");
+            DatabaseManager::setPoolLimits(2, 600, 0, 200);
+
+            // the report connection of a thread counts against its lease
+            PoolLease first, second(false, true);
+            first.start();
+            second.start();
+            QVERIFY(first.waitLeased() && second.waitLeased());
+            QVERIFY(first.isValid() && second.isValid());
+            QVERIFY(second.reportsValid());
+            QVERIFY(DatabaseManager::poolStatus()["connections"].toInt() == 3);
+            QVERIFY(DatabaseManager::poolStatus()["leases"].toInt() == 2);
+
+            // nothing is returned within the lease timeout, the limit holds
+            PoolLease refused;
+            refused.start();
+            QVERIFY(refused.waitLeased());
+            QVERIFY(!refused.isValid());
+            refused.release();
+            QVERIFY(refused.wait(10000));
+            QVERIFY(DatabaseManager::poolStatus()["leases"].toInt() == 2);
+
+            // waits until a finished thread returns its connection
+            DatabaseManager::setPoolLimits(2, 600, 0, 10000);
+            PoolLease waiting(true);
+            waiting.start();
+            QThread::msleep(100);
+            QVERIFY(!waiting.isLeased());
+            first.release();
+            QVERIFY(first.wait(10000));
+            QVERIFY(waiting.waitLeased());
+            QVERIFY(waiting.isValid());
+            // a closed connection is reopened on the next lease
+            QVERIFY(waiting.reopened());
+            QVERIFY(DatabaseManager::poolStatus()["leases"].toInt() == 2);
+
+            second.release();
+            waiting.release();
+            QVERIFY(second.wait(10000) && waiting.wait(10000));
+            QVERIFY(DatabaseManager::poolStatus()["connections"].toInt() == 0);
+
+            // a runnable returns its lease while its pool thread stays idle
+            QThreadPool pool;
+            pool.setExpiryTimeout(-1);
+            PooledJob job;
+            pool.start(&job);
+            QVERIFY(job.waitDone());
+            QVERIFY(job.isValid());
+            QVERIFY(DatabaseManager::poolStatus()["connections"].toInt() == 0);
+            pool.waitForDone();
+
+            DatabaseManager::setPoolLimits(16, 600, 60);
+        }
+
+        void rksignaturesession_chain(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            useSqliteDatabase(dir.path() + "/session.db");
+            globalStringValues.remove("shopCashRegisterId");
+            RKSignatureModule::resetPrivateTurnoverKey();
+
+            QSqlDatabase dbc = Database::database();
+            QVERIFY(createSchema(dbc));
+
+            /* no card reader and no demo mode: the module signs with
+             * "Sicherheitseinrichtung ausgefallen" and keeps the serial of
+             * the start receipt */
+            QString key = "5f3c8d6a1b2e4f7081928374655647382910aabbccddeeff0011223344556677";
+            QSqlQuery query(dbc);
+            QVERIFY(query.exec("UPDATE globals SET value=0 WHERE name='demomode'"));
+            QVERIFY(query.exec("INSERT INTO globals (name, strValue) VALUES('shopCashRegisterId', 'QRK-TEST')"));
+            QVERIFY(query.exec(QString("INSERT INTO globals (name, value, strValue) VALUES('PrivateTurnoverKey', 1, '%1')").arg(key)));
+
+            RKSmartCardInfo card("");
+            QJsonObject start;
+            start["Kassen-ID"] = "QRK-TEST";
+            start["Belegnummer"] = "1";
+            start["Beleg-Datum-Uhrzeit"] = "2019-01-02T08:00:00";
+            start["Satz-Normal"] = "0.00";
+            start["Satz-Ermaessigt-1"] = "0.00";
+            start["Satz-Ermaessigt-2"] = "0.00";
+            start["Satz-Null"] = "0.00";
+            start["Satz-Besonders"] = "0.00";
+            start["Stand-Umsatz-Zaehler-AES256-ICM"] = card.encryptTurnoverCounter("QRK-TEST1", 0, key);
+            start["Zertifikat-Seriennummer"] = "4711";
+            start["Sig-Voriger-Beleg"] = card.getLastSignatureValue("QRK-TEST");
+            query.prepare("INSERT INTO dep (receiptNum, data) VALUES (1, :data)");
+            query.bindValue(":data", card.signReceipt(Utils::getReceiptShortJson(start)));
+            QVERIFY(query.exec());
+
+            QList<QJsonObject> receipts;
+            receipts << signatureData(2, 12.5, 3.2) << signatureData(3, 0, 7.9, true) << signatureData(4, 99.99, 0);
+
+            /* one group, the first try of receipt 3 is rolled back to its
+             * savepoint and signed again */
+            QStringList grouped;
+            {
+                RKSignatureSession session;
+                QVERIFY(session.begin(1));
+                grouped << session.sign(receipts.at(0));
+                session.accept();
+                QVERIFY(!session.sign(signatureData(3, 50, 0)).isEmpty());
+                session.reject();
+                grouped << session.sign(receipts.at(1));
+                session.accept();
+                grouped << session.sign(receipts.at(2));
+                session.accept();
+            }
+
+            /* the one-shot path reads counter and previous signature from the
+             * dep for every receipt */
+            Utils utils;
+            for (int i = 0; i < receipts.size(); i++) {
+                int receiptNum = receipts.at(i).value("receiptNum").toInt();
+                QVERIFY(query.exec(QString("UPDATE globals SET value=%1 WHERE name='lastReceiptNum'").arg(receiptNum)));
+
+                QString signature = utils.getSignature(receipts.at(i));
+                QVERIFY(!signature.isEmpty());
+                QVERIFY(signature == grouped.at(i));
+
+                query.prepare("INSERT INTO dep (receiptNum, data) VALUES (:receiptNum, :data)");
+                query.bindValue(":receiptNum", receiptNum);
+                query.bindValue(":data", signature);
+                QVERIFY(query.exec());
+            }
+
+            /* a full pass verifies the chain and stores a checkpoint at the
+             * last entry, a second pass has nothing new to verify */
+            QStringList error;
+            QVERIFY(Utils::checkTurnOverCounter(error, true));
+            QVERIFY2(error.isEmpty(), qPrintable(error.join('\n')));
+            QVERIFY(selectRows(dbc, "SELECT depId FROM depCheckpoints") == QStringList() << "4");
+            QVERIFY(Utils::checkTurnOverCounter(error));
+            QVERIFY(selectRows(dbc, "SELECT depId FROM depCheckpoints") == QStringList() << "4");
+
+            /* later passes start at the checkpoint */
+            for (int receiptNum = 5; receiptNum <= 6; receiptNum++) {
+                QVERIFY(query.exec(QString("UPDATE globals SET value=%1 WHERE name='lastReceiptNum'").arg(receiptNum)));
+                query.prepare("INSERT INTO dep (receiptNum, data) VALUES (:receiptNum, :data)");
+                query.bindValue(":receiptNum", receiptNum);
+                query.bindValue(":data", utils.getSignature(signatureData(receiptNum, 10, 0)));
+                QVERIFY(query.exec());
+            }
+            QVERIFY(Utils::checkTurnOverCounter(error));
+            QVERIFY2(error.isEmpty(), qPrintable(error.join('\n')));
+            QVERIFY(selectRows(dbc, "SELECT depId FROM depCheckpoints ORDER BY depId") == (QStringList() << "4" << "6"));
+
+            /* a tampered entry after the checkpoint fails and stores no checkpoint */
+            QVERIFY(query.exec("UPDATE globals SET value=7 WHERE name='lastReceiptNum'"));
+            QString signature = utils.getSignature(signatureData(7, 10, 0));
+            query.prepare("INSERT INTO dep (receiptNum, data) VALUES (7, :data)");
+            query.bindValue(":data", tamperDepTurnover(signature));
+            QVERIFY(query.exec());
+            QVERIFY(!Utils::checkTurnOverCounter(error));
+            QVERIFY(error.size() == 1 && error.first().contains("BON 7"));
+            QVERIFY(selectRows(dbc, "SELECT depId FROM depCheckpoints ORDER BY depId") == (QStringList() << "4" << "6"));
+
+            query.prepare("UPDATE dep SET data=:data WHERE receiptNum=7");
+            query.bindValue(":data", signature);
+            QVERIFY(query.exec());
+            error.clear();
+            QVERIFY(Utils::checkTurnOverCounter(error));
+            QVERIFY(selectRows(dbc, "SELECT depId FROM depCheckpoints ORDER BY depId") == (QStringList() << "4" << "6" << "7"));
+
+            /* an entry before the checkpoint is only read again by a full
+             * pass, which finds it by the counter and the chained hash */
+            QString second = selectRows(dbc, "SELECT data FROM dep WHERE receiptNum=2").value(0);
+            query.prepare("UPDATE dep SET data=:data WHERE receiptNum=2");
+            query.bindValue(":data", tamperDepTurnover(second));
+            QVERIFY(query.exec());
+            QVERIFY(Utils::checkTurnOverCounter(error));
+            QVERIFY(error.isEmpty());
+            QVERIFY(!Utils::checkTurnOverCounter(error, true));
+            QVERIFY(error.join('\n').contains("BON 2"));
+
+            DatabaseManager::removeCurrentThread("CN");
+        }
+
+        void salesbreakdown_receipts(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            useSqliteDatabase(dir.path() + "/breakdown.db");
+
+            QSqlDatabase dbc = Database::database();
+            QVERIFY(createSchema(dbc));
+            QSqlQuery query(dbc);
+            QVERIFY(query.exec("INSERT INTO products (itemnum, barcode, name, net, gross) VALUES ('1', '', 'Wurst', 0, 0), ('2', '', 'Bier', 0, 0), ('3', '', 'Kaffee', 0, 0)"));
+
+            // half cents and discounts, every line is rounded on its own
+            QList<TestLine> lines;
+            lines << TestLine(1, 3, 3.995, 0, 10) << TestLine(2, 3, 1.15, 10, 20) << TestLine(3, 1, 2.345, 0, 13)
+                  << TestLine(1, 7, 0.335, 5, 10) << TestLine(2, 2, 4.125, 0, 20) << TestLine(3, 0.5, 3.33, 0, 13);
+
+            for (int receiptNum = 1; receiptNum <= 24; receiptNum++) {
+                QList<TestLine> receipt;
+                for (int line = 0; line < 1 + receiptNum % 3; line++)
+                    receipt << lines.at((receiptNum + line) % lines.size());
+                QDateTime timestamp(QDate(2019, 1, 2 + receiptNum % 3), QTime(8 + receiptNum % 10, 15));
+                QVERIFY(bookReceipt(receiptNum, timestamp, receiptNum % 3, receipt));
+            }
+
+            QDateTime from(QDate(2019, 1, 1), QTime(0, 0));
+            QDateTime to(QDate(2019, 1, 31), QTime(23, 59, 59));
+            QVERIFY(!salesPerPaymentPerLine(dbc, from, to).isEmpty());
+            QVERIFY(sameSales(Database::getSalesPerPayment(dbc, from, to), salesPerPaymentPerLine(dbc, from, to)));
+
+            // partial first and last days are read from the order lines
+            QDateTime morning(QDate(2019, 1, 2), QTime(11, 0));
+            QDateTime noon(QDate(2019, 1, 4), QTime(12, 0));
+            QVERIFY(sameSales(Database::getSalesPerPayment(dbc, morning, noon), salesPerPaymentPerLine(dbc, morning, noon)));
+
+            // the rows added receipt by receipt equal a rebuild from all lines
+            QString breakdown = "SELECT day, payedBy, tax, total FROM salesBreakdown ORDER BY day, payedBy, tax";
+            QStringList rows = selectRows(dbc, breakdown);
+            QVERIFY(!rows.isEmpty());
+            QVERIFY(Database::rebuildSalesBreakdown(dbc));
+            QVERIFY(selectRows(dbc, breakdown) == rows);
+
+            // a breakdown which cannot be written fails the receipt
+            QVERIFY(query.exec("DROP TABLE salesBreakdown"));
+            QVERIFY(!bookReceipt(25, to, 0, lines));
+            QVERIFY(query.exec("SELECT COUNT(*) FROM receipts WHERE receiptNum=25") && query.next());
+            QVERIFY(query.value(0).toInt() == 0);
+
+            query.finish();
+            DatabaseManager::removeCurrentThread("CN");
+        }
+
+        void salesanalytics_buckets(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            useSqliteDatabase(dir.path() + "/analytics.db");
+
+            QSqlDatabase dbc = Database::database();
+            QVERIFY(createSchema(dbc));
+            QSqlQuery query(dbc);
+            QVERIFY(query.exec("INSERT INTO `groups` (name, visible) VALUES ('Kalt', 1)"));
+            QVERIFY(query.exec("INSERT INTO products (itemnum, barcode, name, net, gross, `group`) VALUES ('1', '', 'Wurst', 0, 0, 2), ('2', '', 'Bier', 0, 0, 3), ('3', '', 'Kaffee', 0, 0, 2), ('4', '', 'Zahlungsbeleg', 0, 0, 1)"));
+
+            /* whole cents only, the expected totals are summed up here;
+             * product 4 (group 1) must not show up in any view */
+            QMap<QString, SalesAnalytics::Entry> products;
+            QMap<int, SalesAnalytics::Entry> hours;
+            qint64 secondDay = 0;
+            for (int receiptNum = 1; receiptNum <= 13; receiptNum++) {
+                int day = 1 + receiptNum % 2;
+                int hour = (receiptNum == 13) ? 20 : 9 + receiptNum % 4;
+                QList<TestLine> lines;
+                if (receiptNum < 13) {
+                    lines << TestLine(1, 1 + receiptNum % 2, 2.5, 0, 10);
+                    if (receiptNum % 3 == 0)
+                        lines << TestLine(3, 2, 3.2, 0, 10);
+                    if (receiptNum % 5 == 0)
+                        lines << TestLine(2, 1, 4.1, 0, 20) << TestLine(2, 1, 4.1, 0, 20);
+                }
+                if (receiptNum % 4 == 0 || receiptNum == 13)
+                    lines << TestLine(4, 1, 10, 0, 0);
+
+                QSet<int> counted;
+                foreach (const TestLine &line, lines) {
+                    if (line.product == 4)
+                        continue;
+                    QString name = (line.product == 1) ? "Wurst" : (line.product == 2) ? "Bier" : "Kaffee";
+                    qint64 cents = qRound64(line.count * line.gross * 100);
+                    SalesAnalytics::Entry &p = products[name];
+                    p.name = name;
+                    p.count += line.count;
+                    p.total += cents;
+                    if (!counted.contains(line.product)) {
+                        counted.insert(line.product);
+                        p.receipts++;
+                    }
+                    SalesAnalytics::Entry &h = hours[hour];
+                    h.count += line.count;
+                    h.total += cents;
+                    if (day == 2)
+                        secondDay += cents;
+                }
+                if (!counted.isEmpty())
+                    hours[hour].receipts++;
+
+                QVERIFY(bookReceipt(receiptNum, QDateTime(QDate(2019, 3, day), QTime(hour, 30)), receiptNum % 3, lines));
+            }
+
+            SalesAnalytics analytics(QDate(2019, 3, 1), QDate(2019, 3, 31));
+            QList<SalesAnalytics::Entry> top = analytics.topProducts(10, SalesAnalytics::TOTAL);
+            QVERIFY(top.size() == products.size());
+            SalesAnalytics::Entry expected;
+            for (int i = 0; i < top.size(); i++) {
+                SalesAnalytics::Entry p = products.value(top.at(i).name);
+                QVERIFY(top.at(i).count == p.count);
+                QVERIFY(top.at(i).receipts == p.receipts);
+                QVERIFY(top.at(i).total == p.total);
+                if (i > 0)
+                    QVERIFY(top.at(i - 1).total >= top.at(i).total);
+                expected.count += p.count;
+                expected.total += p.total;
+            }
+            QVERIFY(analytics.topProducts(1).size() == 1);
+
+            SalesAnalytics::Entry sum = analytics.sum();
+            QVERIFY(sum.count == expected.count);
+            QVERIFY(sum.total == expected.total);
+
+            QList<SalesAnalytics::Entry> groups = analytics.groups(SalesAnalytics::TOTAL);
+            QVERIFY(groups.size() == 2);
+            foreach (const SalesAnalytics::Entry &group, groups) {
+                if (group.name == "Kalt")
+                    QVERIFY(group.total == products.value("Bier").total);
+                else
+                    QVERIFY(group.total == products.value("Wurst").total + products.value("Kaffee").total);
+            }
+
+            // receipts with group 1 products only have no hour
+            QList<SalesAnalytics::Entry> perHour = analytics.hours();
+            QVERIFY(perHour.size() == hours.size());
+            QMap<int, SalesAnalytics::Entry>::const_iterator h = hours.constBegin();
+            for (int i = 0; i < perHour.size(); i++, ++h) {
+                QVERIFY(perHour.at(i).name == QString("%1:00").arg(h.key(), 2, 10, QChar('0')));
+                QVERIFY(perHour.at(i).count == h.value().count);
+                QVERIFY(perHour.at(i).receipts == h.value().receipts);
+                QVERIFY(perHour.at(i).total == h.value().total);
+            }
+
+            QVERIFY(SalesAnalytics(QDate(2019, 3, 2), QDate(2019, 3, 2)).sum().total == secondDay);
+            QVERIFY(SalesAnalytics::firstDay() == QDate(2019, 3, 1));
+            DatabaseManager::removeCurrentThread("RO");
+
+            // the buckets added receipt by receipt equal a rebuild from all lines
+            QString productSales = "SELECT day, product, count, receipts, total FROM productSales ORDER BY day, product";
+            QString hourlySales = "SELECT day, hour, count, receipts, total FROM hourlySales ORDER BY day, hour";
+            QStringList productRows = selectRows(dbc, productSales);
+            QStringList hourRows = selectRows(dbc, hourlySales);
+            QVERIFY(Database::rebuildProductSales(dbc));
+            QVERIFY(selectRows(dbc, productSales) == productRows);
+            QVERIFY(selectRows(dbc, hourlySales) == hourRows);
+
+            // productSales and hourlySales are written together or not at all
+            QVERIFY(query.exec("DROP TABLE hourlySales"));
+            QVERIFY(!bookReceipt(14, QDateTime(QDate(2019, 3, 1), QTime(10, 0)), 0, QList<TestLine>() << TestLine(1, 1, 2.5, 0, 10)));
+            QVERIFY(selectRows(dbc, productSales) == productRows);
+
+            query.finish();
+            DatabaseManager::removeCurrentThread("CN");
+        }
+
+        void receiptdetailcache_storno(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+            useSqliteDatabase(dir.path() + "/documents.db");
+
+            QSqlDatabase dbc = Database::database();
+            QVERIFY(createSchema(dbc));
+            QSqlQuery query(dbc);
+            QVERIFY(query.exec("INSERT INTO products (itemnum, barcode, name, net, gross) VALUES ('1', '', 'Wurst', 0, 0), ('2', '', 'Bier', 0, 0)"));
+
+            QDateTime timestamp(QDate(2019, 5, 2), QTime(10, 0));
+            QVERIFY(bookReceipt(1, timestamp, 0, QList<TestLine>() << TestLine(1, 2, 2.5, 0, 10) << TestLine(2, 1, 4.1, 10, 20)));
+            QVERIFY(bookReceipt(2, timestamp, 1, QList<TestLine>() << TestLine(2, 3, 4.1, 0, 20)));
+            QVERIFY(query.exec("INSERT INTO customer (receiptNum, text) VALUES (1, 'Firma Muster')"));
+
+            ReceiptDetailCache cache;
+            ReceiptDetailCache::Detail detail;
+            QVERIFY(cache.detail(1, detail));
+            QVERIFY(detail.receiptNum == 1 && detail.type == 0 && detail.storno == 0);
+            QVERIFY(detail.customerText == "Firma Muster");
+            QVERIFY(detail.lines.size() == 2);
+            QVERIFY(detail.lines.at(0).name == "Wurst" && detail.lines.at(0).price == 5.0);
+            QVERIFY(detail.lines.at(1).name == "Bier" && detail.lines.at(1).discount == -10.0);
+
+            // the neighbours are read ahead, unknown receipts are not cached
+            cache.prefetch(QList<int>() << 1 << 2 << 3);
+            QVERIFY(cache.contains(2) && !cache.contains(3));
+            QVERIFY(!cache.detail(3, detail));
+            QVERIFY(cache.detail(2, detail));
+            QVERIFY(detail.type == 1 && detail.lines.size() == 1);
+
+            // a storno written on the sales connection shows after clear()
+            QVERIFY(query.exec("UPDATE receipts SET storno=1, stornoId=2 WHERE receiptNum=1"));
+            QVERIFY(cache.detail(1, detail) && detail.storno == 0);
+            cache.clear();
+            QVERIFY(cache.detail(1, detail));
+            QVERIFY(detail.storno == 1 && detail.stornoId == 2);
+
+            query.finish();
+            DatabaseManager::removeCurrentThread("RS");
+            DatabaseManager::removeCurrentThread("CN");
+        }
+
+        void journalpartitions_archive(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+
+            int year = QDate::currentDate().year();
+            QString from = QString("%1-01-01T00:00:00").arg(year - 1);
+            QString to = QString("%1-12-31T23:59:59").arg(year);
+
+            {
+                /* the yearly file of last year was copied before its last
+                 * two journal rows were written */
+                QSqlDatabase archive = QSqlDatabase::addDatabase("QSQLITE", "journal_archive");
+                archive.setDatabaseName(QString("%1/%2-QRK.db").arg(dir.path()).arg(year - 1));
+                QVERIFY(archive.open());
+                QVERIFY(createJournal(archive, year - 1, 8));
+
+                QSqlDatabase dbc = QSqlDatabase::addDatabase("QSQLITE", "journal_current");
+                dbc.setDatabaseName(QString("%1/%2-QRK.db").arg(dir.path()).arg(year));
+                QVERIFY(dbc.open());
+                QVERIFY(createJournal(dbc, year - 1, 10));
+
+                QStringList exported = exportJournal(dbc, from, to);
+                QVERIFY(exported.size() == 10);
+
+                // the short archive file keeps every row in the journal
+                QVERIFY(!JournalPartitions::archive(dbc));
+                QVERIFY(JournalPartitions::hotYear(dbc) == 0);
+                QSqlQuery query(dbc);
+                QVERIFY(query.exec("SELECT COUNT(*) FROM journal") && query.next());
+                QVERIFY(query.value(0).toInt() == 14);
+                query.finish();
+                QVERIFY(exportJournal(dbc, from, to) == exported);
+
+                QVERIFY(createJournal(archive, year - 1, 10));
+
+                // as many rows as the journal, but one of them differs
+                QSqlQuery changed(archive);
+                QVERIFY(changed.exec("UPDATE journal SET data='Beleg' WHERE id=7"));
+                QVERIFY(!JournalPartitions::archive(dbc));
+                QVERIFY(JournalPartitions::hotYear(dbc) == 0);
+                QVERIFY(changed.exec("UPDATE journal SET data='Beleg\t7' WHERE id=7"));
+                changed.finish();
+                archive.close();
+
+                QVERIFY(JournalPartitions::archive(dbc));
+                QVERIFY(JournalPartitions::hotYear(dbc) == year);
+
+                // header rows and the last row (MAX(id), last year) stay
+                QList<int> ids;
+                QVERIFY(query.exec("SELECT id FROM journal ORDER BY id"));
+                while (query.next())
+                    ids.append(query.value(0).toInt());
+                QVERIFY(ids == QList<int>() << 1 << 2 << 3 << 4 << 14);
+
+                QVERIFY(exportJournal(dbc, from, to) == exported);
+                JournalPartitions partitions(dbc);
+                QVERIFY(partitions.count(from, to) == exported.size());
+            }
+            QSqlDatabase::removeDatabase("journal_current");
+            QSqlDatabase::removeDatabase("journal_archive");
+        }
+
+        void consolidate_registers(void)
+        {
+            QTemporaryDir dir;
+            QVERIFY(dir.isValid());
+
+            QStringList files;
+            files << dir.path() + "/kasse1.db" << dir.path() + "/kasse2.db";
+
+            RegisterFigures expected;
+            QList<RegisterFigures> figures;
+            for (int i = 0; i < files.size(); i++) {
+                RegisterFigures f;
+                {
+                    QSqlDatabase dbc = QSqlDatabase::addDatabase("QSQLITE", "register_writer");
+                    dbc.setDatabaseName(files.at(i));
+                    QVERIFY(dbc.open());
+                    QVERIFY(writeRegister(dbc, QString("KASSE-%1").arg(i + 1), 40 + 25 * i, i, f));
+                }
+                QSqlDatabase::removeDatabase("register_writer");
+
+                figures.append(f);
+                expected.products += f.products;
+                expected.payments += f.payments;
+                expected.gross += f.gross;
+                QMap<double, qint64>::const_iterator t;
+                for (t = f.perTax.constBegin(); t != f.perTax.constEnd(); ++t)
+                    expected.perTax[t.key()] += t.value();
+            }
+
+            QDateTime from(QDate(2019, 1, 1), QTime(0, 0));
+            QDateTime to(QDate(2019, 1, 31), QTime(23, 59, 59));
+
+            // every register on its own, summed up with add()
+            RegisterStatistics sum;
+            for (int i = 0; i < files.size(); i++) {
+                RegisterStatistics statistics;
+                {
+                    QSqlDatabase dbc = QSqlDatabase::addDatabase("QSQLITE", "register_reader");
+                    dbc.setDatabaseName(files.at(i));
+                    dbc.setConnectOptions("QSQLITE_OPEN_READONLY");
+                    QVERIFY(dbc.open());
+                    QVERIFY(statistics.compute(dbc, from, to));
+                }
+                QSqlDatabase::removeDatabase("register_reader");
+
+                QVERIFY(statistics.cashRegisterId() == QString("KASSE-%1").arg(i + 1));
+                QVERIFY(statistics.payments() == figures.at(i).payments);
+                QVERIFY(qRound64(statistics.gross() * 100) == figures.at(i).gross);
+                sum.add(statistics);
+            }
+
+            Consolidator consolidator(files, from, to);
+            QVERIFY(consolidator.run(2) == 0);
+            RegisterStatistics total = consolidator.total();
+            QVERIFY(total.toJson() == sum.toJson());
+
+            QVERIFY(total.payments() == expected.payments);
+            QVERIFY(total.stornos() == 0);
+            QVERIFY(total.products() == expected.products);
+            QVERIFY(qRound64(total.gross() * 100) == expected.gross);
+
+            QMap<double, double> perTax = total.salesPerTax();
+            QVERIFY(perTax.size() == expected.perTax.size());
+            QMap<double, qint64>::const_iterator t;
+            for (t = expected.perTax.constBegin(); t != expected.perTax.constEnd(); ++t)
+                QVERIFY(qRound64(perTax.value(t.key()) * 100) == t.value());
+
+            qint64 perPayment = 0;
+            QMap<QString, QMap<double, double> > payments = total.salesPerPayment();
+            QMap<QString, QMap<double, double> >::const_iterator p;
+            for (p = payments.constBegin(); p != payments.constEnd(); ++p) {
+                foreach (double value, p.value())
+                    perPayment += qRound64(value * 100);
+            }
+            QVERIFY(payments.size() == 3);
+            QVERIFY(perPayment == expected.gross);
+
+            double items = 0;
+            qint64 itemsTotal = 0;
+            foreach (const RegisterStatistics::Item &item, total.items()) {
+                items += item.count;
+                itemsTotal += qRound64(item.total * 100);
+            }
+            QVERIFY(items == expected.products);
+            QVERIFY(itemsTotal == expected.gross);
+        }
+
 };
 
 QTEST_GUILESS_MAIN(QRK)
@@ -0,0 +1,66 @@
+#
+# This file is part of QRK - Qt Registrier Kasse
+#
+# Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation; either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program; if not, see <http://www.gnu.org/licenses/>.
+#
+# Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+#
+
+include(../defaults.pri)
+
+TARGET = qrk-consolidate
+DESTDIR = ../bin
+
+TEMPLATE = app
+
+QT += core sql
+QT -= gui
+
+CONFIG += console c++11
+CONFIG -= app_bundle
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += main.cpp \
+    consolidator.cpp
+
+HEADERS += consolidator.h
+
+INCLUDEPATH += $$SRC_DIR/qrkcore
+DEPENDPATH += $$SRC_DIR/qrkcore
+
+win32:CONFIG(release, debug|release): LIBS += -L../qrkcore/release -lQrkCore
+else:win32:CONFIG(debug, debug|release): LIBS += -L../qrkcore/debug -lQrkCore
+else:unix: LIBS += -L../qrkcore -lQrkCore
+
+unix:!macx {
+ LIBS += -lpcsclite
+}
+
+macx {
+ QMAKE_LFLAGS += -Wl,-rpath,@executable_path/
+ LIBS += -L/usr/local/lib
+ LIBS += -framework PCSC
+ LIBS += -framework CoreFoundation
+}
+
+win32 {
+ LIBS += libwinscard
+ LIBS += -pthread
+}
+
+LIBS += -lcryptopp
+LIBS += -lz
@@ -0,0 +1,262 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "consolidator.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonArray>
+#include <QFileInfo>
+#include <QFile>
+#include <QDebug>
+
+class ConsolidationJob : public QRunnable
+{
+public:
+    ConsolidationJob(Consolidator::Result *result, const QDateTime &from, const QDateTime &to, int index)
+        : m_result(result), m_from(from), m_to(to), m_index(index)
+    {
+    }
+
+    void run()
+    {
+        Consolidator::process(m_result, m_from, m_to, m_index);
+    }
+
+private:
+    Consolidator::Result *m_result;
+    QDateTime m_from;
+    QDateTime m_to;
+    int m_index;
+};
+
+static QString csvText(const QString &text)
+{
+    return QString("\"%1\"").arg(QString(text).replace("\"", "\"\""));
+}
+
+static QString csvNumber(double value, int digits = 2)
+{
+    return QString::number(value, 'f', digits).replace(".", ",");
+}
+
+Consolidator::Consolidator(const QStringList &files, const QDateTime &from, const QDateTime &to)
+    : m_from(from), m_to(to)
+{
+    foreach (const QString &file, files) {
+        Result result;
+        result.file = file;
+        result.ok = false;
+        m_results.append(result);
+    }
+}
+
+/**
+ * @brief Consolidator::run
+ * @param threads maximum number of databases read at the same time, 0 uses
+ * one thread per core
+ * @return number of databases which could not be read
+ */
+int Consolidator::run(int threads)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    if (threads > 0)
+        pool.setMaxThreadCount(threads);
+
+    Result *results = m_results.data();
+    for (int i = 0; i < m_results.size(); i++)
+        pool.start(new ConsolidationJob(&results[i], m_from, m_to, i));
+
+    pool.waitForDone();
+
+    int failed = 0;
+    m_total = RegisterStatistics();
+    foreach (const Result &result, m_results) {
+        if (result.ok) {
+            m_total.add(result.statistics);
+        } else {
+            failed++;
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " " << result.file << " Error: " << result.error;
+        }
+    }
+
+    qInfo() << "Function Name: " << Q_FUNC_INFO << " registers: " << m_results.size() << " failed: " << failed << " threads: " << pool.maxThreadCount() << " elapsed: " << timer.elapsed() << "ms";
+
+    return failed;
+}
+
+/**
+ * @brief Consolidator::process
+ * reads one register database, runs in a thread of the pool. Every job uses
+ * its own connection which is removed again at the end.
+ * @param result
+ * @param from
+ * @param to
+ * @param index unique number for the connection name
+ */
+void Consolidator::process(Result *result, const QDateTime &from, const QDateTime &to, int index)
+{
+    QString connectionName = QString("consolidate_%1").arg(index);
+
+    if (!QFileInfo::exists(result->file)) {
+        result->error = QString("file not found");
+        return;
+    }
+
+    {
+        QSqlDatabase dbc = QSqlDatabase::addDatabase("QSQLITE", connectionName);
+        dbc.setDatabaseName(result->file);
+        dbc.setConnectOptions("QSQLITE_OPEN_READONLY");
+
+        if (!dbc.open()) {
+            result->error = dbc.lastError().text();
+        } else {
+            QSqlQuery query(dbc);
+            query.exec("SELECT value FROM globals WHERE name='schemaVersion'");
+            int schemaVersion = query.next() ? query.value(0).toInt() : 0;
+            query.finish();
+
+            // the statistics need the salesBreakdown table of schema 23
+            if (schemaVersion < 23) {
+                result->error = QString("schema version %1, open the database with QRK first").arg(schemaVersion);
+            } else {
+                result->ok = result->statistics.compute(dbc, from, to);
+                if (!result->ok)
+                    result->error = result->statistics.lastError();
+            }
+        }
+        dbc.close();
+    }
+
+    QSqlDatabase::removeDatabase(connectionName);
+}
+
+bool Consolidator::write(const QString &filename) const
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error, unable to open" << filename << "for output";
+        return false;
+    }
+
+    if (QFileInfo(filename).suffix().toLower() == "json")
+        file.write(toJson());
+    else
+        file.write(toCsv());
+
+    file.close();
+
+    return true;
+}
+
+QVector<Consolidator::Result> Consolidator::results() const
+{
+    return m_results;
+}
+
+RegisterStatistics Consolidator::total() const
+{
+    return m_total;
+}
+
+QByteArray Consolidator::toJson() const
+{
+    QJsonArray registers;
+    foreach (const Result &result, m_results) {
+        QJsonObject object;
+        if (result.ok)
+            object = result.statistics.toJson();
+        else
+            object["error"] = result.error;
+        object["file"] = result.file;
+        registers.append(object);
+    }
+
+    QJsonObject root;
+    root["from"] = m_from.toString(Qt::ISODate);
+    root["to"] = m_to.toString(Qt::ISODate);
+    root["registers"] = registers;
+    root["total"] = m_total.toJson();
+
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QByteArray Consolidator::toCsv() const
+{
+    QStringList lines;
+    lines.append("Kasse;Datei;Typ;Bezeichnung;Steuersatz;Menge;Betrag");
+
+    QList<const RegisterStatistics *> statistics;
+    QStringList files;
+    for (int i = 0; i < m_results.size(); i++) {
+        const Result &result = m_results.at(i);
+        if (!result.ok) {
+            lines.append(QString(";%1;%2;%3;;;").arg(csvText(result.file)).arg(csvText("Fehler")).arg(csvText(result.error)));
+            continue;
+        }
+        statistics.append(&result.statistics);
+        files.append(result.file);
+    }
+    statistics.append(&m_total);
+    files.append(QString());
+
+    for (int i = 0; i < statistics.size(); i++) {
+        const RegisterStatistics *s = statistics.at(i);
+        QString prefix = QString("%1;%2;").arg(csvText(files.at(i).isEmpty() ? QString("Gesamt") : s->cashRegisterId())).arg(csvText(files.at(i)));
+
+        lines.append(prefix + QString("%1;;;%2;").arg(csvText("Anzahl verkaufter Artikel oder Leistungen")).arg(csvNumber(s->products())));
+        lines.append(prefix + QString("%1;;;%2;").arg(csvText("Anzahl Zahlungen")).arg(s->payments()));
+        lines.append(prefix + QString("%1;;;%2;").arg(csvText("Anzahl Stornos")).arg(s->stornos()));
+
+        QMap<QString, QMap<double, double> > payments = s->salesPerPayment();
+        QMap<QString, QMap<double, double> >::const_iterator p;
+        for (p = payments.constBegin(); p != payments.constEnd(); ++p) {
+            QMap<double, double>::const_iterator t;
+            for (t = p.value().constBegin(); t != p.value().constEnd(); ++t)
+                lines.append(prefix + QString("%1;%2;%3;;%4").arg(csvText("Zahlungsmittel")).arg(csvText(p.key())).arg(csvNumber(t.key())).arg(csvNumber(t.value())));
+        }
+
+        QMap<double, double> taxes = s->salesPerTax();
+        QMap<double, double>::const_iterator t;
+        for (t = taxes.constBegin(); t != taxes.constEnd(); ++t)
+            lines.append(prefix + QString("%1;;%2;;%3").arg(csvText("Steuersatz")).arg(csvNumber(t.key())).arg(csvNumber(t.value())));
+
+        lines.append(prefix + QString("%1;;;;%2").arg(csvText("Umsatz")).arg(csvNumber(s->gross())));
+
+        foreach (const RegisterStatistics::Item &item, s->items()) {
+            QString name = item.name;
+            if (item.discount != 0.0)
+                name = QString("%1 (Rabatt -%2%)").arg(item.name).arg(csvNumber(item.discount));
+            lines.append(prefix + QString("%1;%2;%3;%4;%5").arg(csvText("Artikel")).arg(csvText(name)).arg(csvNumber(item.tax)).arg(csvNumber(item.count)).arg(csvNumber(item.total)));
+        }
+    }
+
+    return lines.join("\n").append("\n").toUtf8();
+}
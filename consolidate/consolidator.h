@@ -0,0 +1,69 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef CONSOLIDATOR_H
+#define CONSOLIDATOR_H
+
+#include "registerstatistics.h"
+
+#include <QDateTime>
+#include <QStringList>
+#include <QVector>
+
+/**
+ * @brief The Consolidator class reads the statistics of several register
+ * databases in parallel. Every database is opened read only on its own
+ * connection and handled by one thread of a QThreadPool, the results are
+ * summed up afterwards.
+ */
+class Consolidator
+{
+public:
+    struct Result
+    {
+        QString file;
+        bool ok;
+        QString error;
+        RegisterStatistics statistics;
+    };
+
+    Consolidator(const QStringList &files, const QDateTime &from, const QDateTime &to);
+
+    int run(int threads = 0);
+    bool write(const QString &filename) const;
+
+    QVector<Result> results() const;
+    RegisterStatistics total() const;
+
+    static void process(Result *result, const QDateTime &from, const QDateTime &to, int index);
+
+private:
+    QByteArray toJson() const;
+    QByteArray toCsv() const;
+
+    QVector<Result> m_results;
+    RegisterStatistics m_total;
+    QDateTime m_from;
+    QDateTime m_to;
+};
+
+#endif // CONSOLIDATOR_H
@@ -0,0 +1,97 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "consolidator.h"
+#include "defines.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QTextStream>
+
+/*
+ * qrk-consolidate [--from yyyy-MM-dd] [--to yyyy-MM-dd | --month yyyy-MM]
+ *                 [--threads n] --output file.(csv|json) database...
+ *
+ * Reads the end of day / end of month figures of several QRK register
+ * databases (<year>-QRK.db) read only and in parallel and writes them per
+ * register and summed up to one file.
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("qrk-consolidate");
+    QCoreApplication::setApplicationVersion(QString("%1.%2").arg(QRK_VERSION_MAJOR).arg(QRK_VERSION_MINOR));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QCoreApplication::translate("main", "Umsatzstatistik mehrerer QRK Kassen zusammenführen"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+
+    QCommandLineOption fromOption("from", QCoreApplication::translate("main", "Erster Tag (yyyy-MM-dd)"), "date");
+    parser.addOption(fromOption);
+    QCommandLineOption toOption("to", QCoreApplication::translate("main", "Letzter Tag (yyyy-MM-dd)"), "date");
+    parser.addOption(toOption);
+    QCommandLineOption monthOption("month", QCoreApplication::translate("main", "Monat (yyyy-MM)"), "month");
+    parser.addOption(monthOption);
+    QCommandLineOption threadsOption("threads", QCoreApplication::translate("main", "Anzahl gleichzeitig gelesener Datenbanken, 0 = ein Thread je CPU Kern"), "n", "0");
+    parser.addOption(threadsOption);
+    QCommandLineOption outputOption(QStringList() << "o" << "output", QCoreApplication::translate("main", "Ausgabedatei (.csv oder .json)"), "file");
+    parser.addOption(outputOption);
+    parser.addPositionalArgument("database", QCoreApplication::translate("main", "Kassen Datenbanken"), "database...");
+
+    parser.process(app);
+
+    QTextStream err(stderr);
+    QStringList files = parser.positionalArguments();
+    if (files.isEmpty() || !parser.isSet(outputOption)) {
+        err << parser.helpText();
+        return 1;
+    }
+
+    QDate fromDate = QDate::currentDate();
+    QDate toDate = fromDate;
+    if (parser.isSet(monthOption)) {
+        fromDate = QDate::fromString(parser.value(monthOption) + "-01", "yyyy-MM-dd");
+        toDate = fromDate.addMonths(1).addDays(-1);
+    }
+    if (parser.isSet(fromOption))
+        fromDate = QDate::fromString(parser.value(fromOption), "yyyy-MM-dd");
+    if (parser.isSet(toOption))
+        toDate = QDate::fromString(parser.value(toOption), "yyyy-MM-dd");
+
+    if (!fromDate.isValid() || !toDate.isValid() || toDate < fromDate) {
+        err << QCoreApplication::translate("main", "Ungültiger Zeitraum") << endl;
+        return 1;
+    }
+
+    for (int i = 0; i < files.size(); i++)
+        files[i] = QDir::fromNativeSeparators(files.at(i));
+
+    Consolidator consolidator(files, QDateTime(fromDate, QTime(0, 0, 0)), QDateTime(toDate, QTime(23, 59, 59)));
+    int failed = consolidator.run(parser.value(threadsOption).toInt());
+
+    if (!consolidator.write(parser.value(outputOption)))
+        return 1;
+
+    return failed > 0 ? 2 : 0;
+}
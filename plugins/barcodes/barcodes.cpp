@@ -22,11 +22,13 @@
 
 #include <QtWidgets>
 #include <QJsonObject>
+#include <QSqlDatabase>
 
 #include "database.h"
 #include "receiptitemmodel.h"
 #include "documentprinter.h"
 #include "reports.h"
+#include "singleton/fiscalperiod.h"
 #include "preferences/qrksettings.h"
 #include "defines.h"
 #include "barcodessettings.h"
@@ -127,21 +129,34 @@ bool Barcodes::process(ReceiptItemModel *model, int currIndex, QString barcode)
 
     switch(barcodes.indexOf(barcode)) {
     case 0:  {//m_barcode_finishReceipt
-        if (m_model->item(m_index,REGISTER_COL_PRODUCT)->text() == "")
+        if (m_model->value(m_index, REGISTER_COL_PRODUCT).toString() == "")
             break;
         if (m_model->rowCount() == 0)
             break;
 
-        Reports rep;
-        bool ret = rep.checkEOAny();
+        bool ret = FiscalPeriod::Instance()->isOpen();
+        if (!ret) {
+            Reports rep;
+            ret = rep.checkEOAny();
+        }
 
         if (ret) {
+            /* receipt, order lines and running totals are committed together */
+            QSqlDatabase dbc = Database::database();
+            dbc.transaction();
+            bool finished = false;
             if (int id = m_model->createReceipts()) {
                 m_model->setCurrentReceiptNum(id);
-                if (m_model->createOrder()) {
-                    m_model->finishReceipts(PAYED_BY_CASH);
-                    emit finishedReceipt();
-                }
+                if (m_model->createOrder())
+                    finished = m_model->finishReceipts(PAYED_BY_CASH);
+            }
+
+            if (finished) {
+                dbc.commit();
+                emit finishedReceipt();
+            } else {
+                dbc.rollback();
+                FiscalPeriod::Instance()->invalidate();
             }
         }
         break;
@@ -159,7 +174,7 @@ bool Barcodes::process(ReceiptItemModel *model, int currIndex, QString barcode)
         discount = true;
         initAmount();
         initAppendType();
-        m_model->item(m_index, REGISTER_COL_COUNT_TYPE_STR)->setText("1");
+        m_model->setValue(m_index, REGISTER_COL_COUNT_TYPE_STR, "1");
         resetAmount();
         break;
     }
@@ -167,7 +182,7 @@ bool Barcodes::process(ReceiptItemModel *model, int currIndex, QString barcode)
         discount = false;
         initAmount();
         initAppendType();
-        m_model->item(m_index, REGISTER_COL_COUNT_TYPE_STR)->setText("1");
+        m_model->setValue(m_index, REGISTER_COL_COUNT_TYPE_STR, "1");
         resetAmount();
         break;
     }
@@ -254,9 +269,10 @@ void Barcodes::printReceipt()
     QrkSettings settings;
     QJsonObject data = reg.compileData();
     data["isCopy"] = true;
-    int storno = Database::getStorno(id);
+    int stornoId = 0;
+    int storno = Database::getStorno(id, stornoId);
     if (storno == 2) {
-        id = Database::getStornoId(id);
+        id = stornoId;
         data["comment"] = (id > 0)? tr("Storno für Beleg Nr: %1").arg(id):settings.value("receiptPrinterHeading", "KASSABON").toString();
     }
 
@@ -271,32 +287,23 @@ void Barcodes::printReceipt()
 void Barcodes::stornoReceipt()
 {
     int id = Database::getLastReceiptNum(true);
-    int payedBy = Database::getPayedBy(id);
 
     int storno = Database::getStorno(id);
     if (storno)
         return; // kann nicht storniert werden. wurde schon storniert oder ist ein storno Beleg
 
     // Hier wird gecheckt ob ein Tags/Monatsabschluss gemacht werden muss
-    Reports rep;
-    bool ret = rep.checkEOAnyServerMode();
+    bool ret = FiscalPeriod::Instance()->isOpen();
+    if (!ret) {
+        Reports rep;
+        ret = rep.checkEOAnyServerMode();
+    }
     if (! ret) {
         return; // Fehler ???
     }
 
     ReceiptItemModel reg;
-    reg.newOrder();
-    reg.storno(id);
-
-    int currentReceipt = reg.createReceipts();
-    if ( currentReceipt ) {
-        reg.setCurrentReceiptNum(currentReceipt);
-        if ( reg.createOrder(true) ) {
-            if ( reg.finishReceipts(payedBy, id) ) {
-                return;
-            }
-        }
-    }
+    reg.cancelReceipt(id);
 }
 
 void Barcodes::handleAmount(QString amount) {
@@ -306,8 +313,8 @@ void Barcodes::handleAmount(QString amount) {
         initAmount();
         initAppendType();
 
-        QStandardItem* item = m_model->item(m_index, REGISTER_COL_COUNT_TYPE_STR);
-        if(QString::compare(item->text(), "0", Qt::CaseInsensitive)==0) {
+        QString type = m_model->value(m_index, REGISTER_COL_COUNT_TYPE_STR).toString();
+        if(QString::compare(type, "0", Qt::CaseInsensitive)==0) {
             appendToAmount(amount);
         } else {
             if (discount)
@@ -322,14 +329,14 @@ void Barcodes::appendToAmount(QString digits) {
 
     QString val;
     if (digits.length() == 1 || digits.startsWith("0"))
-        val = m_model->item(m_index, REGISTER_COL_COUNT_STR)->text() + digits;
+        val = m_model->value(m_index, REGISTER_COL_COUNT_STR).toString() + digits;
     else
         val = digits;
 
-    m_model->item(m_index, REGISTER_COL_COUNT_STR)->setText(val);
+    m_model->setValue(m_index, REGISTER_COL_COUNT_STR, val);
 
     QString valueAsString = QString::number(val.toFloat()/1000.0);
-    m_model->item(m_index, REGISTER_COL_COUNT)->setText(valueAsString);
+    m_model->setValue(m_index, REGISTER_COL_COUNT, valueAsString);
 }
 
 void Barcodes::initAmount() {
@@ -342,43 +349,41 @@ void Barcodes::initAppendType() {
 
 void Barcodes::resetAmount() {
 
-    m_model->item(m_index, REGISTER_COL_COUNT_STR)->setText("");
+    m_model->setValue(m_index, REGISTER_COL_COUNT_STR, "");
 }
 
 void Barcodes::appendToPrice(QString digits) {
 
     QString val;
     if (digits.length() == 1 || digits.startsWith("0"))
-        val = m_model->item(m_index, REGISTER_COL_COUNT_STR)->text() + digits;
+        val = m_model->value(m_index, REGISTER_COL_COUNT_STR).toString() + digits;
     else
         val = digits;
 
-    m_model->item(m_index, REGISTER_COL_COUNT_STR)->setText(val);
+    m_model->setValue(m_index, REGISTER_COL_COUNT_STR, val);
 
     QString valueAsString = QString::number(val.toFloat()/100.0);
-    m_model->item(m_index, REGISTER_COL_SINGLE)->setText(valueAsString);
+    m_model->setValue(m_index, REGISTER_COL_SINGLE, valueAsString);
 }
 
 void Barcodes::appendToDiscount(QString digits) {
 
     QString val;
     if (digits.length() == 1 || digits.startsWith("0"))
-        val = m_model->item(m_index, REGISTER_COL_COUNT_STR)->text() + digits;
+        val = m_model->value(m_index, REGISTER_COL_COUNT_STR).toString() + digits;
     else
         val = digits;
 
-    m_model->item(m_index, REGISTER_COL_COUNT_STR)->setText(val);
+    m_model->setValue(m_index, REGISTER_COL_COUNT_STR, val);
 
     QString valueAsString = QString::number(val.toFloat()/100.0);
-    m_model->item(m_index, REGISTER_COL_DISCOUNT)->setText(valueAsString);
+    m_model->setValue(m_index, REGISTER_COL_DISCOUNT, valueAsString);
 }
 
 void Barcodes::init(int col, QString val) {
 
-    QStandardItem* item = m_model->item(m_index, col);
-    if(item == 0) {
-        item = new QStandardItem(val);
-        m_model->setItem(m_index, col, item);
+    if(m_model->value(m_index, col).toString().isNull()) {
+        m_model->setValue(m_index, col, val);
         emit setColumnHidden(col);
     }
 }
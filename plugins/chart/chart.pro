@@ -40,10 +40,12 @@ DEFINES += QT_DEPRECATED_WARNINGS
 
 HEADERS         = chart.h \
     productchart.h \
-    chartwidget.h
+    chartwidget.h \
+    salesanalytics.h
 SOURCES         = chart.cpp \
     productchart.cpp \
-    chartwidget.cpp
+    chartwidget.cpp \
+    salesanalytics.cpp
 TARGET          = $$qtLibraryTarget(chart)
 
 CHART_FILES = chart.json
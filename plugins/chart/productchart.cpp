@@ -21,9 +21,11 @@
 */
 
 #include "productchart.h"
+#include "salesanalytics.h"
 #include "3rdparty/qbcmath/bcmath.h"
 #include "qrkpushbutton.h"
 #include "database.h"
+#include "utils/metrics.h"
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -32,6 +34,7 @@
 #include <QTableView>
 #include <QSplitter>
 #include <QComboBox>
+#include <QDateEdit>
 #include <QLabel>
 #include <QHeaderView>
 
@@ -48,7 +51,7 @@ ProductChart::ProductChart(QWidget *parent) : QDialog(parent)
 
 void ProductChart::setupModel()
 {
-    QSqlDatabase dbc = Database::database();
+    QSqlDatabase dbc = Database::readOnlyDatabase();
     QSqlQuery q(dbc);
     q.prepare("SELECT COUNT(id) FROM products WHERE products.`group` > 1");
     int rows = 0;
@@ -78,16 +81,64 @@ void ProductChart::setupViews()
 
     table->setModel(model);
 
+    QHBoxLayout *rangeLayout = new QHBoxLayout;
+    m_rangeCombo = new QComboBox;
+    m_rangeCombo->addItem(tr("Heute"), TODAY);
+    m_rangeCombo->addItem(tr("Gestern"), YESTERDAY);
+    m_rangeCombo->addItem(tr("Diese Woche"), WEEK);
+    m_rangeCombo->addItem(tr("Dieser Monat"), MONTH);
+    m_rangeCombo->addItem(tr("Dieses Jahr"), YEAR);
+    m_rangeCombo->addItem(tr("Gesamt"), ALL);
+    m_rangeCombo->addItem(tr("Benutzerdefiniert"), CUSTOM);
+    m_rangeCombo->setCurrentIndex(m_rangeCombo->findData(ALL));
+
+    m_fromEdit = new QDateEdit;
+    m_fromEdit->setCalendarPopup(true);
+    m_fromEdit->setDate(SalesAnalytics::firstDay());
+    m_toEdit = new QDateEdit;
+    m_toEdit->setCalendarPopup(true);
+    m_toEdit->setDate(QDate::currentDate());
+
+    QLabel *rangeLabel = new QLabel;
+    rangeLabel->setText(tr("Zeitraum"));
+    QLabel *fromLabel = new QLabel;
+    fromLabel->setText(tr("von"));
+    QLabel *toLabel = new QLabel;
+    toLabel->setText(tr("bis"));
+    QSpacerItem* rangeSpacer = new QSpacerItem( 0, 0, QSizePolicy::Expanding, QSizePolicy::Expanding );
+    rangeLayout->addWidget(rangeLabel);
+    rangeLayout->addWidget(m_rangeCombo);
+    rangeLayout->addWidget(fromLabel);
+    rangeLayout->addWidget(m_fromEdit);
+    rangeLayout->addWidget(toLabel);
+    rangeLayout->addWidget(m_toEdit);
+    rangeLayout->addItem(rangeSpacer);
+
     QHBoxLayout *comboLayout = new QHBoxLayout;
+    m_viewCombo = new QComboBox;
+    m_viewCombo->addItem(tr("Artikel"), PRODUCTS);
+    m_viewCombo->addItem(tr("Warengruppen"), GROUPS);
+    m_viewCombo->addItem(tr("Uhrzeit"), HOURS);
+    m_orderCombo = new QComboBox;
+    m_orderCombo->addItem(tr("Menge"), SOLD);
+    m_orderCombo->addItem(tr("Umsatz"), GROSS);
     m_combo = new QComboBox;
     m_combo->addItem("10", 10);
     m_combo->addItem("20", 20);
     m_combo->addItem("50", 50);
     m_combo->addItem(tr("alle"), -1);
     m_combo->setCurrentText("10");
+    QLabel *viewLabel = new QLabel;
+    viewLabel->setText(tr("Ansicht"));
+    QLabel *orderLabel = new QLabel;
+    orderLabel->setText(tr("nach"));
     QLabel *comboLabel = new QLabel;
     comboLabel->setText(tr("Anzeigen der Top"));
     QSpacerItem* comboSpacer = new QSpacerItem( 0, 0, QSizePolicy::Expanding, QSizePolicy::Expanding );
+    comboLayout->addWidget(viewLabel);
+    comboLayout->addWidget(m_viewCombo);
+    comboLayout->addWidget(orderLabel);
+    comboLayout->addWidget(m_orderCombo);
     comboLayout->addWidget(comboLabel);
     comboLayout->addWidget(m_combo);
     comboLayout->addItem(comboSpacer);
@@ -119,62 +170,71 @@ void ProductChart::setupViews()
     QFrame *lineH2 = new QFrame;
     lineH2->setFrameShape(QFrame::HLine);
 
+    vlayout->addLayout(rangeLayout);
     vlayout->addLayout(comboLayout);
     vlayout->addWidget(lineH1);
     vlayout->addWidget(splitter);
     vlayout->addWidget(lineH2);
     vlayout->addLayout(buttonLayout);
-    vlayout->setStretch(2,1);
+    vlayout->setStretch(3,1);
     setLayout(vlayout);
 
     connect(pushButton, &QPushButton::clicked, this, &ProductChart::close);
     connect(m_combo, &QComboBox::currentTextChanged, this, &ProductChart::comboBoxChanged);
+    connect(m_viewCombo, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &ProductChart::reload);
+    connect(m_orderCombo, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &ProductChart::reload);
+    connect(m_rangeCombo, static_cast<void(QComboBox::*)(int)>(&QComboBox::currentIndexChanged), this, &ProductChart::rangeChanged);
+    connect(m_fromEdit, &QDateEdit::dateChanged, this, &ProductChart::dateChanged);
+    connect(m_toEdit, &QDateEdit::dateChanged, this, &ProductChart::dateChanged);
 }
 
-void ProductChart::loadData(SORTORDER order)
+void ProductChart::loadData()
 {
+    MetricsTimer timer("chart.load");
+
+    SORTORDER order = SORTORDER(m_orderCombo->currentData().toInt());
+    VIEW view = VIEW(m_viewCombo->currentData().toInt());
+    SalesAnalytics::VALUE value = (order == SOLD) ? SalesAnalytics::COUNT : SalesAnalytics::TOTAL;
+    SalesAnalytics analytics(m_fromEdit->date(), m_toEdit->date());
+
+    m_combo->setEnabled(view == PRODUCTS);
+    model->setHeaderData(0, Qt::Horizontal, (view == PRODUCTS) ? tr("Produktname") : (view == GROUPS) ? tr("Warengruppe") : tr("Uhrzeit"));
+    model->setHeaderData(1, Qt::Horizontal, (order == SOLD) ? tr("verkauft") : tr("Umsatz"));
+
+    QList<SalesAnalytics::Entry> entries;
+    SalesAnalytics::Entry sum;
+    if (view == PRODUCTS) {
+        entries = analytics.topProducts(m_maxview, value);
+        sum = analytics.sum();
+    } else {
+        entries = (view == GROUPS) ? analytics.groups(value) : analytics.hours();
+        foreach (const SalesAnalytics::Entry &entry, entries) {
+            sum.count += entry.count;
+            sum.total += entry.total;
+        }
+    }
 
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery q(dbc);
-
-    q.prepare("SELECT sum(sold) as sold, sum(sold * gross) as gross FROM products WHERE products.`group` > 1");
-    q.exec();
-    q.next();
-    QBCMath whole(q.value("sold").toDouble());
-    if (order == GROSS)
-        whole = q.value("gross").toDouble();
+    QBCMath whole((order == SOLD) ? sum.count : sum.total / 100.0);
     whole.round(2);
 
     QBCMath current(0.0);
 
-    if (order == SOLD)
-        q.prepare("SELECT name, sold FROM products  WHERE products.`group` > 1 ORDER BY sold DESC LIMIT :limit");
-    else
-        q.prepare("SELECT name, sold * gross as sumgross FROM products  WHERE products.`group` > 1 ORDER BY sumgross DESC LIMIT :limit");
-
-    q.bindValue(":limit", m_maxview);
-    q.exec();
-
     model->removeRows(0, model->rowCount(QModelIndex()), QModelIndex());
 
     int size = QColor::colorNames().size();
     int row = 0;
     int color = 0;
-    while (q.next()) {
+    foreach (const SalesAnalytics::Entry &entry, entries) {
         model->insertRows(row, 1, QModelIndex());
 
-        QString name = q.value("name").toString();
-        QBCMath part;
-        if (order == SOLD) {
-            part = q.value("sold").toDouble();
-        } else {
-            part = q.value("sumgross").toDouble();
-        }
-
+        QString name = entry.name;
+        QBCMath part((order == SOLD) ? entry.count : entry.total / 100.0);
         part.round(2);
 
         current += part;
-        QBCMath percentage((part / whole) * 100);
+        QBCMath percentage(0.0);
+        if (whole > 0)
+            percentage = (part / whole) * 100;
         percentage.round(2);
 
         model->setData(model->index(row, 0, QModelIndex()), name);
@@ -213,10 +273,63 @@ void ProductChart::loadData(SORTORDER order)
     }
 }
 
-void ProductChart::comboBoxChanged(QString)
+void ProductChart::reload()
 {
-    m_maxview = m_combo->currentData().toInt();
     m_chart->removeItems();
     loadData();
     m_chart->repaint();
 }
+
+void ProductChart::comboBoxChanged(QString)
+{
+    m_maxview = m_combo->currentData().toInt();
+    reload();
+}
+
+void ProductChart::rangeChanged(int)
+{
+    QDate today = QDate::currentDate();
+    QDate from = m_fromEdit->date();
+    QDate to = today;
+
+    switch (m_rangeCombo->currentData().toInt()) {
+        case TODAY:
+            from = today;
+            break;
+        case YESTERDAY:
+            from = to = today.addDays(-1);
+            break;
+        case WEEK:
+            from = today.addDays(1 - today.dayOfWeek());
+            break;
+        case MONTH:
+            from = QDate(today.year(), today.month(), 1);
+            break;
+        case YEAR:
+            from = QDate(today.year(), 1, 1);
+            break;
+        case ALL:
+            from = SalesAnalytics::firstDay();
+            break;
+        default:
+            return;
+    }
+
+    m_fromEdit->blockSignals(true);
+    m_toEdit->blockSignals(true);
+    m_fromEdit->setDate(from);
+    m_toEdit->setDate(to);
+    m_fromEdit->blockSignals(false);
+    m_toEdit->blockSignals(false);
+
+    reload();
+}
+
+void ProductChart::dateChanged()
+{
+    m_rangeCombo->blockSignals(true);
+    m_rangeCombo->setCurrentIndex(m_rangeCombo->findData(CUSTOM));
+    m_rangeCombo->blockSignals(false);
+
+    reload();
+}
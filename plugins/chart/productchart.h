@@ -30,6 +30,7 @@ class QAbstractItemModel;
 class QAbstractItemView;
 class QItemSelectionModel;
 class QComboBox;
+class QDateEdit;
 
 class ProductChart : public QDialog
 {
@@ -37,18 +38,28 @@ class ProductChart : public QDialog
 
     public:
         enum SORTORDER {SOLD, GROSS};
+        enum VIEW {PRODUCTS, GROUPS, HOURS};
+        enum RANGE {TODAY, YESTERDAY, WEEK, MONTH, YEAR, ALL, CUSTOM};
 
         ProductChart(QWidget *parent = 0);
 
     private:
         void setupModel();
         void setupViews();
-        void loadData(SORTORDER order = SOLD);
+        void loadData();
+        void reload();
         void comboBoxChanged(QString text);
+        void rangeChanged(int index);
+        void dateChanged();
 
         QAbstractItemModel *model;
         ChartWidget *m_chart;
         QComboBox *m_combo;
+        QComboBox *m_rangeCombo;
+        QComboBox *m_viewCombo;
+        QComboBox *m_orderCombo;
+        QDateEdit *m_fromEdit;
+        QDateEdit *m_toEdit;
         int m_maxview = 10;
 };
 
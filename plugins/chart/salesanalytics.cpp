@@ -0,0 +1,123 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "salesanalytics.h"
+#include "database.h"
+#include "utils/metrics.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+SalesAnalytics::SalesAnalytics(const QDate &from, const QDate &to)
+    : m_fromDay(from.toString("yyyy-MM-dd")), m_toDay(to.toString("yyyy-MM-dd"))
+{
+}
+
+QList<SalesAnalytics::Entry> SalesAnalytics::topProducts(int limit, VALUE order) const
+{
+    MetricsTimer timer("chart.topProducts");
+    return select(QString("SELECT products.name as name, SUM(productSales.count) as sold, SUM(productSales.receipts) as receipts, SUM(productSales.total) as gross"
+                          " FROM productSales LEFT JOIN products ON productSales.product=products.id"
+                          " WHERE productSales.day BETWEEN :fromDay AND :toDay AND products.`group` > 1"
+                          " GROUP BY productSales.product, products.name ORDER BY %1 DESC").arg(order == COUNT ? "sold" : "gross"), limit);
+}
+
+QList<SalesAnalytics::Entry> SalesAnalytics::groups(VALUE order) const
+{
+    MetricsTimer timer("chart.groups");
+    return select(QString("SELECT `groups`.name as name, SUM(productSales.count) as sold, SUM(productSales.receipts) as receipts, SUM(productSales.total) as gross"
+                          " FROM productSales LEFT JOIN products ON productSales.product=products.id LEFT JOIN `groups` ON products.`group`=`groups`.id"
+                          " WHERE productSales.day BETWEEN :fromDay AND :toDay AND products.`group` > 1"
+                          " GROUP BY `groups`.id, `groups`.name ORDER BY %1 DESC").arg(order == COUNT ? "sold" : "gross"));
+}
+
+QList<SalesAnalytics::Entry> SalesAnalytics::hours() const
+{
+    MetricsTimer timer("chart.hours");
+    // hourlySales holds the products of group > 1 only, like the other views
+    QList<Entry> list = select("SELECT hour as name, SUM(count) as sold, SUM(receipts) as receipts, SUM(total) as gross"
+                               " FROM hourlySales WHERE day BETWEEN :fromDay AND :toDay GROUP BY hour ORDER BY hour");
+
+    for (int i = 0; i < list.size(); i++)
+        list[i].name = QString("%1:00").arg(list[i].name.toInt(), 2, 10, QChar('0'));
+
+    return list;
+}
+
+SalesAnalytics::Entry SalesAnalytics::sum() const
+{
+    QList<Entry> list = select("SELECT '' as name, SUM(productSales.count) as sold, SUM(productSales.receipts) as receipts, SUM(productSales.total) as gross"
+                               " FROM productSales LEFT JOIN products ON productSales.product=products.id"
+                               " WHERE productSales.day BETWEEN :fromDay AND :toDay AND products.`group` > 1");
+
+    if (list.isEmpty())
+        return Entry();
+
+    return list.first();
+}
+
+QDate SalesAnalytics::firstDay()
+{
+    QSqlDatabase dbc = Database::readOnlyDatabase();
+    QSqlQuery query(dbc);
+
+    if (query.exec("SELECT MIN(day) FROM productSales") && query.next()) {
+        QDate date = QDate::fromString(query.value(0).toString(), "yyyy-MM-dd");
+        if (date.isValid())
+            return date;
+    }
+
+    return QDate::currentDate();
+}
+
+QList<SalesAnalytics::Entry> SalesAnalytics::select(const QString &sql, int limit) const
+{
+    QList<Entry> list;
+
+    QSqlDatabase dbc = Database::readOnlyDatabase();
+    QSqlQuery query(dbc);
+    query.setForwardOnly(true);
+    query.prepare(limit > 0 ? sql + " LIMIT :limit" : sql);
+    query.bindValue(":fromDay", m_fromDay);
+    query.bindValue(":toDay", m_toDay);
+    if (limit > 0)
+        query.bindValue(":limit", limit);
+
+    if (!query.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return list;
+    }
+
+    while (query.next()) {
+        Entry entry;
+        entry.name = query.value("name").toString();
+        entry.count = query.value("sold").toDouble();
+        entry.receipts = query.value("receipts").toInt();
+        entry.total = query.value("gross").toLongLong();
+        list.append(entry);
+    }
+
+    return list;
+}
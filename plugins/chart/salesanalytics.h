@@ -0,0 +1,65 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef SALESANALYTICS_H
+#define SALESANALYTICS_H
+
+#include <QDate>
+#include <QList>
+#include <QString>
+
+/**
+ * @brief The SalesAnalytics class answers the chart queries for a date range
+ * from the daily productSales and hourlySales buckets, which are filled when a
+ * receipt is finished. Totals are kept in cents.
+ */
+class SalesAnalytics
+{
+    public:
+        enum VALUE {COUNT, TOTAL};
+
+        struct Entry
+        {
+            Entry() : count(0.0), receipts(0), total(0) {}
+            QString name;
+            double count;
+            int receipts;
+            qint64 total;
+        };
+
+        SalesAnalytics(const QDate &from, const QDate &to);
+
+        QList<Entry> topProducts(int limit, VALUE order = COUNT) const;
+        QList<Entry> groups(VALUE order = COUNT) const;
+        QList<Entry> hours() const;
+        Entry sum() const;
+
+        static QDate firstDay();
+
+    private:
+        QList<Entry> select(const QString &sql, int limit = -1) const;
+
+        QString m_fromDay;
+        QString m_toDay;
+};
+
+#endif // SALESANALYTICS_H
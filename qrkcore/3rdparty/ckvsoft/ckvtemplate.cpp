@@ -28,11 +28,44 @@
  */
 
 #include "ckvtemplate.h"
+#include "3rdparty/qbcmath/bcmath.h"
 
 #include <QDate>
 #include <QTime>
+#include <QHash>
+#include <QMutex>
+#include <QScopedPointer>
 #include <QDebug>
 
+namespace {
+/* stands for the variable while a compiled expression is derived */
+const QChar SLOT_MARKER(0xE000);
+const int SCALE = 10;
+
+QString decimal(const QString &number)
+{
+    bool ok;
+    number.toDouble(&ok);
+    if (!ok)
+        return "0";
+
+    QString value = number;
+    if (value.startsWith('.'))
+        value.prepend('0');
+    if (value.endsWith('.'))
+        value.append('0');
+
+    return value;
+}
+
+QString round2(const QString &value)
+{
+    QBCMath result(value);
+    result.round(2);
+    return result.toString();
+}
+}
+
 ckvTemplate::ckvTemplate()
 {
 }
@@ -257,7 +290,7 @@ QList<QPair<int, QString> > ckvTemplate::derive(QVector<QPair<int, QString> > to
 
 ckvTemplate::Types ckvTemplate::getType(QChar c)
 {
-    if (c.isDigit()) return NUMBER;
+    if (c.isDigit() || c == SLOT_MARKER) return NUMBER;
     if (c == ' ') return SPACE;
     if (c == '*' || c == '+' || c == '/' || c == '%' || c == '-') return OPERATION;
     if (c == '~') return OPERATION; // sentinel
@@ -302,3 +335,313 @@ void Dictionary::set(const QString & name, const QString & value)
     }
     properties.push_back(QPair<QString, QString>(name, value));
 }
+
+ckvCompiledTemplate::ckvCompiledTemplate(const QString &tpl, const QStringList &variables)
+    : m_variables(variables)
+{
+    QStringMatcher in("{{");
+    QStringMatcher out("}}");
+    int position = 0;
+
+    while (position < tpl.size()) {
+        int next = in.indexIn(tpl, position);
+        if (next == -1) {
+            appendText(tpl.mid(position));
+            break;
+        }
+
+        appendText(tpl.mid(position, next - position));
+        position = next + 2;
+        if (position >= tpl.size())
+            break;
+
+        next = out.indexIn(tpl, position);
+        if (next == -1) {
+            /* ckvTemplate asserts here, keep the rest as it is */
+            appendText(tpl.mid(position - 2));
+            break;
+        }
+
+        compileCode(tpl.mid(position, next - position));
+        position = next + 2;
+    }
+}
+
+/**
+ * @brief ckvCompiledTemplate::compile
+ * returns the compiled template from the cache. Header and footer texts
+ * change only when the settings are changed, so the text is the key.
+ * @param tpl
+ * @param variables
+ * @return
+ */
+QSharedPointer<const ckvCompiledTemplate> ckvCompiledTemplate::compile(const QString &tpl, const QStringList &variables)
+{
+    static QMutex mutex;
+    static QHash<QString, QSharedPointer<const ckvCompiledTemplate> > cache;
+
+    QString key = variables.join(QChar(0x1f)) + QChar(0x1e) + tpl;
+
+    QMutexLocker locker(&mutex);
+    QSharedPointer<const ckvCompiledTemplate> compiled = cache.value(key);
+    if (compiled.isNull()) {
+        if (cache.size() >= 32)
+            cache.clear();
+
+        compiled = QSharedPointer<const ckvCompiledTemplate>(new ckvCompiledTemplate(tpl, variables));
+        cache.insert(key, compiled);
+    }
+
+    return compiled;
+}
+
+void ckvCompiledTemplate::appendText(const QString &text)
+{
+    if (text.isEmpty())
+        return;
+
+    if (!m_parts.isEmpty() && m_parts.last().kind == TEXT) {
+        m_parts.last().text.append(text);
+        return;
+    }
+
+    Part part;
+    part.kind = TEXT;
+    part.text = text;
+    part.slot = -1;
+    part.word = -1;
+    m_parts.append(part);
+}
+
+void ckvCompiledTemplate::compileCode(const QString &code)
+{
+    ckvTemplate engine;
+
+    Part part;
+    part.kind = DYNAMIC;
+    part.text = code;
+    part.slot = -1;
+    part.word = -1;
+    part.words = code.split(" ");
+
+    /* like Dictionary::find, the first variable found is the only one replaced */
+    for (int i = 0; i < m_variables.size() && part.slot < 0; i++) {
+        int word = part.words.indexOf(m_variables.at(i));
+        if (word >= 0) {
+            part.slot = i;
+            part.word = word;
+        }
+    }
+
+    if (part.slot < 0) {
+        appendText(engine.calculate(code));
+        return;
+    }
+
+    if (part.words.size() == 1) {
+        part.kind = VARIABLE;
+        m_parts.append(part);
+        return;
+    }
+
+    /* a numeric value gives exactly one number token if the variable stands
+     * between operators, and without letters and ':' checkForDate can't
+     * match. Everything else is left to ckvTemplate */
+    QString before = QStringList(part.words.mid(0, part.word)).join(" ");
+    QString after = QStringList(part.words.mid(part.word + 1)).join(" ");
+    QString others = before + " " + after;
+
+    bool plain = !others.contains(':');
+    for (int i = 0; plain && i < others.size(); i++)
+        plain = !others.at(i).isLetter();
+
+    int last = before.size() - 1;
+    while (last >= 0 && before.at(last) == ' ')
+        last--;
+    int first = 0;
+    while (first < after.size() && after.at(first) == ' ')
+        first++;
+
+    plain = plain && (last < 0 || engine.getType(before.at(last)) == ckvTemplate::OPERATION);
+    plain = plain && (first >= after.size() || engine.getType(after.at(first)) == ckvTemplate::OPERATION);
+
+    if (plain) {
+        QStringList words = part.words;
+        words[part.word] = SLOT_MARKER;
+        QVector<QPair<int, QString> > tokens = engine.tokenize(words.join(" "));
+
+        int slots = 0;
+        for (int i = 0; plain && i < tokens.size(); i++) {
+            if (tokens[i].second.contains(SLOT_MARKER)) {
+                plain = (tokens[i].second == QString(SLOT_MARKER));
+                slots++;
+            }
+        }
+
+        if (plain && slots == 1) {
+            part.kind = EXPRESSION;
+            part.calc = engine.derive(tokens);
+        }
+    }
+
+    m_parts.append(part);
+}
+
+QString ckvCompiledTemplate::render(const QStringList &values) const
+{
+    QString str;
+    QScopedPointer<ckvTemplate> dictionary;
+
+    foreach (const Part &part, m_parts) {
+        QString value = values.value(part.slot);
+        QString result;
+        bool dynamic = (part.kind == DYNAMIC);
+
+        switch (part.kind) {
+        case TEXT:
+            str.append(part.text);
+            continue;
+        case VARIABLE:
+            dynamic = value.isEmpty() || hasOperation(value);
+            if (!dynamic) {
+                result = ckvTemplate::checkForDate(value);
+                dynamic = hasOperation(result);
+            }
+            break;
+        case EXPRESSION:
+            dynamic = !isNumber(value);
+            if (!dynamic)
+                result = evaluate(part, value);
+            break;
+        case DYNAMIC:
+            break;
+        }
+
+        if (dynamic) {
+            if (dictionary.isNull()) {
+                dictionary.reset(new ckvTemplate);
+                for (int i = 0; i < m_variables.size(); i++)
+                    dictionary->set(m_variables.at(i), values.value(i));
+            }
+            result = part.text;
+            dictionary->replace(result);
+            result = dictionary->calculate(result);
+        }
+
+        str.append(result);
+    }
+
+    return str;
+}
+
+/**
+ * @brief ckvCompiledTemplate::evaluate
+ * same order of calculation as ckvTemplate::calculate, but with exact
+ * decimals instead of double round trips
+ */
+QString ckvCompiledTemplate::evaluate(const Part &part, const QString &value) const
+{
+    QString number = value;
+    number.replace(',', '.');
+
+    QList<QPair<int, QString> > calc = part.calc;
+    for (int i = 0; i < calc.size(); i++) {
+        if (calc[i].second == QString(SLOT_MARKER))
+            calc[i].second = number;
+    }
+
+    if (calc.size() == 0)
+        return substitute(part, value);
+
+    QPair<int, QString> a, b, op, result;
+    int atback = 0;
+    while (calc.size() > 2) {
+        a = calc[0];
+        b = calc[1];
+        op = calc[2];
+
+        if (op.first != ckvTemplate::OPERATION) {
+            calc.push_back(a);
+            calc.pop_front();
+
+            if (++atback > calc.size())
+                break;
+        } else {
+            calc.pop_front(); calc.pop_front(); calc.pop_front();
+
+            QString lhs = decimal(a.second);
+            QString rhs = decimal(b.second);
+
+            if (op.second == "*") {
+                result.second = round2(QBCMath::bcmul(lhs, rhs, SCALE));
+            } else if (op.second == "+") {
+                result.second = round2(QBCMath::bcadd(lhs, rhs, SCALE));
+            } else if (op.second == "-") {
+                result.second = round2(QBCMath::bcsub(lhs, rhs, SCALE));
+            } else {
+                if (QBCMath::bccomp(rhs, "0", SCALE) == 0) {
+                    qWarning() << "Division by zero!";
+                    break;
+                }
+                if (op.second == "/") {
+                    result.second = round2(QBCMath::bcdiv(lhs, rhs, SCALE));
+                } else if (op.second == "%") {
+                    if (b.second.toInt() == 0) {
+                        qWarning() << "Division by zero!";
+                        break;
+                    }
+                    result.second = QString::number(a.second.toInt() % b.second.toInt());
+                }
+            }
+
+            calc.push_front(result);
+
+            while (atback-- > 0) {
+                calc.push_front(calc.back());
+                calc.pop_back();
+            }
+            atback = 0;
+        }
+    }
+
+    if (result.second.isEmpty())
+        return substitute(part, value);
+
+    return result.second;
+}
+
+QString ckvCompiledTemplate::substitute(const Part &part, const QString &value)
+{
+    QStringList words = part.words;
+    words[part.word] = value;
+    return words.join(" ");
+}
+
+bool ckvCompiledTemplate::isNumber(const QString &value)
+{
+    /* digits with an optional decimal part, like "12,50" */
+    int separator = -1;
+    for (int i = 0; i < value.size(); i++) {
+        QChar c = value.at(i);
+        if (c >= '0' && c <= '9')
+            continue;
+        if ((c == '.' || c == ',') && separator < 0 && i > 0) {
+            separator = i;
+            continue;
+        }
+        return false;
+    }
+
+    return !value.isEmpty() && separator != value.size() - 1;
+}
+
+bool ckvCompiledTemplate::hasOperation(const QString &value)
+{
+    for (int i = 0; i < value.size(); i++) {
+        QChar c = value.at(i);
+        if (c == '*' || c == '+' || c == '/' || c == '%' || c == '-' || c == '~')
+            return true;
+    }
+
+    return false;
+}
@@ -36,6 +36,8 @@
 #include <QObject>
 #include <QPair>
 #include <QVector>
+#include <QStringList>
+#include <QSharedPointer>
 #include <QTextStream>
 
 class CKVSOFT_EXPORT Dictionary
@@ -51,6 +53,7 @@ class CKVSOFT_EXPORT Dictionary
 
 class CKVSOFT_EXPORT ckvTemplate : public Dictionary
 {
+    friend class ckvCompiledTemplate;
 
     public:
         ckvTemplate();
@@ -69,8 +72,55 @@ class CKVSOFT_EXPORT ckvTemplate : public Dictionary
         QVector<QPair <int, QString> > tokenize(QString s);
         QList<QPair <int, QString> > derive(QVector <QPair<int, QString> > tokens);
         QString calculate(QString s);
-        QString checkForDate(QString name);
+        static QString checkForDate(QString name);
         void replace(QString &name);
 };
 
+/**
+ * @brief The ckvCompiledTemplate class
+ * a template compiled once for a fixed list of variables, rendering gives
+ * the same text as ckvTemplate::process with the variables set in the same
+ * order. Expressions on a numeric variable are derived at compile time and
+ * calculated with exact decimals, everything else falls back to ckvTemplate.
+ * A result ending in a half cent therefore may differ: ckvTemplate rounds
+ * the double with QString::number, here the decimal is rounded half up,
+ * e.g. {{SUMME / 2}} with SUMME 2.01 gives 1.00 there and 1.01 here.
+ */
+class CKVSOFT_EXPORT ckvCompiledTemplate
+{
+
+    public:
+        ckvCompiledTemplate(const QString &tpl, const QStringList &variables);
+        QString render(const QStringList &values) const;
+
+        static QSharedPointer<const ckvCompiledTemplate> compile(const QString &tpl, const QStringList &variables);
+
+    private:
+        enum Kind {
+            TEXT = 0,
+            VARIABLE,
+            EXPRESSION,
+            DYNAMIC
+        };
+
+        struct Part {
+            Kind kind;
+            QString text;
+            int slot;
+            int word;
+            QStringList words;
+            QList<QPair<int, QString> > calc;
+        };
+
+        void compileCode(const QString &code);
+        void appendText(const QString &text);
+        QString evaluate(const Part &part, const QString &value) const;
+        static QString substitute(const Part &part, const QString &value);
+        static bool isNumber(const QString &value);
+        static bool hasOperation(const QString &value);
+
+        QStringList m_variables;
+        QVector<Part> m_parts;
+};
+
 #endif // TEMPLATE_H
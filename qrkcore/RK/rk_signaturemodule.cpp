@@ -23,7 +23,9 @@
 #include "rk_signaturemodule.h"
 #include "base32decode.h"
 #include "base32encode.h"
+#include "rk_turnovercrypto.h"
 #include "database.h"
+#include "singleton/fiscalstate.h"
 
 #include <stdio.h>
 
@@ -35,6 +37,9 @@
 
 #include <QtEndian>
 #include <QDataStream>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QDateTime>
@@ -43,12 +48,17 @@
 using namespace std;
 using namespace CryptoPP;
 
-bool SignatureModuleSetDamaged = false;
+
+namespace {
+QMutex s_turnoverKeyMutex;
+QString s_turnoverKey;
+}
 
 /**
  * @brief RKSignatureModule::RKSignatureModule
  */
 RKSignatureModule::RKSignatureModule()
+    : m_turnoverCrypto(0)
 {
     m_certificateserial = "";
 }
@@ -58,6 +68,7 @@ RKSignatureModule::RKSignatureModule()
  */
 RKSignatureModule::~RKSignatureModule()
 {
+    delete m_turnoverCrypto;
 }
 
 /**
@@ -77,18 +88,26 @@ QString RKSignatureModule::getDataToBeSigned(QString data)
 /**
  * @brief RKSignatureModule::HashValue
  * @param value
- * @return
+ * @return upper case hex SHA-256 of the UTF-8 value
  */
 QByteArray RKSignatureModule::HashValue(QString value)
 {
-    SHA256 hashtest;
-    string message = value.toStdString();
-    string digest;
+    return QCryptographicHash::hash(value.toUtf8(), QCryptographicHash::Sha256).toHex().toUpper();
+}
 
-    StringSource s(message, true, new HashFilter(hashtest, new HexEncoder(new StringSink(digest))));
-//    StringSource s(message, true, new HashFilter(hashtest, new ArraySink(test, sizeof(test))));
+/**
+ * @brief RKSignatureModule::turnoverCrypto
+ * @param symmetricKey
+ * @return the crypto context for the key, it is kept until another key is used
+ */
+RKTurnoverCrypto *RKSignatureModule::turnoverCrypto(const QString &symmetricKey)
+{
+    if (!m_turnoverCrypto || m_turnoverCrypto->key() != QByteArray::fromHex(symmetricKey.toLatin1())) {
+        delete m_turnoverCrypto;
+        m_turnoverCrypto = new RKTurnoverCrypto(symmetricKey);
+    }
 
-    return QByteArray::fromStdString(digest);
+    return m_turnoverCrypto;
 }
 
 /**
@@ -100,8 +119,7 @@ QByteArray RKSignatureModule::HashValue(QString value)
  */
 QString RKSignatureModule::encryptTurnoverCounter( QString concatenated, qlonglong turnoverCounter, QString symmetricKey)
 {
-    QString hashValue = HashValue(concatenated);
-    return encryptCTR(hashValue.toStdString(), turnoverCounter, symmetricKey.toStdString());
+    return turnoverCrypto(symmetricKey)->encrypt(concatenated, turnoverCounter);
 }
 
 /**
@@ -113,8 +131,7 @@ QString RKSignatureModule::encryptTurnoverCounter( QString concatenated, qlonglo
  */
 QString RKSignatureModule::decryptTurnoverCounter( QString concatenated, QString encodedTurnoverCounter, QString symmetricKey)
 {
-    QString hashValue = HashValue(concatenated);
-    return decryptCTR(hashValue.toStdString(), encodedTurnoverCounter, symmetricKey.toStdString());
+    return QString::number(turnoverCrypto(symmetricKey)->decrypt(concatenated, encodedTurnoverCounter));
 }
 
 /**
@@ -224,96 +241,16 @@ QByteArray RKSignatureModule::base32_decode(QByteArray str)
 
 }
 
-/**
- * @brief RKSignatureModule::encryptCTR
- * @param string concatenatedHashValue
- * @param qlonglong turnoverCounter
- * @param string symmetricKey
- * @return
- */
-QString RKSignatureModule::encryptCTR(std::string concatenatedHashValue, qlonglong turnoverCounter, std::string symmetricKey)
-{
-
-    const int RKSuitSize = 8;
-    union {
-        qlonglong source;
-        byte data[RKSuitSize];
-    } Union;
-
-    memset( Union.data, 0x00, RKSuitSize );
-    Union.source = qToBigEndian(turnoverCounter);
-
-    byte key[ AES::MAX_KEYLENGTH ], iv[ AES::BLOCKSIZE ];
-    StringSource ssk(symmetricKey , true, new HexDecoder( new ArraySink(key, AES::MAX_KEYLENGTH)));
-    StringSource ssv(concatenatedHashValue, true, new HexDecoder( new ArraySink(iv, AES::BLOCKSIZE)));
-
-    byte out[RKSuitSize];
-    memset( out, 0x00, RKSuitSize );
-
-    try {
-        CTR_Mode<AES>::Encryption encryption(key,sizeof(key),iv, sizeof(iv));
-        encryption.ProcessData(out,Union.data,sizeof(Union.data));
-    } catch (Exception &e) {
-        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << e.what();
-    }
-
-    QByteArray ba = 0;
-    ba.append(reinterpret_cast<const char *>(out), sizeof(out));
-
-    return ba.toBase64();
-}
-
-/**
- * @brief RKSignatureModule::decryptCTR
- * @param string concatenatedHashValue
- * @param QString encryptedTurnoverCounter
- * @param string symmetricKey
- * @return
- */
-QString RKSignatureModule::decryptCTR(std::string concatenatedHashValue, QString encryptedTurnoverCounter, std::string symmetricKey)
-{
-    const int RKSuitSize = 8;
-    QByteArray baBase64 = 0;
-    baBase64.append(encryptedTurnoverCounter);
-    string encryptedTurnoverCounterHex = QByteArray::fromBase64(baBase64).toHex().toStdString();
-
-    byte data[AES::BLOCKSIZE];
-    memset( data, 0x00, AES::BLOCKSIZE );
-
-    byte recovered[RKSuitSize];
-    memset( recovered, 0x00, RKSuitSize );
-
-    byte key[ AES::MAX_KEYLENGTH ], iv[ AES::BLOCKSIZE ];
-    StringSource ssk(symmetricKey , true, new HexDecoder( new ArraySink(key, AES::MAX_KEYLENGTH)));
-    StringSource ssv(concatenatedHashValue, true, new HexDecoder( new ArraySink(iv, AES::BLOCKSIZE)));
-    StringSource ssd(encryptedTurnoverCounterHex, true, new HexDecoder( new ArraySink(data, AES::BLOCKSIZE)));
-
-    try {
-        CTR_Mode<AES>::Decryption decryption(key,sizeof(key),iv, sizeof(iv));
-        decryption.ProcessData(recovered,data,AES::BLOCKSIZE);
-    } catch (Exception &e) {
-        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << e.what();
-    }
-
-    /* we need only 8 Bytes for Turnover minimum is 5 Byte */
-    union {
-        qlonglong source;
-        byte data[RKSuitSize];
-    } Union;
-    memset( Union.data, 0x00, RKSuitSize );
-    /* reconstruct reverse */
-    for (int i=0; i < 8;i++)
-        Union.data[i] = recovered[7 - i];
-
-    return QString::number(Union.source);
-}
-
 /**
  * @brief RKSignatureModule::getPrivateTurnoverKey
  * @return QString PrivateTurnoverKey (AES Key)
  */
 QString RKSignatureModule::getPrivateTurnoverKey()
 {
+    QMutexLocker locker(&s_turnoverKeyMutex);
+    if (!s_turnoverKey.isEmpty())
+        return s_turnoverKey;
+
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
     query.prepare("SELECT value, strValue FROM globals WHERE name='PrivateTurnoverKey'");
@@ -321,17 +258,30 @@ QString RKSignatureModule::getPrivateTurnoverKey()
     if (query.next()) {
         int val = query.value(0).toInt();
         /* increment manual for keyversions check */
-        if (val == 1)
-            return query.value(1).toString();
+        if (val == 1) {
+            s_turnoverKey = query.value(1).toString();
+            return s_turnoverKey;
+        }
     }
     QString key = RKSignatureModule::generatePrivateTurnoverHexKey();
     query.prepare(QString("INSERT INTO globals (name, value, strValue) VALUES('PrivateTurnoverKey', 1, '%1')").arg(key));
-    query.exec();
+    if (query.exec())
+        s_turnoverKey = key;
 
     return key;
 
 }
 
+/**
+ * @brief RKSignatureModule::resetPrivateTurnoverKey
+ * forgets the cached key, call it after the globals entry was removed
+ */
+void RKSignatureModule::resetPrivateTurnoverKey()
+{
+    QMutexLocker locker(&s_turnoverKeyMutex);
+    s_turnoverKey.clear();
+}
+
 /**
  * @brief RKSignatureModule::getPrivateTurnoverKeyBase64
  * @return QString AES Key Base64 encoded
@@ -419,28 +369,12 @@ void RKSignatureModule::putCertificate(int serial, QString certificateB64)
 
 void RKSignatureModule::setSignatureModuleDamaged()
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-
-    query.prepare("INSERT INTO globals (name, strValue) VALUES('signatureModuleIsDamaged', :date)");
-    query.bindValue(":date", QDateTime::currentDateTime().toString(Qt::ISODate) );
-
-    query.exec();
-    SignatureModuleSetDamaged = true;
+    FiscalState::Instance()->setSignatureModuleDamaged(true);
 }
 
 bool RKSignatureModule::isSignatureModuleSetDamaged()
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-
-    query.prepare("SELECT strValue FROM globals WHERE name='signatureModuleIsDamaged'");
-    query.exec();
-
-    if (query.next())
-        return true;
-
-    return SignatureModuleSetDamaged;
+    return FiscalState::Instance()->isSignatureModuleDamaged();
 }
 
 QString RKSignatureModule::resetSignatureModuleDamaged()
@@ -456,10 +390,7 @@ QString RKSignatureModule::resetSignatureModuleDamaged()
     if (query.next())
         ISODate = query.value(0).toString();
 
-    query.prepare("DELETE FROM globals WHERE name='signatureModuleIsDamaged'");
-    query.exec();
-
-    SignatureModuleSetDamaged = false;
+    FiscalState::Instance()->setSignatureModuleDamaged(false);
     return ISODate;
 
 }
@@ -491,17 +422,7 @@ QString RKSignatureModule::generatePrivateTurnoverHexKey()
  */
 bool RKSignatureModule::isDEPactive()
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-    query.prepare("SELECT value FROM globals WHERE name='DEP'");
-    query.exec();
-    if (query.next()) {
-        bool active = query.value(0).toBool();
-        return active;
-    }
-
-    return false;
-
+    return FiscalState::Instance()->isDEPactive();
 }
 
 /**
@@ -510,16 +431,5 @@ bool RKSignatureModule::isDEPactive()
  */
 void RKSignatureModule::setDEPactive(bool active)
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-    query.prepare("SELECT value FROM globals WHERE name='DEP'");
-    query.exec();
-    if (query.next()) {
-        query.prepare("UPDATE globals SET value=:active WHERE name='DEP'");
-        query.bindValue(":active", active);
-    } else {
-        query.prepare("INSERT INTO globals (name, value) VALUES('DEP', :active)");
-        query.bindValue(":active", active);
-    }
-    query.exec();
+    FiscalState::Instance()->setDEPactive(active);
 }
@@ -37,6 +37,8 @@
 
 #include "qrkcore_global.h"
 
+class RKTurnoverCrypto;
+
 #define MAX_APDU_BUFFER_SIZE 260 // Max is 256 bytes, but allow some additional space
 
 typedef struct
@@ -60,6 +62,7 @@ public:
     static QByteArray base32_encode(QByteArray str);
     static QByteArray base32_decode(QByteArray str);
     static QString getPrivateTurnoverKey();
+    static void resetPrivateTurnoverKey();
     static QString getPrivateTurnoverKeyBase64();
     static QJsonObject getCertificateMap();
     static bool isDEPactive();
@@ -89,12 +92,11 @@ protected:
 
     QByteArray HashValue(QString value);
     void putCertificate(int serial, QString certificateB64);
-    QString encryptCTR(std::string concatenatedHashValue, qlonglong turnoverCounter, std::string symmetricKey);
-    QString decryptCTR(std::string concatenatedHashValue, QString encryptedTurnoverCounter, std::string symmetricKey);
 
+private:
+    RKTurnoverCrypto *turnoverCrypto(const QString &symmetricKey);
+    RKTurnoverCrypto *m_turnoverCrypto;
 
 };
 
-extern bool SignatureModuleSetDamaged;
-
 #endif // RKSIGNATUREMODULE_H
@@ -0,0 +1,175 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "rk_signaturesession.h"
+#include "rk_signaturemodule.h"
+#include "rk_signaturemodulefactory.h"
+#include "database.h"
+#include "utils/utils.h"
+#include "utils/demomode.h"
+#include "utils/metrics.h"
+#include "singleton/spreadsignal.h"
+#include "3rdparty/qbcmath/bcmath.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+RKSignatureSession::RKSignatureSession()
+    : m_module(Q_NULLPTR), m_error(false)
+{
+    m_accepted.turnOverCounter = 0;
+    m_pending = m_accepted;
+}
+
+RKSignatureSession::~RKSignatureSession()
+{
+    end();
+}
+
+/**
+ * @brief RKSignatureSession::begin
+ * opens the signature module and reads the state after receipt lastReceiptNum,
+ * the receipt signed next must be lastReceiptNum + 1.
+ * @param lastReceiptNum
+ * @return false if the signature module or the DEP could not be read
+ */
+bool RKSignatureSession::begin(int lastReceiptNum)
+{
+    end();
+
+    m_module = RKSignatureModuleFactory::createInstance("", DemoMode::isDemoMode());
+    m_module->selectApplication();
+    m_symmetricKey = RKSignatureModule::getPrivateTurnoverKey();
+    m_error = false;
+
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+    query.prepare("SELECT tax FROM taxTypes WHERE taxlocation=:taxlocation ORDER BY id");
+    query.bindValue(":taxlocation", Database::getTaxLocation());
+
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " error: " << query.lastError().text();
+        m_error = true;
+    }
+
+    m_taxTypes.clear();
+    while (query.next())
+        m_taxTypes.append(Database::getTaxType(query.value(0).toDouble()));
+
+    m_accepted.lastSignature = Utils::getReceiptSignature(lastReceiptNum, true);
+    m_accepted.lastSerial.clear();
+    m_accepted.turnOverCounter = Utils::getTurnOverCounter(m_module, m_accepted.lastSignature, m_accepted.lastSerial, m_error);
+    m_pending = m_accepted;
+
+    return !m_error && !m_accepted.lastSignature.isEmpty();
+}
+
+void RKSignatureSession::end()
+{
+    delete m_module;
+    m_module = Q_NULLPTR;
+}
+
+bool RKSignatureSession::isActive() const
+{
+    return m_module != Q_NULLPTR;
+}
+
+/**
+ * @brief RKSignatureSession::sign
+ * builds and signs the machine readable code of a receipt like
+ * Utils::getSignature does, the counter and the previous signature come from
+ * memory instead of the DEP.
+ * @param data compiled receipt data
+ * @return the signature, empty on error
+ */
+QString RKSignatureSession::sign(const QJsonObject &data)
+{
+    if (!m_module)
+        return QString();
+
+    Spread::Instance()->setProgressBarWait(true);
+
+    QJsonObject sign;
+    sign["Kassen-ID"] = data.value("kasse").toString();
+    sign["Belegnummer"] = QString::number(data.value("receiptNum").toInt());
+    sign["Beleg-Datum-Uhrzeit"] = data.value("receiptTime").toString();
+
+    qlonglong counter = 0;
+    foreach (const QString &taxType, m_taxTypes) {
+        QBCMath gross = data.value(taxType).toDouble();
+        gross.round(2);
+
+        sign[taxType] = gross.toString();
+        counter += sign.value(taxType).toString().replace(".","").toLongLong();
+    }
+
+    QString concatenatedValue = sign["Kassen-ID"].toString() + sign["Belegnummer"].toString();
+    qlonglong turnOverCounter = m_pending.turnOverCounter + counter;
+
+    if (data.value("isStorno").toBool(false))
+        sign["Stand-Umsatz-Zaehler-AES256-ICM"] = "U1RP";
+    else
+        sign["Stand-Umsatz-Zaehler-AES256-ICM"] = m_module->encryptTurnoverCounter(concatenatedValue, turnOverCounter, m_symmetricKey);
+
+    bool safetyDevice;
+    QString certificateSerial = m_module->getCertificateSerial(true);
+    if (certificateSerial == "0" || certificateSerial.isEmpty()) {
+        safetyDevice = false;
+        certificateSerial = m_pending.lastSerial;
+        if (!m_module->isSignatureModuleSetDamaged())
+            m_module->setSignatureModuleDamaged();
+    } else {
+        safetyDevice = true;
+    }
+
+    sign["Zertifikat-Seriennummer"] = certificateSerial;
+    sign["Sig-Voriger-Beleg"] = m_module->getLastSignatureValue(m_pending.lastSignature);
+
+    MetricsTimer timer("receipt.sign");
+    QString signature = m_module->signReceipt(Utils::getReceiptShortJson(sign));
+    timer.stop();
+
+    Spread::Instance()->setProgressBarWait(false);
+    Spread::Instance()->setSafetyDevice(safetyDevice);
+
+    if (certificateSerial.isEmpty() || m_pending.lastSignature.isEmpty() || m_error)
+        return "";
+
+    m_pending.turnOverCounter = turnOverCounter;
+    m_pending.lastSignature = signature;
+    m_pending.lastSerial = certificateSerial;
+
+    return signature;
+}
+
+void RKSignatureSession::accept()
+{
+    m_accepted = m_pending;
+}
+
+void RKSignatureSession::reject()
+{
+    m_pending = m_accepted;
+}
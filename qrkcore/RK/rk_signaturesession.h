@@ -0,0 +1,72 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef RKSIGNATURESESSION_H
+#define RKSIGNATURESESSION_H
+
+#include <QJsonObject>
+#include <QStringList>
+
+#include "qrkcore_global.h"
+
+class RKSignatureModule;
+
+/**
+ * @brief The RKSignatureSession class signs a sequence of receipts with one
+ * open signature module. The turnover counter, the previous signature and the
+ * last certificate serial are read once by begin() and carried in memory.
+ * State of signed receipts stays pending until accept(), reject() returns to
+ * the last accepted receipt (e.g. after a rollback to a savepoint).
+ */
+class QRK_EXPORT RKSignatureSession
+{
+public:
+    RKSignatureSession();
+    ~RKSignatureSession();
+
+    bool begin(int lastReceiptNum);
+    void end();
+    bool isActive() const;
+
+    QString sign(const QJsonObject &data);
+    void accept();
+    void reject();
+
+private:
+    Q_DISABLE_COPY(RKSignatureSession)
+
+    struct State
+    {
+        qlonglong turnOverCounter;
+        QString lastSignature;
+        QString lastSerial;
+    };
+
+    RKSignatureModule *m_module;
+    QStringList m_taxTypes;
+    QString m_symmetricKey;
+    bool m_error;
+    State m_accepted;
+    State m_pending;
+};
+
+#endif // RKSIGNATURESESSION_H
@@ -0,0 +1,146 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "rk_turnovercrypto.h"
+
+#include <cryptopp/aes.h>
+#include <cryptopp/sha.h>
+
+#include <QtEndian>
+#include <QDebug>
+
+using namespace CryptoPP;
+
+struct RKTurnoverCrypto::Private
+{
+    AES::Encryption aes;
+    SHA256 sha;
+    QByteArray key;
+    bool valid;
+};
+
+/**
+ * @brief RKTurnoverCrypto::RKTurnoverCrypto
+ * @param hexKey the AES-256 key as stored in globals (PrivateTurnoverKey)
+ */
+RKTurnoverCrypto::RKTurnoverCrypto(const QString &hexKey)
+    : d(new Private)
+{
+    d->key = QByteArray::fromHex(hexKey.toLatin1());
+    d->valid = (d->key.size() == AES::MAX_KEYLENGTH);
+    if (!d->valid) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: invalid key length " << d->key.size();
+        d->key.resize(AES::MAX_KEYLENGTH);
+    }
+
+    try {
+        d->aes.SetKey(reinterpret_cast<const byte *>(d->key.constData()), AES::MAX_KEYLENGTH);
+    } catch (Exception &e) {
+        d->valid = false;
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << e.what();
+    }
+}
+
+RKTurnoverCrypto::~RKTurnoverCrypto()
+{
+    delete d;
+}
+
+bool RKTurnoverCrypto::isValid() const
+{
+    return d->valid;
+}
+
+QByteArray RKTurnoverCrypto::key() const
+{
+    return d->key;
+}
+
+void RKTurnoverCrypto::hash(const char *data, int size, unsigned char digest[RK_HASH_SIZE])
+{
+    d->sha.CalculateDigest(digest, reinterpret_cast<const byte *>(data), size_t(size));
+}
+
+void RKTurnoverCrypto::keyStream(const char *concatenated, int size, unsigned char stream[16])
+{
+    unsigned char digest[RK_HASH_SIZE];
+    hash(concatenated, size, digest);
+    /* CTR: the first key stream block is AES(IV) */
+    d->aes.ProcessBlock(digest, stream);
+}
+
+void RKTurnoverCrypto::encrypt(const char *concatenated, int size, qlonglong turnoverCounter, unsigned char out[RK_TURNOVER_SIZE])
+{
+    unsigned char stream[AES::BLOCKSIZE];
+    keyStream(concatenated, size, stream);
+
+    qToBigEndian(turnoverCounter, out);
+    for (int i = 0; i < RK_TURNOVER_SIZE; i++)
+        out[i] ^= stream[i];
+}
+
+/**
+ * @brief RKTurnoverCrypto::decrypt
+ * @param encrypted 5 to 16 bytes, missing bytes are taken as 0
+ * @return the turnover counter
+ */
+qlonglong RKTurnoverCrypto::decrypt(const char *concatenated, int size, const unsigned char *encrypted, int length)
+{
+    unsigned char stream[AES::BLOCKSIZE];
+    keyStream(concatenated, size, stream);
+
+    unsigned char recovered[RK_TURNOVER_SIZE];
+    for (int i = 0; i < RK_TURNOVER_SIZE; i++)
+        recovered[i] = (i < length ? encrypted[i] : 0x00) ^ stream[i];
+
+    return qFromBigEndian<qint64>(recovered);
+}
+
+/**
+ * @brief RKTurnoverCrypto::hashHex
+ * @return upper case hex SHA-256 of the UTF-8 value, same as RKSignatureModule::HashValue
+ */
+QByteArray RKTurnoverCrypto::hashHex(const QString &value)
+{
+    QByteArray data = value.toUtf8();
+    unsigned char digest[RK_HASH_SIZE];
+    hash(data.constData(), data.size(), digest);
+
+    return QByteArray(reinterpret_cast<const char *>(digest), RK_HASH_SIZE).toHex().toUpper();
+}
+
+QString RKTurnoverCrypto::encrypt(const QString &concatenated, qlonglong turnoverCounter)
+{
+    QByteArray data = concatenated.toUtf8();
+    unsigned char out[RK_TURNOVER_SIZE];
+    encrypt(data.constData(), data.size(), turnoverCounter, out);
+
+    return QByteArray(reinterpret_cast<const char *>(out), RK_TURNOVER_SIZE).toBase64();
+}
+
+qlonglong RKTurnoverCrypto::decrypt(const QString &concatenated, const QString &encodedTurnoverCounter)
+{
+    QByteArray data = concatenated.toUtf8();
+    QByteArray encrypted = QByteArray::fromBase64(encodedTurnoverCounter.toUtf8());
+
+    return decrypt(data.constData(), data.size(), reinterpret_cast<const unsigned char *>(encrypted.constData()), encrypted.size());
+}
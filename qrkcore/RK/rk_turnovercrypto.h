@@ -0,0 +1,66 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef RKTURNOVERCRYPTO_H
+#define RKTURNOVERCRYPTO_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "qrkcore_global.h"
+
+#define RK_TURNOVER_SIZE 8
+#define RK_HASH_SIZE 32
+
+/**
+ * @brief The RKTurnoverCrypto class holds the decoded AES-256 turnover key and
+ * reusable AES/SHA-256 objects. The IV of the AES-ICM (CTR) mode is the first
+ * half of the SHA-256 over cashbox id + receipt number, so one AES block gives
+ * the whole key stream for the 8 byte turnover counter.
+ * An instance is not thread safe, use one per thread.
+ */
+class QRK_EXPORT RKTurnoverCrypto
+{
+public:
+    explicit RKTurnoverCrypto(const QString &hexKey);
+    ~RKTurnoverCrypto();
+
+    bool isValid() const;
+    QByteArray key() const;
+
+    void hash(const char *data, int size, unsigned char digest[RK_HASH_SIZE]);
+    void encrypt(const char *concatenated, int size, qlonglong turnoverCounter, unsigned char out[RK_TURNOVER_SIZE]);
+    qlonglong decrypt(const char *concatenated, int size, const unsigned char *encrypted, int length);
+
+    QByteArray hashHex(const QString &value);
+    QString encrypt(const QString &concatenated, qlonglong turnoverCounter);
+    qlonglong decrypt(const QString &concatenated, const QString &encodedTurnoverCounter);
+
+private:
+    Q_DISABLE_COPY(RKTurnoverCrypto)
+    void keyStream(const char *concatenated, int size, unsigned char stream[16]);
+
+    struct Private;
+    Private *d;
+};
+
+#endif // RKTURNOVERCRYPTO_H
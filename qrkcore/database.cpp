@@ -22,12 +22,17 @@
 
 #include "database.h"
 #include "databasedefinition.h"
+#include "defines.h"
 #include "utils/demomode.h"
 #include "preferences/qrksettings.h"
 #include "databasemanager.h"
 #include "journal.h"
+#include "journalpartitions.h"
 #include "3rdparty/qbcmath/bcmath.h"
 #include "backup.h"
+#include "RK/rk_signaturemodule.h"
+#include "singleton/fiscalstate.h"
+#include "singleton/fiscalperiod.h"
 
 #include <QDebug>
 #include <QApplication>
@@ -40,6 +45,7 @@
 #include <QDate>
 #include <QStandardPaths>
 #include <QJsonObject>
+#include <QSet>
 
 QMap<QString, QString> globalStringValues;
 
@@ -85,155 +91,596 @@ QString Database::getLastExecutedQuery(const QSqlQuery& query)
 
 QString Database::getDayCounter()
 {
-    QDateTime dateFrom;
-    QDateTime dateTo;
+    return QString::number(getSalesTotal(QDate::currentDate().toString("yyyy-MM-dd")), 'f', 2);
+}
+
+QString Database::getMonthCounter()
+{
+    return QString::number(getSalesTotal(QDate::currentDate().toString("yyyy-MM")), 'f', 2);
+}
+
+QString Database::getYearCounter()
+{
+    return QString::number(getSalesTotal(QString::number(QDate::currentDate().year())), 'f', 2);
+}
 
-    dateFrom.setDate(QDate::currentDate());
-    dateTo.setDate(QDate::currentDate());
-    dateTo.setTime(QTime::currentTime());
+//--------------------------------------------------------------------------------
+
+/**
+ * @brief Database::addSalesTotal
+ * adds the gross of a finished receipt to the running day, month and year
+ * totals (periods yyyy-MM-dd, yyyy-MM and yyyy). The caller commits them
+ * together with the receipt, rebuildSalesTotals recomputes them from receipts.
+ * @param dateTime receipt timestamp
+ * @param gross
+ * @return false if a total could not be written, the caller rolls back
+ */
+bool Database::addSalesTotal(const QDateTime &dateTime, double gross)
+{
+    if (gross == 0.0)
+        return true;
 
     QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
+    QSqlQuery update(dbc);
+    QSqlQuery insert(dbc);
 
-    /* Summe */
-    query.prepare(QString("SELECT sum(gross) as total FROM receipts WHERE timestamp BETWEEN :fromdate AND :todate AND payedBy < 3"));
-    query.bindValue(":fromdate", dateFrom.toString(Qt::ISODate));
-    query.bindValue(":todate", dateTo.toString(Qt::ISODate));
+    update.prepare("UPDATE salesTotals SET gross=gross+:gross WHERE period=:period");
+    insert.prepare("INSERT INTO salesTotals (period, gross) VALUES (:period, :gross)");
 
-    query.exec();
-    query.next();
+    QStringList periods;
+    periods << dateTime.date().toString("yyyy-MM-dd") << dateTime.date().toString("yyyy-MM") << QString::number(dateTime.date().year());
 
-    return QString::number(query.value("total").toDouble(), 'f', 2);
+    foreach (const QString &period, periods) {
+        update.bindValue(":gross", gross);
+        update.bindValue(":period", period);
+        if (!update.exec()) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << update.lastError().text();
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(update);
+            return false;
+        }
+
+        if (update.numRowsAffected() == 0) {
+            insert.bindValue(":period", period);
+            insert.bindValue(":gross", gross);
+            if (!insert.exec()) {
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << insert.lastError().text();
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(insert);
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
-QString Database::getMonthCounter()
+/**
+ * @brief Database::rebuildSalesTotals
+ * recomputes all running totals, the sales breakdown and the product and
+ * hourly buckets from the receipts in one transaction
+ * @return true on success
+ */
+bool Database::rebuildSalesTotals()
 {
-    QDateTime dateFrom;
-    QDateTime dateTo;
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+
+    dbc.transaction();
+
+    bool ok = query.exec("DELETE FROM salesTotals");
+    QList<int> lengths = QList<int>() << 4 << 7 << 10;
+    foreach (int length, lengths) {
+        if (!ok)
+            break;
+        ok = query.exec(QString("INSERT INTO salesTotals (period, gross) SELECT SUBSTR(timestamp, 1, %1), SUM(gross) FROM receipts"
+                                " WHERE payedBy < %2 GROUP BY SUBSTR(timestamp, 1, %1)").arg(length).arg(PAYED_BY_REPORT_EOD));
+    }
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        dbc.rollback();
+        return false;
+    }
 
-    dateFrom.setDate(QDate::fromString(QString("%1-%2-1")
-                                       .arg(QDate::currentDate().year())
-                                       .arg(QDate::currentDate().month())
-                                       , "yyyy-M-d"));
-    dateTo.setDate(QDate::currentDate());
-    dateTo.setTime(QTime::currentTime());
+    if (!fillSalesBreakdown(dbc) || !fillProductSales(dbc)) {
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit();
+}
 
+double Database::getSalesTotal(const QString &period)
+{
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
 
-    /* Summe */
-    query.prepare(QString("SELECT sum(gross) as total FROM receipts WHERE timestamp BETWEEN :fromdate AND :todate AND payedBy < 3"));
-    query.bindValue(":fromdate", dateFrom.toString(Qt::ISODate));
-    query.bindValue(":todate", dateTo.toString(Qt::ISODate));
+    query.prepare("SELECT gross FROM salesTotals WHERE period=:period");
+    query.bindValue(":period", period);
 
-    query.exec();
-    query.next();
+    if (!query.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return 0.0;
+    }
 
-    return QString::number(query.value("total").toDouble(), 'f', 2);
+    if (query.next())
+        return query.value(0).toDouble();
+
+    return 0.0;
 }
 
-QString Database::getYearCounter()
+/*
+ * SQL SUM and ROUND do not round like the receipts do (xx.985 gives xx.98
+ * instead of xx.99), so every order line is rounded with QBCMath and summed
+ * up in cents. salesBreakdown keeps these sums per day, payment type and
+ * tax rate.
+ */
+typedef QMap<int, QMap<double, qint64> > SalesBreakdown;
+
+static QString salesLinesSQLQueryString(const QString &where)
 {
-    QDateTime dateFrom;
-    QDateTime dateTo;
+    return "SELECT receipts.payedBy, SUBSTR(receipts.timestamp, 1, 10) as day, orders.tax, (orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount) as total from orders "
+           " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
+           " WHERE " + where + QString(" AND receipts.payedBy < %1").arg(PAYED_BY_REPORT_EOD);
+}
 
-    dateFrom.setDate(QDate::fromString(
-                         QString("%1-1-1")
-                         .arg(QDate::currentDate().year())
-                         , "yyyy-M-d")
-                     );
+static void addSalesLine(SalesBreakdown &breakdown, const QSqlQuery &query)
+{
+    QBCMath tax(query.value("tax").toString());
+    tax.round(2);
+    QBCMath total(query.value("total").toString());
+    total.round(2);
+    breakdown[query.value("payedBy").toInt()][tax.toDouble()] += qRound64(total.toDouble() * 100);
+}
 
-    dateTo.setDate(QDate::currentDate());
-    dateTo.setTime(QTime::currentTime());
+static bool addSalesLines(QSqlDatabase dbc, SalesBreakdown &breakdown, const QDateTime &from, const QDateTime &to)
+{
+    QSqlQuery query(dbc);
+    query.setForwardOnly(true);
+    query.prepare(salesLinesSQLQueryString("receipts.timestamp BETWEEN :fromDate AND :toDate"));
+    query.bindValue(":fromDate", from.toString(Qt::ISODate));
+    query.bindValue(":toDate", to.toString(Qt::ISODate));
+
+    if (!query.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    while (query.next())
+        addSalesLine(breakdown, query);
+
+    return true;
+}
+
+/**
+ * @brief getSalesBreakdown
+ * whole days are read from salesBreakdown, a partial first or last day
+ * (e.g. an end of day report up to the current time) from the order lines.
+ * @param dbc
+ * @param from
+ * @param to
+ * @return cents per payment type and tax rate
+ */
+static SalesBreakdown getSalesBreakdown(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to)
+{
+    SalesBreakdown breakdown;
+    if (!from.isValid() || !to.isValid() || to < from)
+        return breakdown;
+
+    const QTime endOfDay(23, 59, 59);
+    QDate firstDay = from.date();
+    QDate lastDay = to.date();
+
+    if (from.time() != QTime(0, 0)) {
+        addSalesLines(dbc, breakdown, from, qMin(to, QDateTime(firstDay, endOfDay)));
+        firstDay = firstDay.addDays(1);
+    }
+
+    if (to.time() < endOfDay) {
+        if (lastDay >= firstDay)
+            addSalesLines(dbc, breakdown, QDateTime(lastDay, QTime(0, 0)), to);
+        lastDay = lastDay.addDays(-1);
+    }
+
+    if (firstDay > lastDay)
+        return breakdown;
 
-    QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
+    query.prepare("SELECT payedBy, tax, SUM(total) as total FROM salesBreakdown WHERE day BETWEEN :fromDay AND :toDay GROUP BY payedBy, tax");
+    query.bindValue(":fromDay", firstDay.toString("yyyy-MM-dd"));
+    query.bindValue(":toDay", lastDay.toString("yyyy-MM-dd"));
 
-    /* Summe */
-    query.prepare(QString("SELECT sum(gross) as total FROM receipts WHERE timestamp BETWEEN :fromdate AND :todate AND payedBy < 3"));
-    query.bindValue(":fromdate", dateFrom.toString(Qt::ISODate));
-    query.bindValue(":todate", dateTo.toString(Qt::ISODate));
+    if (!query.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return breakdown;
+    }
 
-    query.exec();
-    query.next();
+    while (query.next())
+        breakdown[query.value("payedBy").toInt()][query.value("tax").toDouble()] += query.value("total").toLongLong();
 
-    return QString::number(query.value("total").toDouble(), 'f', 2);
+    return breakdown;
 }
 
-QString Database::getSalesPerPaymentSQLQueryString()
+/**
+ * @brief Database::getSalesPerPayment
+ * @param from
+ * @param to
+ * @return sales per payment type (actionText) and tax rate
+ */
+QMap<QString, QMap<double, double> > Database::getSalesPerPayment(const QDateTime &from, const QDateTime &to)
 {
-    return "SELECT actionTypes.actionText, orders.tax, (orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount) as total from orders "
-            " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
-            " LEFT JOIN actionTypes on receipts.payedBy=actionTypes.actionId"
-            " WHERE receipts.timestamp between :fromDate AND :toDate AND receipts.payedBy < 3"
-            " ORDER BY receipts.payedBy, orders.tax";
-    /*
-    return "SELECT actionTypes.actionText, orders.tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total from orders "
-           " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
-           " LEFT JOIN actionTypes on receipts.payedBy=actionTypes.actionId"
-           " WHERE receipts.timestamp between :fromDate AND :toDate AND receipts.payedBy < 3"
-           " GROUP BY orders.tax, receipts.payedBy ORDER BY receipts.payedBy, orders.tax";
-*/
-    /*
-    return "SELECT actionTypes.actionText, orders.tax, SUM((orders.count * orders.gross) - round(((orders.count * orders.gross / 100) * orders.discount),2)) as total from orders "
-           " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
-           " LEFT JOIN actionTypes on receipts.payedBy=actionTypes.actionId"
-           " WHERE receipts.timestamp between :fromDate AND :toDate AND receipts.payedBy < 3"
-           " GROUP BY orders.tax, receipts.payedBy ORDER BY receipts.payedBy, orders.tax";
-           */
+    return getSalesPerPayment(Database::database(), from, to);
 }
 
-//--------------------------------------------------------------------------------
+/**
+ * @brief Database::getSalesPerPayment
+ * same as above on the given connection, e.g. a register database opened
+ * for consolidation
+ * @param dbc
+ * @param from
+ * @param to
+ * @return sales per payment type (actionText) and tax rate
+ */
+QMap<QString, QMap<double, double> > Database::getSalesPerPayment(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to)
+{
+    QMap<QString, QMap<double, double> > sales;
+    SalesBreakdown breakdown = getSalesBreakdown(dbc, from, to);
+    if (breakdown.isEmpty())
+        return sales;
 
-void Database::updateProductSold(double count, QString product)
+    QMap<int, QString> actionTypes;
+    QSqlQuery query(dbc);
+    query.exec("SELECT actionId, actionText FROM actionTypes");
+    while (query.next())
+        actionTypes.insert(query.value("actionId").toInt(), query.value("actionText").toString());
+
+    SalesBreakdown::const_iterator i;
+    for (i = breakdown.constBegin(); i != breakdown.constEnd(); ++i) {
+        QMap<double, double> &tax = sales[actionTypes.value(i.key())];
+        QMap<double, qint64>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j)
+            tax[j.key()] += j.value() / 100.0;
+    }
+
+    return sales;
+}
+
+/**
+ * @brief Database::getSalesPerTax
+ * @param from
+ * @param to
+ * @return sales per tax rate
+ */
+QMap<double, double> Database::getSalesPerTax(const QDateTime &from, const QDateTime &to)
 {
-    if (product.startsWith("Zahlungsbeleg für Rechnung"))
-        return;
+    return getSalesPerTax(Database::database(), from, to);
+}
+
+QMap<double, double> Database::getSalesPerTax(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to)
+{
+    QMap<double, qint64> cents;
+    SalesBreakdown breakdown = getSalesBreakdown(dbc, from, to);
+
+    SalesBreakdown::const_iterator i;
+    for (i = breakdown.constBegin(); i != breakdown.constEnd(); ++i) {
+        QMap<double, qint64>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j)
+            cents[j.key()] += j.value();
+    }
 
+    QMap<double, double> sales;
+    QMap<double, qint64>::const_iterator j;
+    for (j = cents.constBegin(); j != cents.constEnd(); ++j)
+        sales[j.key()] = j.value() / 100.0;
+
+    return sales;
+}
+
+static bool insertSalesBreakdown(QSqlDatabase dbc, const QString &day, const SalesBreakdown &breakdown)
+{
+    QSqlQuery update(dbc);
+    QSqlQuery insert(dbc);
+
+    update.prepare("UPDATE salesBreakdown SET total=total+:total WHERE day=:day AND payedBy=:payedBy AND tax=:tax");
+    insert.prepare("INSERT INTO salesBreakdown (day, payedBy, tax, total) VALUES (:day, :payedBy, :tax, :total)");
+
+    SalesBreakdown::const_iterator i;
+    for (i = breakdown.constBegin(); i != breakdown.constEnd(); ++i) {
+        QMap<double, qint64>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            update.bindValue(":total", j.value());
+            update.bindValue(":day", day);
+            update.bindValue(":payedBy", i.key());
+            update.bindValue(":tax", j.key());
+            if (!update.exec()) {
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << update.lastError().text();
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(update);
+                return false;
+            }
+
+            if (update.numRowsAffected() > 0)
+                continue;
+
+            insert.bindValue(":day", day);
+            insert.bindValue(":payedBy", i.key());
+            insert.bindValue(":tax", j.key());
+            insert.bindValue(":total", j.value());
+            if (!insert.exec()) {
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << insert.lastError().text();
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(insert);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Database::addSalesBreakdown
+ * adds the order lines of a finished receipt to salesBreakdown, inside the
+ * transaction of the caller.
+ * @param receiptNum
+ * @return false if the breakdown could not be written, the caller rolls back
+ */
+bool Database::addSalesBreakdown(int receiptNum)
+{
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
+    query.prepare(salesLinesSQLQueryString("orders.receiptId=:receiptNum"));
+    query.bindValue(":receiptNum", receiptNum);
+
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
 
-    query.prepare(QString("UPDATE products SET sold=sold+:sold WHERE name=:name"));
-    query.bindValue(":sold", count);
-    query.bindValue(":name", QVariant(product));
+    QString day;
+    SalesBreakdown breakdown;
+    while (query.next()) {
+        day = query.value("day").toString();
+        addSalesLine(breakdown, query);
+    }
 
-    query.exec();
+    if (breakdown.isEmpty())
+        return true;
 
-    query.prepare(QString("UPDATE products SET stock=stock-:sold WHERE name=:name"));
-    query.bindValue(":sold", count);
-    query.bindValue(":name", QVariant(product));
+    return insertSalesBreakdown(dbc, day, breakdown);
+}
 
-    query.exec();
+/**
+ * @brief Database::rebuildSalesBreakdown
+ * recomputes salesBreakdown from all order lines
+ * @param dbc
+ * @return true on success
+ */
+bool Database::rebuildSalesBreakdown(QSqlDatabase dbc)
+{
+    dbc.transaction();
+
+    if (!fillSalesBreakdown(dbc)) {
+        dbc.rollback();
+        return false;
+    }
 
+    return dbc.commit();
 }
 
-QStringList Database::getStockInfoList()
+/**
+ * @brief Database::fillSalesBreakdown
+ * replaces salesBreakdown inside the caller's transaction
+ */
+bool Database::fillSalesBreakdown(QSqlDatabase dbc)
 {
-    QrkSettings settings;
-    QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
+    query.setForwardOnly(true);
 
-    query.prepare("select name, stock, minstock from products inner join orders on products.id=orders.product where orders.receiptId= (select max(receipts.receiptNum) from receipts) and products.stock <= products.minstock");
-    query.exec();
+    bool ok = query.exec("DELETE FROM salesBreakdown");
+    if (ok)
+        ok = query.exec(salesLinesSQLQueryString("1=1"));
 
-    int decimals = settings.value("decimalDigits", 2).toInt();
-    QStringList list;
-    QBCMath stock;
-    QBCMath minstock;
-    QString name;
-    while(query.next()) {
-        name = query.value("name").toString();
-        if (name.startsWith("Zahlungsbeleg für Rechnung"))
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    QMap<QString, SalesBreakdown> days;
+    while (query.next())
+        addSalesLine(days[query.value("day").toString()], query);
+
+    QMap<QString, SalesBreakdown>::const_iterator i;
+    for (i = days.constBegin(); ok && i != days.constEnd(); ++i)
+        ok = insertSalesBreakdown(dbc, i.key(), i.value());
+
+    return ok;
+}
+
+/*
+ * productSales and hourlySales keep the sold quantity, the number of receipts
+ * and the rounded line totals in cents per day and product resp. day and hour.
+ * They let the chart plugin answer any date range without reading the orders.
+ */
+struct SalesBucket
+{
+    SalesBucket() : count(0.0), receipts(0), total(0) {}
+    double count;
+    int receipts;
+    qint64 total;
+};
+
+typedef QMap<QString, QMap<int, SalesBucket> > SalesBuckets;
+
+static QString productSalesSQLQueryString(const QString &where)
+{
+    return "SELECT orders.receiptId, orders.product, products.`group` as productGroup, SUBSTR(receipts.timestamp, 1, 10) as day, SUBSTR(receipts.timestamp, 12, 2) as hour, orders.count,"
+           " (orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount) as total from orders "
+           " LEFT JOIN receipts on orders.receiptId=receipts.receiptNum"
+           " LEFT JOIN products on orders.product=products.id"
+           " WHERE " + where + QString(" AND receipts.payedBy < %1 ORDER BY orders.receiptId").arg(PAYED_BY_REPORT_EOD);
+}
+
+static void addProductSalesLines(QSqlQuery &query, SalesBuckets &products, SalesBuckets &hours)
+{
+    int receiptNum = -1;
+    bool receiptHour = false;
+    QSet<int> receiptProducts;
+
+    while (query.next()) {
+        QString day = query.value("day").toString();
+        int hour = query.value("hour").toInt();
+        int product = query.value("product").toInt();
+        double count = query.value("count").toDouble();
+        QBCMath total(query.value("total").toString());
+        total.round(2);
+        qint64 cents = qRound64(total.toDouble() * 100);
+
+        if (query.value("receiptId").toInt() != receiptNum) {
+            receiptNum = query.value("receiptId").toInt();
+            receiptProducts.clear();
+            receiptHour = false;
+        }
+
+        SalesBucket &p = products[day][product];
+        if (!receiptProducts.contains(product)) {
+            receiptProducts.insert(product);
+            p.receipts++;
+        }
+        p.count += count;
+        p.total += cents;
+
+        /* the product views leave out group 1 when they read productSales,
+         * the hours have no product any more and are filtered here */
+        if (query.value("productGroup").toInt() <= 1)
             continue;
 
-        stock = query.value("stock").toString();
-        minstock = query.value("minstock").toString();
+        SalesBucket &h = hours[day][hour];
+        if (!receiptHour) {
+            receiptHour = true;
+            h.receipts++;
+        }
+        h.count += count;
+        h.total += cents;
+    }
+}
 
-        list.append(QString("%1 (%2 / %3)").arg(query.value("name").toString())
-                    .arg(QBCMath::bcround(stock.toString(), decimals))
-                    .arg(QBCMath::bcround(minstock.toString(), decimals)));
+static bool insertSalesBuckets(QSqlDatabase dbc, const QString &table, const QString &key, const SalesBuckets &buckets)
+{
+    QSqlQuery update(dbc);
+    QSqlQuery insert(dbc);
+
+    update.prepare(QString("UPDATE %1 SET count=count+:count, receipts=receipts+:receipts, total=total+:total WHERE day=:day AND `%2`=:key").arg(table).arg(key));
+    insert.prepare(QString("INSERT INTO %1 (day, `%2`, count, receipts, total) VALUES (:day, :key, :count, :receipts, :total)").arg(table).arg(key));
+
+    SalesBuckets::const_iterator i;
+    for (i = buckets.constBegin(); i != buckets.constEnd(); ++i) {
+        QMap<int, SalesBucket>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j) {
+            update.bindValue(":count", j.value().count);
+            update.bindValue(":receipts", j.value().receipts);
+            update.bindValue(":total", j.value().total);
+            update.bindValue(":day", i.key());
+            update.bindValue(":key", j.key());
+            if (!update.exec()) {
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << update.lastError().text();
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(update);
+                return false;
+            }
+
+            if (update.numRowsAffected() > 0)
+                continue;
+
+            insert.bindValue(":day", i.key());
+            insert.bindValue(":key", j.key());
+            insert.bindValue(":count", j.value().count);
+            insert.bindValue(":receipts", j.value().receipts);
+            insert.bindValue(":total", j.value().total);
+            if (!insert.exec()) {
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << insert.lastError().text();
+                qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(insert);
+                return false;
+            }
+        }
     }
-    return list;
+
+    return true;
+}
+
+/**
+ * @brief Database::addProductSales
+ * adds the order lines of a finished receipt to productSales and hourlySales,
+ * inside the transaction of the caller.
+ * @param receiptNum
+ * @return false if a bucket could not be written, the caller rolls back
+ */
+bool Database::addProductSales(int receiptNum)
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+    query.prepare(productSalesSQLQueryString("orders.receiptId=:receiptNum"));
+    query.bindValue(":receiptNum", receiptNum);
+
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    SalesBuckets products;
+    SalesBuckets hours;
+    addProductSalesLines(query, products, hours);
+
+    return insertSalesBuckets(dbc, "productSales", "product", products) && insertSalesBuckets(dbc, "hourlySales", "hour", hours);
+}
+
+/**
+ * @brief Database::rebuildProductSales
+ * recomputes productSales and hourlySales from all order lines
+ * @param dbc
+ * @return true on success
+ */
+bool Database::rebuildProductSales(QSqlDatabase dbc)
+{
+    dbc.transaction();
+
+    if (!fillProductSales(dbc)) {
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit();
+}
+
+/**
+ * @brief Database::fillProductSales
+ * replaces productSales and hourlySales inside the caller's transaction
+ */
+bool Database::fillProductSales(QSqlDatabase dbc)
+{
+    QSqlQuery query(dbc);
+    query.setForwardOnly(true);
+
+    bool ok = query.exec("DELETE FROM productSales");
+    if (ok)
+        ok = query.exec("DELETE FROM hourlySales");
+    if (ok)
+        ok = query.exec(productSalesSQLQueryString("1=1"));
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    SalesBuckets products;
+    SalesBuckets hours;
+    addProductSalesLines(query, products, hours);
+
+    return insertSalesBuckets(dbc, "productSales", "product", products) && insertSalesBuckets(dbc, "hourlySales", "hour", hours);
 }
 
 //--------------------------------------------------------------------------------
@@ -695,12 +1142,13 @@ QJsonObject Database::getConnectionDefinition()
     jobj.insert("databaseusername", globalStringValues.value("databaseusername"));
     jobj.insert("databasepassword", globalStringValues.value("databasepassword"));
     jobj.insert("databaseoptions", globalStringValues.value("databaseoptions"));
+    jobj.insert("replicahost", globalStringValues.value("replicahost"));
     return jobj;
 }
 
 bool Database::open(bool dbSelect)
 {
-    const int CURRENT_SCHEMA_VERSION = 19;
+    const int CURRENT_SCHEMA_VERSION = 26;
     // read global defintions (DB, ...)
     QrkSettings settings;
     QJsonObject ConnectionDefinition = Database::getConnectionDefinition();
@@ -762,6 +1210,7 @@ bool Database::open(bool dbSelect)
         currentConnection.setPassword(password);
         currentConnection.setConnectOptions("MYSQL_OPT_RECONNECT=1;MYSQL_OPT_CONNECT_TIMEOUT=86400;MYSQL_OPT_READ_TIMEOUT=60");
         globalStringValues.insert("databasehost", hostName);
+        globalStringValues.insert("replicahost", settings.value("DB_replicaHostName", "").toString());
         globalStringValues.insert("databaseusername", userName);
         globalStringValues.insert("databasepassword", password);
         globalStringValues.insert("databaseoptions", "MYSQL_OPT_RECONNECT=1;MYSQL_OPT_CONNECT_TIMEOUT=86400;MYSQL_OPT_READ_TIMEOUT=60");
@@ -953,6 +1402,14 @@ bool Database::open(bool dbSelect)
             if (i == 19) {
                 Journal::encodeJournal(currentConnection);
             }
+            if (i == 23) {
+                if (!Database::rebuildSalesBreakdown(currentConnection))
+                    return false;
+            }
+            if (i == 24) {
+                if (!Database::rebuildProductSales(currentConnection))
+                    return false;
+            }
         }
 
         if (schemaVersion != CURRENT_SCHEMA_VERSION)
@@ -973,7 +1430,13 @@ bool Database::open(bool dbSelect)
         }
     }
 
+    // the journal of the previous years goes to its yearly partition
+    JournalPartitions::archive(currentConnection);
+
     currentConnection.close();
+    FiscalState::Instance()->load();
+    FiscalPeriod::Instance()->load();
+
     return true;
 }
 
@@ -1102,6 +1565,35 @@ int Database::getStorno(int id)
     return query.value(0).toInt();
 }
 
+/**
+ * @brief Database::getStorno
+ * reads storno state and linked receipt with one query
+ * @param id receiptNum
+ * @param stornoId linked receipt
+ * @return 0 = no storno, 1 = cancelled receipt, 2 = storno receipt
+ */
+int Database::getStorno(int id, int &stornoId)
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+
+    query.prepare("SELECT storno, stornoId FROM receipts WHERE receiptNum=:receiptNum");
+    query.bindValue(":receiptNum", id);
+
+    bool ok = query.exec();
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+    }
+
+    stornoId = 0;
+    if (!query.next())
+        return 0;
+
+    stornoId = query.value("stornoId").toInt();
+    return query.value("storno").toInt();
+}
+
 //--------------------------------------------------------------------------------
 
 int Database::getStornoId(int id)
@@ -1123,44 +1615,12 @@ int Database::getStornoId(int id)
 
 void Database::setCashRegisterInAktive()
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery q(dbc);
-
-    q.prepare("SELECT value FROM globals WHERE name=:name");
-    q.bindValue(":name", "CASHREGISTER INAKTIV");
-    bool ok = q.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << q.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(q);
-    }
-    if (q.next()) {
-        if (q.value("value").toInt() == 1)
-            return;
-        else
-            q.prepare("UPDATE globals set value=:value WHERE name=:name;");
-    } else {
-        q.prepare("INSERT INTO globals (name, value) VALUES(:name, :value)");
-    }
-
-    q.bindValue(":name", "CASHREGISTER INAKTIV");
-    q.bindValue(":value", 1);
-
-    q.exec();
+    FiscalState::Instance()->setCashRegisterInactive(true);
 }
 
 bool Database::isCashRegisterInAktive()
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-
-    query.prepare("SELECT value FROM globals WHERE name = 'CASHREGISTER INAKTIV'");
-    query.exec();
-
-    if (query.next())
-        if (query.value(0).toInt() == 1)
-            return true;
-
-    return false;
+    return FiscalState::Instance()->isCashRegisterInactive();
 }
 
 void Database::resetAllData()
@@ -1183,11 +1643,27 @@ void Database::resetAllData()
     q.prepare("DELETE FROM dep;");
     q.exec();
 
+    q.prepare("DELETE FROM depCheckpoints;");
+    q.exec();
+
+    q.prepare("DELETE FROM salesTotals;");
+    q.exec();
+
+    q.prepare("DELETE FROM salesBreakdown;");
+    q.exec();
+
+    q.prepare("DELETE FROM productSales;");
+    q.exec();
+
+    q.prepare("DELETE FROM hourlySales;");
+    q.exec();
+
     q.prepare("DELETE FROM products WHERE `group`=1;");
     q.exec();
 
     q.prepare("DELETE FROM globals WHERE `name`='PrivateTurnoverKey';");
     q.exec();
+    RKSignatureModule::resetPrivateTurnoverKey();
 
     q.prepare("UPDATE globals SET value = 0 WHERE name = 'lastReceiptNum';");
     q.exec();
@@ -1243,10 +1719,15 @@ void Database::resetAllData()
         q.exec();
     }
 
+    JournalPartitions::reset(dbc);
+
     q.exec(QString("INSERT INTO `journal`(id,version,cashregisterid,datetime,text) VALUES (NULL,'0.15.1222',0,CURRENT_TIMESTAMP, 'Id\tProgrammversion\tKassen-Id\tKonfigurationsänderung\tBeschreibung\tErstellungsdatum')"));
     q.exec(QString("INSERT INTO `journal`(id,version,cashregisterid,datetime,text) VALUES (NULL,'0.15.1222',0,CURRENT_TIMESTAMP, 'Id\tProgrammversion\tKassen-Id\tProduktposition\tBeschreibung\tMenge\tEinzelpreis\tGesamtpreis\tUSt. Satz\tErstellungsdatum')"));
     q.exec(QString("INSERT INTO `journal`(id,version,cashregisterid,datetime,text) VALUES (NULL,'0.15.1222',0,CURRENT_TIMESTAMP, 'Id\tProgrammversion\tKassen-Id\tBeleg\tBelegtyp\tBemerkung\tNachbonierung\tBelegnummer\tDatum\tUmsatz Normal\tUmsatz Ermaessigt1\tUmsatz Ermaessigt2\tUmsatz Null\tUmsatz Besonders\tJahresumsatz bisher\tErstellungsdatum')"));
     q.exec(QString("INSERT INTO `journal`(id,version,cashregisterid,datetime,text) VALUES (NULL,'0.15.1222',0,CURRENT_TIMESTAMP, 'Id\tProgrammversion\tKassen-Id\tBeleg-Textposition\tText\tErstellungsdatum')"));
+
+    FiscalState::Instance()->load();
+    FiscalPeriod::Instance()->load();
 }
 
 void Database::cleanup()
@@ -1302,6 +1783,25 @@ QSqlDatabase Database::database(const QString &connectionname)
     return dbc;
 }
 
+/**
+ * @brief Database::readOnlyDatabase
+ * connection for reports, exports and browsing which must not contend with
+ * the sales connection.
+ * @param consistent true if the result must contain everything committed on
+ * the sales connection, a MySQL replica may lag behind and is not used then
+ * @return
+ */
+QSqlDatabase Database::readOnlyDatabase(bool consistent)
+{
+    if (!consistent)
+        return database("RO");
+
+    if (!globalStringValues.value("replicahost").isEmpty())
+        return database();
+
+    return database("RS");
+}
+
 bool Database::isAnyValueFunctionAvailable()
 {
     QSqlDatabase dbc = Database::database();
@@ -26,6 +26,9 @@
 #include <QObject>
 #include "qrkcore_global.h"
 
+#include <QMap>
+#include <QDateTime>
+
 class QSqlQuery;
 class QSqlDatabase;
 
@@ -58,6 +61,7 @@ class QRK_EXPORT Database : public QObject
     static QString getTaxType(int id);
     static void setStornoId(int, int);
     static int getStorno(int);
+    static int getStorno(int id, int &stornoId);
     static int getStornoId(int);
     static QString getCashRegisterId();
     static QString getCurrency();
@@ -68,9 +72,17 @@ class QRK_EXPORT Database : public QObject
     static QString getDayCounter();
     static QString getMonthCounter();
     static QString getYearCounter();
-    static QString getSalesPerPaymentSQLQueryString();
-    static void updateProductSold(double, QString);
-    static QStringList getStockInfoList();
+    static bool addSalesTotal(const QDateTime &dateTime, double gross);
+    static double getSalesTotal(const QString &period);
+    static bool rebuildSalesTotals();
+    static bool addSalesBreakdown(int receiptNum);
+    static bool rebuildSalesBreakdown(QSqlDatabase dbc);
+    static bool addProductSales(int receiptNum);
+    static bool rebuildProductSales(QSqlDatabase dbc);
+    static QMap<QString, QMap<double, double> > getSalesPerPayment(const QDateTime &from, const QDateTime &to);
+    static QMap<QString, QMap<double, double> > getSalesPerPayment(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to);
+    static QMap<double, double> getSalesPerTax(const QDateTime &from, const QDateTime &to);
+    static QMap<double, double> getSalesPerTax(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to);
     static QStringList getMaximumItemSold();
     static void setCashRegisterInAktive();
     static bool isCashRegisterInAktive();
@@ -79,12 +91,15 @@ class QRK_EXPORT Database : public QObject
     static void cleanup();
     static QString updateGlobals(QString name, QString defaultvalue, QString defaultStrValue);
     static QSqlDatabase database(const QString &connectionname = "CN");
+    static QSqlDatabase readOnlyDatabase(bool consistent = false);
     static bool isAnyValueFunctionAvailable();
     static QString getDatabaseVersion();
 
   private:
     static QString getDatabaseType();
     static void setStorno(int,int = 1);
+    static bool fillSalesBreakdown(QSqlDatabase dbc);
+    static bool fillProductSales(QSqlDatabase dbc);
 
 };
 
@@ -22,38 +22,109 @@
 
 #include "database.h"
 #include "databasemanager.h"
+#include "queryprofiler.h"
+#include "utils/metrics.h"
 
+#include <QCoreApplication>
 #include <QSqlDatabase>
+#include <QSqlQuery>
 #include <QMutexLocker>
 #include <QThread>
 #include <QSqlError>
 #include <QJsonObject>
+#include <QJsonArray>
+#include <QDateTime>
+#include <QElapsedTimer>
 #include <QDebug>
 
 QMutex DatabaseManager::s_databaseMutex;
-QMap<QString, QMap<QString, QSqlDatabase> > DatabaseManager::s_instances;
+QWaitCondition DatabaseManager::s_connectionReleased;
+QMap<QString, QMap<QString, DatabaseManager::PooledConnection> > DatabaseManager::s_instances;
+QSet<QThread *> DatabaseManager::s_watchedThreads;
 
-QSqlDatabase DatabaseManager::database(const QString& connectionName)
+int DatabaseManager::s_maxConnections = 16;
+int DatabaseManager::s_idleTimeout = 600;
+int DatabaseManager::s_validationInterval = 60;
+int DatabaseManager::s_leaseTimeout = 5000;
+
+/**
+ * @brief DatabaseManager::setPoolLimits
+ * @param maxConnections upper bound of threads holding connections, 0 = unbounded
+ * @param idleTimeout seconds after which an idle server connection is reopened
+ * @param validationInterval seconds after which an idle connection is checked with SELECT 1
+ * @param leaseTimeout milliseconds a worker thread waits for a returned connection
+ */
+void DatabaseManager::setPoolLimits(int maxConnections, int idleTimeout, int validationInterval, int leaseTimeout)
 {
     QMutexLocker locker(&s_databaseMutex);
+    s_maxConnections = qMax(0, maxConnections);
+    s_idleTimeout = qMax(0, idleTimeout);
+    s_validationInterval = qMax(0, validationInterval);
+    s_leaseTimeout = qMax(0, leaseTimeout);
+}
+
+QSqlDatabase DatabaseManager::database(const QString& connectionName)
+{
     QThread *thread = QThread::currentThread();
+    QString objectname = QString::number((long long)thread, 16);
+
+    QSqlDatabase connection;
+    qint64 idle = 0;
+    {
+        QMutexLocker locker(&s_databaseMutex);
 
-    if (!thread->objectName().isEmpty()) {
-        QString objectname = QString::number((long long)QThread::currentThread(), 16);
-        // if we have a connection for this thread, return it
-        QMap<QString, QMap<QString, QSqlDatabase> >::Iterator it_thread = s_instances.find(objectname);
-        if (it_thread != s_instances.end()) {
-            QMap<QString, QSqlDatabase>::iterator it_conn = it_thread.value().find(connectionName);
-            if (it_conn != it_thread.value().end()) {
-                QSqlDatabase connection = it_conn.value();
-                qDebug() << "Function Name: " << Q_FUNC_INFO << " found SQL connection instances Thread: " << thread << " Name: " << connectionName;
-                if (connection.isValid())
-                    return it_conn.value();
+        if (!thread->objectName().isEmpty()) {
+            // if we have a connection for this thread, return it
+            QMap<QString, QMap<QString, PooledConnection> >::Iterator it_thread = s_instances.find(objectname);
+            if (it_thread != s_instances.end()) {
+                QMap<QString, PooledConnection>::iterator it_conn = it_thread.value().find(connectionName);
+                if (it_conn != it_thread.value().end() && it_conn.value().connection.isValid()) {
+                    qint64 now = QDateTime::currentMSecsSinceEpoch();
+                    idle = now - it_conn.value().lastUsed;
+                    it_conn.value().lastUsed = now;
+                    connection = it_conn.value().connection;
+                }
             }
         }
     }
 
-    QString objectname = QString::number((long long)QThread::currentThread(), 16);
+    if (connection.isValid()) {
+        Metrics::addCount("db.pool.reused");
+        // the connection belongs to this thread, check it without holding the lock
+        checkConnection(connection, idle);
+        return connection;
+    }
+
+    return createConnection(thread, objectname, connectionName);
+}
+
+QSqlDatabase DatabaseManager::createConnection(QThread *thread, const QString &objectname, const QString &connectionName)
+{
+    QMutexLocker locker(&s_databaseMutex);
+
+    /* wait for a returned lease, the GUI thread never waits. A thread which
+     * holds a connection already would wait for its own lease, its further
+     * connection names count against that lease. */
+    if (s_maxConnections > 0 && !s_instances.contains(objectname) && s_instances.size() >= s_maxConnections) {
+        if (thread == QCoreApplication::instance()->thread()) {
+            Metrics::addCount("db.pool.overflow");
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " connection limit reached: " << s_maxConnections << " Thread: " << thread;
+        } else {
+            Metrics::addCount("db.pool.waits");
+            QElapsedTimer timer;
+            timer.start();
+            // another waiter may take the returned connection first
+            while (s_maxConnections > 0 && s_instances.size() >= s_maxConnections) {
+                qint64 remaining = s_leaseTimeout - timer.elapsed();
+                if (remaining <= 0) {
+                    Metrics::addCount("db.pool.exhausted");
+                    qCritical() << "Function Name: " << Q_FUNC_INFO << " no connection returned within " << s_leaseTimeout << "ms, limit: " << s_maxConnections << " Thread: " << thread;
+                    return QSqlDatabase();
+                }
+                s_connectionReleased.wait(&s_databaseMutex, (unsigned long) remaining);
+            }
+        }
+    }
 
     thread->setObjectName(objectname);
     // otherwise, create a new connection for this thread
@@ -67,14 +138,20 @@ QSqlDatabase DatabaseManager::database(const QString& connectionName)
     QJsonObject connectionDefinition = Database::getConnectionDefinition();
     QString dbtype = connectionDefinition.value("dbtype").toString();
     QSqlDatabase connection = QSqlDatabase::addDatabase(dbtype, QString("%1_%2").arg(connectionName).arg(objectname));
+    bool readOnly = isReadOnly(connectionName);
 
     if (dbtype == "QMYSQL") {
-        connection.setHostName(connectionDefinition.value("databasehost").toString());
+        QString host = connectionDefinition.value("databasehost").toString();
+        if (readOnly && !connectionDefinition.value("replicahost").toString().isEmpty())
+            host = connectionDefinition.value("replicahost").toString();
+        connection.setHostName(host);
         connection.setUserName(connectionDefinition.value("databaseusername").toString());
         connection.setPassword(connectionDefinition.value("databasepassword").toString());
         connection.setConnectOptions(connectionDefinition.value("databaseoptions").toString());
     }
     connection.setDatabaseName(connectionDefinition.value("databasename").toString());
+    if (readOnly && dbtype == "QSQLITE")
+        connection.setConnectOptions("QSQLITE_OPEN_READONLY");
 
     // open the database connection
     // initialize the database connection
@@ -84,31 +161,211 @@ QSqlDatabase DatabaseManager::database(const QString& connectionName)
         return connection;
     }
 
+    if (readOnly)
+        setReadOnly(connection);
+
+    QueryProfiler::attach(connection);
+    Metrics::addCount("db.pool.created");
+
     qDebug() << "Function Name: " << Q_FUNC_INFO << " new SQL connection instances Thread: " << thread->currentThread() << " Name: " << connectionName;
 
-    s_instances[objectname][connectionName] = connection;
+    PooledConnection pooled;
+    pooled.connection = connection;
+    pooled.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    s_instances[objectname][connectionName] = pooled;
+
+    // return the connections of a worker thread when it finishes, the signal is emitted from that thread
+    if (!s_watchedThreads.contains(thread)) {
+        s_watchedThreads.insert(thread);
+        QObject::connect(thread, &QThread::finished, [thread, objectname]() {
+            {
+                QMutexLocker locker(&s_databaseMutex);
+                s_watchedThreads.remove(thread);
+            }
+            removeThread(objectname);
+        });
+    }
+
     qDebug() << "Function Name: " << Q_FUNC_INFO << " connection instances used: " << s_instances.size();
 
     return connection;
 }
 
+/**
+ * @brief DatabaseManager::checkConnection
+ * reconnects a closed or long idle server connection and validates a
+ * connection which was idle for more than the validation interval
+ * @param connection
+ * @param idle milliseconds since the last lease
+ */
+void DatabaseManager::checkConnection(QSqlDatabase &connection, qint64 idle)
+{
+    bool reconnect = !connection.isOpen();
+    bool server = (connection.driverName() != "QSQLITE");
+
+    if (!reconnect && server && s_idleTimeout > 0 && idle > s_idleTimeout * 1000LL)
+        reconnect = true;
+
+    if (!reconnect && s_validationInterval > 0 && idle > s_validationInterval * 1000LL) {
+        QSqlQuery query(connection);
+        if (!query.exec("SELECT 1")) {
+            Metrics::addCount("db.pool.validationFailed");
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            reconnect = true;
+        }
+    }
+
+    if (!reconnect)
+        return;
+
+    connection.close();
+    if (!connection.open()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << connection.lastError().text();
+        return;
+    }
+
+    if (isReadOnly(connection.connectionName().section('_', 0, 0)))
+        setReadOnly(connection);
+
+    QueryProfiler::attach(connection);
+    Metrics::addCount("db.pool.reconnects");
+    qDebug() << "Function Name: " << Q_FUNC_INFO << " reconnected: " << connection.connectionName();
+}
+
 void DatabaseManager::clear()
 {
+    QMutexLocker locker(&s_databaseMutex);
     s_instances.clear();
+    s_connectionReleased.wakeAll();
 }
 
 void DatabaseManager::removeCurrentThread(QString connectionName)
 {
+    QMutexLocker locker(&s_databaseMutex);
+
     QString objectname = QString::number((long long)QThread::currentThread(), 16);
     if (s_instances.contains(objectname)) {
-        QMap<QString, QSqlDatabase> map = s_instances.value(objectname);
-        QSqlDatabase connection = map.value(connectionName);
+        QMap<QString, PooledConnection> &map = s_instances[objectname];
+        QSqlDatabase connection = map.value(connectionName).connection;
         connection.close();
         if (!connection.isOpen()) {
-            s_instances.remove(objectname);
+            map.remove(connectionName);
+            if (map.isEmpty())
+                s_instances.remove(objectname);
+            Metrics::addCount("db.pool.released");
+            s_connectionReleased.wakeOne();
             qDebug() << "Function Name: " << Q_FUNC_INFO << " remove connection instance: " << objectname;
         }
     }
 
     qDebug() << "Function Name: " << Q_FUNC_INFO << " connection instances used: " << s_instances.size();
 }
+
+/**
+ * @brief DatabaseManager::releaseCurrentThread
+ * returns all connections of the current thread, e.g. at the end of a
+ * QRunnable, whose pool thread stays alive for the next runnable
+ */
+void DatabaseManager::releaseCurrentThread()
+{
+    removeThread(QString::number((long long)QThread::currentThread(), 16));
+}
+
+/**
+ * @brief DatabaseManager::removeThread
+ * closes and unregisters all connections of a finished thread
+ * @param objectname
+ */
+void DatabaseManager::removeThread(const QString &objectname)
+{
+    QMutexLocker locker(&s_databaseMutex);
+
+    if (!s_instances.contains(objectname))
+        return;
+
+    QStringList names;
+    {
+        QMap<QString, PooledConnection> map = s_instances.take(objectname);
+        QMap<QString, PooledConnection>::iterator it;
+        for (it = map.begin(); it != map.end(); ++it) {
+            names.append(it.value().connection.connectionName());
+            it.value().connection.close();
+        }
+    }
+
+    foreach (const QString &name, names) {
+        QSqlDatabase::removeDatabase(name);
+        Metrics::addCount("db.pool.released");
+    }
+
+    s_connectionReleased.wakeAll();
+    qDebug() << "Function Name: " << Q_FUNC_INFO << " thread finished, connection instances used: " << s_instances.size();
+}
+
+int DatabaseManager::connectionCount()
+{
+    int count = 0;
+    QMap<QString, QMap<QString, PooledConnection> >::const_iterator it;
+    for (it = s_instances.constBegin(); it != s_instances.constEnd(); ++it)
+        count += it.value().size();
+
+    return count;
+}
+
+bool DatabaseManager::isReadOnly(const QString &connectionName)
+{
+    return connectionName == "RO" || connectionName == "RS";
+}
+
+/**
+ * @brief DatabaseManager::setReadOnly
+ * refuses writes on an open connection. SQLite connections should be opened
+ * with QSQLITE_OPEN_READONLY as well.
+ * @param connection
+ * @return
+ */
+bool DatabaseManager::setReadOnly(QSqlDatabase &connection)
+{
+    QSqlQuery query(connection);
+    bool ok;
+    if (connection.driverName() == "QSQLITE")
+        ok = query.exec("PRAGMA query_only = 1");
+    else
+        ok = query.exec("SET SESSION TRANSACTION READ ONLY");
+
+    if (!ok)
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+
+    return ok;
+}
+
+QJsonObject DatabaseManager::poolStatus()
+{
+    QMutexLocker locker(&s_databaseMutex);
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QJsonArray connections;
+    QMap<QString, QMap<QString, PooledConnection> >::const_iterator it;
+    for (it = s_instances.constBegin(); it != s_instances.constEnd(); ++it) {
+        QMap<QString, PooledConnection>::const_iterator conn;
+        for (conn = it.value().constBegin(); conn != it.value().constEnd(); ++conn) {
+            QJsonObject entry;
+            entry["thread"] = it.key();
+            entry["name"] = conn.key();
+            entry["open"] = conn.value().connection.isOpen();
+            entry["idleMs"] = double(now - conn.value().lastUsed);
+            connections.append(entry);
+        }
+    }
+
+    QJsonObject status;
+    status["connections"] = connectionCount();
+    status["leases"] = s_instances.size();
+    status["maxConnections"] = s_maxConnections;
+    status["idleTimeout"] = s_idleTimeout;
+    status["validationInterval"] = s_validationInterval;
+    status["leaseTimeout"] = s_leaseTimeout;
+    status["list"] = connections;
+
+    return status;
+}
@@ -27,21 +27,64 @@
 
 #include <QMutex>
 #include <QHash>
+#include <QSet>
 #include <QSqlDatabase>
 #include <QMap>
+#include <QWaitCondition>
 
 class QThread;
+class QJsonObject;
 
+/**
+ * @brief Per thread connection pool. A thread leases its connection with
+ * the first database() call and returns it with removeCurrentThread() or
+ * when the thread finishes. The number of leasing threads is bounded, a
+ * worker thread which gets no returned lease within the lease timeout gets
+ * an invalid connection. A thread which holds a lease already opens its
+ * further connection names (e.g. "RS" next to "CN") without waiting.
+ * QThreadPool threads only finish after their expiry timeout, a QRunnable
+ * calls releaseCurrentThread() at the end of run() instead.
+ * Idle connections are validated (or reopened) before they are handed out
+ * again.
+ * The connection names "RO" (browsing) and "RS" (reports) are opened read
+ * only: on SQLite further connections to the same file which read WAL
+ * snapshots without blocking the sales connection, on MySQL the replica host
+ * if one is configured. They are separate so a browsing model which keeps a
+ * cursor (and its snapshot) open never makes a report read stale data.
+ */
 class QRK_EXPORT DatabaseManager
 {
     public:
         static QSqlDatabase database(const QString& connectionName = QLatin1String(QSqlDatabase::defaultConnection));
         static void clear();
         static void removeCurrentThread(QString);
+        static void releaseCurrentThread();
+
+        static void setPoolLimits(int maxConnections, int idleTimeout, int validationInterval, int leaseTimeout = 5000);
+        static QJsonObject poolStatus();
+        static bool setReadOnly(QSqlDatabase &connection);
 
     private:
+        struct PooledConnection {
+            QSqlDatabase connection;
+            qint64 lastUsed;
+        };
+
+        static QSqlDatabase createConnection(QThread *thread, const QString &objectname, const QString &connectionName);
+        static void checkConnection(QSqlDatabase &connection, qint64 idle);
+        static void removeThread(const QString &objectname);
+        static int connectionCount();
+        static bool isReadOnly(const QString &connectionName);
+
         static QMutex s_databaseMutex;
-        static QMap<QString, QMap<QString, QSqlDatabase>> s_instances;
+        static QWaitCondition s_connectionReleased;
+        static QMap<QString, QMap<QString, PooledConnection>> s_instances;
+        static QSet<QThread *> s_watchedThreads;
+
+        static int s_maxConnections;
+        static int s_idleTimeout;
+        static int s_validationInterval;
+        static int s_leaseTimeout;
 
 };
 
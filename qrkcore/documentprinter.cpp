@@ -452,19 +452,20 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
 
     QPainter painter(&printer);
     QFont font(m_receiptPrinterFont);
-    ckvTemplate Template;
-    Template.set("DATUM", QDate::currentDate().toString());
-    Template.set("DISPLAYNAME", data.value("displayname").toString());
-    Template.set("UHRZEIT", QTime::currentTime().toString());
-    Template.set("BONNUMMER", QString::number(data.value("receiptNum").toInt()));
-    Template.set("VERSION", data.value("version").toString());
+    static const QStringList templateVariables = QStringList() << "DATUM" << "DISPLAYNAME" << "UHRZEIT" << "BONNUMMER" << "VERSION" << "SUMME";
     QString sum = QString::number(data.value("sum").toDouble(), 'f', 2);
 
     if (data.value("isTestPrint").toBool()) {
         sum = "0,0";
     }
 
-    Template.set("SUMME", sum);
+    QStringList templateValues;
+    templateValues << QDate::currentDate().toString()
+                   << data.value("displayname").toString()
+                   << QTime::currentTime().toString()
+                   << QString::number(data.value("receiptNum").toInt())
+                   << data.value("version").toString()
+                   << sum;
 
     // font.setFixedPitch(true);
     painter.setFont(font);
@@ -593,7 +594,7 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
 
     if (! data.value("printHeader").toString().isEmpty()) {
         QString printHeader = data.value("printHeader").toString();
-        printHeader = Utils::wordWrap(Template.process(printHeader), WIDTH, font);
+        printHeader = Utils::wordWrap(ckvCompiledTemplate::compile(printHeader, templateVariables)->render(templateValues), WIDTH, font);
         int headerTextHeight = printHeader.split(QRegExp("\n|\r\n|\r")).count() * fontMetr.height();
         painter.drawText(0, y, WIDTH, headerTextHeight, Qt::AlignCenter, printHeader);
         y += m_feedPrintHeader + headerTextHeight + 4;
@@ -890,16 +891,12 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
     }
 
     if (m_printQRCode && m_printQrCodeLeft) {
-        QRCode qr;
-        QPixmap QR = qr.encodeTextToPixmap(qr_code_rep);
-        QR = QR.scaled(QR.size() * FACTOR, Qt::KeepAspectRatio);
-
         int sumWidth = boldMetr.boundingRect(sumText).width();
 
-        if (QR.width() > (WIDTH - sumWidth))
-            QR =  QR.scaled(WIDTH - sumWidth - 4, printer.pageRect().height(), Qt::KeepAspectRatio);
+        QRCode qr;
+        QImage QR = qr.encodeTextToImage(qr_code_rep, FACTOR, qMin(WIDTH - sumWidth - 4, printer.pageRect().height()));
 
-        painter.drawPixmap( 1, ySave, QR);
+        painter.drawImage( 1, ySave, QR);
 
         y = m_feedQRCode + qMax(ySave + QR.height(), y);
 
@@ -927,7 +924,7 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
     else if (! data.value("printFooter").toString().isEmpty()) {
         y += 5;
         QString printFooter = data.value("printFooter").toString();
-        printFooter = Utils::wordWrap(Template.process(printFooter), WIDTH, font);
+        printFooter = Utils::wordWrap(ckvCompiledTemplate::compile(printFooter, templateVariables)->render(templateValues), WIDTH, font);
         int headerTextHeight = printFooter.split(QRegExp("\n|\r\n|\r")).count() * fontMetr.height();
         painter.drawText(0, y, WIDTH, headerTextHeight, Qt::AlignCenter, printFooter);
         y += 5 + headerTextHeight + 4;
@@ -937,12 +934,7 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
 
     if (m_printQRCode && !m_printQrCodeLeft) {
         QRCode qr;
-        QPixmap QR = qr.encodeTextToPixmap(qr_code_rep);
-        QR = QR.scaled(QR.size() * FACTOR, Qt::KeepAspectRatio);
-
-        if (QR.width() > WIDTH) {
-            QR =  QR.scaled(WIDTH, printer.pageRect().height(), Qt::KeepAspectRatio);
-        }
+        QImage QR = qr.encodeTextToImage(qr_code_rep, FACTOR, qMin(WIDTH, printer.pageRect().height()));
 
         y += 5;
         painter.drawLine(0, y, WIDTH, y);
@@ -954,7 +946,7 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
             printer.newPage();
             y = 0;
         }
-        painter.drawPixmap((WIDTH / 2) - (QR.width()/2) - 1, y, QR);
+        painter.drawImage((WIDTH / 2) - (QR.width()/2) - 1, y, QR);
 
         y += QR.height() + m_feedQRCode;
 
@@ -1014,7 +1006,7 @@ void DocumentPrinter::printI(QJsonObject data, QPrinter &printer)
 
     if (! data.value("printAdvertisingText").toString().isEmpty()) {
         QString printAdvertisingText = data.value("printAdvertisingText").toString();
-        printAdvertisingText = Utils::wordWrap(Template.process(printAdvertisingText), WIDTH, font);
+        printAdvertisingText = Utils::wordWrap(ckvCompiledTemplate::compile(printAdvertisingText, templateVariables)->render(templateValues), WIDTH, font);
         int headerTextHeight = printAdvertisingText.split(QRegExp("\n|\r\n|\r")).count() * fontMetr.height();
         painter.drawText(0, y, WIDTH, headerTextHeight, Qt::AlignCenter, printAdvertisingText);
         y += headerTextHeight;
@@ -0,0 +1,390 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "journalpartitions.h"
+#include "database.h"
+#include "utils/metrics.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QFileInfo>
+#include <QDir>
+#include <QDate>
+#include <QDateTime>
+#include <QRegExp>
+#include <QDebug>
+
+#include <algorithm>
+
+JournalPartitions::JournalPartitions(QSqlDatabase dbc)
+    : m_dbc(dbc), m_attached(0)
+{
+}
+
+JournalPartitions::~JournalPartitions()
+{
+    if (m_attached > 0)
+        detach(m_dbc, m_attached);
+}
+
+/**
+ * @brief JournalPartitions::years
+ * @param from ISO date time
+ * @param to ISO date time
+ * @return the archived years which overlap [from, to], oldest first, followed
+ * by 0 for the hot journal table
+ */
+QList<int> JournalPartitions::years(const QString &from, const QString &to)
+{
+    QList<int> list;
+    int first = 0;
+    int hot = hotYear(m_dbc, &first);
+    if (hot > 0) {
+        QDate fromDate = QDateTime::fromString(from, Qt::ISODate).date();
+        QDate toDate = QDateTime::fromString(to, Qt::ISODate).date();
+        foreach (int year, archivedYears(m_dbc, first, hot)) {
+            if (fromDate.isValid() && year < fromDate.year())
+                continue;
+            if (toDate.isValid() && year > toDate.year())
+                continue;
+            list.append(year);
+        }
+    }
+    list.append(0);
+
+    return list;
+}
+
+/**
+ * @brief JournalPartitions::select
+ * runs "SELECT columns" on the journal rows of one partition between from and
+ * to. The header rows (id < 5) are never part of the result. For SQLite the
+ * yearly database file is attached, the previous one is detached, so the
+ * query of the previous partition must be finished.
+ * @param query
+ * @param year 0 for the hot journal table
+ * @param columns
+ * @param from
+ * @param to
+ * @return
+ */
+bool JournalPartitions::select(QSqlQuery &query, int year, const QString &columns, const QString &from, const QString &to)
+{
+    QString source = "journal";
+    QString bounds;
+
+    if (year > 0) {
+        if (m_dbc.driverName() == "QSQLITE") {
+            if (m_attached != year) {
+                if (m_attached > 0)
+                    detach(m_dbc, m_attached);
+                m_attached = 0;
+                if (!attach(m_dbc, year))
+                    return false;
+                m_attached = year;
+            }
+            source = QString("journal_%1.journal").arg(year);
+        } else {
+            source = QString("journal_%1").arg(year);
+        }
+        bounds = QString(" AND datetime >= '%1-01-01' AND datetime < '%2-01-01'").arg(year).arg(year + 1);
+    } else {
+        int hot = hotYear(m_dbc);
+        if (hot > 0)
+            bounds = QString(" AND datetime >= '%1-01-01'").arg(hot);
+    }
+
+    query.prepare(QString("SELECT %1 FROM %2 WHERE datetime BETWEEN :fromDate AND :toDate AND id > 4%3")
+                  .arg(columns).arg(source).arg(bounds));
+    query.bindValue(":fromDate", from);
+    query.bindValue(":toDate", to);
+
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    return true;
+}
+
+int JournalPartitions::count(const QString &from, const QString &to)
+{
+    int rows = 0;
+    foreach (int year, years(from, to)) {
+        QSqlQuery query(m_dbc);
+        if (select(query, year, "COUNT(*)", from, to) && query.next())
+            rows += query.value(0).toInt();
+    }
+
+    return rows;
+}
+
+/**
+ * @brief JournalPartitions::hotYear
+ * @param dbc
+ * @param first if set, receives the oldest archived year
+ * @return first year kept in the journal table, 0 if nothing was archived
+ */
+int JournalPartitions::hotYear(QSqlDatabase dbc, int *first)
+{
+    QSqlQuery query(dbc);
+    query.exec("SELECT value, strValue FROM globals WHERE name='journalArchive'");
+    if (query.next()) {
+        if (first)
+            *first = query.value(1).toInt();
+        return query.value(0).toInt();
+    }
+
+    return 0;
+}
+
+/**
+ * @brief JournalPartitions::reset
+ * the journal starts over in the current year, older partitions are no
+ * longer part of it.
+ * @param dbc
+ */
+void JournalPartitions::reset(QSqlDatabase dbc)
+{
+    int year = QDate::currentDate().year();
+    QSqlQuery query(dbc);
+
+    if (dbc.driverName() != "QSQLITE") {
+        foreach (int i, archivedYears(dbc, 0, year))
+            query.exec(QString("DROP TABLE journal_%1").arg(i));
+    }
+
+    query.exec("DELETE FROM globals WHERE name='journalArchive'");
+    query.exec(QString("INSERT INTO globals (name, value, strValue) VALUES('journalArchive', %1, '%1')").arg(year));
+}
+
+/**
+ * @brief JournalPartitions::archive
+ * moves the journal rows of all years before the current one out of the
+ * journal table. Called once at startup, does nothing if the current year is
+ * already the hot year. SQLite rows are only deleted if the yearly database
+ * file holds every one of them unchanged, the last row stays because
+ * Database::getLastJournalEntryDate and getLastVersionInfo read MAX(id).
+ * @param dbc
+ * @return
+ */
+bool JournalPartitions::archive(QSqlDatabase dbc)
+{
+    int year = QDate::currentDate().year();
+    int first = 0;
+    if (hotYear(dbc, &first) >= year)
+        return true;
+
+    MetricsTimer timer("journal.archive");
+
+    QSqlQuery query(dbc);
+    query.prepare("SELECT MIN(datetime) FROM journal WHERE id > 4 AND id < (SELECT MAX(id) FROM journal)");
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    int minYear = year;
+    if (query.next() && !query.value(0).isNull())
+        minYear = qMin(year, query.value(0).toString().left(4).toInt());
+
+    // the oldest partition is kept from the first run
+    if (first == 0)
+        first = minYear;
+
+    bool ok;
+    if (dbc.driverName() == "QSQLITE")
+        ok = archiveSqlite(dbc, minYear, year, first);
+    else
+        ok = archiveMysql(dbc, minYear, year, first);
+
+    if (!ok)
+        return false;
+
+    qInfo() << "Function Name: " << Q_FUNC_INFO << " journal archived before " << year;
+
+    if (dbc.driverName() == "QSQLITE" && minYear < year)
+        query.exec("VACUUM");
+
+    return true;
+}
+
+bool JournalPartitions::archiveSqlite(QSqlDatabase dbc, int minYear, int year, int first)
+{
+    /* every row deleted below has to be in the database file of its year
+     * with the same content, a row count would accept a partial or a
+     * different copy */
+    QString columns = "id, version, cashregisterid, datetime, data, checksum";
+    QSqlQuery query(dbc);
+    for (int i = minYear; i < year; i++) {
+        if (countRows(dbc, "journal", i) == 0)
+            continue;
+
+        if (!attach(dbc, i)) {
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " no archive for " << i << " journal is not archived";
+            return false;
+        }
+
+        int missing = -1;
+        if (query.exec(QString("SELECT COUNT(*) FROM (SELECT %1 FROM journal WHERE id > 4 AND id < (SELECT MAX(id) FROM journal) AND datetime >= '%2-01-01' AND datetime < '%3-01-01'"
+                               " EXCEPT SELECT %1 FROM journal_%2.journal)").arg(columns).arg(i).arg(i + 1)) && query.next())
+            missing = query.value(0).toInt();
+        else
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        query.finish();
+        detach(dbc, i);
+
+        if (missing != 0) {
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " archive " << i << " lacks " << missing << " journal rows, journal is not archived";
+            return false;
+        }
+    }
+
+    if (!dbc.transaction())
+        return false;
+
+    bool ok = query.exec(QString("DELETE FROM journal WHERE id > 4 AND id < (SELECT MAX(id) FROM journal) AND datetime < '%1-01-01'").arg(year));
+    ok = ok && query.exec("DELETE FROM globals WHERE name='journalArchive'");
+    ok = ok && query.exec(QString("INSERT INTO globals (name, value, strValue) VALUES('journalArchive', %1, '%2')").arg(year).arg(first));
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit();
+}
+
+bool JournalPartitions::archiveMysql(QSqlDatabase dbc, int minYear, int year, int first)
+{
+    QSqlQuery query(dbc);
+
+    // CREATE TABLE commits implicitly, create the partitions first
+    for (int i = minYear; i < year; i++) {
+        if (countRows(dbc, "journal", i) == 0)
+            continue;
+        if (!query.exec(QString("CREATE TABLE IF NOT EXISTS journal_%1 LIKE journal").arg(i))) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            return false;
+        }
+    }
+
+    if (!dbc.transaction())
+        return false;
+
+    bool ok = true;
+    for (int i = minYear; ok && i < year; i++) {
+        if (countRows(dbc, "journal", i) == 0)
+            continue;
+        QString where = QString("WHERE id > 4 AND id < (SELECT MAX(id) FROM (SELECT id FROM journal) AS j) AND datetime >= '%1-01-01' AND datetime < '%2-01-01'").arg(i).arg(i + 1);
+        ok = query.exec(QString("INSERT INTO journal_%1 SELECT * FROM journal %2").arg(i).arg(where));
+        ok = ok && query.exec(QString("DELETE FROM journal %1").arg(where));
+    }
+    ok = ok && query.exec("DELETE FROM globals WHERE name='journalArchive'");
+    ok = ok && query.exec(QString("INSERT INTO globals (name, value, strValue) VALUES('journalArchive', %1, '%2')").arg(year).arg(first));
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        dbc.rollback();
+        return false;
+    }
+
+    return dbc.commit();
+}
+
+int JournalPartitions::countRows(QSqlDatabase dbc, const QString &table, int year)
+{
+    QSqlQuery query(dbc);
+    query.exec(QString("SELECT COUNT(*) FROM %1 WHERE id > 4 AND datetime >= '%2-01-01' AND datetime < '%3-01-01'")
+               .arg(table).arg(year).arg(year + 1));
+    if (query.next())
+        return query.value(0).toInt();
+
+    return 0;
+}
+
+QList<int> JournalPartitions::archivedYears(QSqlDatabase dbc, int first, int hotYear)
+{
+    QList<int> list;
+
+    if (dbc.driverName() == "QSQLITE") {
+        QFileInfo fi(dbc.databaseName());
+        QRegExp rx("^(\\d{4})-(.+)\\.db$");
+        if (!rx.exactMatch(fi.fileName()))
+            return list;
+
+        QString basename = rx.cap(2);
+        QStringList files = fi.absoluteDir().entryList(QStringList() << QString("????-%1.db").arg(basename), QDir::Files, QDir::Name);
+        foreach (const QString &file, files) {
+            int year = rx.exactMatch(file) && rx.cap(2) == basename ? rx.cap(1).toInt() : 0;
+            if (year >= first && year < hotYear)
+                list.append(year);
+        }
+    } else {
+        QSqlQuery query(dbc);
+        query.exec("SHOW TABLES LIKE 'journal\\_%'");
+        QRegExp rx("^journal_(\\d{4})$");
+        while (query.next()) {
+            int year = rx.exactMatch(query.value(0).toString()) ? rx.cap(1).toInt() : 0;
+            if (year >= first && year < hotYear)
+                list.append(year);
+        }
+        std::sort(list.begin(), list.end());
+    }
+
+    return list;
+}
+
+QString JournalPartitions::archiveFile(QSqlDatabase dbc, int year)
+{
+    QFileInfo fi(dbc.databaseName());
+    QString name = fi.fileName();
+
+    return fi.absoluteDir().absoluteFilePath(QString("%1%2").arg(year).arg(name.mid(4)));
+}
+
+bool JournalPartitions::attach(QSqlDatabase dbc, int year)
+{
+    QString filename = archiveFile(dbc, year);
+    if (filename == QFileInfo(dbc.databaseName()).absoluteFilePath() || !QFileInfo::exists(filename))
+        return false;
+
+    QSqlQuery query(dbc);
+    if (!query.exec(QString("ATTACH DATABASE '%1' AS journal_%2").arg(filename.replace("'", "''")).arg(year))) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        return false;
+    }
+
+    return true;
+}
+
+void JournalPartitions::detach(QSqlDatabase dbc, int year)
+{
+    QSqlQuery query(dbc);
+    if (!query.exec(QString("DETACH DATABASE journal_%1").arg(year)))
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+}
@@ -0,0 +1,71 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef JOURNALPARTITIONS_H
+#define JOURNALPARTITIONS_H
+
+#include <QSqlDatabase>
+#include <QStringList>
+#include <QList>
+
+#include "qrkcore_global.h"
+
+class QSqlQuery;
+
+/**
+ * @brief The JournalPartitions class splits the journal by year.
+ * The hot journal table keeps the current year, older years are archived:
+ * SQLite uses the yearly database files (<year>-<name>.db) which are attached
+ * on demand, MySQL moves the rows into tables journal_<year>.
+ * Readers walk years() and select() each partition, the partitions are
+ * returned oldest first so the rows stay in journal (id) order.
+ */
+class QRK_EXPORT JournalPartitions
+{
+public:
+    explicit JournalPartitions(QSqlDatabase dbc);
+    ~JournalPartitions();
+
+    QList<int> years(const QString &from, const QString &to);
+    bool select(QSqlQuery &query, int year, const QString &columns, const QString &from, const QString &to);
+    int count(const QString &from, const QString &to);
+
+    static bool archive(QSqlDatabase dbc);
+    static void reset(QSqlDatabase dbc);
+    static int hotYear(QSqlDatabase dbc, int *first = 0);
+
+private:
+    Q_DISABLE_COPY(JournalPartitions)
+
+    static QList<int> archivedYears(QSqlDatabase dbc, int first, int hotYear);
+    static QString archiveFile(QSqlDatabase dbc, int year);
+    static bool attach(QSqlDatabase dbc, int year);
+    static void detach(QSqlDatabase dbc, int year);
+    static int countRows(QSqlDatabase dbc, const QString &table, int year);
+    static bool archiveSqlite(QSqlDatabase dbc, int minYear, int year, int first);
+    static bool archiveMysql(QSqlDatabase dbc, int minYear, int year, int first);
+
+    QSqlDatabase m_dbc;
+    int m_attached;
+};
+
+#endif // JOURNALPARTITIONS_H
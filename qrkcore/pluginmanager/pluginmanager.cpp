@@ -30,15 +30,20 @@ class PluginManagerPrivate
 {
 public:
     bool check(const QString& path);
+    void setFailed(const QString& path);
+    bool isFailed(const QString& path);
 
 public:
     QHash<QString, QVariant> names;
     QHash<QString, QVariant> versions;
     QHash<QString, QVariant> author;
     QHash<QString, QVariantList> dependencies;
+    QHash<QString, QString> interfaces;
 
 public:
     QHash<QString, QPluginLoader *> loaders;
+    QSet<QString> failed;
+    QMutex mutex;
 };
 
 bool PluginManagerPrivate::check(const QString& path)
@@ -74,6 +79,19 @@ bool PluginManagerPrivate::check(const QString& path)
     return status;
 }
 
+/* plugins are loaded in the gui thread but looked up from any thread */
+void PluginManagerPrivate::setFailed(const QString& path)
+{
+    QMutexLocker locker(&this->mutex);
+    this->failed.insert(path);
+}
+
+bool PluginManagerPrivate::isFailed(const QString& path)
+{
+    QMutexLocker locker(&this->mutex);
+    return this->failed.contains(path);
+}
+
 PluginManager *PluginManager::instance(void)
 {
     if(!s_instance)
@@ -98,14 +116,13 @@ void PluginManager::initialize(void)
     path.cd("plugins");
     paths << path.absolutePath();
 
+    /* only the metadata is read here, the libraries are loaded on first use
+     * by getObjectByName, so startup does not pay for plugins never used */
     foreach (const QString &str, paths) {
         qInfo() << "Plugin search Path=" << str;
         path = QDir(str);
         foreach(QFileInfo info, path.entryInfoList(QDir::Files | QDir::NoDotAndDotDot))
             this->scan(info.absoluteFilePath().trimmed());
-
-        foreach(QFileInfo info, path.entryInfoList(QDir::Files | QDir::NoDotAndDotDot))
-            this->load(info.absoluteFilePath().trimmed());
     }
 }
 
@@ -130,6 +147,7 @@ void PluginManager::scan(const QString& path)
         d->versions.insert(path, loader->metaData().value("MetaData").toObject().value("version").toVariant());
         d->author.insert(path, loader->metaData().value("MetaData").toObject().value("author").toVariant());
         d->dependencies.insert(path, loader->metaData().value("MetaData").toObject().value("dependencies").toArray().toVariantList());
+        d->interfaces.insert(path, loader->metaData().value("IID").toString());
     }
 
     delete loader;
@@ -140,20 +158,34 @@ void PluginManager::load(const QString& path)
     if(!QLibrary::isLibrary(path))
         return;
 
-    if(!d->check(path))
+    if (isLoaded(path))
+        return;
+
+    if(!d->check(path)) {
+        d->setFailed(path);
         return;
+    }
+
+    /* dependencies have to be there before the plugin itself */
+    foreach(QVariant item, d->dependencies.value(path))
+        this->load(d->names.key(item.toMap().value("name")));
 
     QPluginLoader *loader = new QPluginLoader(path);
     if (d->names.value(path) == loader->metaData().value("MetaData").toObject().value("name").toVariant()) {
         if(qobject_cast<PluginInterface *>(loader->instance())) {
-            d->loaders.insert(path, loader);
+            {
+                QMutexLocker locker(&d->mutex);
+                d->loaders.insert(path, loader);
+            }
             if (!qobject_cast<PluginInterface *>(loader->instance())->initialize())
                 qWarning() << "can't initialize: " << path;
         } else {
             qWarning() << "can't load: " << path << " Error: " << loader->errorString();
+            d->setFailed(path);
             delete loader;
         }
     } else {
+        d->setFailed(path);
         delete loader;
     }
 
@@ -167,25 +199,55 @@ void PluginManager::unload(const QString& path)
         qWarning() << "can't deinitialize: " << path;
 
     if(loader->unload()) {
+        QMutexLocker locker(&d->mutex);
         d->loaders.remove(path);
         delete loader;
     }
 }
 
+/* loads the plugins which worker threads look up, they only get plugins
+ * which are already loaded (see getObjectByName) */
+void PluginManager::preload(const QStringList& names)
+{
+    foreach(const QString &name, names)
+        getObjectByName(name);
+}
+
 QStringList PluginManager::plugins(void)
 {
-    return  d->loaders.keys();
+    QStringList list;
+    foreach(const QString &path, d->names.keys()) {
+        if (!d->isFailed(path) && d->check(path))
+            list.append(path);
+    }
+
+    return list;
 }
 
 QObject* PluginManager::getObjectByName(QString name)
 {
     if (name.contains("*"))
         name = getHashValue(name);
-    if (!d->names.key((QVariant)name).isNull()) {
-        if (d->loaders.value(d->names.key((QVariant)name))) {
-            return d->loaders.value(d->names.key((QVariant)name))->instance();
+
+    QString path = d->names.key((QVariant)name);
+    if (path.isNull())
+        return NULL;
+
+    if (!isLoaded(path) && !d->isFailed(path)) {
+        /* plugin objects have to live in the gui thread. A worker thread
+         * must not wait for it, the gui thread may be waiting for that
+         * worker (e.g. the import thread at shutdown) */
+        if (QThread::currentThread() != thread()) {
+            qDebug() << "Function Name: " << Q_FUNC_INFO << " not loaded: " << name;
+            return NULL;
         }
+        load(path);
     }
+
+    QMutexLocker locker(&d->mutex);
+    if (d->loaders.value(path))
+        return d->loaders.value(path)->instance();
+
     return NULL;
 }
 
@@ -194,6 +256,17 @@ QString PluginManager::getNameByPath(QString path)
     return d->names.value(path).toString();
 }
 
+QString PluginManager::getInterfaceByPath(QString path)
+{
+    return d->interfaces.value(path);
+}
+
+bool PluginManager::isLoaded(QString path)
+{
+    QMutexLocker locker(&d->mutex);
+    return d->loaders.contains(path);
+}
+
 QString PluginManager::getHashValue(QString strVal)
 {
     strVal.replace("*", "");
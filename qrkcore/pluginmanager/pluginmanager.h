@@ -39,10 +39,13 @@ public:
     void   scan(const QString& path);
     void   load(const QString& path);
     void unload(const QString& path);
+    void preload(const QStringList& names);
 
     QStringList plugins(void);
     QObject *getObjectByName(QString name);
     QString getNameByPath(QString path);
+    QString getInterfaceByPath(QString path);
+    bool isLoaded(QString path);
 
 protected:
      PluginManager(void);
@@ -51,11 +51,17 @@ TARGET = QrkCore
 SOURCES = database.cpp \
     databasedefinition.cpp \
     utils/demomode.cpp \
+    utils/metrics.cpp \
+    utils/jsonimportfile.cpp \
     preferences/qrksettings.cpp \
     journal.cpp \
+    journalpartitions.cpp \
+    registerstatistics.cpp \
     utils/qrcode.cpp \
     utils/utils.cpp \
     singleton/spreadsignal.cpp \
+    singleton/fiscalstate.cpp \
+    singleton/fiscalperiod.cpp \
     RK/a_signacos_04.cpp \
     RK/a_signcardos_53.cpp \
     RK/a_signonline.cpp \
@@ -66,10 +72,13 @@ SOURCES = database.cpp \
     RK/rk_signaturemodulefactory.cpp \
     RK/rk_signatureonline.cpp \
     RK/rk_signaturesmartcard.cpp \
+    RK/rk_signaturesession.cpp \
     RK/rk_smartcardinfo.cpp \
+    RK/rk_turnovercrypto.cpp \
     documentprinter.cpp \
     receiptitemmodel.cpp \
     reports.cpp \
+    reportjob.cpp \
     backup.cpp \
     pluginmanager/pluginmanager.cpp \
     pluginmanager/treeitem.cpp \
@@ -77,8 +86,10 @@ SOURCES = database.cpp \
     pluginmanager/pluginview.cpp \
     export.cpp \
     utils/versionchecker.cpp \
+    utils/turnovercountercheck.cpp \
     qrkprogress.cpp \
     databasemanager.cpp \
+    queryprofiler.cpp \
     qrkpushbutton.cpp \
     qrkmultimedia.cpp
 
@@ -86,13 +97,19 @@ SOURCES = database.cpp \
 HEADERS = database.h \
     databasedefinition.h \
     utils/demomode.h \
+    utils/metrics.h \
+    utils/jsonimportfile.h \
     preferences/qrksettings.h \
     journal.h \
+    journalpartitions.h \
+    registerstatistics.h \
     defines.h \
     utils/qrcode.h \
     utils/utils.h \
     singleton/Singleton.h \
     singleton/spreadsignal.h \
+    singleton/fiscalstate.h \
+    singleton/fiscalperiod.h \
     RK/a_signacos_04.h \
     RK/a_signcardos_53.h \
     RK/a_signonline.h \
@@ -103,10 +120,13 @@ HEADERS = database.h \
     RK/rk_signaturemodulefactory.h \
     RK/rk_signatureonline.h \
     RK/rk_signaturesmartcard.h \
+    RK/rk_signaturesession.h \
     RK/rk_smartcardinfo.h \
+    RK/rk_turnovercrypto.h \
     documentprinter.h \
     receiptitemmodel.h \
     reports.h \
+    reportjob.h \
     backup.h \
     qrkcore_global.h \
     pluginmanager/pluginmanager.h \
@@ -118,9 +138,11 @@ HEADERS = database.h \
     pluginmanager/Interfaces/wsdlinterface.h \
     export.h \
     utils/versionchecker.h \
+    utils/turnovercountercheck.h \
     qrkprogress.h \
     pluginmanager/Interfaces/independentinterface.h \
     databasemanager.h \
+    queryprofiler.h \
     qrktimedmessagebox.h \
     qrkpushbutton.h \
     qrkmultimedia.h
@@ -160,6 +182,13 @@ RESOURCES += \
     error("Unable to include qbcmath.")
 }
 
+# count and profile SQLite statements, needs Qt built against the system sqlite
+# qmake CONFIG+=qrk_sqlite_trace
+qrk_sqlite_trace {
+ DEFINES += QRK_SQLITE_TRACE
+ LIBS += -lsqlite3
+}
+
 unix:!macx {
  INCLUDEPATH += /usr/include/PCSC
  LIBS += -lpcsclite
@@ -30,6 +30,9 @@ QRKProgress::QRKProgress(QDialog *parent)
     setAttribute(Qt::WA_DeleteOnClose);
     ui->setupUi(this);
     ui->progress->setValue(0);
+    ui->cancelButton->setVisible(false);
+
+    connect(ui->cancelButton, &QPushButton::clicked, this, &QRKProgress::cancelled);
 }
 
 QRKProgress::~QRKProgress()
@@ -55,3 +58,9 @@ void QRKProgress::setText(QString text)
 {
     ui->label->setText(text);
 }
+
+void QRKProgress::setCancelable(bool cancelable)
+{
+    ui->cancelButton->setVisible(cancelable);
+    ui->cancelButton->setEnabled(cancelable);
+}
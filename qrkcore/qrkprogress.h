@@ -40,6 +40,10 @@ public:
 
     void setWaitMode(bool waitmode = true);
     void setText(QString text);
+    void setCancelable(bool cancelable = true);
+
+signals:
+    void cancelled();
 
 public slots:
     void progress ( int );
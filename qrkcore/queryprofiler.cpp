@@ -0,0 +1,268 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "queryprofiler.h"
+#include "database.h"
+#include "utils/metrics.h"
+
+#include <QHash>
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlDriver>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QSqlRecord>
+#include <QDebug>
+
+#include <algorithm>
+
+#ifdef QRK_SQLITE_TRACE
+#include <sqlite3.h>
+#endif
+
+namespace {
+
+QMutex s_mutex;
+QHash<QString, QueryProfile> s_profiles;
+
+#ifdef QRK_SQLITE_TRACE
+QHash<void *, qint64> s_rows;
+
+int sqliteTrace(unsigned type, void *, void *p, void *x)
+{
+    if (type == SQLITE_TRACE_ROW) {
+        if (QueryProfiler::isEnabled()) {
+            QMutexLocker locker(&s_mutex);
+            s_rows[p]++;
+        }
+        return 0;
+    }
+
+    if (type != SQLITE_TRACE_PROFILE)
+        return 0;
+
+    Metrics::addCount("db.queries");
+
+    if (!QueryProfiler::isEnabled())
+        return 0;
+
+    sqlite3_stmt *stmt = static_cast<sqlite3_stmt *>(p);
+    qint64 rows = 0;
+    {
+        QMutexLocker locker(&s_mutex);
+        rows = s_rows.take(p);
+    }
+
+    const char *sql = sqlite3_sql(stmt);
+    if (!sql || qstrnicmp(sql, "EXPLAIN", 7) == 0)
+        return 0;
+
+    qint64 usec = *static_cast<sqlite3_int64 *>(x) / 1000;
+    QString expanded;
+    if (QueryProfiler::isSlow(usec)) {
+        char *text = sqlite3_expanded_sql(stmt);
+        expanded = QString::fromUtf8(text);
+        sqlite3_free(text);
+    }
+
+    QueryProfiler::record(QString::fromUtf8(sql), usec, rows, expanded);
+
+    return 0;
+}
+#endif
+
+}
+
+QAtomicInt QueryProfiler::s_enabled(0);
+QAtomicInt QueryProfiler::s_slowQueryMs(100);
+
+bool QueryProfiler::isAvailable()
+{
+#ifdef QRK_SQLITE_TRACE
+    return true;
+#else
+    return false;
+#endif
+}
+
+void QueryProfiler::setEnabled(bool enabled)
+{
+    s_enabled.store(enabled ? 1 : 0);
+    qInfo() << "Function Name: " << Q_FUNC_INFO << " query profiler enabled: " << enabled << " available: " << isAvailable();
+}
+
+/**
+ * @brief QueryProfiler::setSlowQueryThreshold
+ * @param ms statements running longer are logged with their bound values, 0 disables the log
+ */
+void QueryProfiler::setSlowQueryThreshold(int ms)
+{
+    s_slowQueryMs.store(qMax(0, ms));
+}
+
+bool QueryProfiler::isSlow(qint64 usec)
+{
+    int ms = s_slowQueryMs.load();
+    return ms > 0 && usec >= qint64(ms) * 1000;
+}
+
+void QueryProfiler::reset()
+{
+    QMutexLocker locker(&s_mutex);
+    s_profiles.clear();
+}
+
+/**
+ * @brief QueryProfiler::attach
+ * installs the statement hook on a freshly opened SQLite connection.
+ * The hook stays installed, QueryProfiler::setEnabled switches the recording.
+ */
+void QueryProfiler::attach(QSqlDatabase &connection)
+{
+#ifdef QRK_SQLITE_TRACE
+    if (connection.driverName() != "QSQLITE")
+        return;
+
+    QVariant handle = connection.driver()->handle();
+    if (handle.isValid() && qstrcmp(handle.typeName(), "sqlite3*") == 0) {
+        sqlite3 *db = *static_cast<sqlite3 **>(handle.data());
+        if (db)
+            sqlite3_trace_v2(db, SQLITE_TRACE_PROFILE | SQLITE_TRACE_ROW, sqliteTrace, 0);
+    }
+#else
+    Q_UNUSED(connection)
+#endif
+}
+
+void QueryProfiler::record(const QString &sql, qint64 usec, qint64 rows, const QString &expanded)
+{
+    QString key = normalize(sql);
+
+    if (!expanded.isEmpty())
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " slow query: " << usec / 1000 << " ms Query: " << expanded;
+
+    QMutexLocker locker(&s_mutex);
+    QueryProfile &profile = s_profiles[key];
+    if (profile.count == 0) {
+        profile.sql = key;
+        // normalized IN lists are no valid SQL, keep one statement for explain()
+        profile.example = sql;
+    }
+
+    profile.count++;
+    profile.total += usec;
+    profile.rows += rows;
+    if (usec > profile.max)
+        profile.max = usec;
+}
+
+/**
+ * @brief QueryProfiler::profiles
+ * @param limit maximum number of statements, -1 for all
+ * @return statements ordered by total time, the worst first
+ */
+QList<QueryProfile> QueryProfiler::profiles(int limit)
+{
+    QList<QueryProfile> list;
+    {
+        QMutexLocker locker(&s_mutex);
+        list = s_profiles.values();
+    }
+
+    std::sort(list.begin(), list.end(), [](const QueryProfile &a, const QueryProfile &b) {
+        return a.total > b.total;
+    });
+
+    if (limit >= 0 && list.size() > limit)
+        list = list.mid(0, limit);
+
+    return list;
+}
+
+QJsonArray QueryProfiler::toJson(int limit)
+{
+    QJsonArray array;
+    foreach (const QueryProfile &profile, profiles(limit)) {
+        QJsonObject entry;
+        entry["sql"] = profile.sql;
+        entry["count"] = profile.count;
+        entry["total_us"] = profile.total;
+        entry["max_us"] = profile.max;
+        entry["rows"] = profile.rows;
+        array.append(entry);
+    }
+
+    return array;
+}
+
+/**
+ * @brief QueryProfiler::explain
+ * @param sql statement as executed (QueryProfile::example), placeholders are executed as NULL
+ * @return the rows of EXPLAIN QUERY PLAN
+ */
+QStringList QueryProfiler::explain(const QString &sql)
+{
+    QStringList plan;
+
+    QSqlDatabase dbc = Database::database();
+    if (dbc.driverName() != "QSQLITE") {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " EXPLAIN QUERY PLAN is only supported with SQLite";
+        return plan;
+    }
+
+    QSqlQuery query(dbc);
+    if (!query.exec("EXPLAIN QUERY PLAN " + sql)) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return plan;
+    }
+
+    while (query.next())
+        plan.append(query.value("detail").toString());
+
+    return plan;
+}
+
+/**
+ * @brief QueryProfiler::normalize
+ * replaces string and number literals with ? and collapses whitespace, so
+ * statements built with QString::arg are counted together.
+ */
+QString QueryProfiler::normalize(const QString &sql)
+{
+    static const QRegularExpression strings("'(?:[^']|'')*'");
+    static const QRegularExpression numbers("(?<![\\w.])-?\\d+(?:\\.\\d+)?\\b");
+    static const QRegularExpression lists("\\?(?:\\s*,\\s*\\?)+");
+    static const QRegularExpression spaces("\\s+");
+
+    QString normalized = sql;
+    normalized.replace(strings, "?");
+    normalized.replace(numbers, "?");
+    normalized.replace(lists, "?, ...");
+    normalized.replace(spaces, " ");
+
+    return normalized.trimmed();
+}
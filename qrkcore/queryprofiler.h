@@ -0,0 +1,77 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef QUERYPROFILER_H
+#define QUERYPROFILER_H
+
+#include "qrkcore_global.h"
+
+#include <QAtomicInt>
+#include <QJsonArray>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+class QSqlDatabase;
+
+struct QRK_EXPORT QueryProfile
+{
+    QueryProfile() : count(0), total(0), max(0), rows(0) {}
+
+    QString sql;
+    QString example;
+    qint64 count;
+    qint64 total;
+    qint64 max;
+    qint64 rows;
+};
+
+/**
+ * @brief The QueryProfiler class collects statistics for every statement
+ * executed on a connection handed out by DatabaseManager.
+ * The statement hook uses sqlite3_trace_v2 and is only available when QRK
+ * is built with CONFIG+=qrk_sqlite_trace. MySQL connections are not profiled.
+ */
+class QRK_EXPORT QueryProfiler
+{
+  public:
+    static bool isAvailable();
+    static bool isEnabled() { return s_enabled.load() != 0; }
+    static void setEnabled(bool enabled);
+    static void setSlowQueryThreshold(int ms);
+    static void reset();
+
+    static void attach(QSqlDatabase &connection);
+    static void record(const QString &sql, qint64 usec, qint64 rows, const QString &expanded);
+    static bool isSlow(qint64 usec);
+
+    static QList<QueryProfile> profiles(int limit = -1);
+    static QJsonArray toJson(int limit = -1);
+    static QStringList explain(const QString &sql);
+    static QString normalize(const QString &sql);
+
+  private:
+    static QAtomicInt s_enabled;
+    static QAtomicInt s_slowQueryMs;
+};
+
+#endif // QUERYPROFILER_H
@@ -28,7 +28,12 @@
 #include "journal.h"
 #include "reports.h"
 #include "RK/rk_signaturemodulefactory.h"
+#include "RK/rk_signaturesession.h"
 #include "utils/demomode.h"
+#include "utils/metrics.h"
+#include "queryprofiler.h"
+#include "singleton/spreadsignal.h"
+#include "singleton/fiscalperiod.h"
 #include "pluginmanager/pluginmanager.h"
 #include "preferences/qrksettings.h"
 #include "3rdparty/qbcmath/bcmath.h"
@@ -39,10 +44,90 @@
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QJsonArray>
+#include <QRegExp>
+#include <QSet>
 #include <QDebug>
 
+namespace {
+qint64 toCent(QBCMath value)
+{
+    value.round(2);
+    return qRound64(value.toDouble() * 100.0);
+}
+
+QString fromCent(qint64 value)
+{
+    return QString::number(value / 100.0, 'f', 2);
+}
+
+double toNumber(const QVariant &value)
+{
+    if (value.type() == QVariant::Double || value.type() == QVariant::Int)
+        return value.toDouble();
+
+    QString s = value.toString();
+    s.replace(",", ".");
+    s.remove(QRegExp("[^0-9.\\-]"));
+    return s.toDouble();
+}
+}
+
+void OrderLines::append(double c, const QString &p, double t)
+{
+    count.append(c);
+    product.append(p);
+    net.append(0.0);
+    tax.append(t);
+    single.append(0);
+    discount.append(0.0);
+    total.append(0);
+    save.append(false);
+    editable.append(true);
+    productId.append(0);
+    itemNum.append(QString());
+    coupon.append(QString());
+    countStr.append(QString());
+    countTypeStr.append(QString());
+}
+
+void OrderLines::remove(int row)
+{
+    count.remove(row);
+    product.remove(row);
+    net.remove(row);
+    tax.remove(row);
+    single.remove(row);
+    discount.remove(row);
+    total.remove(row);
+    save.remove(row);
+    editable.remove(row);
+    productId.remove(row);
+    itemNum.remove(row);
+    coupon.remove(row);
+    countStr.remove(row);
+    countTypeStr.remove(row);
+}
+
+void OrderLines::clear()
+{
+    count.clear();
+    product.clear();
+    net.clear();
+    tax.clear();
+    single.clear();
+    discount.clear();
+    total.clear();
+    save.clear();
+    editable.clear();
+    productId.clear();
+    itemNum.clear();
+    coupon.clear();
+    countStr.clear();
+    countTypeStr.clear();
+}
+
 ReceiptItemModel::ReceiptItemModel(QObject* parent)
-    : QStandardItemModel(parent)
+    : QAbstractTableModel(parent)
 {
     m_currency = "";
     m_taxlocation = "";
@@ -51,8 +136,12 @@ ReceiptItemModel::ReceiptItemModel(QObject* parent)
     m_isR2B = false;
     m_isReport = false;
     m_totallyup = false;
-
-    connect(this, &ReceiptItemModel::dataChanged, this, &ReceiptItemModel::itemChangedSlot);
+    m_currentReceipt = 0;
+    m_sum = 0;
+    m_ordersReceipt = 0;
+    m_metricsQueries = 0;
+    m_signatureSession = 0;
+    m_deferOutput = false;
 }
 
 ReceiptItemModel::~ReceiptItemModel()
@@ -61,7 +150,12 @@ ReceiptItemModel::~ReceiptItemModel()
 
 void ReceiptItemModel::clear()
 {
-    QStandardItemModel::clear();
+    beginResetModel();
+    m_lines.clear();
+    m_sum = 0;
+    m_ordersReceipt = 0;
+    endResetModel();
+
     m_currency = Database::getCurrency();
     m_taxlocation = Database::getTaxLocation();
     m_customerText = "";
@@ -95,6 +189,45 @@ int ReceiptItemModel::getReceiptNum()
 bool ReceiptItemModel::finishReceipts(int payedBy, int id, bool isReport)
 {
 
+    MetricsTimer timer(isReport ? "report.finish" : "receipt.finish");
+
+    QBCMath sum = 0.0;
+    QBCMath net = 0.0;
+
+    if (!isReport) {
+        /* the lines written by createOrder are still in memory */
+        OrderLines orders;
+        bool fromLines = (m_ordersReceipt > 0 && m_ordersReceipt == m_currentReceipt);
+        const OrderLines &lines = fromLines ? m_lines : orders;
+        if (!fromLines)
+            loadOrders(orders);
+
+        for (int row = 0; row < lines.size(); row++) {
+            if (!lines.productId[row])
+                continue;
+
+            QBCMath gross = fromCent(lines.total[row]);
+            double tax = QString::number(lines.tax[row],'f',2).toDouble();
+            sum += gross;
+            net += gross / (1.0 + tax / 100.0);
+        }
+    }
+
+    return completeReceipt(payedBy, id, isReport, sum, net);
+}
+
+/**
+ * @brief ReceiptItemModel::completeReceipt
+ * stores the totals of the current receipt, signs, prints and journals it
+ * @param payedBy
+ * @param id receipt which is cancelled by this one, 0 otherwise
+ * @param isReport
+ * @param sum gross total
+ * @param net net total
+ * @return
+ */
+bool ReceiptItemModel::completeReceipt(int payedBy, int id, bool isReport, QBCMath sum, QBCMath net)
+{
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
 
@@ -106,42 +239,6 @@ bool ReceiptItemModel::finishReceipts(int payedBy, int id, bool isReport)
         qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
     }
 
-    QBCMath sum = 0.0;
-    QBCMath net = 0.0;
-
-    if (!isReport) {
-
-        QSqlQuery orders(dbc);
-        orders.prepare(QString("SELECT orders.count, orders.gross, orders.tax, orders.discount FROM orders WHERE orders.receiptId=%1")
-                       .arg(m_currentReceipt));
-
-        ok = orders.exec();
-        if (!ok) {
-            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-            qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-        }
-
-        QrkSettings settings;
-
-        while ( orders.next() )
-        {
-            QBCMath count = orders.value("count").toDouble();
-            count.round(settings.value("decimalDigits", 2).toInt());
-            QBCMath singlePrice = orders.value("gross").toDouble();
-            singlePrice.round(2);
-            double tax = QString::number(orders.value("tax").toDouble(),'f',2).toDouble();
-            QBCMath discount = orders.value("discount").toDouble();
-            discount.round(2);
-
-            QBCMath gross = singlePrice * count;
-            gross = gross - ((gross / 100) * discount.toDouble());
-            gross.round(2);
-            sum += gross;
-            net += gross / (1.0 + tax / 100.0);
-            qApp->processEvents();
-        }
-    }
-
     setReceiptTime(QDateTime::currentDateTime());
     query.prepare(QString("UPDATE receipts SET timestamp=:timestamp, infodate=:infodate, receiptNum=:receiptNum, payedBy=:payedBy, gross=:gross, net=:net, userId=:userId WHERE id=:receiptNum"));
     query.bindValue(":timestamp", m_receiptTime.toString(Qt::ISODate));
@@ -158,6 +255,18 @@ bool ReceiptItemModel::finishReceipts(int payedBy, int id, bool isReport)
         qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
     }
 
+    if (ok)
+        FiscalPeriod::Instance()->receiptCompleted(m_currentReceipt, payedBy, m_receiptTime);
+
+    if (ok && payedBy < PAYED_BY_REPORT_EOD) {
+        // the running totals are committed with the receipt or not at all
+        if (!Database::addSalesTotal(m_receiptTime, sum.toDouble()) || !Database::addSalesBreakdown(m_currentReceipt)
+                || !Database::addProductSales(m_currentReceipt)) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " sales totals of receipt " << m_currentReceipt << " not written";
+            return false;
+        }
+    }
+
     QJsonObject data = compileData(id);
     if (!m_isReport && m_isR2B){
         data["isR2B"] = m_isR2B;
@@ -165,7 +274,7 @@ bool ReceiptItemModel::finishReceipts(int payedBy, int id, bool isReport)
 
     if (RKSignatureModule::isDEPactive()) {
         Utils utils;
-        QString signature = utils.getSignature(data);
+        QString signature = m_signatureSession ? m_signatureSession->sign(data) : utils.getSignature(data);
         if (signature.isEmpty()) {
             qCritical() << "Function Name: " << Q_FUNC_INFO << " No Signature Data: " << signature;
             return false;
@@ -190,13 +299,35 @@ bool ReceiptItemModel::finishReceipts(int payedBy, int id, bool isReport)
         Database::setStornoId(m_currentReceipt, id);
 
     if (ok) {
-        DocumentPrinter p;
-        p.printReceipt(data);
+        if (m_deferOutput) {
+            DeferredReceipt receipt;
+            receipt.data = data;
+            receipt.time = m_receiptTime;
+            receipt.total = sum.toDouble();
+            receipt.sales = (payedBy < PAYED_BY_REPORT_EOD);
+            m_deferred.append(receipt);
+        } else {
+            MetricsTimer printTimer("receipt.print");
+            DocumentPrinter p;
+            p.printReceipt(data);
+            printTimer.stop();
+        }
 
+        MetricsTimer journalTimer("receipt.journal");
         Journal journal;
         journal.journalInsertReceipt(data);
     }
 
+    if (ok && payedBy < PAYED_BY_REPORT_EOD && !m_deferOutput)
+        Spread::Instance()->setSalesTotal(m_receiptTime, sum.toDouble());
+
+    if (Metrics::isEnabled()) {
+        Metrics::addCount("receipt.count");
+        // db.queries is counted by the SQLite statement hook only
+        if (QueryProfiler::isAvailable())
+            Metrics::addValue("receipt.dbQueries", Metrics::counter("db.queries") - m_metricsQueries);
+    }
+
     return ok;
 
 }
@@ -209,8 +340,13 @@ QJsonObject ReceiptItemModel::compileData(int id)
     QSqlQuery query(dbc);
     QJsonObject Root;//root object
 
-    // receiptNum, ReceiptTime
-    query.prepare(QString("SELECT `receiptNum`,`timestamp`, `payedBy` FROM receipts WHERE id=%1").arg(m_currentReceipt));
+    // receiptNum, ReceiptTime, payment text and the running yearly total
+    query.prepare("SELECT receipts.receiptNum, receipts.`timestamp`, receipts.payedBy, actionTypes.actionText, salesTotals.gross AS sumYear FROM receipts"
+                  " LEFT JOIN actionTypes ON actionTypes.actionId = CASE WHEN receipts.payedBy > :startReceipt THEN 0 ELSE receipts.payedBy END"
+                  " LEFT JOIN salesTotals ON salesTotals.period = SUBSTR(receipts.`timestamp`, 1, 4)"
+                  " WHERE receipts.id=:id");
+    query.bindValue(":startReceipt", PAYED_BY_START_RECEIPT);
+    query.bindValue(":id", m_currentReceipt);
     bool ok = query.exec();
 
     if (!ok) {
@@ -219,71 +355,58 @@ QJsonObject ReceiptItemModel::compileData(int id)
     }
 
     query.next();
-    int receiptNum = query.value(0).toInt();
-    QDateTime receiptTime = query.value(1).toDateTime();
-    int payedBy = query.value(2).toInt();
+    int receiptNum = query.value("receiptNum").toInt();
+    QDateTime receiptTime = query.value("timestamp").toDateTime();
+    QString typeText = query.value("actionText").toString();
+    double sumYear = query.value("sumYear").toDouble();
 
     if (!m_customerText.isEmpty())
         Database::addCustomerText(receiptNum, m_customerText);
 
-    // Positions
-    query.prepare(QString("SELECT COUNT(*) FROM orders WHERE receiptId=%1").arg(m_currentReceipt));
-    ok = query.exec();
-
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    query.next();
-    int positions = query.value(0).toInt();
-
-    // sum Year
-    int year = receiptTime.toString("yyyy").toInt();
-/*
-    query.prepare(QString("SELECT SUM(gross) AS Total FROM receipts where timestamp like '%1%'").arg(year));
-    query.exec();
-    query.next();
-    double sumYear = query.value(0).toDouble();
-*/
-    double sumYear = Utils::getYearlyTotal(year);
+    // Orders, from memory if this receipt was created by createOrder
+    OrderLines orders;
+    bool fromLines = (m_ordersReceipt > 0 && m_ordersReceipt == m_currentReceipt);
+    const OrderLines &lines = fromLines ? m_lines : orders;
+    if (!fromLines)
+        loadOrders(orders);
 
-    // AdvertisingText
-    query.prepare("SELECT strValue FROM globals WHERE name='printAdvertisingText'");
+    // Positions
+    int positions = 0;
+    for (int row = 0; row < lines.size(); row++)
+        if (lines.productId[row])
+            positions++;
+
+    // AdvertisingText, Header, Footer and shop master data
+    QMap<QString, QString> globals;
+    query.prepare("SELECT name, strValue FROM globals WHERE name IN ('printAdvertisingText', 'printHeader', 'printFooter', 'shopName', 'shopOwner', 'shopAddress', 'shopUid')");
     query.exec();
-    query.next();
-    Root["printAdvertisingText"] = query.value(0).toString();
+    while (query.next())
+        globals.insert(query.value(0).toString(), query.value(1).toString());
 
-    // Header
-    query.prepare("SELECT strValue FROM globals WHERE name='printHeader'");
-    query.exec();
-    query.next();
-    Root["printHeader"] = query.value(0).toString();
+    Root["printAdvertisingText"] = globals.value("printAdvertisingText");
+    Root["printHeader"] = globals.value("printHeader");
+    Root["printFooter"] = globals.value("printFooter");
 
-    // Footer
-    query.prepare("SELECT strValue FROM globals WHERE name='printFooter'");
-    query.exec();
-    query.next();
-    Root["printFooter"] = query.value(0).toString();
+    QString shopMasterData;
+    foreach (const QString &name, QStringList() << "shopOwner" << "shopAddress" << "shopUid") {
+        QString tmp = globals.value(name);
+        shopMasterData += (tmp.isEmpty()) ? "" : "\n" + tmp;
+    }
 
     // TaxTypes
-
+    QMap<double, QString> taxTypeNames; // <tax-percent, comment> like Database::getTaxType
     QSqlQuery taxTypes(dbc);
-    taxTypes.prepare(QString("SELECT tax, comment FROM taxTypes WHERE taxlocation=:taxlocation ORDER BY id"));
-    query.bindValue(":taxlocation", m_taxlocation);
+    taxTypes.prepare(QString("SELECT tax, comment, taxlocation FROM taxTypes ORDER BY id"));
     taxTypes.exec();
     while(taxTypes.next())
     {
-        Root[taxTypes.value(1).toString()] = 0.0;
+        double tax = taxTypes.value(0).toDouble();
+        if (!taxTypeNames.contains(tax))
+            taxTypeNames.insert(tax, taxTypes.value(1).toString());
+        if (taxTypes.value(2).toString() == m_taxlocation)
+            Root[taxTypes.value(1).toString()] = 0.0;
     }
 
-    // Orders
-    QSqlQuery orders(dbc);
-    orders.prepare(QString("SELECT orders.count, products.name, orders.gross, orders.tax, products.coupon, orders.discount, products.itemnum FROM orders INNER JOIN products ON products.id=orders.product WHERE orders.receiptId=:id"));
-    orders.bindValue(":id", m_currentReceipt);
-
-    orders.exec();
-
     QrkSettings settings;
 
     // ZNr Programmversion Kassen-Id Beleg Belegtyp Bemerkung Nachbonierung
@@ -295,9 +418,9 @@ QJsonObject ReceiptItemModel::compileData(int id)
     Root["kasse"] = Database::getCashRegisterId();
     Root["displayname"] = RBAC::Instance()->getDisplayname();
     Root["actionText"] = tr("Beleg");
-    Root["typeText"] = Database::getActionType((payedBy > PAYED_BY_START_RECEIPT)?0:payedBy);
-    Root["shopName"] = Database::getShopName();
-    Root["shopMasterData"] = Database::getShopMasterData();
+    Root["typeText"] = typeText;
+    Root["shopName"] = globals.value("shopName");
+    Root["shopMasterData"] = shopMasterData;
     Root["headerText"] = m_customerText;
     Root["totallyup"] = (m_totallyup)? "Nachbonierung":"";
     Root["comment"] = (id > 0)? tr("Storno für Beleg Nr: %1").arg(id):settings.value("receiptPrinterHeading", "KASSABON").toString();
@@ -308,21 +431,22 @@ QJsonObject ReceiptItemModel::compileData(int id)
 
     QJsonArray Orders;
 
+    int decimalDigits = settings.value("decimalDigits", 2).toInt();
     QBCMath sum(0.00);
     QMap<double, double> taxes; // <tax-percent, sum>
 
-    while(orders.next()) //load all data from the database
+    for (int row = 0; row < lines.size(); row++)
     {
-        QBCMath discount = orders.value("discount").toDouble();
+        if (!lines.productId[row])
+            continue;
+
+        QBCMath discount = lines.discount[row];
         discount.round(2);
-        QBCMath count(orders.value(0).toDouble());
-        count.round(settings.value("decimalDigits", 2).toInt());
-        QBCMath singlePrice(orders.value(2).toDouble());
-        QBCMath gross = singlePrice * count;
-        gross = gross - ((gross / 100) * discount);
-        gross.round(2);
-//        gross = QString::number(gross, 'f', 2).toDouble();
-        double tax = orders.value(3).toDouble();
+        QBCMath count(lines.count[row]);
+        count.round(decimalDigits);
+        QBCMath singlePrice(fromCent(lines.single[row]));
+        QBCMath gross(fromCent(lines.total[row]));
+        double tax = lines.tax[row];
 
         sum += gross;
 
@@ -333,18 +457,17 @@ QJsonObject ReceiptItemModel::compileData(int id)
 
         QJsonObject order;
         order["count"] = count.toDouble();
-        order["itemNum"] = orders.value("itemNum").toString();
-        order["product"] = orders.value(1).toString();
+        order["itemNum"] = lines.itemNum[row];
+        order["product"] = lines.product[row];
         order["discount"] = discount.toDouble();
         order["gross"] = gross.toDouble();
         order["singleprice"] = singlePrice.toDouble();
         order["tax"] = tax;
-        order["coupon"] = orders.value(4).toString();
+        order["coupon"] = lines.coupon[row];
         Orders.append(order);
 
-        QString taxType = Database::getTaxType(tax);
+        QString taxType = taxTypeNames.value(int(tax));
         Root[taxType] = Root[taxType].toDouble() + gross.toDouble(); /* last Info: we need GROSS :)*/
-        qApp->processEvents();
     }
 
     QJsonArray Taxes;
@@ -375,49 +498,18 @@ void ReceiptItemModel::newOrder( bool  addRow )
 
     clear();
 
-    setColumnCount(8);
-    setHeaderData(REGISTER_COL_COUNT, Qt::Horizontal, QObject::tr("Anzahl"));
-    setHeaderData(REGISTER_COL_PRODUCT, Qt::Horizontal, QObject::tr("Artikel"));
-    setHeaderData(REGISTER_COL_NET, Qt::Horizontal, QObject::tr("E-Netto"));
-    setHeaderData(REGISTER_COL_TAX, Qt::Horizontal, QObject::tr("MwSt."));
-    setHeaderData(REGISTER_COL_SINGLE, Qt::Horizontal, QObject::tr("E-Preis"));
-    setHeaderData(REGISTER_COL_DISCOUNT, Qt::Horizontal, QObject::tr("Rabatt %"));
-    setHeaderData(REGISTER_COL_TOTAL, Qt::Horizontal, QObject::tr("Preis"));
-    setHeaderData(REGISTER_COL_SAVE, Qt::Horizontal, QObject::tr(" "));
-
     if (addRow)
         plus();
 }
 
 void ReceiptItemModel::plus()
 {
-    int row = rowCount();
-    insertRow(row);
-    blockSignals(true);
-
-    QString defaultTax = Database::getDefaultTax();
+    int row = m_lines.size();
 
-    setColumnCount(8);
-    setItem(row, REGISTER_COL_COUNT, new QStandardItem(QString("1")));
-    setItem(row, REGISTER_COL_PRODUCT, new QStandardItem(QString("")));
-    setItem(row, REGISTER_COL_TAX, new QStandardItem(defaultTax));
-    setItem(row, REGISTER_COL_NET, new QStandardItem(QString("0")));
-    setItem(row, REGISTER_COL_SINGLE, new QStandardItem(QString("0")));
-    setItem(row, REGISTER_COL_DISCOUNT, new QStandardItem("0"));
-    setItem(row, REGISTER_COL_TOTAL, new QStandardItem(QString("0")));
+    beginInsertRows(QModelIndex(), row, row);
+    m_lines.append(1.0, "", Database::getDefaultTax().toDouble());
+    endInsertRows();
 
-    QStandardItem* itemSave = new QStandardItem(false);
-    itemSave->setCheckable(true);
-    itemSave->setCheckState(Qt::Unchecked);
-    itemSave->setEditable(false);
-    itemSave->setText(tr("Speichern"));
-
-    setItem(row, REGISTER_COL_SAVE, itemSave);
-
-    item(row ,REGISTER_COL_COUNT)->setTextAlignment(Qt::AlignRight|Qt::AlignVCenter);
-    item(row ,REGISTER_COL_TAX)->setTextAlignment(Qt::AlignRight|Qt::AlignVCenter);
-
-    blockSignals(false);
     emit finishedPlus();
 
 }
@@ -470,8 +562,6 @@ bool ReceiptItemModel::createNullReceipt(int type)
         rc = rowCount();
     }
 
-    removeColumn(REGISTER_COL_SAVE);
-
     QList<QVariant> list;
     list << typeText
          << "0"
@@ -482,11 +572,7 @@ bool ReceiptItemModel::createNullReceipt(int type)
 
     ret = Database::addProduct(list);
     if (ret) {
-        item(rc -1, REGISTER_COL_COUNT)->setText( "1" );
-        item(rc -1, REGISTER_COL_PRODUCT)->setText( typeText );
-        item(rc -1, REGISTER_COL_TAX)->setText( "0" );
-        item(rc -1, REGISTER_COL_SINGLE)->setText( "0" );
-
+        setLine(rc -1, 1.0, typeText, 0.0, "0");
     } else {
         return false;
     }
@@ -532,6 +618,10 @@ bool ReceiptItemModel::createStartReceipt()
 int ReceiptItemModel::createReceipts()
 {
 
+    MetricsTimer timer("receipt.create");
+    if (Metrics::isEnabled())
+        m_metricsQueries = Metrics::counter("db.queries");
+
     // Check if RKSignatureModule
     if (RKSignatureModule::isDEPactive() && RKSignatureModule::isSignatureModuleSetDamaged()) {
         RKSignatureModule *sigModule = RKSignatureModuleFactory::createInstance("", DemoMode::isDemoMode());
@@ -583,69 +673,299 @@ int ReceiptItemModel::createReceipts()
 bool ReceiptItemModel::createOrder(bool storno)
 {
 
-    bool ret = false;
+    MetricsTimer timer("receipt.orders");
+
+    m_stockInfo.clear();
 
     QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc) ;
-    query.prepare(QString("INSERT INTO orders (receiptId, product, count, net, discount, gross, tax) SELECT :receiptId, id, :count, :net, :discount, :egross, :tax FROM products WHERE name=:name LIMIT 1"));
 
     QrkSettings settings;
+    int decimalDigits = settings.value("decimalDigits", 2).toInt();
+
+    QStringList names;
+    for (int row = 0; row < m_lines.size(); row++) {
+        if (!names.contains(m_lines.product[row]))
+            names.append(m_lines.product[row]);
+    }
+
+    QHash<QString, OrderProduct> products;
+    if (!loadOrderProducts(dbc, names, products))
+        return false;
 
-    int row_count = rowCount();
+    /* productId -> sold count of this receipt */
+    QMap<int, QBCMath> sold;
+    QList<int> rows;
+    QVariantList values;
+
+    int row_count = m_lines.size();
     for (int row = 0; row < row_count; row++)
     {
-        QBCMath count(data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble());
-        count.round(settings.value("decimalDigits", 2).toInt());
+        QBCMath count(m_lines.count[row]);
+        count.round(decimalDigits);
         if (storno)
             count *= -1;
 
-        QString product = data(index(row, REGISTER_COL_PRODUCT, QModelIndex())).toString();
-
-        QBCMath tax(data(index(row, REGISTER_COL_TAX, QModelIndex())).toDouble());
-        QBCMath egross(data(index(row, REGISTER_COL_SINGLE, QModelIndex())).toDouble());
-        QBCMath discount(data(index(row, REGISTER_COL_DISCOUNT, QModelIndex())).toDouble());
+        QBCMath tax(m_lines.tax[row]);
+        QBCMath egross(fromCent(m_lines.single[row]));
+        QBCMath discount(m_lines.discount[row]);
         tax.round(2);
-        egross.round(2);
         discount.round(2);
 
-        Database::updateProductSold(count.toDouble(), product);
+        m_lines.productId[row] = 0;
+        if (!products.contains(m_lines.product[row]))
+            continue;
+
+        const OrderProduct &product = products[m_lines.product[row]];
+        m_lines.productId[row] = product.id;
+        m_lines.itemNum[row] = product.itemNum;
+        m_lines.coupon[row] = product.coupon;
+
+        if (!m_lines.product[row].startsWith("Zahlungsbeleg für Rechnung")) {
+            if (!sold.contains(product.id))
+                sold.insert(product.id, QBCMath(0.0));
+            sold[product.id] += count;
+        }
 
         QBCMath net(egross - Utils::getTax(egross.toDouble(), tax.toDouble()));
         net.round(2);
 
-        query.bindValue(":receiptId", m_currentReceipt);
-        query.bindValue(":count", count.toDouble());
-        query.bindValue(":net", net.toDouble());
-        query.bindValue(":discount", discount.toDouble());
-        query.bindValue(":egross", egross.toDouble());
-        query.bindValue(":tax", tax.toDouble());
-        query.bindValue(":name", product);
+        rows.append(row);
+        values << m_currentReceipt << product.id << count.toDouble() << net.toDouble()
+               << discount.toDouble() << egross.toDouble() << tax.toDouble();
+
+        /* keep the lines equal to the stored orders */
+        m_lines.count[row] = count.toDouble();
+        m_lines.tax[row] = tax.toDouble();
+        m_lines.discount[row] = discount.toDouble();
+        setLineTotal(row, lineTotal(row));
+    }
+
+    /* all lines as multi row inserts, 7 values per line keeps every chunk
+     * far below the bind parameter limit of SQLite */
+    const int columns = 7;
+    const int chunkSize = 100;
+    QSqlQuery query(dbc);
+    for (int first = 0; first < rows.size(); first += chunkSize) {
+        int last = qMin(first + chunkSize, rows.size());
+        QStringList placeholders;
+        for (int i = first; i < last; i++)
+            placeholders.append("(?, ?, ?, ?, ?, ?, ?)");
+
+        query.prepare(QString("INSERT INTO orders (receiptId, product, count, net, discount, gross, tax) VALUES %1").arg(placeholders.join(", ")));
+        for (int i = first * columns; i < last * columns; i++)
+            query.addBindValue(values.at(i));
 
-        ret = query.exec();
+        if (!query.exec()) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+            for (int i = first; i < last; i++)
+                m_lines.productId[rows.at(i)] = 0;
+            return false;
+        }
+    }
+
+    /* one update per distinct product, keyed by id. Two spellings of a name
+     * may resolve to the same product on MySQL */
+    query.prepare("UPDATE products SET sold=sold+:sold, stock=stock-:stock WHERE id=:id");
+    QSet<int> updated;
+    QHash<QString, OrderProduct>::const_iterator i;
+    for (i = products.constBegin(); i != products.constEnd(); ++i) {
+        const OrderProduct &product = i.value();
+        if (!sold.contains(product.id) || updated.contains(product.id))
+            continue;
+
+        updated.insert(product.id);
 
-        if (!ret) {
+        QBCMath count = sold.value(product.id);
+        query.bindValue(":sold", count.toDouble());
+        query.bindValue(":stock", count.toDouble());
+        query.bindValue(":id", product.id);
+        if (!query.exec()) {
             qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
             qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+            return false;
         }
+
+        QBCMath stock(product.stock);
+        QBCMath minstock(product.minstock);
+        stock -= count;
+        if (stock <= minstock)
+            m_stockInfo.append(QString("%1 (%2 / %3)").arg(i.key())
+                               .arg(QBCMath::bcround(stock.toString(), decimalDigits))
+                               .arg(QBCMath::bcround(minstock.toString(), decimalDigits)));
     }
 
     query.clear();
+    m_ordersReceipt = m_currentReceipt;
 
-    return ret;
+    return row_count > 0;
+}
+
+static OrderProduct orderProduct(const QSqlQuery &query)
+{
+    OrderProduct product;
+    product.id = query.value("id").toInt();
+    product.itemNum = query.value("itemnum").toString();
+    product.coupon = query.value("coupon").toString();
+    product.stock = QBCMath(query.value("stock").toDouble());
+    product.minstock = QBCMath(query.value("minstock").toDouble());
+
+    return product;
+}
+
+/**
+ * @brief ReceiptItemModel::loadOrderProducts
+ * resolves the product names of the order lines, keyed by the name of the
+ * line. The database compares names with its collation (MySQL ignores case
+ * and trailing blanks), names which only match that way are looked up one
+ * by one with the same comparison the single line lookup used.
+ * @param dbc
+ * @param names
+ * @param products
+ * @return false on a database error
+ */
+bool ReceiptItemModel::loadOrderProducts(QSqlDatabase &dbc, const QStringList &names, QHash<QString, OrderProduct> &products) const
+{
+    QSet<QString> requested;
+    foreach (const QString &name, names)
+        requested.insert(name);
+
+    const int chunkSize = 500;
+    QSqlQuery query(dbc);
+    for (int first = 0; first < names.size(); first += chunkSize) {
+        QStringList chunk = names.mid(first, chunkSize);
+        QStringList placeholders;
+        for (int i = 0; i < chunk.size(); i++)
+            placeholders.append("?");
+
+        query.prepare(QString("SELECT id, name, itemnum, coupon, stock, minstock FROM products WHERE name IN (%1) ORDER BY id").arg(placeholders.join(", ")));
+        foreach (const QString &name, chunk)
+            query.addBindValue(name);
+
+        if (!query.exec()) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+            return false;
+        }
+
+        while (query.next()) {
+            QString name = query.value("name").toString();
+            if (!requested.contains(name) || products.contains(name))
+                continue;
+
+            products.insert(name, orderProduct(query));
+        }
+    }
+
+    if (products.size() == names.size())
+        return true;
+
+    query.prepare("SELECT id, name, itemnum, coupon, stock, minstock FROM products WHERE name=:name ORDER BY id LIMIT 1");
+    foreach (const QString &name, names) {
+        if (products.contains(name))
+            continue;
+
+        query.bindValue(":name", name);
+        if (!query.exec()) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+            return false;
+        }
+
+        if (!query.next()) {
+            qCritical() << "Function Name: " << Q_FUNC_INFO << " unknown product, the line is not booked: " << name;
+            continue;
+        }
+
+        products.insert(name, orderProduct(query));
+    }
+
+    return true;
+}
+
+QStringList ReceiptItemModel::getStockInfoList() const
+{
+    return m_stockInfo;
+}
+
+/**
+ * @brief ReceiptItemModel::setSignatureSession
+ * receipts are signed by session instead of a new signature module per
+ * receipt, 0 returns to the default.
+ * @param session
+ */
+void ReceiptItemModel::setSignatureSession(RKSignatureSession *session)
+{
+    m_signatureSession = session;
+}
+
+/**
+ * @brief ReceiptItemModel::setDeferredOutput
+ * while set, completed receipts are neither printed nor added to the shown
+ * sales total. They are kept until flushDeferred() after the commit of the
+ * transaction group, or dropped with discardDeferred() after a rollback.
+ * @param deferred
+ */
+void ReceiptItemModel::setDeferredOutput(bool deferred)
+{
+    m_deferOutput = deferred;
+}
+
+int ReceiptItemModel::deferredCount() const
+{
+    return m_deferred.size();
+}
+
+/**
+ * @brief ReceiptItemModel::discardDeferred
+ * drops the deferred receipts from index from on, e.g. the receipts after a
+ * savepoint that was rolled back
+ * @param from
+ */
+void ReceiptItemModel::discardDeferred(int from)
+{
+    while (m_deferred.size() > from)
+        m_deferred.removeLast();
+}
+
+void ReceiptItemModel::flushDeferred()
+{
+    QList<DeferredReceipt> receipts = m_deferred;
+    m_deferred.clear();
+
+    foreach (const DeferredReceipt &receipt, receipts) {
+        MetricsTimer printTimer("receipt.print");
+        DocumentPrinter p;
+        p.printReceipt(receipt.data);
+        printTimer.stop();
+
+        if (receipt.sales)
+            Spread::Instance()->setSalesTotal(receipt.time, receipt.total);
+    }
+}
+
+/*
+ * numbers of the import files are strings like "1.234,50". The fast path
+ * parses them in one pass, anything else goes the old way through
+ * normalizeNumber and isNumber.
+ */
+static bool toDecimal(const QJsonValue &value, QString &decimal)
+{
+    if (Utils::parseDecimal(value.toString(), decimal))
+        return true;
+
+    decimal = Utils::normalizeNumber(value.toString());
+    return Utils::isNumber(decimal);
 }
 
 bool ReceiptItemModel::setR2BServerMode(QJsonObject obj)
 {
     QString product = QString("Zahlungsbeleg für Rechnung %1 - nicht für den Vorsteuerabzug geeignet" ).arg(obj.value("receiptNum").toString());
 
-    QString gross = Utils::normalizeNumber( obj.value("gross").toString() );
+    QString gross;
+    if (!toDecimal(obj.value("gross"), gross)) { emit not_a_number("gross"); return false; }
 
-    if (!Utils::isNumber(gross)) { emit not_a_number("gross"); return false; }
-
-    item(0, REGISTER_COL_COUNT)->setText( "1" );
-    item(0, REGISTER_COL_PRODUCT)->setText( product );
-    item(0, REGISTER_COL_TAX)->setText( "0" );
-    item(0, REGISTER_COL_SINGLE)->setText( gross );
+    setLine(0, 1.0, product, 0.0, gross);
 
     if (!obj.value("customerText").toString().isEmpty())
         ReceiptItemModel::setCustomerText(obj.value("customerText").toString());
@@ -654,10 +974,10 @@ bool ReceiptItemModel::setR2BServerMode(QJsonObject obj)
 
     QList<QVariant> list;
 
-    list << data(index(0, REGISTER_COL_PRODUCT, QModelIndex())).toString()
-         << data(index(0, REGISTER_COL_TAX, QModelIndex())).toString()
-         << data(index(0, REGISTER_COL_NET, QModelIndex())).toString()
-         << data(index(0, REGISTER_COL_SINGLE, QModelIndex())).toString()
+    list << value(0, REGISTER_COL_PRODUCT).toString()
+         << value(0, REGISTER_COL_TAX).toString()
+         << value(0, REGISTER_COL_NET).toString()
+         << value(0, REGISTER_COL_SINGLE).toString()
          << "1";
 
     bool ret = Database::addProduct(list);
@@ -665,59 +985,81 @@ bool ReceiptItemModel::setR2BServerMode(QJsonObject obj)
     return ret;
 }
 
-bool ReceiptItemModel::setReceiptServerMode(QJsonObject obj)
+/**
+ * @brief ReceiptItemModel::parseServerModeItems
+ * parses the items of an import receipt into typed lines. Items without
+ * count, name, gross or tax are skipped.
+ * @param items
+ * @param lines
+ * @param error name of the field that is not a number
+ * @return false if a number field can not be parsed
+ */
+bool ReceiptItemModel::parseServerModeItems(const QJsonArray &items, QList<ServerModeItem> &lines, QString &error)
 {
+    lines.reserve(items.size());
 
-    int rc = rowCount();
-    QJsonArray receiptItems = obj.value("items").toArray();
-    bool ok = false;
-    bool ret = false;
-    foreach (const QJsonValue & value, receiptItems) {
+    QString decimal;
+    foreach (const QJsonValue & value, items) {
         QJsonObject jsonItem = value.toObject();
-        ok = jsonItem.contains("count") && jsonItem.contains("name") && jsonItem.contains("gross") && jsonItem.contains("tax");
-        if(!ok)
+        if (!(jsonItem.contains("count") && jsonItem.contains("name") && jsonItem.contains("gross") && jsonItem.contains("tax")))
             continue;
 
-        QList<QVariant> list;
+        ServerModeItem item;
+        item.name = jsonItem.value("name").toString();
 
-        QString gross = Utils::normalizeNumber(jsonItem.value("gross").toString());
-        QString net = Utils::normalizeNumber(jsonItem.value("net").toString());
-        QString tax = Utils::normalizeNumber(jsonItem.value("tax").toString());
-        QString count = Utils::normalizeNumber(jsonItem.value("count").toString());
-        QString discount;
-        if (jsonItem.value("discount").isUndefined()) {
-            discount = "0.00";
-        } else {
-            discount = jsonItem.value("discount").toString();
-            discount.replace("-","");
+        if (!toDecimal(jsonItem.value("gross"), item.gross)) { error = "gross"; return false; }
+        if (!toDecimal(jsonItem.value("tax"), decimal)) { error = "tax"; return false; }
+        item.tax = decimal.toDouble();
+        if (!toDecimal(jsonItem.value("count"), decimal)) { error = "count"; return false; }
+        item.count = decimal.toDouble();
+
+        item.net = 0.0;
+        if (toDecimal(jsonItem.value("net"), decimal))
+            item.net = decimal.toDouble();
+
+        item.discount = 0.0;
+        if (!jsonItem.value("discount").isUndefined()) {
+            if (!toDecimal(jsonItem.value("discount"), decimal)) { error = "discount"; return false; }
+            item.discount = qAbs(decimal.toDouble());
         }
 
-        if (!Utils::isNumber(gross)) { emit not_a_number("gross"); return false; }
-        if (!Utils::isNumber(tax)) { emit not_a_number("tax"); return false; }
-        if (!Utils::isNumber(count)) { emit not_a_number("count"); return false; }
-        if (!Utils::isNumber(discount)) { emit not_a_number("discount"); return false; }
+        lines.append(item);
+    }
+
+    return true;
+}
+
+bool ReceiptItemModel::setReceiptServerMode(QJsonObject obj)
+{
+    QList<ServerModeItem> items;
+    QString error;
+    if (!parseServerModeItems(obj.value("items").toArray(), items, error)) {
+        emit not_a_number(error);
+        return false;
+    }
+
+    int rc = rowCount();
+    bool ret = false;
+    foreach (const ServerModeItem &item, items) {
+        QList<QVariant> list;
 
-        list << jsonItem.value("name").toString()
-             << tax
-             << net
-             << gross
+        list << item.name
+             << item.tax
+             << item.net
+             << item.gross
              << "1";
 
         ret = Database::addProduct(list);
 
         if (ret) {
 
-            bool newItem = item(rc -1, REGISTER_COL_PRODUCT)->text().isEmpty();
+            bool newItem = m_lines.product[rc -1].isEmpty();
             if (!newItem) {
                 plus();
                 rc = rowCount();
             }
 
-            item(rc -1, REGISTER_COL_COUNT)->setText( count );
-            item(rc -1, REGISTER_COL_PRODUCT)->setText( jsonItem.value("name").toString() );
-            item(rc -1, REGISTER_COL_TAX)->setText( tax );
-            item(rc -1, REGISTER_COL_DISCOUNT)->setText( discount );
-            item(rc -1, REGISTER_COL_SINGLE)->setText( gross );
+            setLine(rc -1, item.count, item.name, item.tax, item.gross, item.discount);
 
         } else {
             ret = false;
@@ -732,165 +1074,443 @@ bool ReceiptItemModel::setReceiptServerMode(QJsonObject obj)
     return ret;
 }
 
-void ReceiptItemModel::itemChangedSlot( const QModelIndex& i, const QModelIndex&)
+int ReceiptItemModel::rowCount(const QModelIndex &parent) const
 {
+    if (parent.isValid())
+        return 0;
 
-    int row = i.row();
-    int col = i.column();
+    return m_lines.size();
+}
 
-    QBCMath sum(0.0);
-    QBCMath net(0.0);
-    QBCMath tax(0.0);
+int ReceiptItemModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+
+    return REGISTER_COL_SAVE + 1;
+}
+
+QVariant ReceiptItemModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    switch (section) {
+    case REGISTER_COL_COUNT:
+        return tr("Anzahl");
+    case REGISTER_COL_PRODUCT:
+        return tr("Artikel");
+    case REGISTER_COL_NET:
+        return tr("E-Netto");
+    case REGISTER_COL_TAX:
+        return tr("MwSt.");
+    case REGISTER_COL_SINGLE:
+        return tr("E-Preis");
+    case REGISTER_COL_DISCOUNT:
+        return tr("Rabatt %");
+    case REGISTER_COL_TOTAL:
+        return tr("Preis");
+    case REGISTER_COL_SAVE:
+        return tr(" ");
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags ReceiptItemModel::flags(const QModelIndex &index) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size())
+        return Qt::NoItemFlags;
+
+    if (index.column() == REGISTER_COL_SAVE)
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsUserCheckable;
+
+    if (!m_lines.editable[index.row()])
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+
+    return Qt::ItemIsEnabled | Qt::ItemIsSelectable | Qt::ItemIsEditable;
+}
+
+QVariant ReceiptItemModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= m_lines.size())
+        return QVariant();
+
+    int row = index.row();
+    int col = index.column();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        if (col == REGISTER_COL_SAVE)
+            return tr("Speichern");
+        return value(row, col);
+    case Qt::EditRole:
+        return value(row, col);
+    case Qt::TextAlignmentRole:
+        if (col == REGISTER_COL_COUNT || col == REGISTER_COL_TAX)
+            return int(Qt::AlignRight|Qt::AlignVCenter);
+        break;
+    case Qt::CheckStateRole:
+        if (col == REGISTER_COL_SAVE)
+            return m_lines.save[row] ? Qt::Checked : Qt::Unchecked;
+        break;
+    }
+
+    return QVariant();
+}
+
+bool ReceiptItemModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || index.row() >= m_lines.size())
+        return false;
+
+    if (role == Qt::CheckStateRole && index.column() == REGISTER_COL_SAVE) {
+        m_lines.save[index.row()] = (value.toInt() == Qt::Checked);
+        emit dataChanged(index, index);
+        return true;
+    }
+
+    if (role != Qt::EditRole)
+        return false;
+
+    setValue(index.row(), index.column(), value);
+    return true;
+}
+
+bool ReceiptItemModel::removeRows(int row, int count, const QModelIndex &parent)
+{
+    if (parent.isValid() || row < 0 || count < 1 || row + count > m_lines.size())
+        return false;
+
+    beginRemoveRows(parent, row, row + count -1);
+    for (int i = 0; i < count; i++) {
+        m_sum -= m_lines.total[row];
+        m_lines.remove(row);
+    }
+    endRemoveRows();
+
+    return true;
+}
+
+QVariant ReceiptItemModel::value(int row, int column) const
+{
+    if (row < 0 || row >= m_lines.size())
+        return QVariant();
+
+    switch (column) {
+    case REGISTER_COL_COUNT:
+        return m_lines.count[row];
+    case REGISTER_COL_PRODUCT:
+        return m_lines.product[row];
+    case REGISTER_COL_NET:
+        return m_lines.net[row];
+    case REGISTER_COL_TAX:
+        return m_lines.tax[row];
+    case REGISTER_COL_SINGLE:
+        return m_lines.single[row] / 100.0;
+    case REGISTER_COL_DISCOUNT:
+        return m_lines.discount[row];
+    case REGISTER_COL_TOTAL:
+        return m_lines.total[row] / 100.0;
+    case REGISTER_COL_SAVE:
+        return m_lines.save[row];
+    case REGISTER_COL_COUNT_STR:
+        return m_lines.countStr[row];
+    case REGISTER_COL_COUNT_TYPE_STR:
+        return m_lines.countTypeStr[row];
+    }
+
+    return QVariant();
+}
+
+/**
+ * @brief ReceiptItemModel::setValue
+ * stores the value of one cell and recalculates the dependent cells of the line
+ * @param row
+ * @param column REGISTER_COL
+ * @param value
+ */
+void ReceiptItemModel::setValue(int row, int column, const QVariant &value)
+{
+    if (row < 0 || row >= m_lines.size())
+        return;
+
+    switch (column) {
+    case REGISTER_COL_COUNT:
+        m_lines.count[row] = toNumber(value);
+        break;
+    case REGISTER_COL_PRODUCT:
+        m_lines.product[row] = value.toString();
+        break;
+    case REGISTER_COL_NET:
+        m_lines.net[row] = toNumber(value);
+        break;
+    case REGISTER_COL_TAX:
+        m_lines.tax[row] = toNumber(value);
+        break;
+    case REGISTER_COL_SINGLE:
+        m_lines.single[row] = toCent(QBCMath(toNumber(value)));
+        break;
+    case REGISTER_COL_DISCOUNT:
+        m_lines.discount[row] = qAbs(toNumber(value));
+        break;
+    case REGISTER_COL_TOTAL:
+        setLineTotal(row, toCent(QBCMath(toNumber(value))));
+        break;
+    case REGISTER_COL_SAVE:
+        m_lines.save[row] = value.toBool();
+        break;
+    case REGISTER_COL_COUNT_STR:
+        m_lines.countStr[row] = value.toString();
+        return;
+    case REGISTER_COL_COUNT_TYPE_STR:
+        m_lines.countTypeStr[row] = value.toString();
+        return;
+    default:
+        return;
+    }
+
+    updateLine(row, column);
+
+    emit dataChanged(index(row, REGISTER_COL_COUNT), index(row, REGISTER_COL_SAVE));
+    emit finishedItemChanged();
+}
+
+/**
+ * @brief ReceiptItemModel::setLine
+ * sets a complete line without looking up the product
+ */
+void ReceiptItemModel::setLine(int row, double count, const QString &product, double tax, const QString &single, double discount)
+{
+    if (row < 0 || row >= m_lines.size())
+        return;
+
+    m_lines.count[row] = count;
+    m_lines.product[row] = product;
+    m_lines.tax[row] = tax;
+    m_lines.single[row] = toCent(QBCMath(single));
+    m_lines.discount[row] = qAbs(discount);
+    updateLine(row, REGISTER_COL_SINGLE);
+
+    emit setButtonGroupEnabled(! product.isEmpty());
+    emit dataChanged(index(row, REGISTER_COL_COUNT), index(row, REGISTER_COL_SAVE));
+    emit finishedItemChanged();
+}
+
+void ReceiptItemModel::setRowEditable(int row, bool editable)
+{
+    if (row < 0 || row >= m_lines.size())
+        return;
+
+    m_lines.editable[row] = editable;
+}
+
+int ReceiptItemModel::findProduct(const QString &name) const
+{
+    return m_lines.product.indexOf(name);
+}
+
+double ReceiptItemModel::getSum() const
+{
+    return m_sum / 100.0;
+}
+
+void ReceiptItemModel::setLineTotal(int row, qint64 total)
+{
+    m_sum += total - m_lines.total[row];
+    m_lines.total[row] = total;
+}
 
-    QString s = data(index(row, col, QModelIndex())).toString();
+qint64 ReceiptItemModel::lineTotal(int row) const
+{
+    QBCMath sum = QBCMath(m_lines.count[row]) * QBCMath(fromCent(m_lines.single[row]));
+    sum = sum - ((sum / 100) * QBCMath(m_lines.discount[row]));
 
-    //  QString s2;
-    QStringList temp = data(index(row, REGISTER_COL_SINGLE, QModelIndex())).toString().split(" ");
-    double d2 = temp[0].replace(",", ".").toDouble();
+    return toCent(sum);
+}
 
-    /* initialize QSqlDatabase dbc & QSqlQuery query(dbc)
-   * will not work in a switch block
-   */
+void ReceiptItemModel::updateLine(int row, int column)
+{
 
-    if (col == REGISTER_COL_PRODUCT) {
+    QBCMath tax(m_lines.tax[row]);
+    QBCMath net(0.0);
+    QBCMath single(0.0);
+
+    switch( column )
+    {
+    case REGISTER_COL_PRODUCT: {
         QSqlDatabase dbc = Database::database();
         QSqlQuery query(dbc);
         query.prepare(QString("SELECT gross, tax FROM products WHERE name=:name"));
-        query.bindValue(":name", s);
+        query.bindValue(":name", m_lines.product[row]);
         query.exec();
         if (query.next()) {
-            item(row, REGISTER_COL_TAX)->setText(query.value(1).toString());
-            item(row, REGISTER_COL_SINGLE)->setText(query.value(0).toString());
+            m_lines.tax[row] = query.value(1).toDouble();
+            m_lines.single[row] = toCent(QBCMath(query.value(0).toDouble()));
         } else {
-            item(row, REGISTER_COL_SINGLE)->setText("0");
+            m_lines.single[row] = 0;
         }
 
-        emit setButtonGroupEnabled(! s.isEmpty());
+        emit setButtonGroupEnabled(! m_lines.product[row].isEmpty());
+        updateLine(row, REGISTER_COL_SINGLE);
+        break;
     }
-
-    switch( col )
-    {
     case REGISTER_COL_COUNT:
-        if (s.toDouble() == 0) {
-            sum = 0;
-        } else {
-            sum =  s.toDouble() * d2;
-            sum = sum - ((sum / 100) * data(index(row, REGISTER_COL_DISCOUNT, QModelIndex())).toDouble());
-        }
-
-        sum.round(2);
-        s = sum.toString();
-//        if (s.toDouble() == 0)
-            blockSignals(true);
-
-        item(row, REGISTER_COL_TOTAL)->setText( s );
-
-//        if (s.toDouble() == 0)
-            blockSignals(false);
-
+        setLineTotal(row, (m_lines.count[row] == 0) ? 0 : lineTotal(row));
         break ;
     case REGISTER_COL_TAX:
-        net = data(index(row, REGISTER_COL_NET, QModelIndex())).toDouble();
-        sum = net * (1.0 + s.replace(" %", "").toDouble() / 100.0);
-        sum.round(2);
-        item(row, REGISTER_COL_SINGLE)->setText( sum.toString() );
+        single = QBCMath(m_lines.net[row]) * (1.0 + m_lines.tax[row] / 100.0);
+        m_lines.single[row] = toCent(single);
+        updateLine(row, REGISTER_COL_SINGLE);
         break;
     case REGISTER_COL_NET:
-        s.replace(",", ".");
-        blockSignals(true);
-        tax = data(index(row, REGISTER_COL_TAX, QModelIndex())).toDouble();
-        net = (s.toDouble() * ((100 + tax.toDouble()) / 100));
-        net.round(2);
-        s = net.toString();
-        item(row, REGISTER_COL_SINGLE)->setText( s );
-        sum = s.toDouble() * data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble();
-        sum = sum - ((sum / 100) * data(index(row, REGISTER_COL_DISCOUNT, QModelIndex())).toDouble());
-        sum.round(2);
-        s = sum.toString();
-        item(row, REGISTER_COL_TOTAL)->setText( s );
-        blockSignals(false);
+        single = QBCMath(m_lines.net[row]) * ((100 + tax.toDouble()) / 100);
+        m_lines.single[row] = toCent(single);
+        setLineTotal(row, lineTotal(row));
         break;
     case REGISTER_COL_SINGLE:
-        s.replace(",", ".");
-        blockSignals(true);
-        item(row, REGISTER_COL_SINGLE)->setText( s );
-        tax = data(index(row, REGISTER_COL_TAX, QModelIndex())).toDouble();
-        net = s.toDouble() / (1.0 + tax.toDouble() / 100.0);
-        item(row, REGISTER_COL_NET)->setText( net.toString() );
-        sum = s.toDouble() * data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble();
-        sum = sum - ((sum / 100) * data(index(row, REGISTER_COL_DISCOUNT, QModelIndex())).toDouble());
-        sum.round(2);
-        item(row, REGISTER_COL_TOTAL)->setText( sum.toString() );
-        blockSignals(false);
+        net = QBCMath(fromCent(m_lines.single[row])) / (1.0 + tax.toDouble() / 100.0);
+        m_lines.net[row] = net.toDouble();
+        setLineTotal(row, lineTotal(row));
         break ;
     case REGISTER_COL_DISCOUNT:
-        blockSignals(true);
-        s.replace(",", ".");
-        s.replace("-", "");
-        sum = data(index(row, REGISTER_COL_SINGLE, QModelIndex())).toDouble();
-        sum = sum * data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble();
-        sum = sum - ((sum / 100) * s.toDouble());
-        sum.round(2);
-        item(row, REGISTER_COL_TOTAL)->setText( sum.toString() );
-        blockSignals(false);
+        setLineTotal(row, lineTotal(row));
         break ;
     case REGISTER_COL_TOTAL:
-        if (data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble() == 0.00)
+        if (m_lines.count[row] == 0.00 || m_lines.discount[row] >= 100.0)
             break;
 
-        s.replace(",", ".");
-        s = QString::number(s.toDouble(), 'f', 2);
-        blockSignals(true);
-        item(row, REGISTER_COL_TOTAL)->setText( s );
-        sum = s.toDouble() / data(index(row, REGISTER_COL_COUNT, QModelIndex())).toDouble();
-        sum = (sum / (100 - data(index(row, REGISTER_COL_DISCOUNT, QModelIndex())).toDouble())) * 100;
-        tax = data(index(row, REGISTER_COL_TAX, QModelIndex())).toDouble();
-        net = sum / (1.0 + tax.toDouble() / 100.0);
+        single = QBCMath(fromCent(m_lines.total[row])) / QBCMath(m_lines.count[row]);
+        single = (single / (100 - m_lines.discount[row])) * 100;
+        single.round(2);
+        net = single / (1.0 + tax.toDouble() / 100.0);
         net.round(2);
-        sum.round(2);
-        item(row, REGISTER_COL_NET)->setText( net.toString() );
-        item(row, REGISTER_COL_SINGLE)->setText( sum.toString() );
-        blockSignals(false);
+        m_lines.net[row] = net.toDouble();
+        m_lines.single[row] = toCent(single);
         break;
     }
+}
 
-    emit finishedItemChanged();
+/**
+ * @brief ReceiptItemModel::loadOrders
+ * reads the stored orders of the current receipt, used for receipts which
+ * are not created by this model (copies).
+ */
+bool ReceiptItemModel::loadOrders(OrderLines &lines) const
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery orders(dbc);
+    orders.prepare(QString("SELECT orders.count, products.name, orders.gross, orders.tax, products.coupon, orders.discount, products.itemnum, orders.product FROM orders INNER JOIN products ON products.id=orders.product WHERE orders.receiptId=:id"));
+    orders.bindValue(":id", m_currentReceipt);
+
+    if (!orders.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << orders.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(orders);
+        return false;
+    }
+
+    QrkSettings settings;
+    int decimalDigits = settings.value("decimalDigits", 2).toInt();
 
+    while (orders.next()) {
+        QBCMath count(orders.value(0).toDouble());
+        count.round(decimalDigits);
+        QBCMath discount(orders.value("discount").toDouble());
+        discount.round(2);
+
+        lines.append(count.toDouble(), orders.value(1).toString(), orders.value(3).toDouble());
+        int row = lines.size() -1;
+        lines.single[row] = toCent(QBCMath(orders.value(2).toDouble()));
+        lines.discount[row] = discount.toDouble();
+        lines.productId[row] = orders.value("product").toInt();
+        lines.itemNum[row] = orders.value("itemnum").toString();
+        lines.coupon[row] = orders.value(4).toString();
+
+        QBCMath gross = QBCMath(count) * QBCMath(fromCent(lines.single[row]));
+        gross = gross - ((gross / 100) * discount);
+        lines.total[row] = toCent(gross);
+    }
+
+    return true;
 }
 
-bool ReceiptItemModel::storno(int id)
+/**
+ * @brief ReceiptItemModel::cancelReceipt
+ * creates the cancellation (storno) receipt for receipt id in one
+ * transaction. The order lines are copied with negated counts by the
+ * database, the totals are the negated totals of the original receipt.
+ * @param id receipt to cancel
+ * @return
+ */
+bool ReceiptItemModel::cancelReceipt(int id)
 {
-
-    int rc = rowCount();
+    MetricsTimer timer("receipt.storno");
 
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
-    query.prepare("SELECT orders.count, products.name, orders.tax, orders.net, orders.gross, orders.discount FROM orders INNER JOIN products ON products.id=orders.product WHERE orders.receiptId=:id");
-    query.bindValue(":id", id);
 
-    bool ret = query.exec();
+    query.prepare("SELECT payedBy, gross, net FROM receipts WHERE receiptNum=:receiptNum");
+    query.bindValue(":receiptNum", id);
+
+    if (!query.exec()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    if (!query.next())
+        return false;
+
+    int payedBy = query.value("payedBy").toInt();
+    QBCMath gross(query.value("gross").toString());
+    QBCMath net(query.value("net").toString());
+    gross *= -1;
+    net *= -1;
 
-    if (!ret) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+    clear();
+    m_ordersReceipt = 0;
+
+    dbc.transaction();
+
+    if (!createReceipts()) {
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+        return false;
     }
 
-    while (query.next()) {
-        bool newItem = item(rc -1, REGISTER_COL_PRODUCT)->text().isEmpty();
-        if (!newItem) {
-            plus();
-            rc = rowCount();
-        }
+    bool ok = query.exec(QString("INSERT INTO orders (receiptId, product, count, net, discount, gross, tax)"
+                                 " SELECT %1, product, count * -1, net, discount, gross, tax FROM orders WHERE receiptId=%2 ORDER BY id")
+                         .arg(m_currentReceipt).arg(id));
+
+    if (ok)
+        ok = query.exec(QString("UPDATE products SET"
+                                " sold=sold+(SELECT SUM(orders.count) FROM orders WHERE orders.receiptId=%1 AND orders.product=products.id),"
+                                " stock=stock-(SELECT SUM(orders.count) FROM orders WHERE orders.receiptId=%1 AND orders.product=products.id)"
+                                " WHERE id IN (SELECT product FROM orders WHERE receiptId=%1) AND name NOT LIKE 'Zahlungsbeleg für Rechnung%'")
+                        .arg(m_currentReceipt));
 
-        item(rc -1, REGISTER_COL_COUNT)->setText(query.value(0).toString());
-        item(rc -1, REGISTER_COL_PRODUCT)->setText(query.value(1).toString());
-        item(rc -1, REGISTER_COL_TAX)->setText(query.value(2).toString());
-        item(rc -1, REGISTER_COL_DISCOUNT)->setText(query.value("discount").toString());
-        item(rc -1, REGISTER_COL_NET)->setText(query.value(3).toString());
-        item(rc -1, REGISTER_COL_SINGLE)->setText(query.value(4).toString());
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+        return false;
     }
 
-    return ret;
+    if (!completeReceipt(payedBy, id, false, gross, net)) {
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+        return false;
+    }
+
+    if (!dbc.commit()) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << dbc.lastError().text();
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+        return false;
+    }
+
+    return true;
 }
 
 void ReceiptItemModel::initPlugins()
@@ -25,9 +25,18 @@
 
 #include "pluginmanager/Interfaces/wsdlinterface.h"
 
-#include <QStandardItemModel>
+#include <QAbstractTableModel>
 #include <QDateTime>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QStringList>
+#include <QVector>
 #include "qrkcore_global.h"
+#include "3rdparty/qbcmath/bcmath.h"
+
+class QSqlDatabase;
+class RKSignatureSession;
 
 enum NULL_RECEIPT
 {
@@ -46,13 +55,97 @@ enum NULL_RECEIPT
     9,'Schlussbeleg'
 */
 
-class QRK_EXPORT ReceiptItemModel : public QStandardItemModel
+/**
+ * @brief The DeferredReceipt struct
+ * printout and sales total of a receipt which is part of a transaction
+ * group, they are released when the group is committed.
+ */
+struct DeferredReceipt
+{
+    QJsonObject data;
+    QDateTime time;
+    double total;
+    bool sales;
+};
+
+/**
+ * @brief The OrderProduct struct
+ * product data createOrder needs for one order line, resolved once per receipt.
+ */
+struct OrderProduct
+{
+    int id;
+    QString itemNum;
+    QString coupon;
+    QBCMath stock;
+    QBCMath minstock;
+};
+
+/**
+ * @brief The ServerModeItem struct
+ * one receipt item of a server mode import. The gross price is kept as exact
+ * decimal string, it is converted to cent like a manually entered price.
+ */
+struct ServerModeItem
+{
+    QString name;
+    double count;
+    double tax;
+    double net;
+    double discount;
+    QString gross;
+};
+
+/**
+ * @brief The OrderLines struct
+ * order lines of one receipt as struct of arrays. Prices are held in cent,
+ * count, tax and discount are rounded like they are stored in the orders table.
+ */
+struct OrderLines
+{
+    QVector<double> count;
+    QVector<QString> product;
+    QVector<double> net;
+    QVector<double> tax;
+    QVector<qint64> single;
+    QVector<double> discount;
+    QVector<qint64> total;
+    QVector<bool> save;
+    QVector<bool> editable;
+    QVector<int> productId;
+    QVector<QString> itemNum;
+    QVector<QString> coupon;
+    QVector<QString> countStr;
+    QVector<QString> countTypeStr;
+
+    int size() const { return count.size(); }
+    void append(double c, const QString &p, double t);
+    void remove(int row);
+    void clear();
+};
+
+class QRK_EXPORT ReceiptItemModel : public QAbstractTableModel
 {
     Q_OBJECT
   public:
     ReceiptItemModel(QObject* parent = 0);
     ~ReceiptItemModel();
 
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex &index, const QVariant &value, int role = Qt::EditRole);
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    bool removeRows(int row, int count, const QModelIndex &parent = QModelIndex());
+
+    QVariant value(int row, int column) const;
+    void setValue(int row, int column, const QVariant &value);
+    void setLine(int row, double count, const QString &product, double tax, const QString &single, double discount = 0.0);
+    void setRowEditable(int row, bool editable);
+    int findProduct(const QString &name) const;
+    double getSum() const;
+
     QJsonObject compileData(int id = 0);
 
     void setCurrentReceiptNum(int id);
@@ -63,12 +156,19 @@ class QRK_EXPORT ReceiptItemModel : public QStandardItemModel
     void plus();
 
     bool setReceiptServerMode(QJsonObject obj);
+    static bool parseServerModeItems(const QJsonArray &items, QList<ServerModeItem> &lines, QString &error);
     bool setR2BServerMode(QJsonObject obj);
     bool createNullReceipt(int title);
     bool createStartReceipt();
     bool finishReceipts(int, int = 0, bool = false);
     bool createOrder(bool storno = false);
-    bool storno(int id);
+    QStringList getStockInfoList() const;
+    void setSignatureSession(RKSignatureSession *session);
+    void setDeferredOutput(bool deferred);
+    int deferredCount() const;
+    void discardDeferred(int from = 0);
+    void flushDeferred();
+    bool cancelReceipt(int id);
 
     int createReceipts();
     int getReceiptNum();
@@ -79,10 +179,13 @@ class QRK_EXPORT ReceiptItemModel : public QStandardItemModel
     void finishedPlus();
     void not_a_number(QString);
 
-private slots:
-    void itemChangedSlot(const QModelIndex&, const QModelIndex&);
-
 private:
+    void updateLine(int row, int column);
+    void setLineTotal(int row, qint64 total);
+    qint64 lineTotal(int row) const;
+    bool loadOrders(OrderLines &lines) const;
+    bool loadOrderProducts(QSqlDatabase &dbc, const QStringList &names, QHash<QString, OrderProduct> &products) const;
+    bool completeReceipt(int payedBy, int id, bool isReport, QBCMath sum, QBCMath net);
     void setTotallyUp(bool totallyup);
     bool doEndOfDay(QDate date);
     void initPlugins();
@@ -100,6 +203,15 @@ private:
     bool m_totallyup;
 
     int m_currentReceipt;
+
+    OrderLines m_lines;
+    QStringList m_stockInfo;
+    qint64 m_sum;
+    int m_ordersReceipt;
+    qint64 m_metricsQueries;
+    RKSignatureSession *m_signatureSession;
+    bool m_deferOutput;
+    QList<DeferredReceipt> m_deferred;
 };
 
 #endif // RECEIPTITEMMODEL_H
@@ -0,0 +1,292 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "registerstatistics.h"
+#include "database.h"
+#include "defines.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QJsonArray>
+#include <QHash>
+#include <QMutex>
+#include <QDebug>
+
+#include <algorithm>
+
+static bool itemLessThan(const RegisterStatistics::Item &a, const RegisterStatistics::Item &b)
+{
+    if (a.tax != b.tax)
+        return a.tax < b.tax;
+
+    return a.name < b.name;
+}
+
+static QJsonObject taxObject(const QMap<double, double> &map)
+{
+    QJsonObject object;
+    QMap<double, double>::const_iterator i;
+    for (i = map.constBegin(); i != map.constEnd(); ++i)
+        object[QString::number(i.key(), 'f', 2)] = i.value();
+
+    return object;
+}
+
+/**
+ * @brief anyValueAvailable
+ * probes ANY_VALUE (MySQL with ONLY_FULL_GROUP_BY) once per database, the
+ * register databases of other cash registers may run on another server.
+ */
+static bool anyValueAvailable(QSqlDatabase dbc)
+{
+    static QMutex mutex;
+    static QHash<QString, bool> available;
+
+    QString key = QString("%1\t%2\t%3\t%4").arg(dbc.driverName()).arg(dbc.hostName()).arg(dbc.port()).arg(dbc.databaseName());
+
+    QMutexLocker locker(&mutex);
+    if (!available.contains(key))
+        available.insert(key, QSqlQuery(dbc).exec("SELECT ANY_VALUE(value) FROM globals"));
+
+    return available.value(key);
+}
+
+RegisterStatistics::RegisterStatistics()
+    : m_products(0), m_payments(0), m_stornos(0), m_gross(0)
+{
+}
+
+/**
+ * @brief RegisterStatistics::compute
+ * @param dbc register database
+ * @param from
+ * @param to
+ * @param withItems false skips the list of sold articles
+ * @return false if one of the queries failed, see lastError()
+ */
+bool RegisterStatistics::compute(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to, bool withItems)
+{
+    QSqlQuery query(dbc);
+
+    query.exec("SELECT strValue FROM globals WHERE name='shopCashRegisterId'");
+    if (query.next())
+        m_cashRegisterId = query.value(0).toString();
+
+    /* Anzahl verkaufter Artikel oder Leistungen */
+    query.prepare("SELECT sum(orders.count) as count FROM orders WHERE receiptId IN (SELECT id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy <= 2)");
+    if (!exec(query, from, to))
+        return false;
+    query.next();
+    m_products = query.value("count").toDouble();
+
+    /* Anzahl Zahlungen */
+    query.prepare("SELECT count(id) as count_id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy <= 2 AND storno < 2");
+    if (!exec(query, from, to))
+        return false;
+    query.next();
+    m_payments = query.value("count_id").toInt();
+
+    /* Anzahl Stornos */
+    query.prepare("SELECT count(id) as count_id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND storno = 2");
+    if (!exec(query, from, to))
+        return false;
+    query.next();
+    m_stornos = query.value("count_id").toInt();
+
+    m_salesPerPayment = Database::getSalesPerPayment(dbc, from, to);
+    m_salesPerTax = Database::getSalesPerTax(dbc, from, to);
+
+    /* Summe */
+    query.prepare(QString("SELECT sum(gross) as total FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy < %1").arg(PAYED_BY_REPORT_EOD));
+    if (!exec(query, from, to))
+        return false;
+    query.next();
+    m_gross = query.value("total").toDouble();
+
+    m_items.clear();
+    if (!withItems)
+        return true;
+
+    if (anyValueAvailable(dbc))
+        query.prepare(QString("SELECT sum(orders.count) AS count, products.name, orders.gross, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total, ANY_VALUE(orders.tax) as tax, orders.discount FROM orders LEFT JOIN products ON orders.product=products.id  LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND receipts.payedBy < %1 GROUP BY products.name, orders.gross, orders.discount ORDER BY tax, products.name ASC").arg(PAYED_BY_REPORT_EOD));
+    else
+        query.prepare(QString("SELECT sum(orders.count) AS count, products.name, orders.gross, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total, orders.tax, orders.discount FROM orders LEFT JOIN products ON orders.product=products.id  LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND receipts.payedBy < %1 GROUP BY products.name, orders.gross, orders.discount ORDER BY orders.tax, products.name ASC").arg(PAYED_BY_REPORT_EOD));
+
+    if (!exec(query, from, to))
+        return false;
+
+    while (query.next()) {
+        Item item;
+        item.name = query.value("name").toString();
+        item.gross = query.value("gross").toDouble();
+        item.discount = query.value("discount").toDouble();
+        item.tax = query.value("tax").toDouble();
+        item.count = query.value("count").toDouble();
+        item.total = query.value("total").toDouble();
+        m_items.append(item);
+    }
+
+    return true;
+}
+
+bool RegisterStatistics::exec(QSqlQuery &query, const QDateTime &from, const QDateTime &to)
+{
+    query.bindValue(":fromDate", from.toString(Qt::ISODate));
+    query.bindValue(":toDate", to.toString(Qt::ISODate));
+
+    if (!query.exec()) {
+        m_lastError = query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief RegisterStatistics::add
+ * sums the figures of another register into this one, articles with the same
+ * name, price, discount and tax are merged.
+ * @param other
+ */
+void RegisterStatistics::add(const RegisterStatistics &other)
+{
+    m_products += other.m_products;
+    m_payments += other.m_payments;
+    m_stornos += other.m_stornos;
+    m_gross += other.m_gross;
+
+    QMap<QString, QMap<double, double> >::const_iterator i;
+    for (i = other.m_salesPerPayment.constBegin(); i != other.m_salesPerPayment.constEnd(); ++i) {
+        QMap<double, double> &tax = m_salesPerPayment[i.key()];
+        QMap<double, double>::const_iterator j;
+        for (j = i.value().constBegin(); j != i.value().constEnd(); ++j)
+            tax[j.key()] += j.value();
+    }
+
+    QMap<double, double>::const_iterator j;
+    for (j = other.m_salesPerTax.constBegin(); j != other.m_salesPerTax.constEnd(); ++j)
+        m_salesPerTax[j.key()] += j.value();
+
+    QHash<QString, int> index;
+    for (int k = 0; k < m_items.size(); k++) {
+        const Item &item = m_items.at(k);
+        index.insert(QString("%1\t%2\t%3\t%4").arg(item.name).arg(item.gross).arg(item.discount).arg(item.tax), k);
+    }
+
+    foreach (const Item &item, other.m_items) {
+        QString key = QString("%1\t%2\t%3\t%4").arg(item.name).arg(item.gross).arg(item.discount).arg(item.tax);
+        if (index.contains(key)) {
+            Item &sum = m_items[index.value(key)];
+            sum.count += item.count;
+            sum.total += item.total;
+        } else {
+            index.insert(key, m_items.size());
+            m_items.append(item);
+        }
+    }
+
+    std::stable_sort(m_items.begin(), m_items.end(), itemLessThan);
+}
+
+QJsonObject RegisterStatistics::toJson() const
+{
+    QJsonObject object;
+    object["cashRegisterId"] = m_cashRegisterId;
+    object["products"] = m_products;
+    object["payments"] = m_payments;
+    object["stornos"] = m_stornos;
+    object["gross"] = m_gross;
+
+    QJsonObject payments;
+    QMap<QString, QMap<double, double> >::const_iterator i;
+    for (i = m_salesPerPayment.constBegin(); i != m_salesPerPayment.constEnd(); ++i)
+        payments[i.key()] = taxObject(i.value());
+    object["salesPerPayment"] = payments;
+    object["salesPerTax"] = taxObject(m_salesPerTax);
+
+    QJsonArray items;
+    foreach (const Item &item, m_items) {
+        QJsonObject o;
+        o["name"] = item.name;
+        o["gross"] = item.gross;
+        o["discount"] = item.discount;
+        o["tax"] = item.tax;
+        o["count"] = item.count;
+        o["total"] = item.total;
+        items.append(o);
+    }
+    object["items"] = items;
+
+    return object;
+}
+
+QString RegisterStatistics::cashRegisterId() const
+{
+    return m_cashRegisterId;
+}
+
+void RegisterStatistics::setCashRegisterId(const QString &id)
+{
+    m_cashRegisterId = id;
+}
+
+double RegisterStatistics::products() const
+{
+    return m_products;
+}
+
+int RegisterStatistics::payments() const
+{
+    return m_payments;
+}
+
+int RegisterStatistics::stornos() const
+{
+    return m_stornos;
+}
+
+double RegisterStatistics::gross() const
+{
+    return m_gross;
+}
+
+QMap<QString, QMap<double, double> > RegisterStatistics::salesPerPayment() const
+{
+    return m_salesPerPayment;
+}
+
+QMap<double, double> RegisterStatistics::salesPerTax() const
+{
+    return m_salesPerTax;
+}
+
+QList<RegisterStatistics::Item> RegisterStatistics::items() const
+{
+    return m_items;
+}
+
+QString RegisterStatistics::lastError() const
+{
+    return m_lastError;
+}
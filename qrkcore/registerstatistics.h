@@ -0,0 +1,86 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef REGISTERSTATISTICS_H
+#define REGISTERSTATISTICS_H
+
+#include <QSqlDatabase>
+#include <QDateTime>
+#include <QJsonObject>
+#include <QList>
+#include <QMap>
+
+#include "qrkcore_global.h"
+
+class QSqlQuery;
+
+/**
+ * @brief The RegisterStatistics class reads the figures of an end of day or
+ * end of month report (Reports::createStat) from one register database.
+ * It only reads, so it works on any connection, e.g. register databases of
+ * other cash registers opened read only. add() sums up several registers.
+ */
+class QRK_EXPORT RegisterStatistics
+{
+public:
+    struct Item
+    {
+        QString name;
+        double gross;
+        double discount;
+        double tax;
+        double count;
+        double total;
+    };
+
+    RegisterStatistics();
+
+    bool compute(QSqlDatabase dbc, const QDateTime &from, const QDateTime &to, bool withItems = true);
+    void add(const RegisterStatistics &other);
+    QJsonObject toJson() const;
+
+    QString cashRegisterId() const;
+    void setCashRegisterId(const QString &id);
+    double products() const;
+    int payments() const;
+    int stornos() const;
+    double gross() const;
+    QMap<QString, QMap<double, double> > salesPerPayment() const;
+    QMap<double, double> salesPerTax() const;
+    QList<Item> items() const;
+    QString lastError() const;
+
+private:
+    bool exec(QSqlQuery &query, const QDateTime &from, const QDateTime &to);
+
+    QString m_cashRegisterId;
+    double m_products;
+    int m_payments;
+    int m_stornos;
+    double m_gross;
+    QMap<QString, QMap<double, double> > m_salesPerPayment;
+    QMap<double, double> m_salesPerTax;
+    QList<Item> m_items;
+    QString m_lastError;
+};
+
+#endif // REGISTERSTATISTICS_H
@@ -0,0 +1,80 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "reportjob.h"
+#include "reports.h"
+#include "databasemanager.h"
+#include "defines.h"
+
+#include <QThread>
+#include <QDebug>
+
+ReportJob::ReportJob(const QList<Period> &periods, QObject *parent) :
+    QObject(parent), m_periods(periods), m_cancelled(0)
+{
+}
+
+void ReportJob::cancel()
+{
+    m_cancelled.store(1);
+}
+
+bool ReportJob::isCancelled() const
+{
+    return m_cancelled.load() != 0;
+}
+
+void ReportJob::run()
+{
+    qDebug() << "Function Name: " << Q_FUNC_INFO << "ReportJob: " << QThread::currentThread();
+
+    bool ok = true;
+    int count = m_periods.count();
+
+    for (int i = 0; ok && i < count; i++) {
+        if (isCancelled())
+            break;
+
+        const Period &period = m_periods.at(i);
+        bool eod = (period.type == PAYED_BY_REPORT_EOD);
+        emit progress(i * 100 / count);
+        if (eod)
+            emit progressText(tr("Tagesabschluss vom %1 wird erstellt.").arg(period.date.toString()));
+        else
+            emit progressText(tr("Monatsabschluss für %1 wird erstellt.").arg(period.date.toString("MMMM yyyy")));
+
+        /* servermode: no message boxes from this thread */
+        Reports reports(0, true);
+        if (eod)
+            ok = reports.doEndOfDay(period.date, false);
+        else
+            ok = reports.doEndOfMonth(period.date, false);
+
+        if (ok)
+            emit printReport(reports.m_currentReceipt, eod ? tr("Tagesabschluss") : tr("Monatsabschluss"));
+    }
+
+    emit progress(100);
+
+    DatabaseManager::removeCurrentThread("CN");
+    emit finished(ok && !isCancelled(), isCancelled());
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef REPORTJOB_H
+#define REPORTJOB_H
+
+#include <QObject>
+#include <QDate>
+#include <QList>
+#include <QAtomicInt>
+
+#include "qrkcore_global.h"
+
+/**
+ * @brief Creates one or more end of day / end of month reports in a worker
+ * thread on the thread's own database connection. Every period is committed
+ * in its own transaction, cancel() is honoured between two periods.
+ * Printing is left to the receiver of printReport().
+ */
+class QRK_EXPORT ReportJob : public QObject
+{
+        Q_OBJECT
+
+    public:
+        struct Period {
+            int type;
+            QDate date;
+        };
+
+        ReportJob(const QList<Period> &periods, QObject *parent = 0);
+
+        void cancel();
+        bool isCancelled() const;
+
+    public slots:
+        void run();
+
+    signals:
+        void progress(int value);
+        void progressText(QString text);
+        void printReport(int id, QString title);
+        void finished(bool ok, bool cancelled);
+
+    private:
+        QList<Period> m_periods;
+        QAtomicInt m_cancelled;
+};
+
+#endif // REPORTJOB_H
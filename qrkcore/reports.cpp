@@ -23,17 +23,23 @@
 #include "database.h"
 #include "utils/utils.h"
 #include "reports.h"
+#include "registerstatistics.h"
 #include "documentprinter.h"
 #include "backup.h"
 #include "export.h"
 #include "qrkprogress.h"
 #include "singleton/spreadsignal.h"
+#include "singleton/fiscalperiod.h"
+#include "utils/metrics.h"
 #include "RK/rk_signaturemodule.h"
 #include "3rdparty/qbcmath/bcmath.h"
 #include "preferences/qrksettings.h"
 #include "defines.h"
 
 #include <QApplication>
+#include <QEventLoop>
+#include <QPointer>
+#include <QThread>
 #include <QRegularExpression>
 #include <QSqlQuery>
 #include <QSqlError>
@@ -42,8 +48,10 @@
 #include <QTextDocument>
 #include <QDebug>
 
+bool Reports::s_reportJobRunning = false;
+
 Reports::Reports(QObject *parent, bool servermode)
-    : ReceiptItemModel(parent), m_servermode(servermode)
+    : ReceiptItemModel(parent), m_servermode(servermode), m_reportJobCancelled(false)
 {
 }
 
@@ -54,58 +62,6 @@ Reports::~Reports()
     Spread::Instance()->setProgressBarValue(-1);
 }
 
-/**
- * @brief Reports::getEOFMap
- * @param checkDate
- * @return
- */
-QMap<int, QDate> Reports::getEOFMap(QDate checkDate)
-{
-    QDate last = Database::getLastReceiptDate();
-    QMap<int, QDate> map;
-    QDate lastEOD = getLastEOD();
-    int type = getReportType();
-
-    if (type == PAYED_BY_REPORT_EOM || type == PAYED_BY_MONTH_RECEIPT){
-        type = PAYED_BY_REPORT_EOM;
-        last = lastEOD;
-    }
-
-    if (type == -1)
-        return QMap<int, QDate>();
-
-    // Tagesabschluss von Heute schon gemacht?
-    if (lastEOD.isValid() && lastEOD == checkDate) {
-        map.insert(PAYED_BY_REPORT_EOD, QDate());
-        return map;
-    }
-
-    if (last.isValid() && !(type ==  PAYED_BY_REPORT_EOD) && !(type == PAYED_BY_REPORT_EOM)&& checkDate != last)
-        map.insert(PAYED_BY_REPORT_EOD, last);
-
-    QString lastMonth = last.toString("yyyyMM");
-    QString checkMonth = checkDate.toString("yyyyMM");
-
-    // Monatsabschluss von diesen Monat schon gemacht?
-    if (type == PAYED_BY_REPORT_EOM && lastMonth == checkMonth) {
-        map.insert(PAYED_BY_REPORT_EOM, QDate());
-        return map;
-    }
-    if (lastEOD.isValid() && lastEOD > checkDate) {
-        map.insert(PAYED_BY_REPORT_EOM, QDate());
-        return map;
-    }
-
-    if (last.isValid() && !(lastMonth == checkMonth) && !(type ==  PAYED_BY_REPORT_EOM) && checkDate != last)
-        map.insert(PAYED_BY_REPORT_EOM, last);
-
-    lastMonth = last.addMonths(1).toString("yyyyMM");
-    if ((lastMonth < checkMonth) && (type ==  PAYED_BY_REPORT_EOM) && checkDate != last)
-        map.insert(PAYED_BY_REPORT_EOM, last.addMonths(1));
-
-    return map;
-}
-
 /**
  * @brief Reports::checkEOAny
  * @param checkDate
@@ -114,7 +70,7 @@ QMap<int, QDate> Reports::getEOFMap(QDate checkDate)
 bool Reports::checkEOAny(QDate checkDate, bool checkDay)
 {
     bool ret = true;
-    QMap<int, QDate> map = getEOFMap(checkDate);
+    QMap<int, QDate> map = FiscalPeriod::Instance()->closingsDue(checkDate);
     if (map.isEmpty())
         return true;
 
@@ -245,36 +201,118 @@ bool Reports::endOfDay() {
  * @return
  */
 bool Reports::endOfDay(bool ask)
+{
+    if (m_servermode) {
+        QDate date = Database::getLastReceiptDate();
+        if (canCreateEOD(date))
+            return doEndOfDay(date);
+
+        return false;
+    }
+
+    QList<ReportJob::Period> periods;
+    if (!queueEndOfDay(periods, ask))
+        return false;
+
+    if (runReportJob(periods))
+        return true;
+
+    if (!m_reportJobCancelled)
+        checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOD, QDate::currentDate(), tr("Tagesabschluss konnte nicht erstellt werden."));
+
+    return false;
+}
+
+/**
+ * @brief Reports::queueEndOfDay
+ * @param periods
+ * @param ask
+ * @return false if the end of day was already created or the user declined
+ */
+bool Reports::queueEndOfDay(QList<ReportJob::Period> &periods, bool ask)
 {
     QDate date = Database::getLastReceiptDate();
 
-    bool create = canCreateEOD(date);
-    if (create) {
-        if (m_servermode)
-            return doEndOfDay(date);
+    if (!canCreateEOD(date)) {
+        checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOD, date, tr("Tagesabschluss wurde bereits erstellt."));
+        return false;
+    }
 
-        QString text;
-        bool ok = true;
-        if (ask && date == QDate::currentDate()) {
-            text = tr("Nach dem Erstellen des Tagesabschlusses ist eine Bonierung für den heutigen Tag nicht mehr möglich.");
-            ok = checkEOAnyMessageBoxYesNo(PAYED_BY_REPORT_EOD, date, text);
-        }
+    if (ask && date == QDate::currentDate()) {
+        QString text = tr("Nach dem Erstellen des Tagesabschlusses ist eine Bonierung für den heutigen Tag nicht mehr möglich.");
+        if (!checkEOAnyMessageBoxYesNo(PAYED_BY_REPORT_EOD, date, text))
+            return false;
+    }
 
-        if (ok) {
-            QRKProgress progress;
-            progress.setText(tr("Tagesabschluss wird erstellt."));
-            progress.setWaitMode(true);
-            progress.show();
-            qApp->processEvents();
+    periods << ReportJob::Period{PAYED_BY_REPORT_EOD, date};
+    return true;
+}
 
-            return doEndOfDay(date);
-        }
-    } else {
-        if (!m_servermode)
-            checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOD, date, tr("Tagesabschluss wurde bereits erstellt."));
+/**
+ * @brief Reports::runReportJob
+ * Runs the periods in a ReportJob on its own thread and database connection.
+ * The dialog only observes the job, the reports are printed from here once
+ * their period is committed.
+ * The nested event loop still delivers timers and queued calls, a second
+ * closing requested from there is refused until the running job finished.
+ * @param periods
+ * @return true if all periods were created
+ */
+bool Reports::runReportJob(const QList<ReportJob::Period> &periods)
+{
+    m_reportJobCancelled = false;
+    if (periods.isEmpty())
+        return false;
+
+    if (s_reportJobRunning) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: a report job is already running";
+        return false;
     }
+    s_reportJobRunning = true;
+
+    QThread *thread = new QThread;
+    ReportJob *job = new ReportJob(periods);
+    job->moveToThread(thread);
+
+    QPointer<QRKProgress> progress = new QRKProgress();
+    progress->setText(periods.first().type == PAYED_BY_REPORT_EOD ? tr("Tagesabschluss wird erstellt.") : tr("Monatsabschluss wird erstellt."));
+    progress->setWaitMode(periods.count() == 1);
+    progress->setCancelable(periods.count() > 1);
+
+    bool ok = false;
+    QEventLoop loop;
+
+    connect(thread, &QThread::started, job, &ReportJob::run);
+    connect(progress.data(), &QRKProgress::cancelled, job, [job, progress]() {
+        job->cancel();
+        if (progress) progress->setCancelable(false);
+    }, Qt::DirectConnection);
+    connect(job, &ReportJob::progress, progress.data(), &QRKProgress::progress);
+    connect(job, &ReportJob::progressText, progress.data(), &QRKProgress::setText);
+    connect(job, &ReportJob::printReport, this, [this](int id, QString title) {
+        printDocument(id, title);
+    });
+    connect(job, &ReportJob::finished, this, [this, &ok, &loop](bool success, bool cancelled) {
+        ok = success;
+        m_reportJobCancelled = cancelled;
+        loop.quit();
+    });
+    connect(job, &ReportJob::finished, thread, &QThread::quit);
+    connect(thread, &QThread::finished, job, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    progress->show();
+    thread->start();
+    loop.exec();
+    s_reportJobRunning = false;
+
+    if (progress)
+        progress->close();
+
+    if (m_reportJobCancelled)
+        checkEOAnyMessageBoxInfo(periods.last().type, QDate::currentDate(), tr("Die Erstellung der Abschlüsse wurde abgebrochen. Bereits erstellte Abschlüsse bleiben erhalten."));
 
-    return false;
+    return ok;
 }
 
 /**
@@ -282,8 +320,9 @@ bool Reports::endOfDay(bool ask)
  * @param date
  * @return
  */
-bool Reports::doEndOfDay(QDate date)
+bool Reports::doEndOfDay(QDate date, bool print)
 {
+    MetricsTimer timer("report.eod");
     QSqlDatabase dbc = Database::database();
 
     Spread::Instance()->setProgressBarValue(1);
@@ -294,13 +333,16 @@ bool Reports::doEndOfDay(QDate date)
     if (ret) {
         if (createEOD(m_currentReceipt, date)) {
             dbc.commit();
-            printDocument(m_currentReceipt, tr("Tagesabschluss"));
+            if (print)
+                printDocument(m_currentReceipt, tr("Tagesabschluss"));
         } else {
             dbc.rollback();
+            FiscalPeriod::Instance()->invalidate();
             return false;
         }
     } else {
         dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         return false;
     }
 
@@ -346,6 +388,7 @@ bool Reports::endOfMonth()
         checkdate.setTime(QTime::fromString("23:59:59"));
 
         bool canCreateEom = canCreateEOM(rDate);
+        QList<ReportJob::Period> periods;
 
         if (!(type == PAYED_BY_REPORT_EOM) && !(type == PAYED_BY_MONTH_RECEIPT)) {
             bool canCreateEod = canCreateEOD(rDate);
@@ -355,10 +398,13 @@ bool Reports::endOfMonth()
                 if (!m_servermode)
                     doJob = checkEOAnyMessageBoxYesNo(PAYED_BY_REPORT_EOD, rDate,tr("Der Tagesabschlusses für %1 muß zuerst erstellt werden.").arg(rDate.toString()));
 
-                if (doJob) {
+                if (!doJob)
+                    return false;
+
+                if (m_servermode) {
                     if (! endOfDay())
                         return false;
-                } else {
+                } else if (!queueEndOfDay(periods, true)) {
                     return false;
                 }
             }
@@ -378,28 +424,34 @@ bool Reports::endOfMonth()
                 return ok;
             }
 
-            QRKProgress progress;
-            progress.setText(tr("Monatsabschluss wird erstellt."));
-            progress.setWaitMode(true);
-            progress.show();
-            qApp->processEvents();
-
             if (receiptMonth == currMonth) {
                 QString text = tr("Nach dem Erstellen des Monatsabschlusses ist eine Bonierung für diesen Monat nicht mehr möglich.");
                 ok = checkEOAnyMessageBoxYesNo(PAYED_BY_REPORT_EOM, rDate, text);
             }
             if (ok) {
-                if (doEndOfMonth(checkdate.date())){
+                /* end of day and end of month run as one job, each period commits on its own */
+                periods << ReportJob::Period{PAYED_BY_REPORT_EOM, checkdate.date()};
+                if (runReportJob(periods)){
                     rDate = rDate.addMonths(1);
                     receiptMonth = (rDate.year() * 100) + rDate.month();
                     if (rDate.isValid() && receiptMonth < currMonth)
                         ok = checkEOAny();
                 } else {
                     ok = false;
-                    QString text = tr("Monatsabschluss '%1' konnte nicht erstellt werden.").arg(QLocale().monthName(checkdate.date().month()));
-                    checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOM, QDate::currentDate(), text);
+                    if (!m_reportJobCancelled) {
+                        QString text = tr("Monatsabschluss '%1' konnte nicht erstellt werden.").arg(QLocale().monthName(checkdate.date().month()));
+                        checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOM, QDate::currentDate(), text);
+                    }
                 }
+            } else if (!periods.isEmpty()) {
+                /* the end of month was declined, the queued end of day still runs */
+                if (!runReportJob(periods) && !m_reportJobCancelled)
+                    checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOD, QDate::currentDate(), tr("Tagesabschluss konnte nicht erstellt werden."));
             }
+        } else if (!periods.isEmpty()) {
+            ok = runReportJob(periods);
+            if (!ok && !m_reportJobCancelled)
+                checkEOAnyMessageBoxInfo(PAYED_BY_REPORT_EOD, QDate::currentDate(), tr("Tagesabschluss konnte nicht erstellt werden."));
         }
     } else {
         QDate next = QDate::currentDate();
@@ -416,8 +468,9 @@ bool Reports::endOfMonth()
  * @param date
  * @return
  */
-bool Reports::doEndOfMonth(QDate date)
+bool Reports::doEndOfMonth(QDate date, bool print)
 {
+    MetricsTimer timer("report.eom");
     QSqlDatabase dbc = Database::database();
 
     Spread::Instance()->setProgressBarValue(1);
@@ -431,17 +484,21 @@ bool Reports::doEndOfMonth(QDate date)
         if (createEOM(m_currentReceipt, date)) {
             if (nullReceipt(date)) {
                 dbc.commit();
-                printDocument(m_currentReceipt, tr("Monatsabschluss"));
+                if (print)
+                    printDocument(m_currentReceipt, tr("Monatsabschluss"));
             } else {
                 dbc.rollback();
+                FiscalPeriod::Instance()->invalidate();
                 return false;
             }
         } else {
             dbc.rollback();
+            FiscalPeriod::Instance()->invalidate();
             return false;
         }
     } else {
         dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         return false;
     }
 
@@ -693,94 +750,30 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
 
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
+    // the statistics are read without blocking the sales connection
+    QSqlDatabase reportDbc = Database::readOnlyDatabase(true);
 
-    /* Anzahl verkaufter Artikel oder Leistungen */
-//    query.prepare("SELECT sum(ROUND(orders.count,2)) as count FROM orders WHERE receiptId IN (SELECT id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy <= 2)");
-    query.prepare("SELECT sum(orders.count) as count FROM orders WHERE receiptId IN (SELECT id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy <= 2)");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-    bool ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    query.next();
+    bool byProductGroup = settings.value("report_by_productgroup", false).toBool();
+    RegisterStatistics statistics;
+    statistics.compute(reportDbc, from, to, !byProductGroup);
 
-    //double sumProducts = query.value("count").toDouble();
-    QBCMath sumProducts(query.value("count").toDouble());
+    /* Anzahl verkaufter Artikel oder Leistungen */
+    QBCMath sumProducts(statistics.products());
     sumProducts.round(2);
 
     QStringList stat;
     stat.append(QString("Anzahl verkaufter Artikel oder Leistungen: %1").arg(sumProducts.toString().replace(".",",")));
 
     /* Anzahl Zahlungen */
-    query.prepare("SELECT count(id) as count_id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy <= 2 AND storno < 2");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-    ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    query.next();
-
-    stat.append(QString("Anzahl Zahlungen: %1").arg(query.value("count_id").toInt()));
+    stat.append(QString("Anzahl Zahlungen: %1").arg(statistics.payments()));
 
     /* Anzahl Stornos */
-    query.prepare("SELECT count(id) as count_id FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND storno = 2");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-
-    ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    query.next();
-
-    stat.append(QString("Anzahl Stornos: %1").arg(query.value("count_id").toInt()));
+    stat.append(QString("Anzahl Stornos: %1").arg(statistics.stornos()));
     stat.append("-");
 
     /* Umsätze Zahlungsmittel */
-    query.prepare(Database::getSalesPerPaymentSQLQueryString());
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-
-    ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    /*
-     * FIXME: We do this workaroud, while SUM and ROUND will
-     * give use the false result. SQL ROUND/SUM give xx.98 from xx.985
-     * should be xx.99
-     */
-
     stat.append(tr("Umsätze nach Zahlungsmittel"));
-    QMap<QString, QMap<double, double> > zm;
-    QMap<double, double> map;
-    while (query.next())
-    {
-        QString key = query.value("actionText").toString();
-        QBCMath tax(query.value("tax").toString());
-        tax.round(2);
-        QBCMath total(query.value("total").toString());
-        total.round(2);
-        if ( zm.contains(key) ) {
-            map[tax.toDouble()] += total.toDouble();
-            zm[key] = map;
-        } else {
-            map.clear();
-            map[tax.toDouble()] = total.toDouble();
-            zm[key] = map;
-        }
-    }
-
+    QMap<QString, QMap<double, double> > zm = statistics.salesPerPayment();
     QMap<QString, QMap<double, double> >::iterator i;
     for (i = zm.begin(); i != zm.end(); ++i) {
         QString key = i.key();
@@ -802,37 +795,9 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
         stat.append("-");
     }
 
-    /*
-     * FIXME: We do this workaroud, while SUM and ROUND will
-     * give use the false result. SQL ROUND/SUM give xx.98 from xx.985
-     * should be xx.99
-     */
-
     /* Umsätze Steuern */
-    query.prepare("SELECT orders.tax, receipts.receiptNum, (orders.count * orders.gross) - (orders.count * orders.gross * orders.discount) / 100 as total from receipts LEFT JOIN orders on orders.receiptId=receipts.receiptNum WHERE receipts.timestamp between :fromDate AND :toDate AND receipts.payedBy < 3 ORDER BY orders.tax");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-
-    ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
     stat.append(tr("Umsätze nach Steuersätzen"));
-    map.clear();
-    while (query.next())
-    {
-        QBCMath key(query.value("tax").toString());
-        key.round(2);
-        QBCMath total(query.value("total").toString());
-        total.round(2);
-        if ( map.contains(key.toDouble()) ) {
-            map[key.toDouble()] += total.toDouble();
-        } else {
-            map[key.toDouble()] = total.toDouble();
-        }
-    }
+    QMap<double, double> map = statistics.salesPerTax();
 
     QMap<double, double>::iterator j;
     for (j = map.begin(); j != map.end(); ++j) {
@@ -845,18 +810,7 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
     stat.append("-");
 
     /* Summe */
-    query.prepare("SELECT sum(gross) as total FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy < 3");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-    ok = query.exec();
-    if (!ok) {
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-    }
-
-    query.next();
-
-    QBCMath gross(query.value("total").toDouble());
+    QBCMath gross(statistics.gross());
     gross.round(2);
     QString sales = gross.toString().replace(".",",");
 
@@ -878,39 +832,42 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
         if (!ok) {
             qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
             qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        } else {
+            FiscalPeriod::Instance()->receiptInfoDateChanged(id, to);
         }
     }
 
     stat.append(QString("%1: %2").arg(type).arg(sales));
     stat.append("=");
 
-    if (settings.value("report_by_productgroup", false).toBool()) {
+    if (byProductGroup) {
         /* Warengruppe
          * SELECT sum(orders.count) AS count, groups.name, orders.tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total FROM orders inner join groups as groups LEFT JOIN products ON orders.product=products.id  LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE products.'group' = groups.id AND receipts.payedBy < 3 GROUP BY groups.name, products.tax ORDER BY orders.tax, products.name ASC
          * TODO:
          */
+        QSqlQuery groupQuery(reportDbc);
         if (Database::isAnyValueFunctionAvailable())
-            query.prepare("SELECT groups.name, ANY_VALUE(products.tax) as tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total FROM orders inner join groups as groups LEFT JOIN products ON orders.product=products.id LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND products.'group' = groups.id AND receipts.payedBy < 3 GROUP BY groups.name, products.tax ORDER BY products.tax ASC");
+            groupQuery.prepare("SELECT groups.name, ANY_VALUE(products.tax) as tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total FROM orders inner join groups as groups LEFT JOIN products ON orders.product=products.id LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND products.'group' = groups.id AND receipts.payedBy < 3 GROUP BY groups.name, products.tax ORDER BY products.tax ASC");
         else
-            query.prepare("SELECT groups.name, products.tax as tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total FROM orders inner join groups as groups LEFT JOIN products ON orders.product=products.id LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND products.'group' = groups.id AND receipts.payedBy < 3 GROUP BY groups.name, products.tax ORDER BY products.tax ASC");
+            groupQuery.prepare("SELECT groups.name, products.tax as tax, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total FROM orders inner join groups as groups LEFT JOIN products ON orders.product=products.id LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND products.'group' = groups.id AND receipts.payedBy < 3 GROUP BY groups.name, products.tax ORDER BY products.tax ASC");
 
-        query.bindValue(":fromDate", from.toString(Qt::ISODate));
-        query.bindValue(":toDate", to.toString(Qt::ISODate));
+        groupQuery.bindValue(":fromDate", from.toString(Qt::ISODate));
+        groupQuery.bindValue(":toDate", to.toString(Qt::ISODate));
 
-        ok = query.exec();
+        bool ok = groupQuery.exec();
         if (!ok) {
-            qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-            qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << groupQuery.lastError().text();
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(groupQuery);
         }
 
         stat.append(tr("Warengruppen Abrechnung"));
         stat.append("-");
         QBCMath total_productgroup(0);
-        while (query.next()) {
-            QBCMath total(query.value("total").toDouble());
+        while (groupQuery.next()) {
+            QBCMath total(groupQuery.value("total").toDouble());
             total.round(2);
             total_productgroup += total;
-            QBCMath tax(query.value("tax").toDouble());
+            QBCMath tax(groupQuery.value("tax").toDouble());
             tax.round(2);
             QBCMath totalTax;
             totalTax = total / (tax + 100.00) * 100.00;
@@ -919,7 +876,7 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
             totalTax.round(2);
 
             stat.append(QString("%1: %2")
-                        .arg(query.value("name").toString())
+                        .arg(groupQuery.value("name").toString())
                         .arg(total.toString().replace(".",",")));
 
             stat.append(tr("davon MwSt. %1%: %2")
@@ -934,38 +891,24 @@ QStringList Reports::createStat(int id, QString type, QDateTime from, QDateTime
 
     } else {
 
-        if (Database::isAnyValueFunctionAvailable())
-            query.prepare("SELECT sum(orders.count) AS count, products.name, orders.gross, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total, ANY_VALUE(orders.tax) as tax, orders.discount FROM orders LEFT JOIN products ON orders.product=products.id  LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND receipts.payedBy < 3 GROUP BY products.name, orders.gross, orders.discount ORDER BY tax, products.name ASC");
-        else
-            query.prepare("SELECT sum(orders.count) AS count, products.name, orders.gross, SUM((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount)) as total, orders.tax, orders.discount FROM orders LEFT JOIN products ON orders.product=products.id  LEFT JOIN receipts ON receipts.receiptNum=orders.receiptId WHERE receipts.timestamp BETWEEN :fromDate AND :toDate AND receipts.payedBy < 3 GROUP BY products.name, orders.gross, orders.discount ORDER BY orders.tax, products.name ASC");
-
-        query.bindValue(":fromDate", from.toString(Qt::ISODate));
-        query.bindValue(":toDate", to.toString(Qt::ISODate));
-
-        ok = query.exec();
-        if (!ok) {
-            qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
-            qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
-        }
-
         stat.append(tr("Verkaufte Artikel oder Leistungen (Gruppiert) Gesamt %1").arg(sumProducts.toString().replace(".",",")));
-        while (query.next())
+        foreach (const RegisterStatistics::Item &item, statistics.items())
         {
             QString name;
-            if (query.value("discount").toDouble() != 0.0) {
-                QBCMath discount(query.value("discount").toDouble());
-                name = QString("%1 (Rabatt -%2%)").arg(query.value("name").toString()).arg(QBCMath::bcround(discount.toString(), 2).replace(".",","));
+            if (item.discount != 0.0) {
+                QBCMath discount(item.discount);
+                name = QString("%1 (Rabatt -%2%)").arg(item.name).arg(QBCMath::bcround(discount.toString(), 2).replace(".",","));
             } else {
-                name = query.value("name").toString();
+                name = item.name;
             }
 
-            QBCMath total(query.value("total").toDouble());
+            QBCMath total(item.total);
             total.round(2);
-            QBCMath gross(query.value("gross").toDouble());
+            QBCMath gross(item.gross);
             gross.round(2);
-            QBCMath tax(query.value("tax").toDouble());
+            QBCMath tax(item.tax);
             tax.round(2);
-            QBCMath count = query.value("count").toDouble();
+            QBCMath count = item.count;
             count.round(settings.value("decimalDigits", 2).toInt());
 
             stat.append(QString("%1: %2: %3: %4: %5%")
@@ -1012,6 +955,10 @@ bool Reports::insert(QStringList list, int id, QDateTime to)
 
         Spread::Instance()->setProgressBarValue(((float)i++ / (float)count) * 100 );
     }
+
+    if (ret && !list.isEmpty())
+        FiscalPeriod::Instance()->reportWritten(to);
+
     return ret;
 }
 
@@ -1051,7 +998,6 @@ QString Reports::getReport(int id, bool test)
 {
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
-    QrkSettings settings;
 
     query.prepare("SELECT receipts.payedBy, reports.timestamp FROM receipts JOIN reports ON receipts.receiptNum=reports.receiptNum WHERE receipts.receiptNum=:id");
 
@@ -1069,13 +1015,7 @@ QString Reports::getReport(int id, bool test)
     query.next();
 
     int type = query.value("payedBy").toInt();
-    QString format = (type == PAYED_BY_REPORT_EOM)? "MMMM yyyy": "dd MMMM yyyy";
-
-    QString header;
-    if (test)
-        header = QString("TESTDRUCK für SCHRIFTART");
-    else
-        header = QString("BON # %1, %2 - %3").arg(id).arg(Database::getActionType(type)).arg(query.value("timestamp").toDate().toString(format));
+    QDate date = query.value("timestamp").toDate();
 
     query.prepare("SELECT text FROM reports WHERE receiptNum=:id");
 
@@ -1090,6 +1030,35 @@ QString Reports::getReport(int id, bool test)
         qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
     }
 
+    QStringList lines;
+    while (query.next())
+        lines.append(query.value("text").toString());
+
+    return renderReport(id, test ? QString() : Database::getActionType(type), type, date, lines, test);
+}
+
+/**
+ * @brief Reports::renderReport
+ * formats the stored report lines as HTML table
+ * @param id receiptNum
+ * @param actionText name of the report type
+ * @param type PAYED_BY_REPORT_EOD or PAYED_BY_REPORT_EOM
+ * @param date report date
+ * @param lines text lines from the reports table
+ * @param test print a zeroed sample for the font settings
+ * @return
+ */
+QString Reports::renderReport(int id, const QString &actionText, int type, const QDate &date, const QStringList &lines, bool test)
+{
+    QrkSettings settings;
+    QString format = (type == PAYED_BY_REPORT_EOM)? "MMMM yyyy": "dd MMMM yyyy";
+
+    QString header;
+    if (test)
+        header = QString("TESTDRUCK für SCHRIFTART");
+    else
+        header = QString("BON # %1, %2 - %3").arg(id).arg(actionText).arg(date.toString(format));
+
     QString text;
 
     text.append("<!DOCTYPE html><html><head>\n");
@@ -1104,11 +1073,10 @@ QString Reports::getReport(int id, bool test)
     text.append(QString("<tr><th colspan=\"%1\">%2</th></tr>").arg(span).arg(header) );
     text.append(QString("<tr><th colspan=\"%1\"></th></tr>").arg(span));
 
-    while (query.next()){
+    foreach (QString t, lines) {
         needOneMoreCol = false;
         span = 5;
 
-        QString t = query.value("text").toString();
         x++;
         QString color = "";
         if (x % 2 == 1)
@@ -1189,6 +1157,7 @@ QString Reports::getReport(int id, bool test)
 
 void Reports::printDocument(int id, QString title)
 {
+    MetricsTimer timer("report.print");
     QString DocumentTitle = QString("BON_%1_%2").arg(id).arg(title);
     QTextDocument doc;
     doc.setHtml(Reports::getReport(id));
@@ -25,11 +25,14 @@
 
 #include "journal.h"
 #include "receiptitemmodel.h"
+#include "reportjob.h"
 #include "qrkcore_global.h"
 
 class QRK_EXPORT Reports : public ReceiptItemModel
 {
     Q_OBJECT
+    friend class ReportJob;
+
   public:
     Reports(QObject *parent = 0, bool mode = false);
     ~Reports();
@@ -42,6 +45,7 @@ class QRK_EXPORT Reports : public ReceiptItemModel
     bool endOfMonth();
 
     static QString getReport(int id, bool test = false);
+    static QString renderReport(int id, const QString &actionText, int type, const QDate &date, const QStringList &lines, bool test = false);
 
   private:
     bool checkEOAnyMessageBoxYesNo(int type, QDate date, QString text = "");
@@ -51,7 +55,6 @@ class QRK_EXPORT Reports : public ReceiptItemModel
     int getReportType();
     bool nullReceipt(QDate date);
     QDate getLastEOD();
-    QMap<int, QDate> getEOFMap(QDate checkDate = QDate::currentDate());
 
 
     bool createEOD(int, QDate);
@@ -62,12 +65,17 @@ class QRK_EXPORT Reports : public ReceiptItemModel
     QStringList createYearStat(int, QDate);
     void printDocument(int id, QString title);
 
-    bool doEndOfDay(QDate date);
-    bool doEndOfMonth(QDate date);
+    bool doEndOfDay(QDate date, bool print = true);
+    bool doEndOfMonth(QDate date, bool print = true);
+    bool queueEndOfDay(QList<ReportJob::Period> &periods, bool ask);
+    bool runReportJob(const QList<ReportJob::Period> &periods);
 
     QString m_yearsales;
     int m_currentReceipt;
     bool m_servermode;
+    bool m_reportJobCancelled;
+
+    static bool s_reportJobRunning;
 
 };
 
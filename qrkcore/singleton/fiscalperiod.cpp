@@ -0,0 +1,193 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "fiscalperiod.h"
+#include "database.h"
+#include "defines.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+FiscalPeriodState::FiscalPeriodState(QObject *parent) :
+    QObject(parent), m_loaded(false), m_lastReceiptNum(0), m_lastType(-1)
+{
+}
+
+/**
+ * @brief FiscalPeriodState::load
+ * (re)reads the state from the database, called after the database was
+ * opened and after resetAllData
+ */
+void FiscalPeriodState::load()
+{
+    QMutexLocker locker(&m_mutex);
+    loadUnlocked();
+}
+
+void FiscalPeriodState::invalidate()
+{
+    QMutexLocker locker(&m_mutex);
+    m_loaded = false;
+}
+
+void FiscalPeriodState::loadUnlocked()
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+
+    m_lastReceiptNum = 0;
+    m_lastType = -1;
+    m_lastReceiptDate = QDate();
+    m_lastEOD = QDate();
+
+    bool ok = query.exec("SELECT value FROM globals WHERE name='lastReceiptNum'");
+    if (ok && query.next())
+        m_lastReceiptNum = query.value("value").toInt();
+
+    if (ok) {
+        query.prepare("SELECT infodate FROM receipts WHERE receiptNum=:receiptNum");
+        query.bindValue(":receiptNum", m_lastReceiptNum);
+        ok = query.exec();
+        if (ok && query.next())
+            m_lastReceiptDate = query.value("infodate").toDateTime().date();
+    }
+
+    if (ok) {
+        ok = query.exec("SELECT max(timestamp) AS timestamp FROM reports");
+        if (ok && query.next())
+            m_lastEOD = query.value("timestamp").toDate();
+    }
+
+    if (ok) {
+        ok = query.exec("SELECT payedBy FROM receipts WHERE id=(SELECT max(id) FROM receipts)");
+        if (ok && query.next() && !query.value("payedBy").isNull())
+            m_lastType = query.value("payedBy").toInt();
+    }
+
+    if (!ok) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return;
+    }
+
+    m_loaded = true;
+}
+
+bool FiscalPeriodState::isOpen(QDate checkDate)
+{
+    return closingsDue(checkDate).isEmpty();
+}
+
+/**
+ * @brief FiscalPeriodState::closingsDue
+ * the closings which have to be created before a receipt with checkDate
+ * can be written. An invalid date means the closing for checkDate was
+ * already created and no receipt can be written for this period.
+ * @param checkDate
+ * @return type (PAYED_BY_REPORT_EOD, PAYED_BY_REPORT_EOM) -> date
+ */
+QMap<int, QDate> FiscalPeriodState::closingsDue(QDate checkDate)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_loaded)
+        loadUnlocked();
+
+    QDate last = m_lastReceiptDate;
+    QDate lastEOD = m_lastEOD;
+    int type = m_lastType;
+
+    locker.unlock();
+
+    QMap<int, QDate> map;
+
+    if (type == PAYED_BY_REPORT_EOM || type == PAYED_BY_MONTH_RECEIPT){
+        type = PAYED_BY_REPORT_EOM;
+        last = lastEOD;
+    }
+
+    if (type == -1)
+        return map;
+
+    // Tagesabschluss von Heute schon gemacht?
+    if (lastEOD.isValid() && lastEOD == checkDate) {
+        map.insert(PAYED_BY_REPORT_EOD, QDate());
+        return map;
+    }
+
+    if (last.isValid() && !(type ==  PAYED_BY_REPORT_EOD) && !(type == PAYED_BY_REPORT_EOM)&& checkDate != last)
+        map.insert(PAYED_BY_REPORT_EOD, last);
+
+    QString lastMonth = last.toString("yyyyMM");
+    QString checkMonth = checkDate.toString("yyyyMM");
+
+    // Monatsabschluss von diesen Monat schon gemacht?
+    if (type == PAYED_BY_REPORT_EOM && lastMonth == checkMonth) {
+        map.insert(PAYED_BY_REPORT_EOM, QDate());
+        return map;
+    }
+    if (lastEOD.isValid() && lastEOD > checkDate) {
+        map.insert(PAYED_BY_REPORT_EOM, QDate());
+        return map;
+    }
+
+    if (last.isValid() && !(lastMonth == checkMonth) && !(type ==  PAYED_BY_REPORT_EOM) && checkDate != last)
+        map.insert(PAYED_BY_REPORT_EOM, last);
+
+    lastMonth = last.addMonths(1).toString("yyyyMM");
+    if ((lastMonth < checkMonth) && (type ==  PAYED_BY_REPORT_EOM) && checkDate != last)
+        map.insert(PAYED_BY_REPORT_EOM, last.addMonths(1));
+
+    return map;
+}
+
+/**
+ * @brief FiscalPeriodState::receiptCompleted
+ * called when a receipt (sale, cancellation, null receipt or report) got its
+ * number, type and date
+ */
+void FiscalPeriodState::receiptCompleted(int receiptNum, int payedBy, const QDateTime &infodate)
+{
+    QMutexLocker locker(&m_mutex);
+    m_lastReceiptNum = receiptNum;
+    m_lastType = payedBy;
+    m_lastReceiptDate = infodate.date();
+}
+
+/**
+ * @brief FiscalPeriodState::receiptInfoDateChanged
+ * reports are dated to the end of the closed period after they are written
+ */
+void FiscalPeriodState::receiptInfoDateChanged(int receiptNum, const QDateTime &infodate)
+{
+    QMutexLocker locker(&m_mutex);
+    if (receiptNum == m_lastReceiptNum)
+        m_lastReceiptDate = infodate.date();
+}
+
+void FiscalPeriodState::reportWritten(const QDateTime &timestamp)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_lastEOD.isValid() || timestamp.date() > m_lastEOD)
+        m_lastEOD = timestamp.date();
+}
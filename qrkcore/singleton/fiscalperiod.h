@@ -0,0 +1,75 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef FISCALPERIOD_H
+#define FISCALPERIOD_H
+
+#include <QObject>
+#include <QDate>
+#include <QDateTime>
+#include <QMap>
+#include <QMutex>
+#include "Singleton.h"
+
+#include "qrkcore_global.h"
+
+/**
+ * @brief In-memory state of the fiscal period: the last completed receipt,
+ * its type and date and the date of the last closing (EOD/EOM).
+ * The state is loaded once and then kept up to date by the code that writes
+ * receipts and reports, so the per sale "is the period still open" check
+ * does not touch the database. When a transaction which wrote a receipt
+ * is rolled back, invalidate() has to be called, the next check reloads
+ * the state.
+ */
+class QRK_EXPORT FiscalPeriodState : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FiscalPeriodState(QObject *parent = 0);
+    ~FiscalPeriodState() {}
+
+    void load();
+    void invalidate();
+
+    bool isOpen(QDate checkDate = QDate::currentDate());
+    QMap<int, QDate> closingsDue(QDate checkDate = QDate::currentDate());
+
+    void receiptCompleted(int receiptNum, int payedBy, const QDateTime &infodate);
+    void receiptInfoDateChanged(int receiptNum, const QDateTime &infodate);
+    void reportWritten(const QDateTime &timestamp);
+
+private:
+    void loadUnlocked();
+
+    bool m_loaded;
+    int m_lastReceiptNum;
+    int m_lastType;
+    QDate m_lastReceiptDate;
+    QDate m_lastEOD;
+    QMutex m_mutex;
+};
+
+//Global variable
+typedef Singleton<FiscalPeriodState> FiscalPeriod;
+
+#endif // FISCALPERIOD_H
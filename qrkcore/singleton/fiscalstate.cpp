@@ -0,0 +1,251 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "fiscalstate.h"
+#include "database.h"
+
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDateTime>
+#include <QDebug>
+
+FiscalStateFlags::FiscalStateFlags(QObject *parent) :
+    QObject(parent), m_loaded(0), m_depActive(0), m_signatureModuleDamaged(0), m_cashRegisterInactive(0)
+{
+}
+
+/**
+ * @brief FiscalStateFlags::load
+ * (re)reads all flags from globals, called after the database was opened
+ * and after resetAllData
+ */
+void FiscalStateFlags::load()
+{
+    QMutexLocker locker(&m_mutex);
+
+    bool depActive, damaged, inactive;
+    if (!readFlags(depActive, damaged, inactive))
+        return;
+
+    if (!m_loaded.loadAcquire()) {
+        m_depActive.storeRelease(depActive);
+        m_signatureModuleDamaged.storeRelease(damaged);
+        m_cashRegisterInactive.storeRelease(inactive);
+        m_loaded.storeRelease(1);
+        return;
+    }
+
+    bool depChanged = store(m_depActive, depActive);
+    bool damagedChanged = store(m_signatureModuleDamaged, damaged);
+    bool inactiveChanged = store(m_cashRegisterInactive, inactive);
+    locker.unlock();
+
+    if (depChanged)
+        emit depActiveChanged(depActive);
+    if (damagedChanged)
+        emit signatureModuleDamagedChanged(damaged);
+    if (inactiveChanged)
+        emit cashRegisterInactiveChanged(inactive);
+}
+
+/**
+ * @brief FiscalStateFlags::ensureLoaded
+ * first read of the flags, the check is repeated under the mutex so
+ * concurrent readers load only once
+ */
+void FiscalStateFlags::ensureLoaded()
+{
+    if (m_loaded.loadAcquire())
+        return;
+
+    QMutexLocker locker(&m_mutex);
+    if (m_loaded.loadAcquire())
+        return;
+
+    bool depActive, damaged, inactive;
+    if (!readFlags(depActive, damaged, inactive))
+        return;
+
+    m_depActive.storeRelease(depActive);
+    m_signatureModuleDamaged.storeRelease(damaged);
+    m_cashRegisterInactive.storeRelease(inactive);
+    m_loaded.storeRelease(1);
+}
+
+bool FiscalStateFlags::readFlags(bool &depActive, bool &damaged, bool &inactive)
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+
+    depActive = false;
+    damaged = false;
+    inactive = false;
+
+    query.prepare("SELECT name, value FROM globals WHERE name IN ('DEP', 'signatureModuleIsDamaged', 'CASHREGISTER INAKTIV')");
+    if (!query.exec()) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    while (query.next()) {
+        QString name = query.value("name").toString();
+        if (name == "DEP")
+            depActive = query.value("value").toBool();
+        else if (name == "signatureModuleIsDamaged")
+            damaged = true;
+        else if (name == "CASHREGISTER INAKTIV")
+            inactive = (query.value("value").toInt() == 1);
+    }
+
+    return true;
+}
+
+bool FiscalStateFlags::isDEPactive()
+{
+    ensureLoaded();
+    return m_depActive.loadAcquire();
+}
+
+bool FiscalStateFlags::isSignatureModuleDamaged()
+{
+    ensureLoaded();
+    return m_signatureModuleDamaged.loadAcquire();
+}
+
+bool FiscalStateFlags::isCashRegisterInactive()
+{
+    ensureLoaded();
+    return m_cashRegisterInactive.loadAcquire();
+}
+
+bool FiscalStateFlags::setDEPactive(bool active)
+{
+    ensureLoaded();
+    QMutexLocker locker(&m_mutex);
+
+    if (!writeValue("DEP", active))
+        return false;
+
+    bool changed = store(m_depActive, active);
+    locker.unlock();
+
+    if (changed)
+        emit depActiveChanged(active);
+    return true;
+}
+
+/**
+ * @brief FiscalStateFlags::setSignatureModuleDamaged
+ * the failure time is kept in globals until the collective receipt
+ * resets the flag. The in-memory flag is set even if the database can't
+ * be written, the receipt has to be marked anyway.
+ * @param damaged
+ * @return
+ */
+bool FiscalStateFlags::setSignatureModuleDamaged(bool damaged)
+{
+    ensureLoaded();
+    QMutexLocker locker(&m_mutex);
+
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+    bool ok = true;
+
+    if (damaged && !m_signatureModuleDamaged.loadAcquire()) {
+        query.prepare("INSERT INTO globals (name, strValue) VALUES('signatureModuleIsDamaged', :date)");
+        query.bindValue(":date", QDateTime::currentDateTime().toString(Qt::ISODate));
+        ok = query.exec();
+    } else if (!damaged) {
+        query.prepare("DELETE FROM globals WHERE name='signatureModuleIsDamaged'");
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+    }
+
+    bool changed = store(m_signatureModuleDamaged, damaged);
+    locker.unlock();
+
+    if (changed)
+        emit signatureModuleDamagedChanged(damaged);
+    return ok;
+}
+
+bool FiscalStateFlags::setCashRegisterInactive(bool inactive)
+{
+    ensureLoaded();
+    QMutexLocker locker(&m_mutex);
+
+    if (!writeValue("CASHREGISTER INAKTIV", inactive ? 1 : 0))
+        return false;
+
+    bool changed = store(m_cashRegisterInactive, inactive);
+    locker.unlock();
+
+    if (changed)
+        emit cashRegisterInactiveChanged(inactive);
+    return true;
+}
+
+bool FiscalStateFlags::writeValue(const QString &name, int value)
+{
+    QSqlDatabase dbc = Database::database();
+    QSqlQuery query(dbc);
+
+    query.prepare("UPDATE globals SET value=:value WHERE name=:name");
+    query.bindValue(":value", value);
+    query.bindValue(":name", name);
+    bool ok = query.exec();
+
+    if (ok && query.numRowsAffected() == 0) {
+        query.prepare("SELECT value FROM globals WHERE name=:name");
+        query.bindValue(":name", name);
+        ok = query.exec();
+        if (ok && !query.next()) {
+            query.prepare("INSERT INTO globals (name, value) VALUES(:name, :value)");
+            query.bindValue(":name", name);
+            query.bindValue(":value", value);
+            ok = query.exec();
+        }
+    }
+
+    if (!ok) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+    }
+
+    return ok;
+}
+
+/**
+ * @brief FiscalStateFlags::store
+ * @return true if the flag changed. The caller emits the signal after
+ * releasing the mutex, a slot may call back into the setters.
+ */
+bool FiscalStateFlags::store(QAtomicInt &flag, bool value)
+{
+    return flag.fetchAndStoreOrdered(value) != int(value);
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef FISCALSTATE_H
+#define FISCALSTATE_H
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QMutex>
+#include "Singleton.h"
+
+#include "qrkcore_global.h"
+
+/**
+ * @brief In-memory copy of the fiscal state flags kept in globals
+ * (DEP, signatureModuleIsDamaged, CASHREGISTER INAKTIV).
+ * The flags are loaded once and only changed through the setters, which
+ * write through to the database and emit a signal when a flag changes.
+ * Reads are lock-free and may come from any thread.
+ */
+class QRK_EXPORT FiscalStateFlags : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FiscalStateFlags(QObject *parent = 0);
+    ~FiscalStateFlags() {}
+
+    void load();
+
+    bool isDEPactive();
+    bool isSignatureModuleDamaged();
+    bool isCashRegisterInactive();
+
+    bool setDEPactive(bool active);
+    bool setSignatureModuleDamaged(bool damaged);
+    bool setCashRegisterInactive(bool inactive);
+
+signals:
+    void depActiveChanged(bool active);
+    void signatureModuleDamagedChanged(bool damaged);
+    void cashRegisterInactiveChanged(bool inactive);
+
+private:
+    void ensureLoaded();
+    bool readFlags(bool &depActive, bool &damaged, bool &inactive);
+    bool writeValue(const QString &name, int value);
+    bool store(QAtomicInt &flag, bool value);
+
+    QAtomicInt m_loaded;
+    QAtomicInt m_depActive;
+    QAtomicInt m_signatureModuleDamaged;
+    QAtomicInt m_cashRegisterInactive;
+    QMutex m_mutex;
+};
+
+//Global variable
+typedef Singleton<FiscalStateFlags> FiscalState;
+
+#endif // FISCALSTATE_H
@@ -46,3 +46,13 @@ void SpreadSignal::setSafetyDevice(bool active)
 {
     Spread::Instance()->updateSafetyDevice(active);
 }
+
+/**
+ * @brief SpreadSignal::setSalesTotal
+ * @param dateTime receipt time, an invalid QDateTime asks the listeners to reload all totals
+ * @param gross
+ */
+void SpreadSignal::setSalesTotal(QDateTime dateTime, double gross)
+{
+    Spread::Instance()->updateSalesTotal(dateTime, gross);
+}
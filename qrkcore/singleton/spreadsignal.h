@@ -24,6 +24,7 @@
 #define SPREADSIGNAL_H
 
 #include <QObject>
+#include <QDateTime>
 #include "Singleton.h"
 
 #include "qrkcore_global.h"
@@ -39,12 +40,14 @@ public:
     void setProgressBarWait(bool on_off);
     void setImportInfo(QString message, bool isError = false);
     void setSafetyDevice(bool active);
+    void setSalesTotal(QDateTime dateTime, double gross);
 
 signals:
     void updateProgressBar(int value, bool add);
     void updateProgressBarWait(bool on_off);
     void updateImportInfo(QString message, bool isError = false);
     void updateSafetyDevice(bool active);
+    void updateSalesTotal(QDateTime dateTime, double gross);
 
 public slots:
 
@@ -0,0 +1,106 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "jsonimportfile.h"
+
+#include <QJsonDocument>
+#include <QTextCodec>
+#include <QDebug>
+
+#include <cstring>
+
+JsonImportFile::JsonImportFile(const QString &filename, const QString &codec)
+    : m_file(filename)
+    , m_codec(QTextCodec::codecForName(codec.toUtf8()))
+    , m_data(Q_NULLPTR)
+    , m_size(0)
+{
+    if (!m_codec)
+        m_codec = QTextCodec::codecForName("UTF-8");
+}
+
+JsonImportFile::~JsonImportFile()
+{
+    close();
+}
+
+/**
+ * @brief JsonImportFile::open
+ * maps the file into memory. If mapping is not possible (empty file, special
+ * filesystems) the content is read into a buffer as fallback.
+ * @return
+ */
+bool JsonImportFile::open()
+{
+    close();
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+    if (!m_data) {
+        m_buffer = m_file.readAll();
+        m_data = m_buffer.constData();
+        m_size = m_buffer.size();
+    }
+
+    return true;
+}
+
+void JsonImportFile::close()
+{
+    if (m_file.isOpen()) {
+        if (m_buffer.isEmpty() && m_data)
+            m_file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+        m_file.close();
+    }
+    m_buffer.clear();
+    m_data = Q_NULLPTR;
+    m_size = 0;
+}
+
+bool JsonImportFile::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QJsonObject JsonImportFile::object(QJsonParseError *error) const
+{
+    const char *begin = m_data;
+    const char *end = m_data + m_size;
+
+    // remove any prefix and suffix from dirty json files
+    if (begin < end && *begin != '{') {
+        const char *brace = static_cast<const char *>(memchr(begin, '{', end - begin));
+        begin = brace ? brace : end;
+        while (end > begin && *(end - 1) != '}')
+            end--;
+    }
+
+    QByteArray json;
+    if (m_codec->mibEnum() == 106)  // UTF-8, parse the mapped bytes in place
+        json = QByteArray::fromRawData(begin, int(end - begin));
+    else
+        json = m_codec->toUnicode(begin, int(end - begin)).toUtf8();
+
+    return QJsonDocument::fromJson(json, error).object();
+}
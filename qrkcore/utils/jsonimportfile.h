@@ -0,0 +1,59 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef JSONIMPORTFILE_H
+#define JSONIMPORTFILE_H
+
+#include "qrkcore_global.h"
+
+#include <QFile>
+#include <QJsonObject>
+
+class QTextCodec;
+struct QJsonParseError;
+
+/**
+ * @brief The JsonImportFile class
+ * Maps a server mode import file into memory and parses it without
+ * intermediate copies. Only codepages other than UTF-8 are transcoded.
+ * Prefix and suffix around the outer braces of dirty files are skipped.
+ */
+class QRK_EXPORT JsonImportFile
+{
+  public:
+    JsonImportFile(const QString &filename, const QString &codec = "UTF-8");
+    ~JsonImportFile();
+
+    bool open();
+    void close();
+    bool isOpen() const;
+    QJsonObject object(QJsonParseError *error = Q_NULLPTR) const;
+
+  private:
+    QFile m_file;
+    QTextCodec *m_codec;
+    QByteArray m_buffer;
+    const char *m_data;
+    qint64 m_size;
+};
+
+#endif // JSONIMPORTFILE_H
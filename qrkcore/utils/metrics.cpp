@@ -0,0 +1,312 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "metrics.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+#include <cmath>
+
+namespace {
+
+struct TraceEvent
+{
+    const char *name;
+    quintptr tid;
+    qint64 start;
+    qint64 duration;
+};
+
+/* keeps a long shop day in memory (~5MB) */
+const int MAX_TRACE_EVENTS = 200000;
+
+QMutex s_mutex;
+QElapsedTimer s_clock;
+QHash<QByteArray, qint64> s_counters;
+QHash<QByteArray, MetricsHistogram> s_timers;
+QHash<QByteArray, MetricsHistogram> s_values;
+QVector<TraceEvent> s_events;
+
+void addSample(QHash<QByteArray, MetricsHistogram> &map, const char *name, qint64 value)
+{
+    QByteArray key(name);
+    QHash<QByteArray, MetricsHistogram>::iterator it = map.find(key);
+    if (it == map.end()) {
+        it = map.insert(key, MetricsHistogram());
+        it.value().name = QString::fromLatin1(name);
+    }
+    it.value().add(value);
+}
+
+QList<MetricsHistogram> sorted(const QHash<QByteArray, MetricsHistogram> &map)
+{
+    QMap<QString, MetricsHistogram> ordered;
+    QHashIterator<QByteArray, MetricsHistogram> i(map);
+    while (i.hasNext()) {
+        i.next();
+        ordered.insert(i.value().name, i.value());
+    }
+    return ordered.values();
+}
+
+QJsonObject histogramsToJson(const QList<MetricsHistogram> &list)
+{
+    QJsonObject object;
+    foreach (const MetricsHistogram &h, list) {
+        QJsonObject entry;
+        entry["count"] = h.count;
+        entry["total"] = h.total;
+        entry["min"] = h.min;
+        entry["max"] = h.max;
+        entry["avg"] = h.count ? double(h.total) / h.count : 0.0;
+        entry["p50"] = h.percentile(0.5);
+        entry["p95"] = h.percentile(0.95);
+        object[h.name] = entry;
+    }
+    return object;
+}
+
+}
+
+QAtomicInt Metrics::s_enabled(0);
+
+MetricsHistogram::MetricsHistogram()
+    : count(0), total(0), min(0), max(0)
+{
+    for (int i = 0; i < METRICS_BUCKETS; i++)
+        buckets[i] = 0;
+}
+
+void MetricsHistogram::add(qint64 value)
+{
+    if (value < 0)
+        value = 0;
+
+    if (count == 0 || value < min)
+        min = value;
+    if (value > max)
+        max = value;
+
+    count++;
+    total += value;
+
+    // bucket i holds values below 2^i
+    int bucket = 0;
+    while (bucket < METRICS_BUCKETS - 1 && (qint64(1) << bucket) <= value)
+        bucket++;
+    buckets[bucket]++;
+}
+
+qint64 MetricsHistogram::percentile(double p) const
+{
+    if (count == 0)
+        return 0;
+
+    qint64 rank = qint64(std::ceil(p * count));
+    qint64 seen = 0;
+    for (int i = 0; i < METRICS_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank)
+            return qMin(qint64(1) << i, max);
+    }
+
+    return max;
+}
+
+//--------------------------------------------------------------------------------
+
+void Metrics::setEnabled(bool enabled)
+{
+    QMutexLocker locker(&s_mutex);
+    if (enabled && !s_clock.isValid())
+        s_clock.start();
+
+    s_enabled.store(enabled ? 1 : 0);
+    qInfo() << "Function Name: " << Q_FUNC_INFO << " metrics enabled: " << enabled;
+}
+
+void Metrics::reset()
+{
+    QMutexLocker locker(&s_mutex);
+    s_counters.clear();
+    s_timers.clear();
+    s_values.clear();
+    s_events.clear();
+}
+
+/**
+ * @brief Metrics::now
+ * @return microseconds since metrics were enabled the first time
+ */
+qint64 Metrics::now()
+{
+    return s_clock.isValid() ? s_clock.nsecsElapsed() / 1000 : 0;
+}
+
+void Metrics::addCount(const char *name, qint64 delta)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&s_mutex);
+    s_counters[QByteArray(name)] += delta;
+}
+
+void Metrics::addValue(const char *name, qint64 value)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&s_mutex);
+    addSample(s_values, name, value);
+}
+
+/**
+ * @brief Metrics::addTime
+ * @param name must be a string literal, the trace buffer keeps the pointer
+ * @param start microseconds from Metrics::now()
+ * @param usec duration in microseconds
+ */
+void Metrics::addTime(const char *name, qint64 start, qint64 usec)
+{
+    if (!isEnabled())
+        return;
+
+    QMutexLocker locker(&s_mutex);
+    addSample(s_timers, name, usec);
+
+    if (s_events.size() < MAX_TRACE_EVENTS) {
+        TraceEvent event = { name, quintptr(QThread::currentThreadId()), start, usec };
+        s_events.append(event);
+    } else {
+        s_counters["metrics.droppedEvents"]++;
+    }
+}
+
+qint64 Metrics::counter(const char *name)
+{
+    QMutexLocker locker(&s_mutex);
+    return s_counters.value(QByteArray(name), 0);
+}
+
+QList<QPair<QString, qint64> > Metrics::counters()
+{
+    QMutexLocker locker(&s_mutex);
+    QMap<QString, qint64> ordered;
+    QHashIterator<QByteArray, qint64> i(s_counters);
+    while (i.hasNext()) {
+        i.next();
+        ordered.insert(QString::fromLatin1(i.key()), i.value());
+    }
+
+    QList<QPair<QString, qint64> > list;
+    QMapIterator<QString, qint64> j(ordered);
+    while (j.hasNext()) {
+        j.next();
+        list.append(qMakePair(j.key(), j.value()));
+    }
+    return list;
+}
+
+QList<MetricsHistogram> Metrics::timers()
+{
+    QMutexLocker locker(&s_mutex);
+    return sorted(s_timers);
+}
+
+QList<MetricsHistogram> Metrics::values()
+{
+    QMutexLocker locker(&s_mutex);
+    return sorted(s_values);
+}
+
+QJsonObject Metrics::toJson()
+{
+    QJsonObject counterObject;
+    QList<QPair<QString, qint64> > list = counters();
+    for (int i = 0; i < list.size(); i++)
+        counterObject[list.at(i).first] = list.at(i).second;
+
+    QJsonObject object;
+    object["counters"] = counterObject;
+    object["timers_us"] = histogramsToJson(timers());
+    object["values"] = histogramsToJson(values());
+
+    return object;
+}
+
+/**
+ * @brief Metrics::writeTrace
+ * writes the recorded scopes in the Chrome trace event format
+ * (chrome://tracing, Perfetto). Counters, histograms and the keys of
+ * extra are stored in "otherData".
+ */
+bool Metrics::writeTrace(const QString &filename, const QJsonObject &extra)
+{
+    QJsonObject summary = toJson();
+    for (QJsonObject::const_iterator it = extra.constBegin(); it != extra.constEnd(); ++it)
+        summary[it.key()] = it.value();
+    qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    {
+        QMutexLocker locker(&s_mutex);
+        foreach (const TraceEvent &e, s_events) {
+            QJsonObject event;
+            event["name"] = QString::fromLatin1(e.name);
+            event["cat"] = QString::fromLatin1(e.name).section('.', 0, 0);
+            event["ph"] = QString("X");
+            event["ts"] = e.start;
+            event["dur"] = e.duration;
+            event["pid"] = pid;
+            event["tid"] = qint64(e.tid);
+            events.append(event);
+        }
+    }
+
+    QJsonObject root;
+    root["traceEvents"] = events;
+    root["displayTimeUnit"] = QString("ms");
+    root["otherData"] = summary;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << file.errorString();
+        return false;
+    }
+
+    file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    file.close();
+
+    return true;
+}
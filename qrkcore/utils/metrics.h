@@ -0,0 +1,98 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "qrkcore_global.h"
+
+#include <QAtomicInt>
+#include <QJsonObject>
+#include <QList>
+#include <QPair>
+#include <QString>
+
+#define METRICS_BUCKETS 24
+
+struct QRK_EXPORT MetricsHistogram
+{
+    MetricsHistogram();
+    void add(qint64 value);
+    qint64 percentile(double p) const;
+
+    QString name;
+    qint64 count;
+    qint64 total;
+    qint64 min;
+    qint64 max;
+    qint64 buckets[METRICS_BUCKETS];
+};
+
+class QRK_EXPORT Metrics
+{
+  public:
+    static bool isEnabled() { return s_enabled.load() != 0; }
+    static void setEnabled(bool enabled);
+    static void reset();
+
+    static qint64 now();
+    static void addCount(const char *name, qint64 delta = 1);
+    static void addValue(const char *name, qint64 value);
+    static void addTime(const char *name, qint64 start, qint64 usec);
+    static qint64 counter(const char *name);
+
+    static QList<QPair<QString, qint64> > counters();
+    static QList<MetricsHistogram> timers();
+    static QList<MetricsHistogram> values();
+
+    static QJsonObject toJson();
+    static bool writeTrace(const QString &filename, const QJsonObject &extra = QJsonObject());
+
+  private:
+    static QAtomicInt s_enabled;
+};
+
+/**
+ * @brief The MetricsTimer class measures the lifetime of a scope.
+ * When metrics are disabled the constructor only reads one flag.
+ */
+class QRK_EXPORT MetricsTimer
+{
+  public:
+    explicit MetricsTimer(const char *name)
+        : m_name(Metrics::isEnabled() ? name : 0), m_start(m_name ? Metrics::now() : 0) {}
+    ~MetricsTimer() { stop(); }
+
+    void stop()
+    {
+        if (m_name)
+            Metrics::addTime(m_name, m_start, Metrics::now() - m_start);
+        m_name = 0;
+    }
+
+  private:
+    Q_DISABLE_COPY(MetricsTimer)
+    const char *m_name;
+    qint64 m_start;
+};
+
+#endif // METRICS_H
@@ -18,19 +18,45 @@
  */
 
 #include "qrcode.h"
+#include "metrics.h"
 
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPixmap>
-#include <QPainter>
+#include <QVector>
+
+#include <string.h>
+
+/*
+ * The QRCode of a receipt is built from the receipt number and its signature
+ * and never changes, so the encoded module matrix is kept in a small LRU cache.
+ * Printing a receipt and browsing the documents only render the bitmap again.
+ */
+namespace {
+struct QRMatrix
+{
+    int width;
+    QByteArray modules;
+};
+
+QMutex s_cacheMutex;
+QCache<QString, QRMatrix> s_cache(256);
+}
 
 QRCode::QRCode(QObject *parent)
   : QObject(parent)
 {
-  m_image = NULL;
 }
 
 QRCode::~QRCode()
 {
-  if (m_image != NULL) delete m_image;
+}
+
+void QRCode::clearCache()
+{
+  QMutexLocker locker(&s_cacheMutex);
+  s_cache.clear();
 }
 
 QRcode *QRCode::encode(const unsigned char *intext, int length, QRecLevel level)
@@ -43,9 +69,22 @@ QRcode *QRCode::encode(const unsigned char *intext, int length, QRecLevel level)
   return code;
 }
 
-
-QPixmap QRCode::encodeTextToPixmap( QString text, int size, int margin, int ErrCLevel )
+QByteArray QRCode::matrix(const QString &text, int ErrCLevel, int &width)
 {
+  QString key = QString::number(ErrCLevel) + text;
+
+  {
+    QMutexLocker locker(&s_cacheMutex);
+    QRMatrix *cached = s_cache.object(key);
+    if (cached) {
+      Metrics::addCount("qrcode.cache.hit");
+      width = cached->width;
+      return cached->modules;
+    }
+  }
+
+  Metrics::addCount("qrcode.cache.miss");
+
   QByteArray a = text.toUtf8();
 
   QRecLevel level;
@@ -67,54 +106,107 @@ QPixmap QRCode::encodeTextToPixmap( QString text, int size, int margin, int ErrC
       break;
   }
 
+  MetricsTimer timer("qrcode.encode");
   QRcode *qrcode = encode( (unsigned char*)a.constData(), a.length(), level); // Generate QRCode from string.
+  timer.stop();
+
   if ( qrcode == NULL ) {
-    return QPixmap();
+    return QByteArray();
   }
   if (qrcode->width < 21 || qrcode->width > 177) { // qrcode width range is min is "ver-1 = 21 cell", max is ver-40 = 177 cell
-    return QPixmap();
+    QRcode_free(qrcode);
+    return QByteArray();
   }
 
-  int realwidth = (qrcode->width + margin * 2) * size;
+  width = qrcode->width;
+  QByteArray modules(width * width, 0);
+  for (int i = 0; i < modules.size(); i++)
+    modules[i] = qrcode->data[i] & 1;
 
-  if (m_image != NULL) {
-    delete(m_image);
+  QRcode_free(qrcode);
+
+  QMutexLocker locker(&s_cacheMutex);
+  QRMatrix *entry = new QRMatrix;
+  entry->width = width;
+  entry->modules = modules;
+  s_cache.insert(key, entry);
+
+  return modules;
+}
+
+/*
+ * Writes the modules straight into a 1-bit image of target x target pixels.
+ * Pixels are mapped to modules like a nearest neighbour scaling of the
+ * realwidth bitmap, equal rows are copied as a whole scanline.
+ */
+QImage QRCode::render(const QByteArray &modules, int width, int margin, int realwidth, int target)
+{
+  MetricsTimer timer("qrcode.render");
+
+  QImage image(target, target, QImage::Format_Mono);
+  image.setColor(0, qRgb(255, 255, 255));
+  image.setColor(1, qRgb(0, 0, 0));
+  image.fill(0);
+
+  int size = realwidth / (width + margin * 2);
+  QVector<int> map(target);
+  for (int i = 0; i < target; i++) {
+    int module = int(((2 * qint64(i) + 1) * realwidth) / (2 * qint64(target))) / size - margin;
+    map[i] = (module < 0 || module >= width) ? -1 : module;
   }
 
-  m_image = new QImage( realwidth, realwidth, QImage::Format_Mono );
-  QPainter painter(m_image);
+  const char *data = modules.constData();
+  const int bytesPerLine = image.bytesPerLine();
+  int lastRow = -1;
+  uchar *lastLine = 0;
 
-  painter.fillRect( QRect( 0, 0, realwidth, realwidth ), QColor( Qt::white ) );
+  for (int y = 0; y < target; y++) {
+    int row = map[y];
+    if (row < 0)
+      continue;
 
-  QColor black( Qt::black );
+    uchar *line = image.scanLine(y);
+    if (row == lastRow) {
+      memcpy(line, lastLine, bytesPerLine);
+      continue;
+    }
 
-  int i = 0;
-  int x = 0;
-  int y = 0;
-  QRect rect( 0, 0, size, size );
-  while ( y < qrcode->width )
-  {
-    x = 0;
-    while ( x < qrcode->width )
-    {
-      // only if a block is present (black)
-      if ( qrcode->data[i] & 1 )
-      {
-        rect.moveTo(size * (margin + x),
-                    size * (margin + y));
-        painter.fillRect( rect, black );
-      }
-      i++;
-      x++;
+    const char *moduleRow = data + row * width;
+    for (int x = 0; x < target; x++) {
+      int column = map[x];
+      if (column >= 0 && moduleRow[column])
+        line[x >> 3] |= 0x80 >> (x & 7);
     }
-    y++;
+    lastRow = row;
+    lastLine = line;
   }
 
-  painter.end();
+  return image;
+}
 
-  QPixmap pixmap = QPixmap::fromImage(*m_image);
+QImage QRCode::encodeTextToImage( const QString &text, double factor, int maxWidth, int size, int margin, int ErrCLevel )
+{
+  int width = 0;
+  QByteArray modules = matrix(text, ErrCLevel, width);
+  if (modules.isEmpty())
+    return QImage();
 
-  QRcode_free(qrcode);
+  int realwidth = (width + margin * 2) * size;
+  int target = qMin(qRound(realwidth * factor), maxWidth);
+  if (target < 1)
+    return QImage();
+
+  return render(modules, width, margin, realwidth, target);
+}
+
+QPixmap QRCode::encodeTextToPixmap( QString text, int size, int margin, int ErrCLevel )
+{
+  int width = 0;
+  QByteArray modules = matrix(text, ErrCLevel, width);
+  if (modules.isEmpty())
+    return QPixmap();
+
+  int realwidth = (width + margin * 2) * size;
 
-  return pixmap;
+  return QPixmap::fromImage(render(modules, width, margin, realwidth, realwidth));
 }
@@ -24,6 +24,7 @@
 #define QRCODE_H
 
 #include <qrencode.h>
+#include <QImage>
 #include <QObject>
 
 #include "qrkcore_global.h"
@@ -36,10 +37,14 @@ class QRK_EXPORT QRCode : public QObject
     QRCode(QObject *parent = 0);
     ~QRCode();
     QPixmap encodeTextToPixmap( QString text, int size = 2, int margin = 2, int ErrCLevel = 0 );
+    QImage encodeTextToImage( const QString &text, double factor, int maxWidth, int size = 2, int margin = 2, int ErrCLevel = 0 );
+
+    static void clearCache();
 
   private:
     QRcode *encode(const unsigned char *intext, int length, QRecLevel level = QR_ECLEVEL_L);
-    QImage *m_image;
+    QByteArray matrix(const QString &text, int ErrCLevel, int &width);
+    QImage render(const QByteArray &modules, int width, int margin, int realwidth, int target);
 
 };
 
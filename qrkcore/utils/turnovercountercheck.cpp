@@ -0,0 +1,44 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "turnovercountercheck.h"
+#include "utils.h"
+#include "databasemanager.h"
+
+#include <QThread>
+#include <QDebug>
+
+TurnOverCounterCheck::TurnOverCounterCheck(bool full, QObject *parent) :
+    QObject(parent), m_full(full)
+{
+}
+
+void TurnOverCounterCheck::run()
+{
+    qDebug() << "Function Name: " << Q_FUNC_INFO << "TurnOverCounterCheck: " << QThread::currentThread();
+
+    QStringList error;
+    bool ok = Utils::checkTurnOverCounter(error, m_full);
+
+    DatabaseManager::removeCurrentThread("CN");
+    emit finished(ok, error);
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef TURNOVERCOUNTERCHECK_H
+#define TURNOVERCOUNTERCHECK_H
+
+#include <QObject>
+#include <QStringList>
+
+#include "qrkcore_global.h"
+
+/**
+ * @brief The TurnOverCounterCheck class runs the DEP-7 turnover counter
+ * verification in a worker thread. The full check is used from the menu,
+ * the incremental one at startup.
+ */
+class QRK_EXPORT TurnOverCounterCheck : public QObject
+{
+        Q_OBJECT
+
+    public:
+        TurnOverCounterCheck(bool full = true, QObject *parent = 0);
+
+    public slots:
+        void run();
+
+    signals:
+        void finished(bool ok, QStringList error);
+
+    private:
+        bool m_full;
+};
+
+#endif // TURNOVERCOUNTERCHECK_H
@@ -23,8 +23,10 @@
 #include "singleton/spreadsignal.h"
 #include "RK/rk_signaturemodule.h"
 #include "RK/rk_signaturemodulefactory.h"
+#include "RK/rk_signaturesession.h"
 #include "3rdparty/qbcmath/bcmath.h"
 #include "qrcode.h"
+#include "metrics.h"
 
 #include <QDateTime>
 #include <QSqlDatabase>
@@ -32,6 +34,8 @@
 #include <QSqlError>
 #include <QJsonObject>
 #include <QByteArray>
+#include <QCryptographicHash>
+#include <QMap>
 #include <QFileInfo>
 #include <QFont>
 #include <QFontMetrics>
@@ -51,87 +55,10 @@ Utils::~Utils()
 
 QString Utils::getSignature(QJsonObject data)
 {
+    RKSignatureSession session;
+    session.begin(Database::getLastReceiptNum() - 1);
 
-    Spread::Instance()->setProgressBarWait(true);
-    RKSignatureModule *RKSignature = RKSignatureModuleFactory::createInstance("", DemoMode::isDemoMode());
-    RKSignature->selectApplication();
-
-    QString taxlocation =  Database::getTaxLocation();
-    QSqlDatabase dbc= Database::database();
-    QSqlQuery query(dbc);
-
-    QJsonObject sign;
-    bool error = false;
-
-    sign["Kassen-ID"] = data.value("kasse").toString();
-    sign["Belegnummer"] = QString::number(data.value("receiptNum").toInt());
-    sign["Beleg-Datum-Uhrzeit"] = data.value("receiptTime").toString();
-
-    query.prepare("SELECT tax FROM taxTypes WHERE taxlocation=:taxlocation ORDER BY id");
-    query.bindValue(":taxlocation", taxlocation);
-
-    bool ok = query.exec();
-    if (!ok) {
-        qCritical() << "Function Name: " << Q_FUNC_INFO << " error: " << query.lastError().text();
-        error = true;
-    }
-
-    qlonglong counter = 0;
-    while(query.next()){
-        double tax = query.value(0).toDouble();
-        QBCMath gross = data.value(Database::getTaxType(tax)).toDouble();
-        gross.round(2);
-
-        sign[Database::getTaxType( tax )] = gross.toString();
-        // counter += sign.value(Database::getTaxType( tax )).toString().toDouble() * 100;
-        counter += sign.value(Database::getTaxType( tax )).toString().replace(".","").toLongLong();
-    }
-
-    QString concatenatedValue = sign["Kassen-ID"].toString() + sign["Belegnummer"].toString();
-    QString lastUsedCertificateSerial = "";
-    QString last_signature = getLastReceiptSignature();
-    if (last_signature.isEmpty()) error = true;
-    qlonglong turnOverCounter = getTurnOverCounter(RKSignature, lastUsedCertificateSerial, error);
-
-    turnOverCounter += counter;
-
-    QString symmetricKey = RKSignature->getPrivateTurnoverKey();
-    QString base64encryptedTurnOverCounter = RKSignature->encryptTurnoverCounter(concatenatedValue, turnOverCounter, symmetricKey);
-
-    if (data.value("isStorno").toBool(false))
-        sign["Stand-Umsatz-Zaehler-AES256-ICM"] = "U1RP";
-    else
-        sign["Stand-Umsatz-Zaehler-AES256-ICM"] = base64encryptedTurnOverCounter;
-
-    bool safetyDevice;
-    QString certificateSerial = RKSignature->getCertificateSerial(true);
-    if (certificateSerial == "0" || certificateSerial.isEmpty()) {
-        safetyDevice = false;
-        certificateSerial = lastUsedCertificateSerial;
-        if (!RKSignature->isSignatureModuleSetDamaged())
-            RKSignature->setSignatureModuleDamaged();
-    } else {
-        safetyDevice = true;
-    }
-
-    sign["Zertifikat-Seriennummer"] = certificateSerial;
-
-    sign["Sig-Voriger-Beleg"] = RKSignature->getLastSignatureValue(last_signature);
-
-    QTime t;
-    t.start();
-    QString signature = RKSignature->signReceipt(getReceiptShortJson(sign));
-    qDebug() << "Function Name: " << Q_FUNC_INFO << "Signature Time elapsed: " << t.elapsed() << " ms";
-
-    delete RKSignature;
-
-    Spread::Instance()->setProgressBarWait(false);
-    Spread::Instance()->setSafetyDevice(safetyDevice);
-
-    if (certificateSerial.isEmpty() || last_signature.isEmpty() || error)
-        return "";
-
-    return signature;
+    return session.sign(data);
 }
 
 /*
@@ -212,10 +139,22 @@ QString Utils::getReceiptShortJson(QJsonObject sig)
 }
 
 qlonglong Utils::getTurnOverCounter(RKSignatureModule *sm, QString &lastSerial, bool &error)
+{
+    return getTurnOverCounter(sm, Utils::getLastReceiptSignature(), lastSerial, error);
+}
+
+/**
+ * @brief Utils::getTurnOverCounter
+ * @param sm
+ * @param lastReceiptSignature signature of the receipt before the next one
+ * @param lastSerial receives the certificate serial of the last DEP entry
+ * @param error
+ * @return the turnover counter after the last DEP entry
+ */
+qlonglong Utils::getTurnOverCounter(RKSignatureModule *sm, const QString &lastReceiptSignature, QString &lastSerial, bool &error)
 {
     QString key = RKSignatureModule::getPrivateTurnoverKey();
 
-    QString lastReceiptSignature = Utils::getLastReceiptSignature();
     if (lastReceiptSignature.isEmpty()) {
         error = true;
         return 0;
@@ -269,33 +208,10 @@ qlonglong Utils::getTurnOverCounter(RKSignatureModule *sm, QString &lastSerial,
 
 double Utils::getYearlyTotal(int year)
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-
-    QDateTime from;
-    QDateTime to;
-
     if (year == 0) year = QDate::currentDate().year();
 
-    QString fromString = QString("%1-01-01").arg(year);
-    QString toString = QString("%1-12-31").arg(year);
-
-    from.setDate(QDate::fromString(fromString, "yyyy-MM-dd"));
-    to.setDate(QDate::fromString(toString, "yyyy-MM-dd"));
-    to.setTime(QTime::fromString("23:59:59"));
-
-    /* Summe */
-    query.prepare("SELECT sum(gross) FROM receipts WHERE timestamp BETWEEN :fromDate AND :toDate AND payedBy < 3");
-    query.bindValue(":fromDate", from.toString(Qt::ISODate));
-    query.bindValue(":toDate", to.toString(Qt::ISODate));
-
-    query.exec();
-    query.next();
-
-    double sales = query.value(0).toDouble() ;
-
-    return sales;
-
+    /* running total, maintained by ReceiptItemModel::finishReceipts */
+    return Database::getSalesTotal(QString::number(year));
 }
 
 bool Utils::isDirectoryWritable(QString path)
@@ -349,8 +265,29 @@ QString Utils::wordWrap(QString text, int width, QFont font)
     return result + text;
 }
 
-bool Utils::checkTurnOverCounter(QStringList &error)
+/* sum of the five turnover fields of a decoded DEP-7 payload in cent */
+static qlonglong depTurnover(const QStringList &list)
 {
+    qlonglong turnover = 0;
+    for (int y = 5; y < 10; y++) {
+        QString current = list.at(y);
+        turnover += current.replace(",","").toLongLong();
+    }
+
+    return turnover;
+}
+
+/**
+ * @brief Utils::checkTurnOverCounter
+ * verifies the turnover counter of the DEP-7 entries written after the last
+ * checkpoint. A successful pass stores a new checkpoint with a SHA-256 hash
+ * chained over the verified entries. With full = true every entry is verified
+ * again and each stored checkpoint is compared with the recomputed hash.
+ */
+bool Utils::checkTurnOverCounter(QStringList &error, bool full)
+{
+    MetricsTimer timer(full ? "dep.verifyFull" : "dep.verify");
+
     QString key = RKSignatureModule::getPrivateTurnoverKey();
     RKSignatureModule *sm = RKSignatureModuleFactory::createInstance("", DemoMode::isDemoMode());
 
@@ -364,14 +301,66 @@ bool Utils::checkTurnOverCounter(QStringList &error)
         ret = false;
     }
 
-    query.prepare("SELECT id, receiptNum, data FROM dep ORDER BY id");
+    /* depId -> counter, hash */
+    QMap<int, QPair<qlonglong, QByteArray> > checkpoints;
+    int lastCheckpoint = 0;
+    qlonglong counter = 0;
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+
+    if (!full) {
+        query.prepare("SELECT depId, counter, hash FROM depCheckpoints ORDER BY depId DESC LIMIT 1");
+        query.exec();
+        if (query.next()) {
+            int depId = query.value("depId").toInt();
+            qlonglong checkpointCounter = query.value("counter").toLongLong();
+            QByteArray checkpointHash = query.value("hash").toByteArray();
+
+            /* the checkpoint must still match the DEP-7 entry it points to.
+             * Storno entries carry no encrypted counter, then the last entry
+             * which has one is decrypted and the storno turnovers are added */
+            query.prepare("SELECT id, data FROM dep WHERE id <= :id ORDER BY id DESC");
+            query.bindValue(":id", depId);
+            query.exec();
+            bool valid = query.next() && query.value("id").toInt() == depId;
+            qlonglong stornoTurnover = 0;
+            while (valid) {
+                QStringList list = RKSignatureModule::base64Url_decode(query.value("data").toString().split('.').at(1)).split('_');
+                QString encTOC = list.at(10);
+                if (encTOC != "U1RP") {
+                    valid = (sm->decryptTurnoverCounter(list.at(2) + list.at(3), encTOC, key).toLongLong() + stornoTurnover == checkpointCounter);
+                    break;
+                }
+                stornoTurnover += depTurnover(list);
+                valid = query.next();
+            }
+
+            if (valid) {
+                lastCheckpoint = depId;
+                counter = checkpointCounter;
+                hash.addData(checkpointHash);
+            } else {
+                qWarning() << "Function Name: " << Q_FUNC_INFO << " checkpoint " << depId << " does not match the DEP-7, full verification";
+                full = true;
+            }
+        }
+    }
+
+    if (full) {
+        query.prepare("SELECT depId, counter, hash FROM depCheckpoints ORDER BY depId");
+        query.exec();
+        while (query.next())
+            checkpoints.insert(query.value("depId").toInt(), qMakePair(query.value("counter").toLongLong(), query.value("hash").toByteArray()));
+    }
+
+    query.prepare("SELECT id, receiptNum, data FROM dep WHERE id > :id ORDER BY id");
+    query.bindValue(":id", lastCheckpoint);
     query.exec();
 
-    qlonglong counter = 0;
+    int lastId = lastCheckpoint;
     while(query.next()) {
-        QString payload = RKSignatureModule::base64Url_decode(query.value("data").toString().split('.').at(1));
+        QString data = query.value("data").toString();
+        QString payload = RKSignatureModule::base64Url_decode(data.split('.').at(1));
         QStringList list = payload.split('_');
-        qlonglong counter2 = 0;
         QString con = list.at(2) + list.at(3);
         QString encTOC = list.at(10);
         QString serial = list.at(11);
@@ -379,23 +368,47 @@ bool Utils::checkTurnOverCounter(QStringList &error)
 
         if (serial.isEmpty())
             error.append(QObject::tr("Fehlende Seriennummer bei BON %1").arg(receiptNum));
-        QString decTOC = sm->decryptTurnoverCounter(con, encTOC, key);
-        for (int y = 5; y < 10; y++) {
-            QString current = list.at(y);
-            counter2 += current.replace(",","").toLongLong();
-        }
-        counter += counter2;
+        counter += depTurnover(list);
 //        qDebug() << "#" << list.at(3) << "decTOC " << decTOC << " Counter " << counter << " L:" << list;
         QString newEncTOC = sm->encryptTurnoverCounter(con,counter,key);
 
         if (newEncTOC.compare(encTOC) != 0) {
             if (encTOC != "U1RP") {
+                QString decTOC = sm->decryptTurnoverCounter(con, encTOC, key);
                 error.append(QObject::tr("Fehler beim Umsatzzähler für BON %1, Wert=%2 statt %3").arg(receiptNum).arg(decTOC).arg(counter));
                 ret = false;
             }
         }
+
+        lastId = query.value("id").toInt();
+        hash.addData(data.toUtf8());
+
+        if (checkpoints.contains(lastId)) {
+            QByteArray result = hash.result().toHex();
+            QPair<qlonglong, QByteArray> checkpoint = checkpoints.value(lastId);
+            if (checkpoint.first != counter || checkpoint.second != result) {
+                error.append(QObject::tr("DEP-7 Prüfpunkt bei Eintrag %1 stimmt nicht mit den Daten überein.").arg(lastId));
+                ret = false;
+            }
+            lastCheckpoint = lastId;
+            hash.reset();
+            hash.addData(result);
+        }
     }
     delete sm;
+
+    if (ret && error.isEmpty() && lastId > lastCheckpoint) {
+        query.prepare("INSERT INTO depCheckpoints (depId, counter, hash, timestamp) VALUES (:depId, :counter, :hash, :timestamp)");
+        query.bindValue(":depId", lastId);
+        query.bindValue(":counter", counter);
+        query.bindValue(":hash", QString::fromLatin1(hash.result().toHex()));
+        query.bindValue(":timestamp", QDateTime::currentDateTime().toString(Qt::ISODate));
+        if (!query.exec()) {
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+            qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        }
+    }
+
     return ret;
 }
 
@@ -409,6 +422,54 @@ QString Utils::normalizeNumber(QString value)
     return value.replace(",", "");
 }
 
+/**
+ * @brief Utils::parseDecimal
+ * single pass variant of normalizeNumber and isNumber: the last '.' or ','
+ * is the decimal separator, all others are grouping separators.
+ * @param value e.g. "1.234,50"
+ * @param decimal receives the exact decimal string, e.g. "1234.50"
+ * @return false if value is not a plain decimal number
+ */
+bool Utils::parseDecimal(const QString &value, QString &decimal)
+{
+    const QChar *begin = value.constData();
+    const QChar *end = begin + value.size();
+    while (begin < end && begin->isSpace())
+        begin++;
+    while (end > begin && (end - 1)->isSpace())
+        end--;
+
+    decimal.resize(0);
+    if (begin == end)
+        return false;
+
+    if (*begin == QLatin1Char('-') || *begin == QLatin1Char('+')) {
+        if (*begin == QLatin1Char('-'))
+            decimal.append(*begin);
+        begin++;
+    }
+
+    const QChar *separator = 0;
+    for (const QChar *p = begin; p < end; p++)
+        if (*p == QLatin1Char('.') || *p == QLatin1Char(','))
+            separator = p;
+
+    int digits = 0;
+    for (const QChar *p = begin; p < end; p++) {
+        ushort c = p->unicode();
+        if (c >= '0' && c <= '9') {
+            decimal.append(*p);
+            digits++;
+        } else if (p == separator) {
+            decimal.append(QLatin1Char('.'));
+        } else if (c != '.' && c != ',') {
+            return false;
+        }
+    }
+
+    return digits > 0;
+}
+
 QString Utils::color_best_contrast(QString color){
     bool hash = false;
     bool ok;
@@ -487,10 +548,20 @@ QPixmap Utils::getQRCode(int id, bool &isDamaged )
     if (id < 1)
         return QPixmap();
 
+    return getQRCode(Utils::getReceiptSignature(id,true), isDamaged);
+}
+
+/**
+ * @brief Utils::getQRCode
+ * @param signature full DEP signature (JWS compact) of the receipt
+ * @param isDamaged
+ * @return
+ */
+QPixmap Utils::getQRCode(const QString &signature, bool &isDamaged)
+{
     isDamaged = false;
 
     QString qr_code_rep = "";
-    QString signature = Utils::getReceiptSignature(id,true);
     if (signature.split('.').size() == 3) {
         qr_code_rep = signature.split('.').at(1);
         qr_code_rep = RKSignatureModule::base64Url_decode(qr_code_rep);
@@ -39,21 +39,24 @@ class QRK_EXPORT Utils
 
     QString getSignature(QJsonObject data);
 
-    static bool checkTurnOverCounter(QStringList &error);
+    static bool checkTurnOverCounter(QStringList &error, bool full = false);
     static double getYearlyTotal(int year);
     static qlonglong getTurnOverCounter(RKSignatureModule *sm, QString &lastSerial, bool &error);
+    static qlonglong getTurnOverCounter(RKSignatureModule *sm, const QString &lastReceiptSignature, QString &lastSerial, bool &error);
     static bool isDirectoryWritable(QString path);
     static QString getReceiptSignature(int id, bool full = false);
     static QString getLastReceiptSignature();
     static QString getReceiptShortJson(QJsonObject obj);
     static QString wordWrap(QString text, int width, QFont font);
     static QString normalizeNumber(QString value);
+    static bool parseDecimal(const QString &value, QString &decimal);
     static QString color_best_contrast(QString color);
     static QString taxRoundUp(double value,unsigned short np);
     static double getTax(double value, double tax, bool net = false);
     static double getNet(double gross, double tax);
     static double getGross(double net, double tax);
     static QPixmap getQRCode(int id, bool &isDamaged);
+    static QPixmap getQRCode(const QString &signature, bool &isDamaged);
     static void diskSpace(QString path, qint64 &size, qint64 &bytesAvailable, double &percent);
     static bool isNumber(QVariant number);
     static bool compareNames(const QString& s1,const QString& s2);
@@ -23,6 +23,7 @@
 #include "exportjournal.h"
 #include "exportdialog.h"
 #include "database.h"
+#include "journalpartitions.h"
 #include "singleton/spreadsignal.h"
 #include "3rdparty/ckvsoft/rbac/crypto.h"
 
@@ -74,7 +75,7 @@ bool ExportJournal::journalExport(QString outputFilename, QString from, QString
     // Point a QTextStream object at the file
     QTextStream outStream(&outputFile);
 
-    QSqlDatabase dbc = Database::database();
+    QSqlDatabase dbc = Database::readOnlyDatabase(true);
     QSqlQuery query(dbc);
 
     query.prepare(QString("SELECT data FROM journal WHERE id < 5"));
@@ -87,37 +88,37 @@ bool ExportJournal::journalExport(QString outputFilename, QString from, QString
         outStream << data + '\n';
     }
 
-    query.prepare(QString("SELECT version, cashregisterid, data FROM journal WHERE datetime BETWEEN :fromDate AND :toDate AND id > 4"));
-    query.bindValue(":fromDate", from);
-    query.bindValue(":toDate", to);
-
-    query.exec();
+    // older years may live in archived partitions, read them oldest first
+    JournalPartitions partitions(dbc);
     int i = 0;
-    int numberOfRows = 0;
-    if(query.last())
-    {
-        numberOfRows =  query.at() + 1;
-        query.first();
-        query.previous();
-    }
-
-    while (query.next())
-    {
-        i++;
-        Spread::Instance()->setProgressBarValue(((float)i / (float)numberOfRows) * 100);
-        QString data = query.value("data").toString();
-        data = Crypto::decrypt(data, SecureByteArray("Journal"));
-        QStringList datalist = data.split('\t');
-
-        int j = 0;
-        foreach (const QString &str, datalist) {
-            datalist[j] = QString("\"%1\"").arg(str);
-            j++;
+    int numberOfRows = partitions.count(from, to);
+
+    foreach (int year, partitions.years(from, to)) {
+        QSqlQuery yearQuery(dbc);
+        if (!partitions.select(yearQuery, year, "version, cashregisterid, data", from, to)) {
+            outputFile.close();
+            Spread::Instance()->setProgressBarValue(-1);
+            return false;
         }
-        data = datalist.join(';');
 
-        QString s = QString("%1;%2;%3;%4\n").arg(i).arg(query.value("version").toString()).arg(query.value("cashregisterid").toString()).arg(data);
-        outStream << s;
+        while (yearQuery.next())
+        {
+            i++;
+            Spread::Instance()->setProgressBarValue(((float)i / (float)numberOfRows) * 100);
+            QString data = yearQuery.value("data").toString();
+            data = Crypto::decrypt(data, SecureByteArray("Journal"));
+            QStringList datalist = data.split('\t');
+
+            int j = 0;
+            foreach (const QString &str, datalist) {
+                datalist[j] = QString("\"%1\"").arg(str);
+                j++;
+            }
+            data = datalist.join(';');
+
+            QString s = QString("%1;%2;%3;%4\n").arg(i).arg(yearQuery.value("version").toString()).arg(yearQuery.value("cashregisterid").toString()).arg(data);
+            outStream << s;
+        }
     }
     outStream.flush();
     // Close the file
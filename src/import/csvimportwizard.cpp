@@ -32,16 +32,18 @@ CsvImportWizard::CsvImportWizard(QWidget *parent) :
     m_model = new QStandardItemModel();
     m_assignmentModel = new QStandardItemModel();
     m_map = new QMap<QString, QVariant>;
+    m_source = new CsvImportSource;
 
     m_pageImport = new CsvImportWizardPage1(this);
     m_pageAssign = new CsvImportWizardPage2(this);
     m_pageSave = new CsvImportWizardPage3(this);
 
     m_pageImport->setModel(m_model);
+    m_pageImport->setSource(m_source);
     m_pageAssign->setModel(m_model);
     m_pageAssign->setMap(m_map);
     m_pageAssign->setAssignmentModel(m_assignmentModel);
-    m_pageSave->setModel(m_model);
+    m_pageSave->setSource(m_source);
     m_pageSave->setMap(m_map);
 
     addPage(m_pageImport);
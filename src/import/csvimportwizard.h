@@ -23,6 +23,8 @@
 #ifndef CSVIMPORTWIZARD_H
 #define CSVIMPORTWIZARD_H
 
+#include "csvreader.h"
+
 #include <QWizard>
 #include <QStandardItem>
 
@@ -45,6 +47,7 @@ class CsvImportWizard : public QWizard
     QStandardItemModel *m_model;
     QStandardItemModel *m_assignmentModel;
     QMap<QString, QVariant> *m_map;
+    CsvImportSource *m_source;
 
 };
 
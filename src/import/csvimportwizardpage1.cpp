@@ -27,16 +27,16 @@
 #include <QStandardItemModel>
 #include <QFile>
 #include <QFileInfo>
-#include <QTextStream>
 #include <QFileDialog>
 #include <QTimer>
 #include <QProgressDialog>
 #include <QThread>
-#include <QTextCodec>
 
 CsvImportWizardPage1::CsvImportWizardPage1(QWidget *parent)
     : QWizardPage(parent)
     , ui(new Ui::CsvImportWizardPage1)
+    , m_source(Q_NULLPTR)
+    , m_thread(Q_NULLPTR)
 {
     ui->setupUi(this);
     m_timer = new QTimer(this);
@@ -68,6 +68,8 @@ CsvImportWizardPage1::CsvImportWizardPage1(QWidget *parent)
 
 CsvImportWizardPage1::~CsvImportWizardPage1()
 {
+    if (m_load)
+        m_load->cancel();
     delete ui;
     m_timer->stop();
 }
@@ -142,6 +144,11 @@ void CsvImportWizardPage1::setModel(QStandardItemModel *model)
 
 }
 
+void CsvImportWizardPage1::setSource(CsvImportSource *source)
+{
+    m_source = source;
+}
+
 void CsvImportWizardPage1::codecChanged(QString codec)
 {
     m_codec = codec;
@@ -271,16 +278,36 @@ void CsvImportWizardPage1::loadCsvFile(QString text)
         m_isFileLoaded = false;
         emit completeChanged();
         m_model->clear();
-        m_load = new LoadCsvFile(ui->filePathEdit->text(), m_delimiter, ui->textSeperatorBox->currentText(), ui->firstRowIsHeaderCheckBox->isChecked(), ui->fromLineSpinBox->value(), ui->toLineSpinBox->value(), m_codec);
+
+        /* a running preview belongs to the old settings */
+        if (m_load) {
+            disconnect(m_load, 0, this, 0);
+            m_load->cancel();
+        }
+
+        m_source->filename = ui->filePathEdit->text();
+        m_source->delimiter = m_delimiter;
+        m_source->textDelimiter = ui->textSeperatorBox->currentText();
+        m_source->firstRowIsHeader = ui->firstRowIsHeaderCheckBox->isChecked();
+        m_source->fromLine = ui->fromLineSpinBox->value();
+        m_source->toLine = ui->toLineSpinBox->value();
+        m_source->codec = m_codec;
+
+        QrkSettings settings;
+        int previewRows = settings.value("CsvImportWizard/previewrows", 200).toInt();
+
+        m_load = new LoadCsvFile(*m_source, previewRows);
         m_thread = new QThread;
         m_load->moveToThread(m_thread);
 
         connect(m_thread, &QThread::started, m_load, &LoadCsvFile::run);
         connect(m_load, &LoadCsvFile::percentChanged, ui->progressBar, &QProgressBar::setValue);
-        connect(m_load, &LoadCsvFile::addHeader, this, &CsvImportWizardPage1::addHeader);
-        connect(m_load, &LoadCsvFile::addItem, this, &CsvImportWizardPage1::addItem);
+        connect(m_load, &LoadCsvFile::setHeader, this, &CsvImportWizardPage1::setHeader);
+        connect(m_load, &LoadCsvFile::addRow, this, &CsvImportWizardPage1::addRow);
+        connect(m_load, &LoadCsvFile::rowCount, this, &CsvImportWizardPage1::setRowCount);
         connect(m_load, &LoadCsvFile::finished, this, &CsvImportWizardPage1::fileLoadFinished);
         connect(m_load, &LoadCsvFile::finished, this, &CsvImportWizardPage1::completeChanged);
+        connect(m_load, &LoadCsvFile::finished, m_thread, &QThread::quit);
         connect(m_load, &LoadCsvFile::finished, m_load, &LoadCsvFile::deleteLater);
         connect(m_thread, &QThread::finished, m_thread, &QThread::deleteLater);
 
@@ -291,160 +318,85 @@ void CsvImportWizardPage1::loadCsvFile(QString text)
 void CsvImportWizardPage1::fileLoadFinished()
 {
     m_isFileLoaded = true;
-    m_load = 0;
-    m_thread = 0;
+    m_load = Q_NULLPTR;
+    m_thread = Q_NULLPTR;
     m_timer->stop();
     ui->tableView->resizeColumnsToContents();
 }
 
-void CsvImportWizardPage1::addHeader(int count, int section, QString value)
+void CsvImportWizardPage1::setHeader(QStringList header)
 {
-    if (m_model->columnCount() < count)
-        m_model->setColumnCount(count);
+    if (m_model->columnCount() < header.size())
+        m_model->setColumnCount(header.size());
 
-    m_model->setHeaderData(section, Qt::Horizontal, value);
-    ui->tableView->resizeColumnsToContents();
+    m_model->setHorizontalHeaderLabels(header);
 }
 
-void CsvImportWizardPage1::addItem(int lineindex, int j, QString value)
+void CsvImportWizardPage1::addRow(int row, QStringList values)
 {
-    QStandardItem *item = new QStandardItem(value);
+    for (int j = 0; j < values.size(); j++)
+        m_model->setItem(row, j, new QStandardItem(values.at(j)));
+}
 
-    m_model->setItem(lineindex, j, item);
-    ui->toLineSpinBox->setValue(lineindex + 1);
+void CsvImportWizardPage1::setRowCount(int count)
+{
+    // toLine is a line number, the rows are counted from fromLine on
+    int toLine = ui->fromLineSpinBox->value() - 1 + count;
+    ui->toLineSpinBox->setValue(qMin(toLine, ui->toLineSpinBox->maximum()));
 }
 
 //---- LoadCsvFile ------------------------------------------------------------------------------------------------------
 
-LoadCsvFile::LoadCsvFile(QString filename, QString delimiter, QString textDelimiter, bool firstRowIsHeader, int fromLine, int toLine, const QString codec)
-    : m_filename(filename)
-    , m_delimiter(delimiter)
-    , m_textDelimiter(textDelimiter)
-    , m_firstRowIsHeader(firstRowIsHeader)
-    , m_fromLine(fromLine)
-    , m_toLine(toLine)
-    , m_codec(codec)
+LoadCsvFile::LoadCsvFile(const CsvImportSource &source, int previewRows)
+    : m_source(source)
+    , m_previewRows(previewRows)
+    , m_canceled(0)
 {
 }
+
 LoadCsvFile::~LoadCsvFile()
 {
 }
 
-void LoadCsvFile::run()
+void LoadCsvFile::cancel()
 {
-    QFile file(m_filename);
-
-    m_fromLine--;
-    m_toLine--;
-    if (m_toLine == 0)
-        m_toLine = 99999;
-
-    if (file.open(QIODevice::ReadOnly)) {
-        int lineindex = 0;      // file line counter
-        QTextStream in(&file);  // read to text stream
-        in.setCodec(QTextCodec::codecForName(m_codec.toUtf8()));
-        QFileInfo fi(file);
-        qint64 currsize = 0;
-        bool headerwritten = false;
-
-        while (!in.atEnd()) {
-            if (m_fromLine > lineindex) {
-                lineindex++;
-                in.readLine();
-                continue;
-            }
-            if (m_toLine < lineindex)
-                break;
-
-            QString fileLine = in.readLine();
-
-            currsize += fileLine.size() + 2;
-            int percent = ((float)currsize / (float)fi.size()) * 100;
-            if (percent < ((float)lineindex / (float)m_toLine) * 100)
-                percent = ((float)lineindex / (float)m_toLine) * 100;
-
-            emit percentChanged(percent);
-
-            QStringList lineToken = parseCSV(fileLine.trimmed());
-
-            for (int j = 0; j < lineToken.size(); j++) {
-                QString value = lineToken.at(j);
-                if (m_firstRowIsHeader && !headerwritten)
-                    emit addHeader(lineToken.size(), j, value);
-                else {
-                    if (!headerwritten)
-                        emit addHeader(lineToken.size(), j, QString::number(j));
+    m_canceled.store(1);
+}
 
-                    emit addItem(lineindex - m_fromLine, j, value);
-                }
+/**
+ * @brief LoadCsvFile::run
+ * reads only the first m_previewRows rows for the column assignment. The
+ * remaining lines are counted but not parsed, the import streams the file
+ * again (see ImportData::run).
+ */
+void LoadCsvFile::run()
+{
+    CsvReader reader(m_source);
+
+    if (reader.open()) {
+        QStringList header = reader.header();
+        if (!header.isEmpty())
+            emit setHeader(header);
+
+        QStringList row;
+        int rowindex = 0;
+        while (rowindex < m_previewRows && !m_canceled.load() && reader.nextRow(row)) {
+            if (rowindex == 0 && header.isEmpty()) {
+                for (int j = 0; j < row.size(); j++)
+                    header << QString::number(j);
+                emit setHeader(header);
             }
 
-
-            if (!headerwritten && lineindex == 0) {
-                headerwritten = true;
-                if (!m_firstRowIsHeader)
-                    lineindex++;
-            } else
-                lineindex++;
+            emit addRow(rowindex++, row);
+            emit percentChanged(reader.percent());
         }
 
-        file.close();
-        emit percentChanged(100);
-        emit finished();
-    }
-}
+        if (!m_canceled.load())
+            emit rowCount(reader.linesRead() + reader.countRemainingLines());
 
-QStringList LoadCsvFile::parseCSV(const QString& string)
-{
-    enum State { Normal,
-                 Quote } state = Normal;
-    QStringList fields;
-    QString value;
-
-    for (int i = 0; i < string.size(); i++) {
-        QChar current = string.at(i);
-
-        // Normal state
-        if (state == Normal) {
-            // delimiter
-            if (current == m_delimiter && m_delimiter != m_textDelimiter) {
-                // Save field
-                fields.append(value);
-                value.clear();
-            }
-            // delimitor == textDelimiter
-            else if (current == m_textDelimiter) {
-                state = Quote;
-            }
-            // Other character
-            else {
-                value += current;
-            }
-        }
-        // In-quote state
-        else if (state == Quote) {
-            // Another textDelimiter
-            if (current == m_textDelimiter) {
-                if (i + 1 < string.size()) {
-                    QChar next = string.at(i + 1);
-
-                    // A double textDelimiter?
-                    if (next == m_textDelimiter) {
-                        value += m_textDelimiter;
-                        i++;
-                    } else {
-                        state = Normal;
-                    }
-                }
-            }
-            // Other character
-            else {
-                value += current;
-            }
-        }
+        reader.close();
     }
-    if (!value.isEmpty())
-        fields.append(value);
 
-    return fields;
+    emit percentChanged(100);
+    emit finished();
 }
@@ -23,8 +23,12 @@
 #ifndef CSVIMPORTWIZARDPAGE1_H
 #define CSVIMPORTWIZARDPAGE1_H
 
+#include "csvreader.h"
+
 #include <QStandardItemModel>
 #include <QWizardPage>
+#include <QPointer>
+#include <QAtomicInt>
 #include "ui_csvimportwizardpage1.h"
 
 class QStandardItem;
@@ -47,6 +51,7 @@ class CsvImportWizardPage1 : public QWizardPage
     ~CsvImportWizardPage1();
     bool isComplete() const;
     void setModel(QStandardItemModel *model);
+    void setSource(CsvImportSource *source);
 
  public:
     void csvPathTextChanged(QString text);
@@ -54,8 +59,9 @@ class CsvImportWizardPage1 : public QWizardPage
     void otherDelimiterChanged();
     void fileLoadClicked(bool);
     void fileLoadFinished();
-    void addItem(int, int, QString);
-    void addHeader(int count, int section, QString value);
+    void addRow(int row, QStringList values);
+    void setHeader(QStringList header);
+    void setRowCount(int count);
     void checkBoxToogled(int, bool);
     void firstRowCheckBoxToogled(bool);
     void fromValueChanged(int);
@@ -76,11 +82,12 @@ class CsvImportWizardPage1 : public QWizardPage
 
     QTimer *m_timer;
     QStandardItemModel *m_model;
+    CsvImportSource *m_source;
     QString m_delimiter;
     QString m_textDelimiter;
     QString m_codec;
     bool m_isFileLoaded;
-    LoadCsvFile *m_load;
+    QPointer<LoadCsvFile> m_load;
     QThread *m_thread;
     int m_fromLine;
     int m_toLine;
@@ -92,29 +99,24 @@ class LoadCsvFile : public QObject
     Q_OBJECT
 
   public:
-    LoadCsvFile(QString filename, QString delimiter, QString textDelimiter, bool firstRowIsHeader, int fromLine, int toLine, const QString codec);
+    LoadCsvFile(const CsvImportSource &source, int previewRows);
     ~LoadCsvFile();
+    void cancel();
 
   public slots:
     void run();
 
   signals:
     void percentChanged(int percent);
-    void addHeader(int, int, QString);
-    void addItem(int, int, QString);
+    void setHeader(QStringList);
+    void addRow(int, QStringList);
+    void rowCount(int);
     void finished();
 
   private:
-    QStringList parseCSV(const QString &string);
-
-    QString m_filename;
-    QString m_delimiter;
-    QString m_textDelimiter;
-
-    bool m_firstRowIsHeader;
-    int m_fromLine;
-    int m_toLine;
-    QString m_codec;
+    CsvImportSource m_source;
+    int m_previewRows;
+    QAtomicInt m_canceled;
 
 };
 
@@ -24,6 +24,7 @@
 #include "ui_csvimportwizardpage3.h"
 #include "database.h"
 #include "backup.h"
+#include "utils/metrics.h"
 
 #include <QTableView>
 #include <QSqlQuery>
@@ -66,10 +67,9 @@ void CsvImportWizardPage3::initializePage()
 
 }
 
-void CsvImportWizardPage3::setModel(QStandardItemModel *model)
+void CsvImportWizardPage3::setSource(CsvImportSource *source)
 {
-    m_model =  model;
-
+    m_source = source;
 }
 
 void CsvImportWizardPage3::setMap(QMap<QString, QVariant> *map)
@@ -100,7 +100,7 @@ void CsvImportWizardPage3::save(bool)
     emit info(tr("Backup der Daten fertig."));
     emit completeChanged();
     emit info(tr("Der DatenImport wurde gestarted."));
-    ImportData *import = new ImportData(m_model, m_map, m_ignoreExistingProduct, m_guessGroup, m_autoGroup, m_visibleGroup, m_visibleProduct, m_updateExistingProduct);
+    ImportData *import = new ImportData(*m_source, m_map, m_ignoreExistingProduct, m_guessGroup, m_autoGroup, m_visibleGroup, m_visibleProduct, m_updateExistingProduct);
     QThread *thread = new QThread;
     import->moveToThread(thread);
 
@@ -117,9 +117,9 @@ void CsvImportWizardPage3::save(bool)
 
 //---- ImportData ------------------------------------------------------------------------------------------------------
 
-ImportData::ImportData(QStandardItemModel *model, QMap<QString, QVariant> *map, bool ignoreExistingProduct, bool guessGroup, bool autoGroup,  bool visibleGroup, bool visibleProduct, bool updateExistingProduct)
+ImportData::ImportData(const CsvImportSource &source, QMap<QString, QVariant> *map, bool ignoreExistingProduct, bool guessGroup, bool autoGroup,  bool visibleGroup, bool visibleProduct, bool updateExistingProduct)
 {
-    m_model = model;
+    m_source = source;
     m_map = map;
     m_autoGroup = autoGroup;
     m_guessGroup = guessGroup;
@@ -135,17 +135,24 @@ ImportData::~ImportData()
 
 void ImportData::run()
 {
+    MetricsTimer timer("import.csv");
     QSqlDatabase dbc = Database::database();
     QSqlQuery query(dbc);
-    dbc.transaction();
 
-    int count = m_model->rowCount();
-    // count = 100; /* for testing */
+    /* the preview model holds only the first rows, stream the whole file */
+    CsvReader reader(m_source);
+    if (!reader.open()) {
+        emit info(tr("Die Datei %1 konnte nicht geöffnet werden.").arg(m_source.filename));
+        emit finished();
+        return;
+    }
 
-    for (int row = 0; row < count; row++) {
+    dbc.transaction();
 
-        int percent = ((float)row / (float)count) * 100;
-        emit percentChanged(percent);
+    QStringList row;
+    while (reader.nextRow(row)) {
+
+        emit percentChanged(reader.percent());
 
         QString itemnum = getItemValue(row, m_map->value(tr("Artikelnummer")).toInt());
         QString barcode = getItemValue(row, m_map->value(tr("Barcode")).toInt());
@@ -255,22 +262,17 @@ void ImportData::run()
 
 }
 
-QString ImportData::getItemValue(int row, int col, bool replace)
+QString ImportData::getItemValue(const QStringList &row, int col, bool replace)
 {
     col--;
-    if (col >= 0) {
-        QStandardItem *item;
-        item = m_model->item(row, col);
-        if (!item)
-            return "";
-
+    if (col >= 0 && col < row.size()) {
+        QString text = row.at(col);
         if (replace)
-            return item->text().remove(QRegExp("[^0-9,.]")).replace(",",".");
+            return text.remove(QRegExp("[^0-9,.]")).replace(",",".");
 
-        QString text = item->text();
         if (text.isNull())
             return "";
-        return item->text();
+        return text;
     }
 
     return "";
@@ -23,9 +23,10 @@
 #ifndef CSVIMPORTWIZARDPAGE3_H
 #define CSVIMPORTWIZARDPAGE3_H
 
+#include "csvreader.h"
+
 #include <QWizardPage>
 #include <QMap>
-#include <QStandardItemModel>
 
 namespace Ui {
   class CsvImportWizardPage3;
@@ -39,7 +40,7 @@ class CsvImportWizardPage3 : public QWizardPage
     explicit CsvImportWizardPage3(QWidget *parent = 0);
     ~CsvImportWizardPage3();
     bool isComplete() const;
-    void setModel(QStandardItemModel *model);
+    void setSource(CsvImportSource *source);
     void setMap(QMap<QString, QVariant> *m);
 
   private slots:
@@ -50,7 +51,7 @@ class CsvImportWizardPage3 : public QWizardPage
   private:
     Ui::CsvImportWizardPage3 *ui;
     void initializePage();
-    QStandardItemModel *m_model;
+    CsvImportSource *m_source;
     QMap<QString, QVariant> *m_map;
     bool m_autoGroup;
     bool m_guessGroup;
@@ -68,7 +69,7 @@ class ImportData : public QObject
     Q_OBJECT
 
   public:
-    ImportData(QStandardItemModel *model, QMap<QString, QVariant> *map, bool ignoreExistingProduct = false, bool guessGroup = false, bool autogroup = false,  bool visibleGroup = false, bool visibleProduct = false, bool updateExistingProduct = false);
+    ImportData(const CsvImportSource &source, QMap<QString, QVariant> *map, bool ignoreExistingProduct = false, bool guessGroup = false, bool autogroup = false,  bool visibleGroup = false, bool visibleProduct = false, bool updateExistingProduct = false);
     ~ImportData();
 
     void run();
@@ -79,14 +80,14 @@ class ImportData : public QObject
     void info(QString);
 
   private:
-    QString getItemValue(int roe, int col, bool replace = false);
+    QString getItemValue(const QStringList &row, int col, bool replace = false);
     int exists(QString itemnum, QString barcode, QString name);
     QString getGuessGroup(QString name);
     int createGroup(QString name);
     QString getGroupById(int id);
     int getGroupByName(QString name);
 
-    QStandardItemModel *m_model;
+    CsvImportSource m_source;
     QMap<QString, QVariant> *m_map;
 
     bool m_ignoreExistingProduct;
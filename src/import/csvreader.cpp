@@ -0,0 +1,338 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "csvreader.h"
+
+#include <QTextCodec>
+#include <QDebug>
+
+#include <cstring>
+#include <climits>
+
+CsvReader::CsvReader(const CsvImportSource &source)
+    : m_source(source)
+    , m_codec(Q_NULLPTR)
+    , m_data(Q_NULLPTR)
+    , m_size(0)
+    , m_pos(0)
+    , m_linesRead(0)
+    , m_linesLeft(0)
+{
+}
+
+CsvReader::~CsvReader()
+{
+    close();
+}
+
+/**
+ * @brief CsvReader::open
+ * maps the file into memory. If mapping is not possible (empty file, special
+ * filesystems) the content is read into a buffer as fallback.
+ * @return
+ */
+bool CsvReader::open()
+{
+    close();
+
+    m_file.setFileName(m_source.filename);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << m_file.errorString();
+        return false;
+    }
+
+    m_size = m_file.size();
+    m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+    if (!m_data) {
+        m_buffer = m_file.readAll();
+        m_data = m_buffer.constData();
+        m_size = m_buffer.size();
+    }
+
+    m_codec = QTextCodec::codecForName(m_source.codec.toUtf8());
+    if (!m_codec)
+        m_codec = QTextCodec::codecForName("UTF-8");
+
+    m_pos = 0;
+    detectLineBreaks();
+
+    const char *begin;
+    int length;
+    for (int i = 1; i < m_source.fromLine; i++)
+        if (!nextLine(begin, length))
+            break;
+
+    m_linesRead = 0;
+    m_linesLeft = (m_source.toLine <= 1) ? INT_MAX : m_source.toLine - qMax(m_source.fromLine, 1) + 1;
+
+    m_header.clear();
+    if (m_source.firstRowIsHeader)
+        readLine(m_header, length);
+
+    return true;
+}
+
+void CsvReader::close()
+{
+    if (m_file.isOpen()) {
+        if (m_buffer.isEmpty() && m_data)
+            m_file.unmap(reinterpret_cast<uchar *>(const_cast<char *>(m_data)));
+        m_file.close();
+    }
+    m_buffer.clear();
+    m_data = Q_NULLPTR;
+    m_size = 0;
+    m_pos = 0;
+    m_header.clear();
+    m_linesRead = 0;
+    m_linesLeft = 0;
+}
+
+bool CsvReader::atEnd() const
+{
+    return m_pos >= m_size;
+}
+
+int CsvReader::percent() const
+{
+    if (m_size <= 0)
+        return 100;
+
+    return int((m_pos * 100) / m_size);
+}
+
+/**
+ * @brief CsvReader::detectLineBreaks
+ * skips a byte order mark and encodes '\n' and '\r' with the codec. Wide
+ * encodings are decoded with the explicit endianness of the line break, so
+ * the lines (which carry no BOM) are read the same way.
+ */
+void CsvReader::detectLineBreaks()
+{
+    static const struct { const char *bom; int size; int unit; const char *codec; } boms[] = {
+        { "\xFF\xFE\x00\x00", 4, 4, "UTF-32LE" },
+        { "\x00\x00\xFE\xFF", 4, 4, "UTF-32BE" },
+        { "\xFF\xFE", 2, 2, "UTF-16LE" },
+        { "\xFE\xFF", 2, 2, "UTF-16BE" },
+        { "\xEF\xBB\xBF", 3, 1, Q_NULLPTR }
+    };
+
+    QString lineBreaks("\n\r");
+    QTextCodec::ConverterState state(QTextCodec::IgnoreHeader);
+    QByteArray encoded = m_codec->fromUnicode(lineBreaks.constData(), lineBreaks.size(), &state);
+    int unit = qMax(1, encoded.size() / 2);
+
+    for (const auto &bom : boms) {
+        if (bom.unit == unit && m_size >= bom.size && std::memcmp(m_data, bom.bom, size_t(bom.size)) == 0) {
+            m_pos = bom.size;
+            if (bom.codec)
+                m_codec = QTextCodec::codecForName(bom.codec);
+            break;
+        }
+    }
+
+    if (unit > 1 && m_pos == 0) {
+        // no BOM, pin the endianness the codec writes
+        bool little = encoded.at(0) == '\n';
+        if (unit == 2)
+            m_codec = QTextCodec::codecForName(little ? "UTF-16LE" : "UTF-16BE");
+        else
+            m_codec = QTextCodec::codecForName(little ? "UTF-32LE" : "UTF-32BE");
+    }
+
+    QTextCodec::ConverterState pinned(QTextCodec::IgnoreHeader);
+    encoded = m_codec->fromUnicode(lineBreaks.constData(), lineBreaks.size(), &pinned);
+    m_newline = encoded.left(unit);
+    m_carriageReturn = encoded.mid(unit, unit);
+}
+
+/**
+ * @brief CsvReader::findLineBreak
+ * @param from offset of a code unit
+ * @return offset of the next line break or m_size
+ */
+qint64 CsvReader::findLineBreak(qint64 from) const
+{
+    int unit = m_newline.size();
+    if (unit == 1) {
+        const char *nl = static_cast<const char *>(std::memchr(m_data + from, '\n', size_t(m_size - from)));
+        return nl ? nl - m_data : m_size;
+    }
+
+    for (qint64 pos = from; pos + unit <= m_size; pos += unit)
+        if (std::memcmp(m_data + pos, m_newline.constData(), size_t(unit)) == 0)
+            return pos;
+
+    return m_size;
+}
+
+bool CsvReader::nextLine(const char *&begin, int &length)
+{
+    if (atEnd())
+        return false;
+
+    int unit = m_newline.size();
+    begin = m_data + m_pos;
+    qint64 end = findLineBreak(m_pos);
+
+    length = int(end - m_pos);
+    m_pos = end + unit;
+
+    if (length >= unit && std::memcmp(begin + length - unit, m_carriageReturn.constData(), size_t(unit)) == 0)
+        length -= unit;
+
+    return true;
+}
+
+/**
+ * @brief CsvReader::readLine
+ * an odd number of text delimiters leaves a quoted field open, the line
+ * break belongs to the field and the next line is appended.
+ * @param row
+ * @param lines number of lines read for this row
+ * @return false at end of file
+ */
+bool CsvReader::readLine(QStringList &row, int &lines)
+{
+    const char *begin;
+    int length;
+    if (!nextLine(begin, length))
+        return false;
+
+    QString record = m_codec->toUnicode(begin, length);
+    lines = 1;
+
+    if (!m_source.textDelimiter.isEmpty()) {
+        int quotes = record.count(m_source.textDelimiter);
+        while (quotes % 2 && nextLine(begin, length)) {
+            QString line = m_codec->toUnicode(begin, length);
+            quotes += line.count(m_source.textDelimiter);
+            record += QLatin1Char('\n') + line;
+            lines++;
+        }
+    }
+
+    row = parseCSV(record.trimmed());
+    return true;
+}
+
+QStringList CsvReader::header() const
+{
+    return m_header;
+}
+
+/**
+ * @brief CsvReader::nextRow
+ * decodes and splits the next line. Only the bytes of this line are converted,
+ * the file itself is never copied.
+ * @param row
+ * @return false at end of file or end of the line window
+ */
+bool CsvReader::nextRow(QStringList &row)
+{
+    if (m_linesLeft <= 0)
+        return false;
+
+    int lines;
+    if (!readLine(row, lines))
+        return false;
+
+    m_linesRead += lines;
+    m_linesLeft -= lines;
+    return true;
+}
+
+/**
+ * @brief CsvReader::linesRead
+ * @return lines of the window read by nextRow(), the header is not counted
+ */
+int CsvReader::linesRead() const
+{
+    return m_linesRead;
+}
+
+int CsvReader::countRemainingLines() const
+{
+    int count = 0;
+    qint64 pos = m_pos;
+    while (pos < m_size && count < m_linesLeft) {
+        count++;
+        pos = findLineBreak(pos) + m_newline.size();
+    }
+
+    return count;
+}
+
+QStringList CsvReader::parseCSV(const QString &string) const
+{
+    enum State { Normal,
+                 Quote } state = Normal;
+    QStringList fields;
+    QString value;
+
+    for (int i = 0; i < string.size(); i++) {
+        QChar current = string.at(i);
+
+        // Normal state
+        if (state == Normal) {
+            // delimiter
+            if (current == m_source.delimiter && m_source.delimiter != m_source.textDelimiter) {
+                // Save field
+                fields.append(value);
+                value.clear();
+            }
+            // delimitor == textDelimiter
+            else if (current == m_source.textDelimiter) {
+                state = Quote;
+            }
+            // Other character
+            else {
+                value += current;
+            }
+        }
+        // In-quote state
+        else if (state == Quote) {
+            // Another textDelimiter
+            if (current == m_source.textDelimiter) {
+                if (i + 1 < string.size()) {
+                    QChar next = string.at(i + 1);
+
+                    // A double textDelimiter?
+                    if (next == m_source.textDelimiter) {
+                        value += m_source.textDelimiter;
+                        i++;
+                    } else {
+                        state = Normal;
+                    }
+                }
+            }
+            // Other character
+            else {
+                value += current;
+            }
+        }
+    }
+    if (!value.isEmpty())
+        fields.append(value);
+
+    return fields;
+}
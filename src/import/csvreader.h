@@ -0,0 +1,88 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QFile>
+#include <QStringList>
+
+class QTextCodec;
+
+struct CsvImportSource
+{
+    QString filename;
+    QString delimiter;
+    QString textDelimiter;
+    QString codec;
+    bool firstRowIsHeader = true;
+    int fromLine = 1;
+    int toLine = 1;
+};
+
+/**
+ * @brief The CsvReader class
+ * Streams a csv file line by line from a memory mapped file. Line breaks
+ * are searched as encoded by the codec, on code unit boundaries for UTF-16
+ * and UTF-32. A quoted field may span several lines, the row goes on until
+ * the quote is closed. Rows are handed out as QStringList, nothing is kept
+ * in memory after nextRow() returns. The line window (fromLine, toLine)
+ * and the header row are handled by open(), toLine == 1 means read all
+ * lines. The window counts lines, not rows.
+ */
+class CsvReader
+{
+  public:
+    CsvReader(const CsvImportSource &source);
+    ~CsvReader();
+
+    bool open();
+    void close();
+    bool atEnd() const;
+    QStringList header() const;
+    bool nextRow(QStringList &row);
+    int linesRead() const;
+    int countRemainingLines() const;
+    int percent() const;
+
+  private:
+    void detectLineBreaks();
+    qint64 findLineBreak(qint64 from) const;
+    bool nextLine(const char *&begin, int &length);
+    bool readLine(QStringList &row, int &lines);
+    QStringList parseCSV(const QString &string) const;
+
+    CsvImportSource m_source;
+    QFile m_file;
+    QTextCodec *m_codec;
+    QByteArray m_buffer;
+    const char *m_data;
+    qint64 m_size;
+    qint64 m_pos;
+    QByteArray m_newline;
+    QByteArray m_carriageReturn;
+    QStringList m_header;
+    int m_linesRead;
+    int m_linesLeft;
+};
+
+#endif // CSVREADER_H
@@ -22,21 +22,25 @@
 
 #include "importworker.h"
 #include "singleton/spreadsignal.h"
+#include "singleton/fiscalperiod.h"
 #include "preferences/qrksettings.h"
 #include "RK/rk_signaturemodule.h"
+#include "RK/rk_signaturesession.h"
 #include "database.h"
 #include "databasemanager.h"
 #include "documentprinter.h"
+#include "utils/metrics.h"
+#include "utils/jsonimportfile.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
+#include <QDate>
 #include <QDir>
 #include <QFile>
 #include <QQueue>
 #include <QThread>
 #include <QWidget>
-#include <QTextCodec>
 #include <QSqlQuery>
 #include <QSqlError>
 #include <QDebug>
@@ -63,10 +67,16 @@ void ImportWorker::stopProcess()
 
 void ImportWorker::process()
 {
+    QrkSettings settings;
+    int batchSize = settings.value("importBatchSize", 1).toInt();
+
     while (!m_isStopped && !m_queue->isEmpty()) {
         qDebug() << "Function Name: " << Q_FUNC_INFO << " From Worker thread: " << QThread::currentThread();
 
         if (checkEOAnyServerMode()) {
+            if (batchSize > 1 && processBatch(batchSize) > 0)
+                continue;
+
             QString filename = m_queue->first();
             loadJSonFile(filename);
             QThread::msleep(200);
@@ -101,41 +111,14 @@ void ImportWorker::database_error(QString what)
 bool ImportWorker::loadJSonFile(QString filename)
 {
 
-    QByteArray receiptInfo;
-    QFile file(filename);
-
-    // in some cases we are to fast here. Try 3 times to open the file while file is in use by create process
-    for (int i = 0; i < 3; i++) {
-        if (file.open(QIODevice::ReadOnly | QIODevice::Text)) {
-            break;
-        }
-        if (i == 3) {
-            Spread::Instance()->setImportInfo(tr("Import Fehler -> Datei %1 kann nicht geöffnet werden.").arg(filename), true);
-            return false;
-        }
-        QThread::msleep(300);
-    }
-
-    receiptInfo = file.readAll();
-
-    file.close();
-    // remove any prefix and suffix from dirty json files
-    if (!receiptInfo.startsWith('{')) {
-        int begin = receiptInfo.indexOf('{');
-        int end = receiptInfo.lastIndexOf('}') - begin + 1;
-        receiptInfo = receiptInfo.mid(begin,end);
-    }
+    MetricsTimer timer("import.file");
+    Metrics::addCount("import.files");
 
-    QrkSettings settings;
     QJsonParseError jerror;
-
-    QTextCodec *codec = QTextCodec::codecForName (settings.value("importCodePage", "UTF-8").toString().toUtf8());
-    QString json = codec->toUnicode(receiptInfo);
-    QJsonDocument jd = QJsonDocument::fromJson(json.toUtf8(), &jerror);
-    QJsonObject data = jd.object();
+    QJsonObject data = readJSonFile(filename, &jerror);
 
     if (data.contains("r2b")) {
-        data["filename"] = file.fileName();
+        data["filename"] = filename;
         if (importR2B(data)) {
             Spread::Instance()->setImportInfo(tr("Import %1 -> OK").arg(data.value("filename").toString()));
             if (!fileMover(filename, ".old"))
@@ -150,7 +133,7 @@ bool ImportWorker::loadJSonFile(QString filename)
         }
 
     } else if (data.contains("receipt")) {
-        data["filename"] = file.fileName();
+        data["filename"] = filename;
         if (importReceipt(data)) {
             Spread::Instance()->setImportInfo(tr("Import %1 -> OK").arg(data.value("filename").toString()));
             if (!fileMover(filename, ".old")) {
@@ -166,7 +149,7 @@ bool ImportWorker::loadJSonFile(QString filename)
         }
 
     } else if (data.contains("printtagged")) {
-        data["filename"] = file.fileName();
+        data["filename"] = filename;
         if (importTagged(data)) {
             Spread::Instance()->setImportInfo(tr("Import %1 -> Druck OK").arg(data.value("filename").toString()));
             if (!fileMover(filename, ".old"))
@@ -188,6 +171,212 @@ bool ImportWorker::loadJSonFile(QString filename)
     return false;
 }
 
+QJsonObject ImportWorker::readJSonFile(const QString &filename, QJsonParseError *jerror)
+{
+    QrkSettings settings;
+    JsonImportFile file(filename, settings.value("importCodePage", "UTF-8").toString());
+
+    // in some cases we are to fast here. Try 3 times to open the file while file is in use by create process
+    for (int i = 0; i < 3; i++) {
+        if (file.open())
+            break;
+        if (i < 2)
+            QThread::msleep(300);
+    }
+
+    if (!file.isOpen()) {
+        Spread::Instance()->setImportInfo(tr("Import Fehler -> Datei %1 kann nicht geöffnet werden.").arg(filename), true);
+        return QJsonObject();
+    }
+
+    QJsonObject data = file.object(jerror);
+    file.close();
+
+    return data;
+}
+
+/**
+ * @brief ImportWorker::processBatch
+ * imports up to batchSize receipt files from the queue in one database
+ * transaction. Each receipt gets its own savepoint, a broken receipt is
+ * rolled back alone and its file is renamed to .false. The signature module
+ * stays open for the whole group. Printouts, the shown sales total and the
+ * file renames wait until the group is committed.
+ * Files other than r2b/receipt end the group and go the single file way.
+ * @param batchSize
+ * @return number of files handled, 0 if the caller has to import the first
+ * file of the queue with loadJSonFile
+ */
+int ImportWorker::processBatch(int batchSize)
+{
+    MetricsTimer timer("import.batch");
+
+    QSqlDatabase dbc = Database::database();
+    RKSignatureSession session;
+    bool depActive = RKSignatureModule::isDEPactive();
+
+    if (depActive && !session.begin(Database::getLastReceiptNum())) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Signature session failed, fallback to single file import";
+        return 0;
+    }
+
+    if (!dbc.transaction()) {
+        emit database_error(QString("Transaction failed, %1 %2").arg(dbc.lastError().text()).arg(dbc.lastError().nativeErrorCode()));
+        return 0;
+    }
+
+    if (depActive)
+        setSignatureSession(&session);
+    setDeferredOutput(true);
+
+    QList<QPair<QString, QString> > moves;
+    QDate day = QDate::currentDate();
+
+    while (!m_isStopped && !m_queue->isEmpty() && moves.size() < batchSize && day == QDate::currentDate()) {
+        QString filename = m_queue->first();
+        QJsonParseError jerror;
+        QJsonObject data = readJSonFile(filename, &jerror);
+        if (!data.contains("r2b") && !data.contains("receipt"))
+            break;
+
+        m_queue->dequeue();
+        Metrics::addCount("import.files");
+        data["filename"] = filename;
+
+        if (importBatchFile(data, session))
+            moves.append(qMakePair(filename, QString(".old")));
+        else
+            moves.append(qMakePair(filename, QString(".false")));
+    }
+
+    setSignatureSession(0);
+    setDeferredOutput(false);
+
+    if (!dbc.commit()) {
+        bool sql_ok = dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+        discardDeferred();
+        emit database_error(QString("Rollback = %1,%2 %3").arg(sql_ok).arg(dbc.lastError().text()).arg(dbc.lastError().nativeErrorCode()));
+        // nothing was written, the files are imported again one by one
+        for (int i = moves.size() - 1; i >= 0; i--)
+            m_queue->prepend(moves.at(i).first);
+        return 0;
+    }
+
+    walCheckpoint();
+    flushDeferred();
+
+    for (int i = 0; i < moves.size(); i++) {
+        QString filename = moves.at(i).first;
+        QString ext = moves.at(i).second;
+        if (ext == ".old")
+            Spread::Instance()->setImportInfo(tr("Import %1 -> OK").arg(filename));
+        else
+            Spread::Instance()->setImportInfo(tr("Import %1 -> Fehler").arg(filename), true);
+
+        if (!fileMover(filename, ext))
+            Spread::Instance()->setImportInfo(tr("Import Fehler -> Datei %1 kann nicht umbenannt werden.").arg(filename), true);
+    }
+
+    qDebug() << "Function Name: " << Q_FUNC_INFO << " Files: " << moves.size();
+
+    return moves.size();
+}
+
+/**
+ * @brief ImportWorker::importBatchFile
+ * creates the receipts of one r2b or receipt file inside the open transaction
+ * of processBatch, each behind its own savepoint. Nothing is committed here.
+ * A failing receipt is rolled back and ends the file, the receipts before it
+ * stay booked like with the single file import.
+ * @param data
+ * @param session
+ * @return false if any receipt of the file failed
+ */
+bool ImportWorker::importBatchFile(QJsonObject data, RKSignatureSession &session)
+{
+    bool isR2B = data.contains("r2b");
+    QJsonArray receiptData = data.value(isR2B ? "r2b" : "receipt").toArray();
+    bool ok = false;
+
+    foreach (const QJsonValue & value, receiptData) {
+        QJsonObject obj = value.toObject();
+        if (isR2B)
+            ok = obj.contains("gross") && obj.contains("receiptNum") && obj.contains("payedBy");
+        else
+            ok = obj.contains("payedBy") && obj.contains("items");
+
+        if (!ok) {
+            QString info = tr("Import Fehler -> Falsches JSON Format, Dateiname: %1").arg(data.value("filename").toString());
+            Spread::Instance()->setImportInfo(info, true);
+            return false;
+        }
+
+        int deferred = deferredCount();
+        if (!savepoint("SAVEPOINT import_receipt"))
+            return false;
+
+        if (importBatchReceipt(obj, isR2B, data.value("filename").toString())) {
+            savepoint("RELEASE SAVEPOINT import_receipt");
+            session.accept();
+            continue;
+        }
+
+        savepoint("ROLLBACK TO SAVEPOINT import_receipt");
+        savepoint("RELEASE SAVEPOINT import_receipt");
+        session.reject();
+        discardDeferred(deferred);
+        FiscalPeriod::Instance()->invalidate();
+        return false;
+    }
+
+    return ok;
+}
+
+bool ImportWorker::importBatchReceipt(const QJsonObject &obj, bool isR2B, const QString &filename)
+{
+    newOrder();
+    if (isR2B && !setR2BServerMode(obj)) {
+        QString info = tr("Import Fehler -> Rechnungsnummer: %1 aus Importdatei %2 wird schon verwendet!").arg(obj.value("receiptNum").toString()).arg(filename);
+        Spread::Instance()->setImportInfo(info, true);
+        return false;
+    } else if (!isR2B && !setReceiptServerMode(obj)) {
+        QString info = tr("Import Fehler -> Importdatei %1!").arg(filename);
+        Spread::Instance()->setImportInfo(info, true);
+        return false;
+    }
+
+    int id = createReceipts();
+    if (!id)
+        return false;
+
+    setCurrentReceiptNum(id);
+    return createOrder() && finishReceipts(obj.value("payedBy").toString().toInt());
+}
+
+bool ImportWorker::savepoint(const QString &command)
+{
+    QSqlQuery query(Database::database());
+    if (!query.exec(command)) {
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qCritical() << "Function Name: " << Q_FUNC_INFO << " Query: " << command;
+        return false;
+    }
+
+    return true;
+}
+
+void ImportWorker::walCheckpoint()
+{
+    QSqlDatabase dbc = Database::database();
+    if (dbc.driverName() == "QSQLITE") {
+        QSqlQuery query(dbc);
+        query.exec("PRAGMA wal_checkpoint;");
+        query.next();
+        qDebug() << "Function Name: " << Q_FUNC_INFO << "WAL Checkpoint: (busy:" << query.value(0).toString() << ") log: " << query.value(1).toString() << " checkpointed: " << query.value(2).toString();
+    }
+}
+
 bool ImportWorker::importR2B(QJsonObject data)
 {
     QJsonArray r2bArray = data.value("r2b").toArray();
@@ -227,15 +416,11 @@ bool ImportWorker::importR2B(QJsonObject data)
 
     if (!ok) {
         bool sql_ok = dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         emit database_error(QString("Rollback = %1,%2 %3").arg(sql_ok).arg(dbc.lastError().text()).arg(dbc.lastError().nativeErrorCode()));
     }
 
-    if (dbc.driverName() == "QSQLITE") {
-        QSqlQuery query(dbc);
-        query.exec("PRAGMA wal_checkpoint;");
-        query.next();
-        qDebug() << "Function Name: " << Q_FUNC_INFO << "WAL Checkpoint: (busy:" << query.value(0).toString() << ") log: " << query.value(1).toString() << " checkpointed: " << query.value(2).toString();
-    }
+    walCheckpoint();
     return ok;
 }
 
@@ -277,15 +462,11 @@ bool ImportWorker::importReceipt(QJsonObject data)
     }
     if (!ok) {
         bool sql_ok = dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         emit database_error(QString("Rollback = %1,%2 %3").arg(sql_ok).arg(dbc.lastError().text()).arg(dbc.lastError().nativeErrorCode()));
     }
 
-    if (dbc.driverName() == "QSQLITE") {
-        QSqlQuery query(dbc);
-        query.exec("PRAGMA wal_checkpoint;");
-        query.next();
-        qDebug() << "Function Name: " << Q_FUNC_INFO << "WAL Checkpoint: (busy:" << query.value(0).toString() << ") log: " << query.value(1).toString() << " checkpointed: " << query.value(2).toString();
-    }
+    walCheckpoint();
 
     return ok;
 }
@@ -25,6 +25,11 @@
 
 #include "reports.h"
 
+#include <QJsonDocument>
+#include <QJsonObject>
+
+class RKSignatureSession;
+
 class ImportWorker : public Reports
 {
     Q_OBJECT
@@ -44,6 +49,12 @@ public slots:
 
 private:
     bool loadJSonFile(QString filename);
+    QJsonObject readJSonFile(const QString &filename, QJsonParseError *jerror);
+    int processBatch(int batchSize);
+    bool importBatchFile(QJsonObject data, RKSignatureSession &session);
+    bool importBatchReceipt(const QJsonObject &obj, bool isR2B, const QString &filename);
+    bool savepoint(const QString &command);
+    void walCheckpoint();
     bool importR2B(QJsonObject data);
     bool importReceipt(QJsonObject data);
     bool importTagged(QJsonObject data);
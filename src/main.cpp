@@ -30,6 +30,10 @@
 #include "preferences/qrksettings.h"
 #include "utils/demomode.h"
 #include "utils/utils.h"
+#include "utils/metrics.h"
+#include "utils/turnovercountercheck.h"
+#include "queryprofiler.h"
+#include "databasemanager.h"
 #include "backup.h"
 #include "reports.h"
 #include "3rdparty/ckvsoft/rbac/userlogin.h"
@@ -55,6 +59,7 @@
 #include <QSplashScreen>
 #include <QGraphicsBlurEffect>
 #include <QThread>
+#include <QElapsedTimer>
 
 //--------------------------------------------------------------------------------
 #include <QFile>
@@ -283,6 +288,18 @@ int main(int argc, char *argv[])
         settings.removeSettings("QRK_RUNNING", false);
     }
 
+    if (settings.value("Metrics/enabled", false).toBool())
+        Metrics::setEnabled(true);
+
+    QueryProfiler::setSlowQueryThreshold(settings.value("Profiler/slowQueryMs", 100).toInt());
+    if (settings.value("Profiler/enabled", false).toBool())
+        QueryProfiler::setEnabled(true);
+
+    DatabaseManager::setPoolLimits(settings.value("DB_maxConnections", 16).toInt(),
+                                   settings.value("DB_idleTimeout", 600).toInt(),
+                                   settings.value("DB_validationInterval", 60).toInt(),
+                                   settings.value("DB_leaseTimeout", 5000).toInt());
+
     QSize buttonsize = settings.value("ButtonSize", QSize(150, 60)).toSize();
 
     qApp->setStyleSheet("QFileDialog QPushButton, QWizard QPushButton, QMessageBox QPushButton {"
@@ -300,18 +317,25 @@ int main(int argc, char *argv[])
     if (isQRKrunning())
       return 0;
 
+    QElapsedTimer startupTime;
+    startupTime.start();
+    MetricsTimer startupTimer("startup.total");
+
     splash->setVisible(true);
     splash->showMessage(QObject::tr("Schriftarten werden geladen ..."),topRight, Qt::black);
     setApplicationFont();
 
     splash->showMessage(QObject::tr("Verbindung zur Datenbank wird hergestellt ..."),topRight, Qt::black);
-    if ( !Database::open( dbSelect) ) {
-        sighandler(0);
-        return 0;
-    }
+    {
+        MetricsTimer timer("startup.database");
+        if ( !Database::open( dbSelect) ) {
+            sighandler(0);
+            return 0;
+        }
 
-    // Cleanup unused old globals Database entries
-    Database::cleanup();
+        // Cleanup unused old globals Database entries
+        Database::cleanup();
+    }
 
     // DateTime check
     if (Database::getLastJournalEntryDate().secsTo(QDateTime::currentDateTime()) < 0) {
@@ -334,14 +358,40 @@ int main(int argc, char *argv[])
         splash->setVisible(true);
     }
 
+    // DEP-7 Check, runs in its own thread while the main window is built
+    QStringList error;
+    bool depOk = true;
+    QThread *depThread = 0;
+    TurnOverCounterCheck *depCheck = 0;
+    if (!Database::isCashRegisterInAktive() && !DemoMode::isDemoMode() && RKSignatureModule::isDEPactive()) {
+        depThread = new QThread;
+        depCheck = new TurnOverCounterCheck(false);
+        depCheck->moveToThread(depThread);
+
+        QObject::connect(depThread, &QThread::started, depCheck, &TurnOverCounterCheck::run);
+        QObject::connect(depCheck, &TurnOverCounterCheck::finished, depCheck, [&depOk, &error](bool ok, QStringList err) {
+            depOk = ok;
+            error = err;
+        }, Qt::DirectConnection);
+        QObject::connect(depCheck, &TurnOverCounterCheck::finished, depThread, &QThread::quit, Qt::DirectConnection);
+        depThread->start();
+    }
+
+    MetricsTimer mainWindowTimer("startup.mainwindow");
     QRK mainWidget(servermode);
     UserLogin *userLogin = new UserLogin(&mainWidget);
+    mainWindowTimer.stop();
 
     splash->showMessage(QObject::tr("DEP-7 wird überprüft ..."),topRight, Qt::black);
 
-    // DEP-7 Check
-    QStringList error;
-    if (!Database::isCashRegisterInAktive() && !DemoMode::isDemoMode() && RKSignatureModule::isDEPactive() && !Utils::checkTurnOverCounter(error)) {
+    if (depThread) {
+        MetricsTimer timer("startup.depWait");
+        depThread->wait();
+        delete depCheck;
+        delete depThread;
+    }
+
+    if (!depOk) {
         splash->setHidden(true);
         QMessageBox messageBox(QMessageBox::Critical,
                                QObject::tr("DEP-7 Fehler"),
@@ -468,6 +518,9 @@ int main(int argc, char *argv[])
     */
     mainWidget.show();
 
+    startupTimer.stop();
+    qInfo() << "Function Name: " << Q_FUNC_INFO << " Startup time: " << startupTime.elapsed() << "ms";
+
     if (RBAC::Instance()->Login()) {
         userLogin->show();
     } else {
@@ -0,0 +1,269 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include <QtWidgets>
+
+#include "metricsdialog.h"
+#include "databasemanager.h"
+#include "utils/metrics.h"
+#include "queryprofiler.h"
+#include "preferences/qrksettings.h"
+#include "qrkpushbutton.h"
+
+namespace {
+
+QString toMs(qint64 usec)
+{
+    return QString::number(usec / 1000.0, 'f', 2);
+}
+
+}
+
+MetricsDialog::MetricsDialog(QWidget *parent)
+  : QDialog(parent)
+{
+
+  m_enabled = new QCheckBox(tr("Messung aktiv"));
+  m_enabled->setChecked(Metrics::isEnabled());
+
+  m_tree = new QTreeWidget;
+  m_tree->setColumnCount(7);
+  m_tree->setHeaderLabels(QStringList() << tr("Name") << tr("Anzahl") << tr("Summe") << tr("Mittel")
+                          << tr("p50") << tr("p95") << tr("Max"));
+  m_tree->setRootIsDecorated(false);
+  m_tree->setAlternatingRowColors(true);
+
+  QrkSettings settings;
+  m_profiler = new QCheckBox(tr("SQL Abfragen aufzeichnen"));
+  m_profiler->setChecked(QueryProfiler::isEnabled());
+  m_profiler->setEnabled(QueryProfiler::isAvailable());
+
+  m_slowQuery = new QSpinBox;
+  m_slowQuery->setRange(0, 60000);
+  m_slowQuery->setSuffix(" ms");
+  m_slowQuery->setSpecialValueText(tr("aus"));
+  m_slowQuery->setValue(settings.value("Profiler/slowQueryMs", 100).toInt());
+
+  QHBoxLayout *profilerLayout = new QHBoxLayout;
+  profilerLayout->addWidget(m_profiler);
+  profilerLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding, QSizePolicy::Minimum));
+  profilerLayout->addWidget(new QLabel(tr("Langsame Abfragen protokollieren ab")));
+  profilerLayout->addWidget(m_slowQuery);
+
+  m_queries = new QTreeWidget;
+  m_queries->setColumnCount(5);
+  m_queries->setHeaderLabels(QStringList() << tr("Anzahl") << tr("Summe ms") << tr("Max ms") << tr("Zeilen") << tr("SQL"));
+  m_queries->setRootIsDecorated(false);
+  m_queries->setAlternatingRowColors(true);
+
+  QrkPushButton *explainButton = new QrkPushButton;
+  explainButton->setMinimumHeight(60);
+  explainButton->setText(tr("Abfrageplan"));
+  explainButton->setEnabled(QueryProfiler::isAvailable());
+
+  QHBoxLayout *explainLayout = new QHBoxLayout;
+  explainLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding, QSizePolicy::Minimum));
+  explainLayout->addWidget(explainButton);
+
+  QWidget *queryWidget = new QWidget;
+  QVBoxLayout *queryLayout = new QVBoxLayout;
+  queryLayout->addLayout(profilerLayout);
+  queryLayout->addWidget(m_queries);
+  queryLayout->addLayout(explainLayout);
+  queryWidget->setLayout(queryLayout);
+
+  QTabWidget *tabWidget = new QTabWidget;
+  tabWidget->addTab(m_tree, tr("Messwerte"));
+  tabWidget->addTab(queryWidget, tr("SQL"));
+
+  QrkPushButton *refreshButton = new QrkPushButton;
+  refreshButton->setMinimumHeight(60);
+  refreshButton->setText(tr("Aktualisieren"));
+
+  QrkPushButton *resetButton = new QrkPushButton;
+  resetButton->setMinimumHeight(60);
+  resetButton->setText(tr("Zurücksetzen"));
+
+  QrkPushButton *saveButton = new QrkPushButton;
+  saveButton->setMinimumHeight(60);
+  saveButton->setText(tr("Speichern ..."));
+
+  QrkPushButton *pushButton = new QrkPushButton;
+  pushButton->setMinimumHeight(60);
+  pushButton->setMinimumWidth(0);
+  pushButton->setIcon(QIcon(":src/icons/ok.png"));
+  pushButton->setIconSize(QSize(32,32));
+  pushButton->setText(tr("OK"));
+
+  QHBoxLayout *buttonLayout = new QHBoxLayout;
+  buttonLayout->addWidget(refreshButton);
+  buttonLayout->addWidget(resetButton);
+  buttonLayout->addWidget(saveButton);
+  buttonLayout->addItem(new QSpacerItem(0, 0, QSizePolicy::Expanding, QSizePolicy::Expanding));
+  buttonLayout->addWidget(pushButton);
+
+  QVBoxLayout *mainLayout = new QVBoxLayout;
+  mainLayout->addWidget(m_enabled);
+  mainLayout->addWidget(tabWidget);
+  mainLayout->addLayout(buttonLayout);
+  setLayout(mainLayout);
+
+  setWindowTitle(tr("Diagnose"));
+  setMinimumWidth(800);
+  setMinimumHeight(400);
+
+  connect(m_enabled, &QCheckBox::toggled, this, &MetricsDialog::enabledChanged);
+  connect(m_profiler, &QCheckBox::toggled, this, &MetricsDialog::profilerChanged);
+  connect(m_slowQuery, static_cast<void(QSpinBox::*)(int)>(&QSpinBox::valueChanged), this, &MetricsDialog::slowQueryChanged);
+  connect(explainButton, &QPushButton::clicked, this, &MetricsDialog::explain);
+  connect(refreshButton, &QPushButton::clicked, this, &MetricsDialog::refresh);
+  connect(resetButton, &QPushButton::clicked, this, &MetricsDialog::reset);
+  connect(saveButton, &QPushButton::clicked, this, &MetricsDialog::save);
+  connect(pushButton, &QPushButton::clicked, this, &MetricsDialog::accept);
+
+  refresh();
+}
+
+void MetricsDialog::enabledChanged(bool enabled)
+{
+  QrkSettings settings;
+  settings.save2Settings("Metrics/enabled", enabled, false);
+  Metrics::setEnabled(enabled);
+}
+
+void MetricsDialog::profilerChanged(bool enabled)
+{
+  QrkSettings settings;
+  settings.save2Settings("Profiler/enabled", enabled, false);
+  QueryProfiler::setEnabled(enabled);
+}
+
+void MetricsDialog::slowQueryChanged(int ms)
+{
+  QrkSettings settings;
+  settings.save2Settings("Profiler/slowQueryMs", ms, false);
+  QueryProfiler::setSlowQueryThreshold(ms);
+}
+
+QTreeWidgetItem *MetricsDialog::addGroup(const QString &title)
+{
+  QTreeWidgetItem *group = new QTreeWidgetItem(m_tree, QStringList() << title);
+  QFont font = group->font(0);
+  font.setBold(true);
+  group->setFont(0, font);
+  group->setFirstColumnSpanned(true);
+
+  return group;
+}
+
+void MetricsDialog::refresh()
+{
+  m_tree->clear();
+
+  addGroup(tr("Zeiten (ms)"));
+  foreach (const MetricsHistogram &h, Metrics::timers()) {
+    new QTreeWidgetItem(m_tree, QStringList() << h.name << QString::number(h.count) << toMs(h.total)
+                        << toMs(h.count ? h.total / h.count : 0) << toMs(h.percentile(0.5))
+                        << toMs(h.percentile(0.95)) << toMs(h.max));
+  }
+
+  addGroup(tr("Werte"));
+  foreach (const MetricsHistogram &h, Metrics::values()) {
+    new QTreeWidgetItem(m_tree, QStringList() << h.name << QString::number(h.count) << QString::number(h.total)
+                        << QString::number(h.count ? double(h.total) / h.count : 0.0, 'f', 1)
+                        << QString::number(h.percentile(0.5)) << QString::number(h.percentile(0.95))
+                        << QString::number(h.max));
+  }
+
+  addGroup(tr("Zähler"));
+  QList<QPair<QString, qint64> > counters = Metrics::counters();
+  for (int i = 0; i < counters.size(); i++)
+    new QTreeWidgetItem(m_tree, QStringList() << counters.at(i).first << QString::number(counters.at(i).second));
+
+  for (int i = 0; i < m_tree->columnCount(); i++)
+    m_tree->resizeColumnToContents(i);
+
+  refreshQueries();
+}
+
+void MetricsDialog::refreshQueries()
+{
+  m_queries->clear();
+
+  foreach (const QueryProfile &profile, QueryProfiler::profiles(200)) {
+    QTreeWidgetItem *item = new QTreeWidgetItem(m_queries, QStringList() << QString::number(profile.count)
+                                                << toMs(profile.total) << toMs(profile.max)
+                                                << QString::number(profile.rows) << profile.sql);
+    item->setToolTip(4, profile.sql);
+    item->setData(4, Qt::UserRole, profile.example);
+  }
+
+  for (int i = 0; i < m_queries->columnCount() - 1; i++)
+    m_queries->resizeColumnToContents(i);
+}
+
+void MetricsDialog::explain()
+{
+  QTreeWidgetItem *item = m_queries->currentItem();
+  if (!item)
+    item = m_queries->topLevelItem(0);
+  if (!item)
+    return;
+
+  QString sql = item->data(4, Qt::UserRole).toString();
+  QStringList plan = QueryProfiler::explain(sql);
+
+  QMessageBox box(this);
+  box.setWindowTitle(tr("Abfrageplan"));
+  box.setText(sql);
+  box.setDetailedText(plan.isEmpty() ? tr("Kein Abfrageplan verfügbar.") : plan.join("\n"));
+  box.setIcon(QMessageBox::Information);
+  box.exec();
+}
+
+void MetricsDialog::reset()
+{
+  Metrics::reset();
+  QueryProfiler::reset();
+  refresh();
+}
+
+void MetricsDialog::save()
+{
+  QrkSettings settings;
+  QString lastUsedDirectory = settings.value("lastUsedDirectory", QDir::currentPath()).toString();
+
+  QString filename = QFileDialog::getSaveFileName(this, tr("Datei speichern"),
+                                                  lastUsedDirectory + "/qrk-trace-" + QDateTime::currentDateTime().toString("yyyyMMdd-hhmmss") + ".json",
+                                                  "Trace (*.json)", 0, QFileDialog::DontUseNativeDialog);
+  if (filename.isEmpty())
+    return;
+
+  QJsonObject extra;
+  extra["queries"] = QueryProfiler::toJson();
+  extra["connections"] = DatabaseManager::poolStatus();
+
+  if (Metrics::writeTrace(filename, extra))
+    QMessageBox::information(this, tr("Diagnose"), tr("Die Messdaten wurden nach %1 geschrieben.").arg(filename));
+  else
+    QMessageBox::warning(this, tr("Diagnose"), tr("Die Datei %1 konnte nicht geschrieben werden.").arg(filename));
+}
@@ -37,6 +37,7 @@
 #include "RK/rk_signaturemodulefactory.h"
 #include "database.h"
 #include "reports.h"
+#include "singleton/fiscalperiod.h"
 #include "preferences/qrksettings.h"
 #include "textedit.h"
 #include "3rdparty/ckvsoft/rbac/acl.h"
@@ -206,6 +207,7 @@ void SettingsDialog::accept()
     settings.save2Settings("importCodePage", m_server->getImportCodePage());
     settings.save2Settings("importServerFullscreen", m_server->getServerFullscreen());
     settings.save2Settings("serverCriticalMessageBox", m_server->getServerCriticalMessageBox());
+    settings.save2Settings("importBatchSize", m_server->getImportBatchSize());
 
     settings.save2Settings("backupDirectory", m_general->getBackupDirectory());
     settings.save2Settings("keepMaxBackups", m_general->getKeepMaxBackups());
@@ -1011,6 +1013,10 @@ ServerTab::ServerTab(QWidget *parent)
     m_codePageCombo->addItem("IBM-850",2);
     m_serverFullscreen = new QCheckBox();
     m_serverCriticalMessageBox = new QCheckBox();
+    m_importBatchSpinBox = new QSpinBox();
+    m_importBatchSpinBox->setMinimum(1);
+    m_importBatchSpinBox->setMaximum(500);
+    m_importBatchSpinBox->setToolTip(tr("Anzahl der Importdateien die gemeinsam in einer Transaktion gespeichert werden. 1 = jede Datei einzeln."));
 
     QPushButton *importDirectoryButton = new QPushButton;
 
@@ -1027,11 +1033,13 @@ ServerTab::ServerTab(QWidget *parent)
     serverLayout->addWidget(new QLabel(tr("Import Zeichensatz:")), 2,1);
     serverLayout->addWidget(new QLabel(tr("Import Info Vollbild:")), 3,1);
     serverLayout->addWidget(new QLabel(tr("Fehlermeldungsdialog:")), 4,1);
+    serverLayout->addWidget(new QLabel(tr("Import Gruppengröße:")), 5,1);
 
     serverLayout->addWidget(m_importDirectoryEdit, 1,2);
     serverLayout->addWidget(m_codePageCombo, 2,2);
     serverLayout->addWidget(m_serverFullscreen, 3,2);
     serverLayout->addWidget(m_serverCriticalMessageBox, 4,2);
+    serverLayout->addWidget(m_importBatchSpinBox, 5,2);
 
     serverLayout->addWidget(importDirectoryButton, 1,3);
     serverGroup->setLayout(serverLayout);
@@ -1049,6 +1057,7 @@ ServerTab::ServerTab(QWidget *parent)
     m_codePageCombo->setCurrentText(settings.value("importCodePage", "UTF-8").toString());
     m_serverFullscreen->setChecked(settings.value("importServerFullscreen", false).toBool());
     m_serverCriticalMessageBox->setChecked(settings.value("serverCriticalMessageBox", true).toBool());
+    m_importBatchSpinBox->setValue(settings.value("importBatchSize", 1).toInt());
 
     if (!RBAC::Instance()->hasPermission("settings_edit_extra"))
         disableWidgets();
@@ -1088,6 +1097,11 @@ bool ServerTab::getServerCriticalMessageBox()
     return m_serverCriticalMessageBox->isChecked();
 }
 
+int ServerTab::getImportBatchSize()
+{
+    return m_importBatchSpinBox->value();
+}
+
 GeneralTab::GeneralTab(QWidget *parent)
     : Widget(parent)
 {
@@ -2450,7 +2464,16 @@ void SCardReaderTab::activateButton_clicked(bool)
                 bool check = rep.checkEOAnyServerMode();
                 if (check) {
                     ReceiptItemModel rec;
-                    if (rec.createStartReceipt()) {
+                    QSqlDatabase dbc = Database::database();
+                    dbc.transaction();
+                    bool created = rec.createStartReceipt();
+                    if (created) {
+                        dbc.commit();
+                    } else {
+                        dbc.rollback();
+                        FiscalPeriod::Instance()->invalidate();
+                    }
+                    if (created) {
                         m_scardActivateButton->setVisible(false);
                         waitbar.close();
                         QMessageBox::information(this,tr("DEP-7 wurde aktiviert!"), tr("DEP-7 wurde aktiviert. Die Kasse ist RKSV-konform.\n Der STARTBELEG wurde erstellt."), "Ok");
@@ -2485,7 +2508,16 @@ void SCardReaderTab::activateButton_clicked(bool)
                 bool check = rep.checkEOAnyServerMode();
                 if (check) {
                     ReceiptItemModel rec;
-                    if (rec.createNullReceipt(CONCLUSION_RECEIPT)) {
+                    QSqlDatabase dbc = Database::database();
+                    dbc.transaction();
+                    bool created = rec.createNullReceipt(CONCLUSION_RECEIPT);
+                    if (created) {
+                        dbc.commit();
+                    } else {
+                        dbc.rollback();
+                        FiscalPeriod::Instance()->invalidate();
+                    }
+                    if (created) {
                         m_scardActivateButton->setVisible(false);
                         Database::setCashRegisterInAktive();
                         waitbar.close();
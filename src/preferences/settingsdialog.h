@@ -195,6 +195,7 @@ public:
     QString getImportCodePage();
     bool getServerFullscreen();
     bool getServerCriticalMessageBox();
+    int getImportBatchSize();
 
 private slots:
     void importDirectoryButton_clicked();
@@ -204,6 +205,7 @@ private:
     QComboBox *m_codePageCombo;
     QCheckBox *m_serverFullscreen;
     QCheckBox *m_serverCriticalMessageBox;
+    QSpinBox *m_importBatchSpinBox;
 
 };
 
@@ -37,11 +37,16 @@
 #include "utils/demomode.h"
 #include "import/csvimportwizard.h"
 #include "singleton/spreadsignal.h"
+#include "singleton/fiscalstate.h"
+#include "singleton/fiscalperiod.h"
 #include "RK/rk_signaturemodulefactory.h"
 #include "foninfo.h"
+#include "metricsdialog.h"
 #include "backup.h"
 #include "utils/utils.h"
 #include "utils/versionchecker.h"
+#include "utils/metrics.h"
+#include "utils/turnovercountercheck.h"
 #include "preferences/qrksettings.h"
 #include "pluginmanager/pluginmanager.h"
 #include "pluginmanager/pluginview.h"
@@ -65,6 +70,8 @@
 #include <QTreeView>
 #include <QThread>
 #include <QScreen>
+#include <QMenu>
+#include <QSqlDatabase>
 
 //-----------------------------------------------------------------------
 
@@ -119,8 +126,13 @@ QRK::QRK(bool servermode)
     m_currentRegisterYear = QDateTime::currentDateTime().toString("yyyy").toInt();
     // setWindowFlags(Qt::CustomizeWindowHint | Qt::WindowTitleHint);
 
-    PluginManager::instance()->initialize();
-    initPlugins();
+    {
+        MetricsTimer timer("startup.plugins");
+        PluginManager::instance()->initialize();
+        // the import thread finds the Wsdl plugin only when it is loaded here
+        PluginManager::instance()->preload(QStringList() << "Wsdl*" << "BarCodes");
+        initPlugins();
+    }
 
     //Stacked Widget
     m_stackedWidget = new QStackedWidget(this);
@@ -128,23 +140,33 @@ QRK::QRK(bool servermode)
 
     m_timer->start(1000);
 
-    iniStack();
+    {
+        MetricsTimer timer("startup.pages");
+        iniStack();
+    }
 
     connect(ui->export_CSV, &QAction::triggered, this, &QRK::export_CSV);
     connect(ui->import_CSV, &QAction::triggered, this, &QRK::import_CSV);
     connect(ui->export_JSON, &QAction::triggered, this, &QRK::export_JSON);
     connect(ui->exportProducts_CSV, &QAction::triggered, this, &QRK::exportProducts_CSV);
     connect(ui->actionDEPexternalBackup, &QAction::triggered, this, &QRK::backupDEP);
+    connect(ui->actionDEPcheck, &QAction::triggered, this, &QRK::checkDEP);
+    connect(ui->actionRebuildSalesTotals, &QAction::triggered, this, &QRK::rebuildSalesTotals);
     connect(ui->actionDatenbank_sichern, &QAction::triggered, this, &QRK::backup);
     connect(ui->actionAbout_QRK, &QAction::triggered, this, &QRK::actionAbout_QRK);
     connect(ui->actionAbout_QT, &QAction::triggered, qApp, &QApplication::aboutQt);
     connect(ui->actionQRK_Forum, &QAction::triggered, this, &QRK::actionQRK_Forum);
+    connect(ui->actionDiagnostics, &QAction::triggered, this, &QRK::actionDiagnostics);
     connect(ui->actionDEMO_Daten_zur_cksetzen, &QAction::triggered, this, &QRK::actionResetDemoData);
     connect(ui->actionDEMOMODUS_Verlassen, &QAction::triggered, this, &QRK::actionLeaveDemoMode);
     connect(ui->actionInfos_zur_Registrierung_bei_FON, &QAction::triggered, this, &QRK::infoFON);
     connect(ui->actionResuscitationCashRegister, &QAction::triggered, this, &QRK::actionResuscitationCashRegister);
     connect(ui->actionAclManager, &QAction::triggered, this, &QRK::actionAclManager);
 
+    /* fiscal state changes may happen while a receipt is written, refresh afterwards */
+    connect(FiscalState::Instance(), &FiscalStateFlags::depActiveChanged, this, &QRK::init, Qt::QueuedConnection);
+    connect(FiscalState::Instance(), &FiscalStateFlags::cashRegisterInactiveChanged, this, &QRK::init, Qt::QueuedConnection);
+
     connect(this, &QRK::setServerMode, m_qrk_home, &QRKHome::setServerMode);
     connect(m_qrk_home, &QRKHome::endOfDay, this, &QRK::endOfDaySlot);
     connect(m_qrk_home, &QRKHome::endOfMonth, this, &QRK::endOfMonthSlot);
@@ -162,9 +184,6 @@ QRK::QRK(bool servermode)
     connect(m_qrk_register, &QRKRegister::finishedReceipt, this, &QRK::finishedReceipt);
     connect(m_qrk_register, &QRKRegister::fullScreen, this, &QRK::setFullScreenMode);
 
-    connect(m_qrk_document, &QRKDocument::cancelDocumentButton, this, &QRK::onCancelDocumentButton_clicked);
-    connect(m_qrk_document, &QRKDocument::documentButton_clicked, this, &QRK::onDocumentButton_clicked);
-
     QString title = QString("QRK V%1.%2 - Qt Registrier Kasse - %3").arg(QRK_VERSION_MAJOR).arg(QRK_VERSION_MINOR).arg(Database::getShopName());
     setWindowTitle ( title );
 
@@ -204,39 +223,70 @@ void QRK::iniStack()
     m_qrk_register =  new QRKRegister(m_stackedWidget);
     m_stackedWidget->addWidget(m_qrk_register);
 
-    m_qrk_document =  new QRKDocument(m_stackedWidget);
-    m_stackedWidget->addWidget(m_qrk_document);
+    /* the document page is built on first use, see document() */
+    m_qrk_document = 0;
 
     m_stackedWidget->setCurrentWidget(m_qrk_home);
 
 }
 
+QRKDocument *QRK::document()
+{
+    if (!m_qrk_document) {
+        MetricsTimer timer("startup.documentPage");
+        m_qrk_document =  new QRKDocument(m_stackedWidget);
+        m_stackedWidget->addWidget(m_qrk_document);
+
+        connect(m_qrk_document, &QRKDocument::cancelDocumentButton, this, &QRK::onCancelDocumentButton_clicked);
+        connect(m_qrk_document, &QRKDocument::documentButton_clicked, this, &QRK::onDocumentButton_clicked);
+    }
+
+    return m_qrk_document;
+}
+
 //--------------------------------------------------------------------------------
 
 void QRK::initPlugins()
 {
+    /* the menu is built from the plugin metadata, the libraries themselves
+     * are loaded when the menu is opened or the plugin is used */
     QStringList plugins = PluginManager::instance()->plugins();
     QListIterator<QString> i(plugins);
     bool hasPlugins = false;
     while(i.hasNext()) {
         QString path = i.next();
+        if (PluginManager::instance()->getInterfaceByPath(path) != IndependentInterface_iid)
+            continue;
+
         QString name = PluginManager::instance()->getNameByPath(path);
-        IndependentInterface *plugin = qobject_cast<IndependentInterface *>(PluginManager::instance()->getObjectByName(name));
-        if (plugin) {
-            QAction *action = ui->menuPlugins->addAction(plugin->getPluginName(), this, SLOT(runPlugin()));
-            action->setObjectName(name);
-            addAction(action);
-            delete plugin;
-            hasPlugins = true;
-        }
+        QAction *action = ui->menuPlugins->addAction(name, this, SLOT(runPlugin()));
+        action->setObjectName(name);
+        addAction(action);
+        hasPlugins = true;
     }
-    if (hasPlugins)
+    if (hasPlugins) {
         ui->menuPlugins->addSeparator();
+        connect(ui->menuPlugins, &QMenu::aboutToShow, this, &QRK::updatePluginActions);
+    }
 
       ui->menuPlugins->addAction(tr("Plugins ..."), this, SLOT(viewPlugins()));
 
 }
 
+void QRK::updatePluginActions()
+{
+    /* the translated plugin name is only known after loading the plugin */
+    disconnect(ui->menuPlugins, &QMenu::aboutToShow, this, &QRK::updatePluginActions);
+
+    foreach (QAction *action, ui->menuPlugins->actions()) {
+        if (action->objectName().isEmpty())
+            continue;
+        IndependentInterface *plugin = qobject_cast<IndependentInterface *>(PluginManager::instance()->getObjectByName(action->objectName()));
+        if (plugin)
+            action->setText(plugin->getPluginName());
+    }
+}
+
 void QRK::runPlugin()
 {
     QAction *action = qobject_cast<QAction *>(QObject::sender());
@@ -477,6 +527,12 @@ void QRK::actionAbout_QRK()
     dlg.exec();
 }
 
+void QRK::actionDiagnostics()
+{
+    MetricsDialog dlg(this);
+    dlg.exec();
+}
+
 void QRK::actionQRK_Forum()
 {
     QString link = "http://forum.ckvsoft.at/";
@@ -597,7 +653,7 @@ void QRK::onDocumentButton_clicked()
         return;
     }
 
-    m_stackedWidget->setCurrentWidget(m_qrk_document);
+    m_stackedWidget->setCurrentWidget(document());
     m_qrk_document->documentList(m_qrk_home->isServerMode());
 }
 
@@ -695,7 +751,15 @@ void QRK::closeCashRegister()
 {
     Reports rep(this, true);
     rep.endOfMonth();
-    rep.createNullReceipt(PAYED_BY_CONCLUSION_RECEIPT);
+
+    QSqlDatabase dbc = Database::database();
+    dbc.transaction();
+    if (rep.createNullReceipt(PAYED_BY_CONCLUSION_RECEIPT)) {
+        dbc.commit();
+    } else {
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
+    }
     Database::setCashRegisterInAktive();
     backupDEP();
     restartApplication();
@@ -709,6 +773,57 @@ void QRK::actionResuscitationCashRegister()
     restartApplication();
 }
 
+void QRK::checkDEP()
+{
+    if (!RBAC::Instance()->hasPermission("admin_access", true)) return;
+
+    ui->actionDEPcheck->setEnabled(false);
+    statusBar()->showMessage(tr("DEP-7 wird im Hintergrund überprüft ..."));
+
+    QThread *thread = new QThread;
+    TurnOverCounterCheck *check = new TurnOverCounterCheck;
+    check->moveToThread(thread);
+
+    connect(thread, &QThread::started, check, &TurnOverCounterCheck::run);
+    connect(check, &TurnOverCounterCheck::finished, this, &QRK::checkDEPFinished);
+    connect(check, &TurnOverCounterCheck::finished, thread, &QThread::quit);
+    connect(thread, &QThread::finished, check, &QObject::deleteLater);
+    connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+
+    thread->start();
+}
+
+void QRK::checkDEPFinished(bool ok, QStringList error)
+{
+    ui->actionDEPcheck->setEnabled(true);
+    statusBar()->clearMessage();
+
+    if (ok && error.isEmpty()) {
+        QMessageBox::information(this, tr("DEP-7 Prüfung"), tr("Das DEP-7 wurde vollständig überprüft. Es wurden keine Fehler gefunden."));
+        return;
+    }
+
+    QMessageBox messageBox(QMessageBox::Critical,
+                           tr("DEP-7 Prüfung"),
+                           tr("ACHTUNG! Das gespeicherte DEP-7 hat einen oder mehrere Fehler."),
+                           QMessageBox::Ok,
+                           this);
+    messageBox.setDetailedText(error.join('\n'));
+    messageBox.exec();
+}
+
+void QRK::rebuildSalesTotals()
+{
+    if (!RBAC::Instance()->hasPermission("admin_access", true)) return;
+
+    if (Database::rebuildSalesTotals()) {
+        Spread::Instance()->setSalesTotal(QDateTime(), 0.0);
+        QMessageBox::information(this, tr("Umsatzsummen"), tr("Die Tages-, Monats- und Jahressummen wurden neu berechnet."));
+    } else {
+        QMessageBox::warning(this, tr("Umsatzsummen"), tr("Die Umsatzsummen konnten nicht neu berechnet werden. (siehe Logdatei)"));
+    }
+}
+
 void QRK::backupDEP()
 {
     if (Export::getLastMonthReceiptId() == -1) {
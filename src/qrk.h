@@ -71,6 +71,7 @@ private slots:
     void finishedReceipt();
     void init();
     void initPlugins();
+    void updatePluginActions();
 
     void onDocumentButton_clicked();
     void onCancelDocumentButton_clicked();
@@ -80,6 +81,9 @@ private slots:
     void exportProducts_CSV();
     void infoFON();
     void backupDEP();
+    void checkDEP();
+    void checkDEPFinished(bool ok, QStringList error);
+    void rebuildSalesTotals();
     void backup();
     void runPlugin();
     void viewPlugins();
@@ -88,6 +92,7 @@ private slots:
 
     void actionAclManager();
     void actionAbout_QRK();
+    void actionDiagnostics();
     void actionQRK_Forum();
     void actionLeaveDemoMode();
     void actionResetDemoData();
@@ -126,6 +131,7 @@ private:
     QRKHome *m_qrk_home;
     QRKRegister *m_qrk_register;
     QRKDocument *m_qrk_document;
+    QRKDocument *document();
     QStackedWidget *m_stackedWidget;
 
     QTimer *m_timer;
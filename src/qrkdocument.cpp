@@ -24,9 +24,11 @@
 #include "database.h"
 #include "databasemanager.h"
 #include "qrkdocument.h"
+#include "receiptdetailcache.h"
 #include "documentprinter.h"
 #include "preferences/qrksettings.h"
 #include "reports.h"
+#include "singleton/fiscalperiod.h"
 #include "qrkdelegate.h"
 #include "qrktimedmessagebox.h"
 #include "utils/utils.h"
@@ -39,10 +41,15 @@
 #include <QSqlRecord>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QStandardItemModel>
+#include <QTimer>
 #include <QDebug>
 
+// rows above and below the selection which are read ahead
+static const int PREFETCH_ROWS = 10;
+
 QRKDocument::QRKDocument(QWidget *parent)
-    : QWidget(parent), ui(new Ui::QRKDocument)
+    : QWidget(parent), ui(new Ui::QRKDocument), m_prefetchRow(-1)
 
 {
 
@@ -58,6 +65,33 @@ QRKDocument::QRKDocument(QWidget *parent)
         ui->pushFreeButton->setMinimumWidth(0);
     }
 
+    // models and delegates live as long as the page, documentList() refills them
+    m_documentContentModel = new QStandardItemModel(0, REGISTER_COL_SAVE, this);
+    m_documentContentModel->setHeaderData(REGISTER_COL_COUNT, Qt::Horizontal, tr("Anz."));
+    m_documentContentModel->setHeaderData(REGISTER_COL_PRODUCT, Qt::Horizontal, tr("Artikel"));
+    m_documentContentModel->setHeaderData(REGISTER_COL_NET, Qt::Horizontal, tr("E-Netto"));
+    m_documentContentModel->setHeaderData(REGISTER_COL_TAX, Qt::Horizontal, tr("MwSt."));
+    m_documentContentModel->setHeaderData(REGISTER_COL_SINGLE, Qt::Horizontal, tr("E-Preis"));
+    m_documentContentModel->setHeaderData(REGISTER_COL_DISCOUNT, Qt::Horizontal, tr("Rabatt %"));
+    m_documentContentModel->setHeaderData(REGISTER_COL_TOTAL, Qt::Horizontal, tr("Preis"));
+
+    m_documentListModel = new QSortFilterSqlQueryModel(this);
+
+    ui->documentList->setModel(m_documentListModel);
+    ui->documentList->setItemDelegateForColumn(DOCUMENT_COL_TOTAL, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
+
+    ui->documentContent->setModel(m_documentContentModel);
+    ui->documentContent->setShowGrid(false);
+    ui->documentContent->setItemDelegateForColumn(REGISTER_COL_NET, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
+    ui->documentContent->setItemDelegateForColumn(REGISTER_COL_TAX, new QrkDelegate (QrkDelegate::COMBO_TAX, this));
+    ui->documentContent->setItemDelegateForColumn(REGISTER_COL_SINGLE, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
+    ui->documentContent->setItemDelegateForColumn(REGISTER_COL_DISCOUNT, new QrkDelegate (QrkDelegate::DISCOUNT, this));
+    ui->documentContent->setItemDelegateForColumn(REGISTER_COL_TOTAL, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
+
+    connect(m_documentListModel, &QSortFilterSqlQueryModel::sortChanged, this, &QRKDocument::sortChanged);
+    connect(ui->documentFilterEdit, &QLineEdit::textChanged, m_documentListModel, &QSortFilterSqlQueryModel::filter);
+    connect(ui->documentList->selectionModel(), &QItemSelectionModel::selectionChanged, this, &QRKDocument::onDocumentSelectionChanged);
+
     connect(ui->cancelDocumentButton, &QPushButton::clicked, this, &QRKDocument::cancelDocumentButton_clicked);
     connect(ui->printcopyButton, &QPushButton::clicked, this, &QRKDocument::onPrintcopyButton_clicked);
     connect(ui->invoiceCompanyPrintcopyButton, &QPushButton::clicked, this, &QRKDocument::onInvoiceCompanyButton_clicked);
@@ -75,12 +109,11 @@ QRKDocument::~QRKDocument()
 void QRKDocument::documentList(bool servermode)
 {
     m_servermode = servermode;
-    QSqlDatabase dbc = Database::database();
+    QSqlDatabase dbc = Database::readOnlyDatabase();
 
     ui->documentLabel->setText("");
-    m_documentContentModel = new QSqlQueryModel;
-
-    m_documentListModel = new QSortFilterSqlQueryModel;
+    m_detailCache.clear();
+    m_documentContentModel->setRowCount(0);
 
     QString driverName = dbc.driverName();
     if ( driverName == "QMYSQL" ) {
@@ -105,12 +138,6 @@ void QRKDocument::documentList(bool servermode)
     if (m_documentListModel->lastError().isValid())
         qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << m_documentListModel->lastError();
 
-    ui->documentList->setModel(m_documentListModel);
-    ui->documentList->setItemDelegateForColumn(DOCUMENT_COL_TOTAL, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
-
-    ui->documentContent->setModel(m_documentContentModel);
-    ui->documentContent->setShowGrid(false);
-
     ui->documentList->horizontalHeader()->setStretchLastSection(false);
     ui->documentList->resizeColumnsToContents();
     ui->documentContent->resizeColumnsToContents();
@@ -118,10 +145,6 @@ void QRKDocument::documentList(bool servermode)
 
     ui->documentFilterLabel->setText("Filter " + m_documentListModel->getFilterColumnName());
 
-    connect(m_documentListModel, &QSortFilterSqlQueryModel::sortChanged, this, &QRKDocument::sortChanged);
-    connect(ui->documentFilterEdit, &QLineEdit::textChanged, m_documentListModel, &QSortFilterSqlQueryModel::filter);
-    connect(ui->documentList->selectionModel(), &QItemSelectionModel::selectionChanged, this, &QRKDocument::onDocumentSelectionChanged);
-
     ui->cancellationButton->setEnabled(false);
     ui->printcopyButton->setEnabled(false);
     ui->invoiceCompanyPrintcopyButton->setEnabled(false);
@@ -148,18 +171,28 @@ void QRKDocument::onDocumentSelectionChanged(const QItemSelection &, const QItem
     }
 
     int receiptNum = m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_RECEIPT, QModelIndex())).toInt();
-    QString payedByText = m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_TYPE, QModelIndex())).toString();
     double price = m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_TOTAL, QModelIndex())).toDouble();
-    int type = Database::getActionTypeByName(payedByText);
+
+    // a miss reads the neighbours with the same query, a hit reads ahead after painting
+    m_prefetchRow = row;
+    if (m_detailCache.contains(receiptNum))
+        QTimer::singleShot(0, this, &QRKDocument::prefetchNeighbours);
+    else
+        prefetchNeighbours();
+
+    ReceiptDetailCache::Detail detail;
+    if (!m_detailCache.detail(receiptNum, detail))
+        return;
 
     bool isDamaged = false;
-    ui->pixmapLabel->setPixmap(Utils::getQRCode(receiptNum, isDamaged));
+    ui->pixmapLabel->setPixmap(Utils::getQRCode(detail.signature, isDamaged));
     ui->pixmapLabel->show();
     if (isDamaged)
         ui->qrcodeTextLabel->setText(tr("Sicherheitseinrichtung ausgefallen"));
     else
         ui->qrcodeTextLabel->setText("");
 
+    int type = detail.type;
     ui->cancellationButton->setEnabled(!Database::isCashRegisterInAktive() && type < PAYED_BY_REPORT_EOD);
     ui->invoiceCompanyPrintcopyButton->setEnabled(type < PAYED_BY_REPORT_EOD);
 
@@ -168,7 +201,7 @@ void QRKDocument::onDocumentSelectionChanged(const QItemSelection &, const QItem
         ui->documentContent->setHidden(true);
         ui->textBrowser->setHidden(false);
         ui->printcopyButton->setEnabled(true);
-        ui->textBrowser->setHtml(Reports::getReport(receiptNum));
+        ui->textBrowser->setHtml(detail.reportHtml);
 
     } else {
         ui->customerTextLabel->setHidden(false);
@@ -177,38 +210,51 @@ void QRKDocument::onDocumentSelectionChanged(const QItemSelection &, const QItem
         ui->printcopyButton->setEnabled(true);
 
         QString stornoText = "";
-        if (Database::getStorno(receiptNum) == 1)
-            stornoText = tr("(Stornierter Beleg, siehe Beleg Nr: %1)").arg(Database::getStornoId(receiptNum));
-        else if (Database::getStorno(receiptNum) == 2)
-            stornoText = tr("(Storno Beleg für Beleg Nr: %1)").arg(Database::getStornoId(receiptNum));
-
-        ui->documentLabel->setText(tr("Beleg Nr: %1\t%2\t%3\t\t%4").arg(receiptNum).arg(payedByText).arg(QString::number(price, 'f', 2)).arg(stornoText));
-        ui->customerTextLabel->setText(tr("Kunden Zusatztext: ") + Database::getCustomerText(receiptNum));
-
-        QSqlDatabase dbc = Database::database();
-        int id = ui->documentList->model()->data(m_documentListModel->index(row, REGISTER_COL_COUNT, QModelIndex())).toInt();
-
-        m_documentContentModel->setQuery(QString("SELECT orders.count, products.name, round(orders.net,2), orders.tax, orders.gross, orders.discount * (-1), ROUND((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount),2) AS Price FROM orders INNER JOIN products ON products.id=orders.product WHERE orders.receiptId=%1").arg(id), dbc);
-        m_documentContentModel->setHeaderData(REGISTER_COL_COUNT, Qt::Horizontal, tr("Anz."));
-        m_documentContentModel->setHeaderData(REGISTER_COL_PRODUCT, Qt::Horizontal, tr("Artikel"));
-        m_documentContentModel->setHeaderData(REGISTER_COL_NET, Qt::Horizontal, tr("E-Netto"));
-        m_documentContentModel->setHeaderData(REGISTER_COL_TAX, Qt::Horizontal, tr("MwSt."));
-        m_documentContentModel->setHeaderData(REGISTER_COL_SINGLE, Qt::Horizontal, tr("E-Preis"));
-        m_documentContentModel->setHeaderData(REGISTER_COL_DISCOUNT, Qt::Horizontal, tr("Rabatt %"));
-        m_documentContentModel->setHeaderData(REGISTER_COL_TOTAL, Qt::Horizontal, tr("Preis"));
-        ui->documentContent->setItemDelegateForColumn(REGISTER_COL_NET, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
-        ui->documentContent->setItemDelegateForColumn(REGISTER_COL_TAX, new QrkDelegate (QrkDelegate::COMBO_TAX, this));
-        ui->documentContent->setItemDelegateForColumn(REGISTER_COL_SINGLE, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
-        ui->documentContent->setItemDelegateForColumn(REGISTER_COL_DISCOUNT, new QrkDelegate (QrkDelegate::DISCOUNT, this));
-        ui->documentContent->setItemDelegateForColumn(REGISTER_COL_TOTAL, new QrkDelegate (QrkDelegate::NUMBERFORMAT_DOUBLE, this));
-
-        ui->documentContent->resizeColumnsToContents();
-        ui->documentContent->horizontalHeader()->setSectionResizeMode(REGISTER_COL_PRODUCT, QHeaderView::Stretch);
-        //ui->documentContent->setColumnHidden(REGISTER_COL_NET, true);
+        if (detail.storno == 1)
+            stornoText = tr("(Stornierter Beleg, siehe Beleg Nr: %1)").arg(detail.stornoId);
+        else if (detail.storno == 2)
+            stornoText = tr("(Storno Beleg für Beleg Nr: %1)").arg(detail.stornoId);
 
+        ui->documentLabel->setText(tr("Beleg Nr: %1\t%2\t%3\t\t%4").arg(receiptNum).arg(detail.actionText).arg(QString::number(price, 'f', 2)).arg(stornoText));
+        ui->customerTextLabel->setText(tr("Kunden Zusatztext: ") + detail.customerText);
+
+        showContent(detail);
     }
 }
 
+void QRKDocument::prefetchNeighbours()
+{
+    int first = qMax(0, m_prefetchRow - PREFETCH_ROWS);
+    int last = qMin(m_documentListModel->rowCount() - 1, m_prefetchRow + PREFETCH_ROWS);
+
+    QList<int> receiptNums;
+    for (int row = first; row <= last; row++)
+        receiptNums.append(m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_RECEIPT, QModelIndex())).toInt());
+
+    m_detailCache.prefetch(receiptNums);
+}
+
+void QRKDocument::showContent(const ReceiptDetailCache::Detail &detail)
+{
+    m_documentContentModel->setRowCount(detail.lines.size());
+
+    int row = 0;
+    foreach (const ReceiptDetailCache::Line &line, detail.lines) {
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_COUNT), line.count);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_PRODUCT), line.name);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_NET), line.net);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_TAX), line.tax);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_SINGLE), line.gross);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_DISCOUNT), line.discount);
+        m_documentContentModel->setData(m_documentContentModel->index(row, REGISTER_COL_TOTAL), line.price);
+        row++;
+    }
+
+    ui->documentContent->resizeColumnsToContents();
+    ui->documentContent->horizontalHeader()->setSectionResizeMode(REGISTER_COL_PRODUCT, QHeaderView::Stretch);
+    //ui->documentContent->setColumnHidden(REGISTER_COL_NET, true);
+}
+
 //--------------------------------------------------------------------------------
 
 void QRKDocument::onCancellationButton_clicked()
@@ -231,42 +277,37 @@ void QRKDocument::onCancellationButton_clicked()
 
     int id = m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_RECEIPT, QModelIndex())).toInt();
 
-    int storno = Database::getStorno(id);
+    int stornoId = 0;
+    int storno = Database::getStorno(id, stornoId);
     if (storno)
     {
         QString stornoText = "";
         if (storno == 1)
-            stornoText = tr("Beleg mit der Nummer %1 wurde bereits storniert. Siehe Beleg Nr: %2").arg(id).arg(Database::getStornoId(id));
+            stornoText = tr("Beleg mit der Nummer %1 wurde bereits storniert. Siehe Beleg Nr: %2").arg(id).arg(stornoId);
         else
-            stornoText = tr("Beleg mit der Nummer %1 ist ein Stornobeleg von Beleg Nummer %2 und kann nicht storniert werden.\nErstellen Sie einen neuen Beleg. (Kassabon)").arg(id).arg(Database::getStornoId(id));
+            stornoText = tr("Beleg mit der Nummer %1 ist ein Stornobeleg von Beleg Nummer %2 und kann nicht storniert werden.\nErstellen Sie einen neuen Beleg. (Kassabon)").arg(id).arg(stornoId);
 
         QMessageBox::warning( this, tr("Storno"), stornoText);
         emit documentButton_clicked();
         return;
     }
 
-    int payedBy = Database::getPayedBy(id);
-    Reports rep;
-    bool ret = rep.checkEOAny(); //  rep->checkEOAnyServerMode();
+    bool ret = FiscalPeriod::Instance()->isOpen();
+    if (!ret) {
+        Reports rep;
+        ret = rep.checkEOAny(); //  rep->checkEOAnyServerMode();
+    }
     if (! ret) {
         emit documentButton_clicked();
         return;
     }
 
     ReceiptItemModel reg;
-    reg.clear();
-    reg.newOrder();
-    reg.storno(id);
-
-    m_currentReceipt = reg.createReceipts();
-    if ( m_currentReceipt ) {
-        reg.setCurrentReceiptNum(m_currentReceipt);
-        if ( reg.createOrder(true) ) {
-            if ( reg.finishReceipts(payedBy, id) ) {
-                emit documentButton_clicked();
-                return;
-            }
-        }
+    if ( reg.cancelReceipt(id) ) {
+        // the storno state of the cancelled receipt has changed
+        m_detailCache.clear();
+        m_currentReceipt = reg.getReceiptNum();
+        emit documentButton_clicked();
     }
 }
 
@@ -290,12 +331,16 @@ void QRKDocument::onPrintcopyButton_clicked(bool isInvoiceCompany)
 
 
     QString payedByText = m_documentListModel->data(m_documentListModel->index(row, DOCUMENT_COL_TYPE, QModelIndex())).toString();
-    int type = Database::getActionTypeByName(payedByText);
+    ReceiptDetailCache::Detail detail;
+    if (!m_detailCache.detail(id, detail))
+        return;
+
+    int type = detail.type;
 
     if (type == PAYED_BY_REPORT_EOD || type == PAYED_BY_REPORT_EOM) { /* actionType Tagesbeleg*/
         QString DocumentTitle = QString("BELEG_%1_%2").arg(id).arg(payedByText);
         QTextDocument doc;
-        doc.setHtml(Reports::getReport(id));
+        doc.setHtml(detail.reportHtml);
 
         DocumentPrinter p;
         p.printDocument(&doc, DocumentTitle);
@@ -324,9 +369,10 @@ void QRKDocument::onPrintcopyButton_clicked(bool isInvoiceCompany)
         QJsonObject data = reg.compileData();
 
         data["isCopy"] = true;
-        int storno = Database::getStorno(id);
+        int stornoId = 0;
+        int storno = Database::getStorno(id, stornoId);
         if (storno == 2) {
-            id = Database::getStornoId(id);
+            id = stornoId;
             data["comment"] = (id > 0)? tr("Storno für Beleg Nr: %1").arg(id):settings.value("receiptPrinterHeading", "KASSABON").toString();
         }
 
@@ -24,10 +24,13 @@
 #define QRKDOCUMENT_H
 
 #include "qsortfiltersqlquerymodel.h"
+#include "receiptdetailcache.h"
 
 #include <QWidget>
 #include <QItemSelection>
 
+class QStandardItemModel;
+
 namespace Ui {
   class QRKDocument;
 }
@@ -58,11 +61,16 @@ class QRKDocument : public QWidget
 
   protected slots:
     void onDocumentSelectionChanged(const QItemSelection &, const QItemSelection &);
+    void prefetchNeighbours();
 
   private:
+    void showContent(const ReceiptDetailCache::Detail &detail);
+
     Ui::QRKDocument *ui;
-    QSqlQueryModel *m_documentContentModel;
+    QStandardItemModel *m_documentContentModel;
     QSortFilterSqlQueryModel *m_documentListModel;
+    ReceiptDetailCache m_detailCache;
+    int m_prefetchRow;
 
     int m_currentReceipt;
     bool m_receiptPrintDialog;
@@ -46,6 +46,7 @@ QRKHome::QRKHome(bool servermode, QWidget *parent)
     : QWidget(parent),ui(new Ui::QRKHome), m_menu(0)
 {
     connect(Spread::Instance(), &SpreadSignal::updateSafetyDevice, this, &QRKHome::safetyDevice);
+    connect(Spread::Instance(), &SpreadSignal::updateSalesTotal, this, &QRKHome::salesTotal);
     connect(RBAC::Instance(), static_cast<void(Acl::*)()>(&Acl::userChanged), this, &QRKHome::init);
 
     ui->setupUi(this);
@@ -319,9 +320,7 @@ void QRKHome::init()
 
     if (settings.value("showSalesWidget", true).toBool() && RBAC::Instance()->hasPermission("salesinfo_view")) {
         ui->salesFrame->setHidden(false);
-        ui->lcdNumberDay->display(Database::getDayCounter());
-        ui->lcdNumberMonth->display(Database::getMonthCounter());
-        ui->lcdNumberYear->display(Database::getYearCounter());
+        loadSalesTotals();
     } else {
         ui->salesFrame->setHidden(true);
     }
@@ -517,8 +516,44 @@ void QRKHome::importInfo(QString str, bool isError)
     ui->importWidget->setWordWrap( true);
 //    ui->importWidget->repaint();
 
-    ui->lcdNumberDay->display(Database::getDayCounter());
-    ui->lcdNumberMonth->display(Database::getMonthCounter());
-    ui->lcdNumberYear->display(Database::getYearCounter());
+}
+
+void QRKHome::loadSalesTotals()
+{
+    m_salesDate = QDate::currentDate();
+    m_salesDay = Database::getDayCounter().toDouble();
+    m_salesMonth = Database::getMonthCounter().toDouble();
+    m_salesYear = Database::getYearCounter().toDouble();
+
+    displaySalesTotals();
+}
+
+void QRKHome::displaySalesTotals()
+{
+    ui->lcdNumberDay->display(QString::number(m_salesDay, 'f', 2));
+    ui->lcdNumberMonth->display(QString::number(m_salesMonth, 'f', 2));
+    ui->lcdNumberYear->display(QString::number(m_salesYear, 'f', 2));
+}
+
+/**
+ * @brief QRKHome::salesTotal
+ * adds a finished receipt to the displayed totals, reloads them after
+ * midnight or when dateTime is invalid (totals rebuilt)
+ */
+void QRKHome::salesTotal(QDateTime dateTime, double gross)
+{
+    if (!dateTime.isValid() || m_salesDate != QDate::currentDate()) {
+        loadSalesTotals();
+        return;
+    }
+
+    QDate date = dateTime.date();
+    if (date == m_salesDate)
+        m_salesDay += gross;
+    if (date.year() == m_salesDate.year() && date.month() == m_salesDate.month())
+        m_salesMonth += gross;
+    if (date.year() == m_salesDate.year())
+        m_salesYear += gross;
 
+    displaySalesTotals();
 }
@@ -26,6 +26,7 @@
 #include <QWidget>
 #include <QFileInfoList>
 #include <QFileSystemWatcher>
+#include <QDateTime>
 
 class FileWatcher;
 class QFrame;
@@ -71,6 +72,7 @@ class QRKHome : public QWidget
     void settingsSlot();
     void serverModeCheckBox_clicked(bool checked);
     void importInfo(QString str, bool isError);
+    void salesTotal(QDateTime dateTime, double gross);
     void dayPushButton_clicked(bool);
     void monthPushButton_clicked(bool);
     void yearPushButton_clicked(bool);
@@ -85,6 +87,13 @@ class QRKHome : public QWidget
     QString m_watcherpath;
     bool m_previousSafetyDeviceState = true;
 
+    void loadSalesTotals();
+    void displaySalesTotals();
+    QDate m_salesDate;
+    double m_salesDay = 0.0;
+    double m_salesMonth = 0.0;
+    double m_salesYear = 0.0;
+
 };
 
 #endif // HOME_H
@@ -29,6 +29,7 @@
 #include "documentprinter.h"
 #include "utils/utils.h"
 #include "reports.h"
+#include "singleton/fiscalperiod.h"
 #include "pluginmanager/pluginmanager.h"
 #include "qrkprogress.h"
 #include "3rdparty/ckvsoft/rbac/acl.h"
@@ -277,7 +278,6 @@ void QRKRegister::quickGroupButtons()
                                                                                                                                   "}"
                     );
 
-        qApp->processEvents();
         m_buttonGroupGroups->addButton(pb,query.value(0).toInt());
         flowLayout->addWidget(pb);
 
@@ -300,9 +300,8 @@ void QRKRegister::numPadValueButtonPressed(const QString &text, REGISTER_COL col
         else
             newText.round(2);
 
-        QStandardItem *item = m_orderListModel->item(idx.row(), column);
-        if (item) {
-            item->setText( newText.toString() );
+        if (idx.row() < m_orderListModel->rowCount()) {
+            m_orderListModel->setValue(idx.row(), column, newText.toString());
             ui->orderList->selectionModel()->setCurrentIndex(idx, QItemSelectionModel::NoUpdate);
             ui->orderList->edit(idx);
         }
@@ -477,32 +476,29 @@ void QRKRegister::addProductToOrderList(int id)
 
     if (query.next()) {
         QString name = query.value("name").toString();
-        QList<QStandardItem*> list = m_orderListModel->findItems(name, Qt::MatchExactly,REGISTER_COL_PRODUCT);
-        if (list.count() > 0 && !forceOverwrite) {
-            foreach( QStandardItem *item, list ) {
-                int row = item->row();
-                QBCMath count(m_orderListModel->item(row, REGISTER_COL_COUNT)->text().toDouble());
-                if (ui->numPadLabel->text().toDouble() > 0.00)
-                    count += ui->numPadLabel->text().toDouble();
-                else
-                    count += 1;
-                count.round(m_decimaldigits);
-                m_orderListModel->item(row, REGISTER_COL_COUNT)->setText( count.toString() );
-                QModelIndex idx = m_orderListModel->index(row, REGISTER_COL_COUNT);
-
-                if (!m_barcodeInputLineEditDefault) {
-                    ui->orderList->selectionModel()->setCurrentIndex(idx, QItemSelectionModel::NoUpdate);
-                    ui->orderList->edit(idx);
-                } else {
-                    ui->barcodeLineEdit->setFocus();
-                }
-                ui->numericKeyPad->clear();
-
-                return;
+        int row = m_orderListModel->findProduct(name);
+        if (row >= 0 && !forceOverwrite) {
+            QBCMath count(m_orderListModel->value(row, REGISTER_COL_COUNT).toDouble());
+            if (ui->numPadLabel->text().toDouble() > 0.00)
+                count += ui->numPadLabel->text().toDouble();
+            else
+                count += 1;
+            count.round(m_decimaldigits);
+            m_orderListModel->setValue(row, REGISTER_COL_COUNT, count.toString());
+            QModelIndex idx = m_orderListModel->index(row, REGISTER_COL_COUNT);
+
+            if (!m_barcodeInputLineEditDefault) {
+                ui->orderList->selectionModel()->setCurrentIndex(idx, QItemSelectionModel::NoUpdate);
+                ui->orderList->edit(idx);
+            } else {
+                ui->barcodeLineEdit->setFocus();
             }
+            ui->numericKeyPad->clear();
+
+            return;
         }
 
-        bool newItem = m_orderListModel->item(rc -1, REGISTER_COL_PRODUCT)->text().isEmpty();
+        bool newItem = m_orderListModel->value(rc -1, REGISTER_COL_PRODUCT).toString().isEmpty();
         if (!newItem && !forceOverwrite) {
             plusSlot();
             rc = m_orderListModel->rowCount();
@@ -517,10 +513,7 @@ void QRKRegister::addProductToOrderList(int id)
         else
             count = count.toInt();
 
-        m_orderListModel->item(rc -1, REGISTER_COL_COUNT)->setText( count.toString() );
-        m_orderListModel->item(rc -1, REGISTER_COL_PRODUCT)->setText( query.value("name").toString() );
-        m_orderListModel->item(rc -1, REGISTER_COL_TAX)->setText( query.value("tax").toString() );
-        m_orderListModel->item(rc -1, REGISTER_COL_SINGLE)->setText( query.value("gross").toString() );
+        m_orderListModel->setLine(rc -1, count.toDouble(), query.value("name").toString(), query.value("tax").toDouble(), query.value("gross").toString());
 
         if (!m_barcodeInputLineEditDefault) {
             QModelIndex idx = m_orderListModel->index(rc -1, REGISTER_COL_COUNT);
@@ -537,7 +530,7 @@ void QRKRegister::addProductToOrderList(int id)
 
 void QRKRegister::updateOrderSum()
 {
-    double sum = 0;
+    double sum = m_orderListModel->getSum();
     bool enabled = true;
     int rows = m_orderListModel->rowCount();
     if (rows == 0)
@@ -545,14 +538,10 @@ void QRKRegister::updateOrderSum()
 
     for (int row = 0; row < rows; row++)
     {
-        QStringList dTemp = m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_TOTAL, QModelIndex())).toString().split(" ");
-        QString sTemp = m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_PRODUCT, QModelIndex())).toString();
-        if (sTemp.isEmpty())
+        if (m_orderListModel->value(row, REGISTER_COL_PRODUCT).toString().isEmpty()) {
             enabled = false;
-
-        double d4 = dTemp[0].toDouble();
-
-        sum += d4;
+            break;
+        }
     }
 
     if (rows > 0)
@@ -571,7 +560,8 @@ bool QRKRegister::finishReceipts(int payedBy, int id, bool isReport)
     waitBar.setWaitMode();
     waitBar.show();
 
-    qApp->processEvents();
+    /* paint the wait bar only, no user input while the receipt is written */
+    qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
     QDateTime dt = QDateTime::currentDateTime();;
     m_orderListModel->setCustomerText(ui->customerText->text());
@@ -671,15 +661,22 @@ void QRKRegister::createCheckReceipt(bool)
     waitBar.setWaitMode();
     waitBar.show();
 
-    qApp->processEvents();
+    /* paint the wait bar only, no user input while the receipt is written */
+    qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
-    Reports rep;
-    bool ret = rep.checkEOAny();
+    bool ret = FiscalPeriod::Instance()->isOpen();
+    if (!ret) {
+        Reports rep;
+        ret = rep.checkEOAny();
+    }
     if (!ret) {
         return;
     }
 
-    if (m_orderListModel->createNullReceipt(CONTROL_RECEIPT)) {
+    /* receipt and running totals are committed together */
+    QSqlDatabase dbc = Database::database();
+    dbc.transaction();
+    if (m_orderListModel->createNullReceipt(CONTROL_RECEIPT) && dbc.commit()) {
         emit finishedReceipt();
 
         if (m_receiptPrintDialog) {
@@ -695,6 +692,8 @@ void QRKRegister::createCheckReceipt(bool)
             messageBox.exec();
         }
     } else {
+        dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: can't create CheckReceipt";
     }
 }
@@ -754,9 +753,7 @@ void QRKRegister::finishedPlus()
     if (m_useMaximumItemSold) {
         QStringList list;
         list = Database::getMaximumItemSold();
-        m_orderListModel->setItem(row, REGISTER_COL_PRODUCT, new QStandardItem(list.at(0)));
-        m_orderListModel->setItem(row, REGISTER_COL_TAX, new QStandardItem(list.at(1)));
-        m_orderListModel->setItem(row, REGISTER_COL_SINGLE, new QStandardItem(list.at(2)));
+        m_orderListModel->setLine(row, 1.0, list.at(0), list.at(1).toDouble(), list.at(2));
     }
 
     ui->orderList->selectRow(row);
@@ -836,8 +833,12 @@ void QRKRegister::onButtonGroup_payNow_clicked(int payedBy)
     QDate date;
     date = QDate::currentDate();
 
-    Reports rep;
-    bool ret = rep.checkEOAny(date);
+    /* only build the Reports model when a closing is due */
+    bool ret = FiscalPeriod::Instance()->isOpen(date);
+    if (!ret) {
+        Reports rep;
+        ret = rep.checkEOAny(date);
+    }
     if (!ret) {
         setButtonGroupEnabled(true);
         return;
@@ -847,7 +848,6 @@ void QRKRegister::onButtonGroup_payNow_clicked(int payedBy)
         double sum = ui->sumLabel->text().replace(Database::getCurrency() ,"").toDouble();
         GivenDialog given(sum, this);
         if (given.exec() == 0) {
-            qApp->processEvents();
             setButtonGroupEnabled(true);
             return;
         }
@@ -861,14 +861,14 @@ void QRKRegister::onButtonGroup_payNow_clicked(int payedBy)
 
         for(int row = 0; row < rc; row++) {
             /* TODO: check for Autosave */
-            bool checked = m_orderListModel->item(row ,REGISTER_COL_SAVE)->checkState();
+            bool checked = m_orderListModel->value(row ,REGISTER_COL_SAVE).toBool();
             Q_UNUSED(checked);
 
             list.clear();
-            list << m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_PRODUCT, QModelIndex())).toString()
-                 << m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_TAX, QModelIndex())).toString()
-                 << m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_NET, QModelIndex())).toString()
-                 << m_orderListModel->data(m_orderListModel->index(row, REGISTER_COL_SINGLE, QModelIndex())).toString()
+            list << m_orderListModel->value(row, REGISTER_COL_PRODUCT).toString()
+                 << m_orderListModel->value(row, REGISTER_COL_TAX).toString()
+                 << m_orderListModel->value(row, REGISTER_COL_NET).toString()
+                 << m_orderListModel->value(row, REGISTER_COL_SINGLE).toString()
                  << "1";
 
             Database::addProduct(list);
@@ -907,7 +907,7 @@ void QRKRegister::onButtonGroup_payNow_clicked(int payedBy)
             messageBox.exec();
         }
 
-        QStringList stockList = Database::getStockInfoList();
+        QStringList stockList = m_orderListModel->getStockInfoList();
         if (m_minstockDialog && stockList.count() > 0) {
             QMessageBox messageBox(QMessageBox::Information,
                                           tr("Lagerbestand"),
@@ -923,6 +923,7 @@ void QRKRegister::onButtonGroup_payNow_clicked(int payedBy)
         }
     } else {
         sql_ok = dbc.rollback();
+        FiscalPeriod::Instance()->invalidate();
         QMessageBox::warning(this, tr("Fehler"), tr("Datenbank und/oder Signatur Fehler!\nAktueller BON kann nicht erstellt werden. (Rollback: %1).\nÜberprüfen Sie ob genügend Speicherplatz für die Datenbank vorhanden ist. Weitere Hilfe gibt es im Forum. http:://www.ckvsoft.at").arg(sql_ok?tr("durchgeführt"):tr("fehlgeschlagen") ));
         qCritical() << "Function Name: " << Q_FUNC_INFO << " Error: " << dbc.lastError().text();
     }
@@ -958,20 +959,8 @@ void QRKRegister::receiptToInvoiceSlot()
         if (rc == 1) {
             m_isR2B = true;
 
-            m_orderListModel->blockSignals(true);
-            m_orderListModel->item(0, REGISTER_COL_COUNT)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_PRODUCT)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_NET)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_TAX)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_SINGLE)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_DISCOUNT)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-            m_orderListModel->item(0, REGISTER_COL_TOTAL)->setFlags(Qt::ItemIsEnabled | Qt::ItemIsSelectable);
-
-            m_orderListModel->item(0, REGISTER_COL_COUNT)->setText( "1" );
-            m_orderListModel->item(0, REGISTER_COL_PRODUCT)->setText( r2b.getInvoiceNum() );
-            m_orderListModel->item(0, REGISTER_COL_TAX)->setText( "0" );
-            m_orderListModel->blockSignals(false);
-            m_orderListModel->item(0, REGISTER_COL_SINGLE)->setText( r2b.getInvoiceSum() );
+            m_orderListModel->setRowEditable(0, false);
+            m_orderListModel->setLine(0, 1.0, r2b.getInvoiceNum(), 0.0, r2b.getInvoiceSum());
 
             ui->plusButton->setEnabled(false);
 
@@ -987,7 +976,6 @@ void QRKRegister::receiptToInvoiceSlot()
 void QRKRegister::clearModel()
 {
     m_orderListModel->clear();
-    m_orderListModel->setRowCount(0);
 }
 
 //--------------------------------------------------------------------------------
@@ -1004,7 +992,7 @@ void QRKRegister::onCancelRegisterButton_clicked()
     writeSettings();
 
     if (m_orderListModel->rowCount() > 0 ) {
-        if (m_orderListModel->item(0, REGISTER_COL_PRODUCT)->text() == "") {
+        if (m_orderListModel->value(0, REGISTER_COL_PRODUCT).toString() == "") {
             emit cancelRegisterButton_clicked();
             return;
         }
@@ -0,0 +1,187 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#include "receiptdetailcache.h"
+#include "database.h"
+#include "defines.h"
+#include "reports.h"
+#include "utils/metrics.h"
+
+#include <QSqlQuery>
+#include <QSqlError>
+#include <QDebug>
+
+ReceiptDetailCache::ReceiptDetailCache(int maxBytes)
+    : m_cache(maxBytes)
+{
+}
+
+bool ReceiptDetailCache::contains(int receiptNum) const
+{
+    return m_cache.contains(receiptNum);
+}
+
+/**
+ * @brief ReceiptDetailCache::detail
+ * @param receiptNum
+ * @param detail copy of the cached entry, read from the database on a miss
+ * @return false if the receipt does not exist
+ */
+bool ReceiptDetailCache::detail(int receiptNum, Detail &detail)
+{
+    Detail *cached = m_cache.object(receiptNum);
+    if (cached) {
+        Metrics::addCount("document.cache.hits");
+        detail = *cached;
+        return true;
+    }
+
+    Metrics::addCount("document.cache.misses");
+    return load(QList<int>() << receiptNum, receiptNum, &detail);
+}
+
+/**
+ * @brief ReceiptDetailCache::prefetch
+ * reads all receipts which are not cached yet with one query
+ * @param receiptNums
+ */
+void ReceiptDetailCache::prefetch(const QList<int> &receiptNums)
+{
+    QList<int> missing;
+    foreach (int receiptNum, receiptNums)
+        if (receiptNum > 0 && !m_cache.contains(receiptNum) && !missing.contains(receiptNum))
+            missing.append(receiptNum);
+
+    if (!missing.isEmpty())
+        load(missing);
+}
+
+void ReceiptDetailCache::clear()
+{
+    m_cache.clear();
+}
+
+bool ReceiptDetailCache::load(const QList<int> &receiptNums, int receiptNum, Detail *detail)
+{
+    MetricsTimer timer("document.cache.load");
+
+    QStringList ids;
+    foreach (int id, receiptNums)
+        ids.append(QString::number(id));
+
+    // a lagging replica would keep an old storno state for the whole session
+    QSqlDatabase dbc = Database::readOnlyDatabase(true);
+    QSqlQuery query(dbc);
+    query.setForwardOnly(true);
+
+    // part 0: header with order lines, part 1: report lines
+    bool ok = query.exec(QString("SELECT receipts.receiptNum, receipts.payedBy, actionTypes.actionText, receipts.storno, receipts.stornoId, customer.text AS customerText, dep.data AS signature, "
+                                 "0 AS part, orders.id AS seq, orders.count, products.name, ROUND(orders.net,2) AS net, orders.tax, orders.gross, orders.discount * (-1) AS discount, "
+                                 "ROUND((orders.count * orders.gross) - ((orders.count * orders.gross / 100) * orders.discount),2) AS price, NULL AS reportTimestamp, NULL AS reportText "
+                                 "FROM receipts INNER JOIN actionTypes ON receipts.payedBy=actionTypes.actionId LEFT JOIN customer ON customer.receiptNum=receipts.receiptNum "
+                                 "LEFT JOIN dep ON dep.receiptNum=receipts.receiptNum LEFT JOIN orders ON orders.receiptId=receipts.receiptNum LEFT JOIN products ON products.id=orders.product "
+                                 "WHERE receipts.receiptNum IN (%1) "
+                                 "UNION ALL "
+                                 "SELECT reports.receiptNum, NULL, NULL, NULL, NULL, NULL, NULL, 1, reports.id, NULL, NULL, NULL, NULL, NULL, NULL, NULL, reports.timestamp, reports.text "
+                                 "FROM reports WHERE reports.receiptNum IN (%1) "
+                                 "ORDER BY receiptNum, part, seq").arg(ids.join(",")));
+    if (!ok) {
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Error: " << query.lastError().text();
+        qWarning() << "Function Name: " << Q_FUNC_INFO << " Query: " << Database::getLastExecutedQuery(query);
+        return false;
+    }
+
+    QMap<int, Detail> details;
+    QMap<int, QDate> reportDates;
+    QMap<int, QStringList> reportLines;
+    QMap<int, int> lastSeq;
+
+    while (query.next()) {
+        int id = query.value("receiptNum").toInt();
+        int seq = query.value("seq").toInt();
+
+        if (query.value("part").toInt() == 1) {
+            if (!details.contains(id))
+                continue;
+            if (!reportDates.contains(id))
+                reportDates.insert(id, query.value("reportTimestamp").toDate());
+            reportLines[id].append(query.value("reportText").toString());
+            continue;
+        }
+
+        if (!details.contains(id)) {
+            Detail d;
+            d.receiptNum = id;
+            d.type = query.value("payedBy").toInt();
+            d.actionText = query.value("actionText").toString();
+            d.storno = query.value("storno").toInt();
+            d.stornoId = query.value("stornoId").toInt();
+            d.customerText = query.value("customerText").toString();
+            d.signature = query.value("signature").toString();
+            details.insert(id, d);
+        }
+
+        // orders without product are not shown, a second customer or dep row repeats the lines
+        if (query.value("name").isNull() || lastSeq.value(id) == seq)
+            continue;
+        lastSeq.insert(id, seq);
+
+        Line line;
+        line.count = query.value("count").toDouble();
+        line.name = query.value("name").toString();
+        line.net = query.value("net").toDouble();
+        line.tax = query.value("tax").toDouble();
+        line.gross = query.value("gross").toDouble();
+        line.discount = query.value("discount").toDouble();
+        line.price = query.value("price").toDouble();
+        details[id].lines.append(line);
+    }
+
+    QMap<int, Detail>::iterator it;
+    for (it = details.begin(); it != details.end(); ++it) {
+        Detail &d = it.value();
+        if (d.type == PAYED_BY_REPORT_EOD || d.type == PAYED_BY_REPORT_EOM)
+            d.reportHtml = Reports::renderReport(d.receiptNum, d.actionText, d.type, reportDates.value(d.receiptNum), reportLines.value(d.receiptNum));
+
+        if (detail && d.receiptNum == receiptNum)
+            *detail = d;
+
+        m_cache.insert(d.receiptNum, new Detail(d), cost(d));
+    }
+
+    Metrics::addValue("document.cache.rows", details.size());
+    return !detail || details.contains(receiptNum);
+}
+
+/**
+ * @brief ReceiptDetailCache::cost
+ * approximate memory use of an entry in bytes
+ */
+int ReceiptDetailCache::cost(const Detail &detail)
+{
+    int bytes = int(sizeof(Detail));
+    bytes += (detail.actionText.size() + detail.customerText.size() + detail.signature.size() + detail.reportHtml.size()) * int(sizeof(QChar));
+    foreach (const Line &line, detail.lines)
+        bytes += int(sizeof(Line)) + line.name.size() * int(sizeof(QChar));
+
+    return bytes;
+}
@@ -0,0 +1,78 @@
+/*
+ * This file is part of QRK - Qt Registrier Kasse
+ *
+ * Copyright (C) 2015-2019 Christian Kvasny <chris@ckvsoft.at>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <http://www.gnu.org/licenses/>.
+ *
+ * Button Design, and Idea for the Layout are lean out from LillePOS, Copyright 2010, Martin Koller, kollix@aon.at
+ *
+*/
+
+#ifndef RECEIPTDETAILCACHE_H
+#define RECEIPTDETAILCACHE_H
+
+#include <QCache>
+#include <QDate>
+#include <QList>
+#include <QStringList>
+
+/**
+ * @brief The ReceiptDetailCache class
+ * keeps what the document view shows for a receipt: header, storno state,
+ * customer text, DEP signature, order lines and the rendered report. Missing
+ * receipts are read together with one query, the cache is bounded by the
+ * approximate size of the entries.
+ */
+class ReceiptDetailCache
+{
+  public:
+    struct Line {
+        double count;
+        QString name;
+        double net;
+        double tax;
+        double gross;
+        double discount;
+        double price;
+    };
+
+    struct Detail {
+        Detail() : receiptNum(0), type(0), storno(0), stornoId(0) {}
+        int receiptNum;
+        int type;
+        QString actionText;
+        int storno;
+        int stornoId;
+        QString customerText;
+        QString signature;
+        QList<Line> lines;
+        QString reportHtml;
+    };
+
+    explicit ReceiptDetailCache(int maxBytes = 4 * 1024 * 1024);
+
+    bool contains(int receiptNum) const;
+    bool detail(int receiptNum, Detail &detail);
+    void prefetch(const QList<int> &receiptNums);
+    void clear();
+
+  private:
+    bool load(const QList<int> &receiptNums, int receiptNum = 0, Detail *detail = 0);
+    static int cost(const Detail &detail);
+
+    QCache<int, Detail> m_cache;
+};
+
+#endif // RECEIPTDETAILCACHE_H
@@ -53,38 +53,7 @@ SalesInfo::~SalesInfo()
 
 void SalesInfo::loadData(QString from, QString to)
 {
-    QSqlDatabase dbc = Database::database();
-    QSqlQuery query(dbc);
-    query.prepare(Database::getSalesPerPaymentSQLQueryString());
-    query.bindValue(":fromDate", from);
-    query.bindValue(":toDate", to);
-
-    query.exec();
-
-    /*
-     * FIXME: We do this workaroud, while SUM and ROUND will
-     * give use the false result. SQL ROUND/SUM give xx.98 from xx.985
-     * should be xx.99
-     */
-
-    QMap<QString, QMap<double, double> > zm;
-    QMap<double, double> map;
-    while (query.next())
-    {
-        QString key = query.value("actionText").toString();
-        QBCMath tax(query.value("tax").toString());
-        tax.round(2);
-        QBCMath total(query.value("total").toString());
-        total.round(2);
-        if ( zm.contains(key) ) {
-            map[tax.toDouble()] += total.toDouble();
-            zm[key] = map;
-        } else {
-            map.clear();
-            map[tax.toDouble()] = total.toDouble();
-            zm[key] = map;
-        }
-    }
+    QMap<QString, QMap<double, double> > zm = Database::getSalesPerPayment(QDateTime::fromString(from, Qt::ISODate), QDateTime::fromString(to, Qt::ISODate));
 
     QMap<QString, QMap<double, double> >::iterator i;
     QStandardItemModel *table_model = new QStandardItemModel(3, zm.size());
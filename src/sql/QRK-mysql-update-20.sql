@@ -0,0 +1,16 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+CREATE TABLE `salesTotals` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `period` varchar(10) NOT NULL,
+  `gross` double NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `salesTotals_period_index` (`period`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT SUBSTR(`timestamp`, 1, 4), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY SUBSTR(`timestamp`, 1, 4);
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
@@ -0,0 +1,16 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+CREATE TABLE `depCheckpoints` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `depId` int(11) NOT NULL,
+  `counter` bigint NOT NULL DEFAULT '0',
+  `hash` varchar(64) NOT NULL,
+  `timestamp` datetime NOT NULL,
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `depCheckpoints_depId_index` (`depId`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
@@ -0,0 +1,9 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT SUBSTR(`timestamp`, 1, 7), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY SUBSTR(`timestamp`, 1, 7);
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT SUBSTR(`timestamp`, 1, 10), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY SUBSTR(`timestamp`, 1, 10);
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
@@ -0,0 +1,28 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+CREATE TABLE `productSales` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `day` varchar(10) NOT NULL,
+  `product` int(11) NOT NULL,
+  `count` double NOT NULL DEFAULT '0',
+  `receipts` int(11) NOT NULL DEFAULT '0',
+  `total` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `productSales_day_index` (`day`, `product`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+CREATE TABLE `hourlySales` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `day` varchar(10) NOT NULL,
+  `hour` int(11) NOT NULL,
+  `count` double NOT NULL DEFAULT '0',
+  `receipts` int(11) NOT NULL DEFAULT '0',
+  `total` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `hourlySales_day_index` (`day`, `hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
@@ -0,0 +1,8 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+ALTER TABLE `journal` ADD KEY `journal_datetime_index` (`datetime`);
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
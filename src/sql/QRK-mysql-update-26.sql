@@ -0,0 +1,9 @@
+SET FOREIGN_KEY_CHECKS=0;
+SET SQL_MODE = "NO_AUTO_VALUE_ON_ZERO";
+START TRANSACTION;
+
+ALTER TABLE `dep` ADD KEY `dep_receiptNum_index` (`receiptNum`);
+ALTER TABLE `customer` ADD KEY `customer_receiptNum_index` (`receiptNum`);
+
+SET FOREIGN_KEY_CHECKS=1;
+COMMIT;
@@ -26,7 +26,8 @@ CREATE TABLE `customer` (
   `id` int(11) NOT NULL AUTO_INCREMENT,
   `receiptNum` int(11) DEFAULT NULL,
   `text` text,
-  PRIMARY KEY (`id`)
+  PRIMARY KEY (`id`),
+  KEY `customer_receiptNum_index` (`receiptNum`)
 ) ENGINE=InnoDB  DEFAULT CHARSET=utf8;
 
 CREATE TABLE `journal` (
@@ -37,16 +38,28 @@ CREATE TABLE `journal` (
   `data` text,
   `checksum` text,
   `userId` int(11) NOT NULL DEFAULT '0',
-  PRIMARY KEY (`id`)
+  PRIMARY KEY (`id`),
+  KEY `journal_datetime_index` (`datetime`)
 ) ENGINE=InnoDB DEFAULT CHARSET=utf8;
 
 CREATE TABLE `dep` (
   `id` int(11) NOT NULL AUTO_INCREMENT,
   `receiptNum` int(11),
   `data` text,
-  PRIMARY KEY (`id`)
+  PRIMARY KEY (`id`),
+  KEY `dep_receiptNum_index` (`receiptNum`)
 ) ENGINE=InnoDB  DEFAULT CHARSET=utf8;
 
+CREATE TABLE `depCheckpoints` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `depId` int(11) NOT NULL,
+  `counter` bigint NOT NULL DEFAULT '0',
+  `hash` varchar(64) NOT NULL,
+  `timestamp` datetime NOT NULL,
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `depCheckpoints_depId_index` (`depId`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
 CREATE TABLE `globals` (
   `id` int(11) NOT NULL AUTO_INCREMENT,
   `name` text NOT NULL,
@@ -129,6 +142,46 @@ CREATE TABLE `reports` (
   KEY `reports_receiptNum_index` (`receiptNum`)
 ) ENGINE=InnoDB  DEFAULT CHARSET=utf8;
 
+CREATE TABLE `salesTotals` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `period` varchar(10) NOT NULL,
+  `gross` double NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `salesTotals_period_index` (`period`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+CREATE TABLE `salesBreakdown` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `day` varchar(10) NOT NULL,
+  `payedBy` int(11) NOT NULL,
+  `tax` double NOT NULL,
+  `total` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `salesBreakdown_day_index` (`day`, `payedBy`, `tax`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+CREATE TABLE `productSales` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `day` varchar(10) NOT NULL,
+  `product` int(11) NOT NULL,
+  `count` double NOT NULL DEFAULT '0',
+  `receipts` int(11) NOT NULL DEFAULT '0',
+  `total` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `productSales_day_index` (`day`, `product`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
+CREATE TABLE `hourlySales` (
+  `id` int(11) NOT NULL AUTO_INCREMENT,
+  `day` varchar(10) NOT NULL,
+  `hour` int(11) NOT NULL,
+  `count` double NOT NULL DEFAULT '0',
+  `receipts` int(11) NOT NULL DEFAULT '0',
+  `total` bigint NOT NULL DEFAULT '0',
+  PRIMARY KEY (`id`),
+  UNIQUE KEY `hourlySales_day_index` (`day`, `hour`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8;
+
 CREATE TABLE `taxTypes` (
   `id` int(11) NOT NULL AUTO_INCREMENT,
   `tax` double DEFAULT NULL,
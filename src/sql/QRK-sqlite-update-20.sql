@@ -0,0 +1,13 @@
+BEGIN TRANSACTION;
+
+CREATE TABLE `salesTotals` (
+    `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    `period`	text NOT NULL,
+    `gross`	double NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `salesTotals_period_index` ON `salesTotals` (`period`);
+
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT substr(`timestamp`, 1, 4), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY substr(`timestamp`, 1, 4);
+
+COMMIT;
@@ -0,0 +1,13 @@
+BEGIN TRANSACTION;
+
+CREATE TABLE `depCheckpoints` (
+    `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    `depId`	INTEGER NOT NULL,
+    `counter`	INTEGER NOT NULL DEFAULT '0',
+    `hash`	text NOT NULL,
+    `timestamp`	datetime NOT NULL
+);
+
+CREATE UNIQUE INDEX `depCheckpoints_depId_index` ON `depCheckpoints` (`depId`);
+
+COMMIT;
@@ -0,0 +1,6 @@
+BEGIN TRANSACTION;
+
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT substr(`timestamp`, 1, 7), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY substr(`timestamp`, 1, 7);
+INSERT INTO `salesTotals` (`period`, `gross`) SELECT substr(`timestamp`, 1, 10), SUM(`gross`) FROM `receipts` WHERE `payedBy` < 3 GROUP BY substr(`timestamp`, 1, 10);
+
+COMMIT;
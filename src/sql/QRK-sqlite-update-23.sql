@@ -0,0 +1,13 @@
+BEGIN TRANSACTION;
+
+CREATE TABLE `salesBreakdown` (
+    `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    `day`	text NOT NULL,
+    `payedBy`	INTEGER NOT NULL,
+    `tax`	double NOT NULL,
+    `total`	INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `salesBreakdown_day_index` ON `salesBreakdown` (`day`, `payedBy`, `tax`);
+
+COMMIT;
@@ -0,0 +1,25 @@
+BEGIN TRANSACTION;
+
+CREATE TABLE `productSales` (
+    `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    `day`	text NOT NULL,
+    `product`	INTEGER NOT NULL,
+    `count`	double NOT NULL DEFAULT '0',
+    `receipts`	INTEGER NOT NULL DEFAULT '0',
+    `total`	INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `productSales_day_index` ON `productSales` (`day`, `product`);
+
+CREATE TABLE `hourlySales` (
+    `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+    `day`	text NOT NULL,
+    `hour`	INTEGER NOT NULL,
+    `count`	double NOT NULL DEFAULT '0',
+    `receipts`	INTEGER NOT NULL DEFAULT '0',
+    `total`	INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `hourlySales_day_index` ON `hourlySales` (`day`, `hour`);
+
+COMMIT;
@@ -0,0 +1,5 @@
+BEGIN TRANSACTION;
+
+CREATE INDEX `journal_datetime_index` ON `journal` (`datetime`);
+
+COMMIT;
@@ -0,0 +1,6 @@
+BEGIN TRANSACTION;
+
+CREATE INDEX `dep_receiptNum_index` ON `dep` (`receiptNum`);
+CREATE INDEX `customer_receiptNum_index` ON `customer` (`receiptNum`);
+
+COMMIT;
@@ -113,6 +113,8 @@ CREATE TABLE `customer` (
     `text`              text
 );
 
+CREATE INDEX `customer_receiptNum_index` ON `customer` (`receiptNum`);
+
 CREATE TABLE `journal` (
     `id`                INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
     `version`           text NOT NULL,
@@ -123,12 +125,26 @@ CREATE TABLE `journal` (
     `userId`            INTEGER NOT NULL DEFAULT '0'
 );
 
+CREATE INDEX `journal_datetime_index` ON `journal` (`datetime`);
+
 CREATE TABLE `dep` (
         `id`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
         `receiptNum`	INTEGER,
         `data`	text
 );
 
+CREATE INDEX `dep_receiptNum_index` ON `dep` (`receiptNum`);
+
+CREATE TABLE `depCheckpoints` (
+        `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+        `depId`         INTEGER NOT NULL,
+        `counter`	INTEGER NOT NULL DEFAULT '0',
+        `hash`          text NOT NULL,
+        `timestamp`	datetime NOT NULL
+);
+
+CREATE UNIQUE INDEX `depCheckpoints_depId_index` ON `depCheckpoints` (`depId`);
+
 CREATE TABLE `reports` (
         `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
         `receiptNum`	INTEGER,
@@ -138,6 +154,46 @@ CREATE TABLE `reports` (
 
 CREATE INDEX `reports_receiptNum_index` ON `reports` (`receiptNum`);
 
+CREATE TABLE `salesTotals` (
+        `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+        `period`	text NOT NULL,
+        `gross`         double NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `salesTotals_period_index` ON `salesTotals` (`period`);
+
+CREATE TABLE `salesBreakdown` (
+        `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+        `day`           text NOT NULL,
+        `payedBy`	INTEGER NOT NULL,
+        `tax`           double NOT NULL,
+        `total`         INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `salesBreakdown_day_index` ON `salesBreakdown` (`day`, `payedBy`, `tax`);
+
+CREATE TABLE `productSales` (
+        `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+        `day`           text NOT NULL,
+        `product`       INTEGER NOT NULL,
+        `count`         double NOT NULL DEFAULT '0',
+        `receipts`      INTEGER NOT NULL DEFAULT '0',
+        `total`         INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `productSales_day_index` ON `productSales` (`day`, `product`);
+
+CREATE TABLE `hourlySales` (
+        `id`            INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
+        `day`           text NOT NULL,
+        `hour`          INTEGER NOT NULL,
+        `count`         double NOT NULL DEFAULT '0',
+        `receipts`      INTEGER NOT NULL DEFAULT '0',
+        `total`         INTEGER NOT NULL DEFAULT '0'
+);
+
+CREATE UNIQUE INDEX `hourlySales_day_index` ON `hourlySales` (`day`, `hour`);
+
 CREATE TABLE `permissions` (
         `ID`	INTEGER NOT NULL PRIMARY KEY AUTOINCREMENT,
         `permKey`	TEXT NOT NULL,
@@ -59,6 +59,7 @@ SOURCES += main.cpp \
     r2bdialog.cpp \
     qrkhome.cpp \
     qrkdocument.cpp \
+    receiptdetailcache.cpp \
     qrkregister.cpp \
     aboutdlg.cpp \
     givendialog.cpp \
@@ -73,6 +74,7 @@ SOURCES += main.cpp \
     import/csvimportwizardpage1.cpp \
     import/csvimportwizardpage2.cpp \
     import/csvimportwizardpage3.cpp \
+    import/csvreader.cpp \
     export/exportdialog.cpp \
     export/exportdep.cpp \
     import/importworker.cpp \
@@ -82,6 +84,7 @@ SOURCES += main.cpp \
     foninfo.cpp \
     preferences/settingsdialog.cpp \
     salesinfo.cpp \
+    metricsdialog.cpp \
     preferences/textedit.cpp \
     horizontalscrollarea.cpp \
     barcodefinder.cpp \
@@ -93,6 +96,7 @@ HEADERS  += \
     qrkdelegate.h \
     r2bdialog.h \
     qrkdocument.h \
+    receiptdetailcache.h \
     qrkhome.h \
     qrkregister.h \
     aboutdlg.h \
@@ -110,6 +114,7 @@ HEADERS  += \
     import/csvimportwizardpage1.h \
     import/csvimportwizardpage2.h \
     import/csvimportwizardpage3.h \
+    import/csvreader.h \
     export/exportdialog.h \
     export/exportdep.h \
     import/importworker.h \
@@ -117,6 +122,7 @@ HEADERS  += \
     foninfo.h \
     preferences/settingsdialog.h \
     salesinfo.h \
+    metricsdialog.h \
     preferences/textedit.h \
     horizontalscrollarea.h \
     barcodefinder.h \